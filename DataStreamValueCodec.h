@@ -0,0 +1,34 @@
+#ifndef DATASTREAMVALUECODEC_H
+#define DATASTREAMVALUECODEC_H
+
+#include <QDataStream>
+#include <iostream>
+#include "TextValueCodec.h"
+
+class DataStreamValueCodec : public TextValueCodec
+{
+public:
+
+    /** Constructor. If the transport is not binary-safe, encoded values are armoured as base64 text. */
+    explicit DataStreamValueCodec(bool binarySafe = true);
+
+    QString name() const;
+    QByteArray encode(const QVariant& value) const;
+    QVariant decode(const QVariant& data, int type = QMetaType::UnknownType) const;
+
+private:
+
+    /** Prefix of values stored as raw QDataStream bytes. Its first byte never occurs in UTF-8 text. */
+    static const char* const BinaryMarker;
+
+    /** Prefix of values stored as base64-armoured QDataStream bytes. */
+    static const char* const ArmouredMarker;
+
+    /** QDataStream format version used for every value, so that clients built against different Qt versions interoperate. */
+    static const int StreamVersion = QDataStream::Qt_5_6;
+
+    /** Whether the transport can carry arbitrary bytes. */
+    bool _binarySafe;
+};
+
+#endif // DATASTREAMVALUECODEC_H
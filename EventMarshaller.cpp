@@ -0,0 +1,147 @@
+#include "EventMarshaller.h"
+
+/*!
+    \class EventMarshaller
+    \inmodule RedisInterface
+    \brief Converts between the arguments of an event and the parameters of the signal or method bound to it.
+
+    A marshaller is created once per bound signal or method, when it is bound, and resolves everything that depends only on its
+    signature: the metatype of every parameter, and whether the first parameter receives the channel name. Marshalling an emission or
+    a received event then involves no signature parsing or name lookups.
+
+    On the publishing side, pack() copies the arguments of a signal emission into a \l{QVariantList}, which the RedisInterface encodes
+    (with its ValueCodec) as the event's payload. On the subscribing side, invoke() calls the bound method with the decoded arguments,
+    each converted to the type of its parameter. Missing arguments are passed as default-constructed values, and extra arguments are
+    ignored, so a slot may take fewer parameters than the signal that triggers it.
+
+    A first parameter of type \l{QString} or \l{QVariant} named \c{channel} receives the name of the channel the event arrived on
+    instead (eg. \c{handleReading(QString channel, double value)}), as does an unnamed sole parameter of either type, for
+    compatibility with bindings made before events carried arguments.
+
+    \sa RedisInterface::subscribeToEvent(), RedisInterface::publishEvent()
+*/
+
+/*!
+ * \brief Constructor. Creates an invalid marshaller.
+ */
+EventMarshaller::EventMarshaller() :
+    _takesChannel(false),
+    _valid(false)
+{
+}
+
+/*!
+ * \brief Constructor. Resolves the parameter types of \a{method}, and whether its first parameter receives the channel name.
+ */
+EventMarshaller::EventMarshaller(const QMetaMethod &method) :
+    _method(method),
+    _takesChannel(false),
+    _valid(method.isValid() && method.parameterCount() <= MaxParameters)
+{
+    for(int i = 0; i < method.parameterCount(); ++i)
+    {
+        _types.append(method.parameterType(i));
+
+        if(_types.last() == QMetaType::UnknownType)
+            _valid = false;
+    }
+
+    if(!_types.isEmpty() && (_types.first() == QMetaType::QString || _types.first() == QMetaType::QVariant))
+    {
+        QByteArray name = method.parameterNames().first();
+        _takesChannel = (name == "channel") || (_types.size() == 1 && name.isEmpty());
+    }
+}
+
+/*!
+ * \brief Returns true if arguments can be marshalled for the method: every parameter has a type known to \l{QMetaType}, and there are
+ * no more than \c{MaxParameters} of them.
+ */
+bool EventMarshaller::isValid() const
+{
+    return _valid;
+}
+
+/*!
+ * \brief Returns the signal or method.
+ */
+QMetaMethod EventMarshaller::method() const
+{
+    return _method;
+}
+
+/*!
+ * \brief Returns true if the method's first parameter receives the name of the channel the event arrived on.
+ */
+bool EventMarshaller::takesChannel() const
+{
+    return _takesChannel;
+}
+
+/*!
+ * \brief Returns the number of event arguments the method takes, excluding any channel name.
+ */
+int EventMarshaller::argumentCount() const
+{
+    return _types.size() - (_takesChannel ? 1 : 0);
+}
+
+/*!
+ * \brief Copies the \a{arguments} of a signal emission into a list. \a{arguments} is the array passed to \c{qt_metacall()}: the return
+ * value, followed by a pointer to each argument.
+ */
+QVariantList EventMarshaller::pack(void **arguments) const
+{
+    QVariantList values;
+    values.reserve(_types.size());
+
+    for(int i = 0; i < _types.size(); ++i)
+    {
+        if(_types.at(i) == QMetaType::QVariant)
+            values.append(*static_cast<const QVariant*>(arguments[i + 1]));
+        else
+            values.append(QVariant(_types.at(i), arguments[i + 1]));
+    }
+
+    return values;
+}
+
+/*!
+ * \brief Invokes the method on \a{object} (directly), passing \a{channel} as its first parameter if it takes the channel name, and
+ * \a{arguments} as its remaining parameters. Each argument is converted to the type of its parameter; missing or inconvertible
+ * arguments are passed as default-constructed values. Returns false if the method could not be invoked.
+ */
+bool EventMarshaller::invoke(QObject *object, const QString &channel, const QVariantList &arguments) const
+{
+    if(!_valid)
+        return false;
+
+    if(_types.isEmpty())
+        return _method.invoke(object, Qt::DirectConnection);
+
+    QVariant values[MaxParameters];
+    QGenericArgument parameters[MaxParameters];
+
+    int firstArgument = _takesChannel ? 1 : 0;
+
+    for(int i = 0; i < _types.size(); ++i)
+    {
+        int type = _types.at(i);
+        values[i] = (i < firstArgument) ? QVariant(channel) : arguments.value(i - firstArgument);
+
+        if(type == QMetaType::QVariant)
+        {
+            // The parameter is the variant itself.
+            parameters[i] = QGenericArgument("QVariant", &values[i]);
+            continue;
+        }
+
+        if(values[i].userType() != type && !values[i].convert(type))
+            values[i] = QVariant(type, static_cast<const void*>(NULL));
+
+        parameters[i] = QGenericArgument(QMetaType::typeName(type), values[i].constData());
+    }
+
+    return _method.invoke(object, Qt::DirectConnection, parameters[0], parameters[1], parameters[2], parameters[3], parameters[4],
+                          parameters[5], parameters[6], parameters[7], parameters[8], parameters[9]);
+}
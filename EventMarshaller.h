@@ -0,0 +1,56 @@
+#ifndef EVENTMARSHALLER_H
+#define EVENTMARSHALLER_H
+
+#include <QMetaMethod>
+#include <QVariant>
+#include <QVariantList>
+#include <QVector>
+#include <QString>
+
+class EventMarshaller
+{
+public:
+
+    /** Maximum number of parameters a marshalled method may have (the limit of QMetaMethod::invoke()). */
+    static const int MaxParameters = 10;
+
+    /** Constructor. Creates an invalid marshaller. */
+    EventMarshaller();
+
+    /** Constructor. Precomputes the marshalling of arguments to/from the parameters of the given signal or method. */
+    explicit EventMarshaller(const QMetaMethod& method);
+
+    /** Returns true if arguments can be marshalled for the method (every parameter has a known type, and there are few enough). */
+    bool isValid() const;
+
+    /** Returns the method. */
+    QMetaMethod method() const;
+
+    /** Returns true if the method's first parameter receives the channel name rather than an event argument. */
+    bool takesChannel() const;
+
+    /** Returns the number of event arguments the method takes (excluding any channel name). */
+    int argumentCount() const;
+
+    /** Copies the raw arguments of a signal emission (as passed to qt_metacall(), with the return value first) into a list. */
+    QVariantList pack(void** arguments) const;
+
+    /** Invokes the method on the given object, passing the channel name (if taken) and the given arguments converted to its parameter types. */
+    bool invoke(QObject* object, const QString& channel, const QVariantList& arguments) const;
+
+private:
+
+    /** The signal or method. */
+    QMetaMethod _method;
+
+    /** Type of each parameter. */
+    QVector<int> _types;
+
+    /** Whether the first parameter receives the channel name. */
+    bool _takesChannel;
+
+    /** Whether every parameter has a known type. */
+    bool _valid;
+};
+
+#endif // EVENTMARSHALLER_H
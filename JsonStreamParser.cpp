@@ -0,0 +1,104 @@
+#include "JsonStreamParser.h"
+
+/*!
+    \class JsonStreamParser
+    \inmodule RedisInterface
+    \brief An incremental framer for a stream of concatenated JSON documents, as sent by webdis on a subscription.
+
+    Webdis writes one JSON document per pub/sub message to a long-lived HTTP response, but the boundaries of those documents are not
+    preserved by the time the data reaches a \l{QNetworkReply}: one read may hold several documents, or only part of one. This parser
+    tracks object/array nesting (ignoring brackets inside string literals) across reads, and hands out each complete top-level document as
+    a view into its buffer.
+
+    Scanning resumes where the previous read left off, so every byte is examined exactly once regardless of how the stream is split.
+
+    \sa WebdisTransport, StreamParser
+*/
+
+/*!
+ * \brief Constructor.
+ */
+JsonStreamParser::JsonStreamParser() :
+    StreamParser(),
+    _scanned(0),
+    _depth(0),
+    _inString(false),
+    _escaped(false)
+{
+}
+
+/*!
+ * \brief Extracts the next complete top-level JSON document into \a{document}, as a view into the buffer that remains valid until more
+ * data is read into the parser. Returns false if no complete document is buffered yet.
+ */
+bool JsonStreamParser::nextDocument(QByteArray &document)
+{
+    const char* data = _buffer.constData();
+    int size = _buffer.size();
+
+    for(int i = _position + _scanned; i < size; ++i)
+    {
+        char c = data[i];
+
+        if(_inString)
+        {
+            if(_escaped)
+                _escaped = false;
+            else if(c == '\\')
+                _escaped = true;
+            else if(c == '"')
+                _inString = false;
+
+            continue;
+        }
+
+        switch(c)
+        {
+        case '"':
+            if(_depth > 0)
+                _inString = true;
+            break;
+
+        case '{':
+        case '[':
+            // Skip any whitespace/separators between documents.
+            if(_depth == 0)
+                _position = i;
+
+            ++_depth;
+            break;
+
+        case '}':
+        case ']':
+            if(_depth > 0 && --_depth == 0)
+            {
+                document = QByteArray::fromRawData(data + _position, i + 1 - _position);
+                _position = i + 1;
+                _scanned = 0;
+                return true;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    // Nothing outside a document is worth keeping.
+    if(_depth == 0)
+        _position = size;
+
+    _scanned = size - _position;
+    return false;
+}
+
+/*!
+ * \brief Resets the scan state when the buffer is cleared.
+ */
+void JsonStreamParser::resetState()
+{
+    _scanned = 0;
+    _depth = 0;
+    _inString = false;
+    _escaped = false;
+}
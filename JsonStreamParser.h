@@ -0,0 +1,33 @@
+#ifndef JSONSTREAMPARSER_H
+#define JSONSTREAMPARSER_H
+
+#include "StreamParser.h"
+
+class JsonStreamParser : public StreamParser
+{
+public:
+
+    /** Constructor. */
+    JsonStreamParser();
+
+    /** Extracts the next complete top-level JSON document as a view into the buffer. Returns false if none is complete yet. */
+    bool nextDocument(QByteArray& document);
+
+protected:
+
+    void resetState();
+
+private:
+
+    /** Number of unconsumed bytes already scanned for the end of the current document. */
+    int _scanned;
+
+    /** Nesting depth of objects/arrays at the scan position. */
+    int _depth;
+
+    /** Whether the scan position is inside a string literal, and whether the previous character was a backslash within it. */
+    bool _inString;
+    bool _escaped;
+};
+
+#endif // JSONSTREAMPARSER_H
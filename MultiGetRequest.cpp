@@ -0,0 +1,155 @@
+#include "MultiGetRequest.h"
+
+/*!
+    \class MultiGetRequest
+    \inmodule RedisInterface
+    \brief Gathers the results of a multi-key read issued as several \c{MGET} chunks.
+
+    RedisInterface splits a large multi-key read into \c{MGET}s of bounded size, which are queued together and therefore sent in the same
+    batch (pipelined on a native connection, or as a single request to webdis). A MultiGetRequest collects the chunk replies as they
+    arrive, maps each value back to its key, and emits \c{finished()} once the last chunk has completed, so the caller sees a single
+    key-to-value map regardless of how many chunks were needed.
+
+    \sa RedisInterface
+*/
+
+/*!
+ * \brief Constructor. Values fetched from the server are decoded with \a{codec}.
+ */
+MultiGetRequest::MultiGetRequest(QSharedPointer<ValueCodec> codec, QObject *parent) :
+    QObject(parent),
+    _codec(codec),
+    _cacheEpoch(0),
+    _cacheable(false),
+    _finished(false)
+{
+}
+
+/*!
+ * \brief Records \a{value} for \a{key} without requesting it from the server.
+ */
+void MultiGetRequest::setValue(const QString &key, const QVariant &value)
+{
+    _knownValues.insert(key, value);
+}
+
+/*!
+ * \brief Adds the pending \c{MGET} \a{reply} for \a{keys}, in the order they were requested. The request takes ownership of the reply.
+ */
+void MultiGetRequest::addChunk(RedisReply *reply, const QStringList &keys)
+{
+    reply->setParent(this);
+    _pendingChunks.insert(reply, keys);
+    connect(reply, SIGNAL(finished()), this, SLOT(handleChunkFinished()));
+}
+
+/*!
+ * \brief Starts waiting for the chunks. If there are none (every key was already known), \c{finished()} is emitted from the event loop.
+ */
+void MultiGetRequest::start()
+{
+    if(_pendingChunks.isEmpty())
+        QMetaObject::invokeMethod(this, "checkFinished", Qt::QueuedConnection);
+}
+
+/*!
+ * \brief Returns the value of every requested key. Keys that do not exist have invalid values.
+ */
+QVariantMap MultiGetRequest::values() const
+{
+    QVariantMap values = _fetchedValues;
+
+    for(QVariantMap::const_iterator iter = _knownValues.constBegin(); iter != _knownValues.constEnd(); ++iter)
+        values.insert(iter.key(), iter.value());
+
+    return values;
+}
+
+/*!
+ * \brief Returns only the values received from the server.
+ */
+QVariantMap MultiGetRequest::fetchedValues() const
+{
+    return _fetchedValues;
+}
+
+/*!
+ * \brief Returns true if any chunk failed.
+ */
+bool MultiGetRequest::isError() const
+{
+    return !_errorString.isEmpty();
+}
+
+/*!
+ * \brief Returns the error reported by the first chunk to fail.
+ */
+QString MultiGetRequest::errorString() const
+{
+    return _errorString;
+}
+
+/*!
+ * \brief Returns true if a read cache epoch was recorded with setCacheEpoch(), ie. the results may be cached.
+ */
+bool MultiGetRequest::isCacheable() const
+{
+    return _cacheable;
+}
+
+/*!
+ * \brief Returns the read cache epoch recorded with setCacheEpoch().
+ */
+quint64 MultiGetRequest::cacheEpoch() const
+{
+    return _cacheEpoch;
+}
+
+/*!
+ * \brief Records the read cache \a{epoch} at the time the chunks were sent, marking the results as cacheable.
+ */
+void MultiGetRequest::setCacheEpoch(quint64 epoch)
+{
+    _cacheEpoch = epoch;
+    _cacheable = true;
+}
+
+/*!
+ * \brief Maps the values in a completed chunk reply back to their keys.
+ */
+void MultiGetRequest::handleChunkFinished()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL || !_pendingChunks.contains(reply))
+        return;
+
+    QStringList keys = _pendingChunks.take(reply);
+    reply->deleteLater();
+
+    if(reply->isError())
+    {
+        if(_errorString.isEmpty())
+            _errorString = reply->errorString();
+    }
+    else
+    {
+        QVariantList chunkValues = reply->value().toList();
+
+        for(int i = 0; i < keys.size(); ++i)
+            _fetchedValues.insert(keys.at(i), i < chunkValues.size() ? _codec->decodePayload(chunkValues.at(i)) : QVariant());
+    }
+
+    checkFinished();
+}
+
+/*!
+ * \brief Emits \c{finished()} (once) when no chunks remain.
+ */
+void MultiGetRequest::checkFinished()
+{
+    if(_pendingChunks.isEmpty() && !_finished)
+    {
+        _finished = true;
+        emit finished();
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef MULTIGETREQUEST_H
+#define MULTIGETREQUEST_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+#include <QHash>
+#include <QPointer>
+#include <QSharedPointer>
+#include "RedisReply.h"
+#include "ValueCodec.h"
+
+class MultiGetRequest : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. Fetched values are decoded with the given codec. */
+    explicit MultiGetRequest(QSharedPointer<ValueCodec> codec, QObject* parent = 0);
+
+    /** Records a value already known without a request (eg. from the read cache). */
+    void setValue(const QString& key, const QVariant& value);
+
+    /** Adds a pending MGET reply for the given keys. The request takes ownership of the reply. */
+    void addChunk(RedisReply* reply, const QStringList& keys);
+
+    /** Emits finished() once every chunk has completed (from the event loop, if there are no chunks at all). */
+    void start();
+
+    /** Returns the values of every key, fetched or otherwise. */
+    QVariantMap values() const;
+
+    /** Returns only the values fetched from the server. */
+    QVariantMap fetchedValues() const;
+
+    /** Returns true if any chunk failed. */
+    bool isError() const;
+    QString errorString() const;
+
+    /** Read cache epoch when the request was sent, if its results may be cached (used by the owner to decide whether to cache them). */
+    bool isCacheable() const;
+    quint64 cacheEpoch() const;
+    void setCacheEpoch(quint64 epoch);
+
+signals:
+
+    /** Emitted once all chunks have completed. */
+    void finished();
+
+private slots:
+
+    /** Private handler slot for chunk replies. */
+    void handleChunkFinished();
+
+    /** Emits finished() if no chunks remain. */
+    void checkFinished();
+
+private:
+
+    /** Codec used to decode fetched values. */
+    QSharedPointer<ValueCodec> _codec;
+
+    /** Values known before the request was sent. */
+    QVariantMap _knownValues;
+
+    /** Values received from the server. */
+    QVariantMap _fetchedValues;
+
+    /** Keys requested by each pending chunk. */
+    QHash<RedisReply*, QStringList> _pendingChunks;
+
+    /** Description of the first chunk error, if any. */
+    QString _errorString;
+
+    /** Read cache epoch at the time of sending, and whether one was recorded. */
+    quint64 _cacheEpoch;
+    bool _cacheable;
+
+    /** Whether finished() has been emitted. */
+    bool _finished;
+};
+
+#endif // MULTIGETREQUEST_H
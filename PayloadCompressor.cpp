@@ -0,0 +1,247 @@
+#include "PayloadCompressor.h"
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <cctype>
+#include <iostream>
+
+/*!
+    \class PayloadCompressor
+    \inmodule RedisInterface
+    \brief Compresses large encoded payloads with zlib (\l{qCompress()}), and inflates compressed payloads received from Redis.
+
+    Large values (eg. multi-kilobyte JSON documents) are sent in full with every write, and again with every change notification, to
+    every subscriber. Where bandwidth is scarce, a binding can opt in to compression (see RedisInterface::publishProperty()): payloads of
+    at least its threshold are compressed after encoding, and sent compressed unless that fails to make them smaller.
+
+    Compressed payloads begin with a marker, so readers detect them whatever their own settings. On a binary-safe transport (the native
+    protocol), the marker \c{"\\xFFQZ"} is followed by the 32-bit big-endian size of the compressed data, then the data itself: the
+    output of \l{qCompress()}, ie. the 32-bit big-endian size of the original payload followed by a zlib stream. Webdis relays values as
+    JSON strings, so on webdis the \l{qCompress()} output is armoured as base64 behind the marker \c{"\\x1BQZ:"} instead. Either way, any
+    bytes following the compressed data are kept after the inflated payload.
+
+    Payloads are inflated as they are decoded (see ValueCodec::decodePayload()), before the value codec sees them, so compression works
+    with every codec. The transports themselves deliver compressed payloads untouched, so both transports share the same behaviour;
+    with a ThreadedTransport, the TransportWorker inflates replies and messages on the transport's thread instead, and decoding then
+    finds nothing left to inflate.
+
+    \sa RedisInterface, ValueCodec
+*/
+
+const char* const PayloadCompressor::BinaryMarker = "\xFFQZ";
+const char* const PayloadCompressor::ArmouredMarker = "\x1BQZ:";
+
+QAtomicInteger<qint64> PayloadCompressor::_inflated(0);
+QAtomicInteger<qint64> PayloadCompressor::_inflatedBytesIn(0);
+QAtomicInteger<qint64> PayloadCompressor::_inflatedBytesOut(0);
+QAtomicInteger<qint64> PayloadCompressor::_inflateNsecs(0);
+
+/*!
+ * \brief Constructor. \a{binarySafe} selects between the raw and base64-armoured forms.
+ */
+PayloadCompressor::PayloadCompressor(bool binarySafe) :
+    _binarySafe(binarySafe),
+    _compressed(0),
+    _incompressible(0),
+    _bytesIn(0),
+    _bytesOut(0),
+    _compressNsecs(0)
+{
+}
+
+/*!
+ * \brief Returns \a{payload} compressed behind the appropriate marker, if it is at least \a{threshold} bytes long and compressing it
+ * makes it smaller. Otherwise, returns \a{payload} unchanged. A \a{threshold} of 0 or less disables compression.
+ */
+QByteArray PayloadCompressor::compress(const QByteArray &payload, int threshold)
+{
+    if(threshold <= 0 || payload.size() < threshold)
+        return payload;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QByteArray data = qCompress(payload, CompressionLevel);
+    QByteArray compressed;
+
+    if(_binarySafe)
+    {
+        uchar size[4];
+        qToBigEndian<quint32>(quint32(data.size()), size);
+        compressed = BinaryMarker + QByteArray(reinterpret_cast<const char*>(size), 4) + data;
+    }
+    else
+    {
+        compressed = ArmouredMarker + data.toBase64();
+    }
+
+    _compressNsecs += timer.nsecsElapsed();
+
+    if(compressed.size() >= payload.size())
+    {
+        ++_incompressible;
+        return payload;
+    }
+
+    ++_compressed;
+    _bytesIn += payload.size();
+    _bytesOut += compressed.size();
+
+    return compressed;
+}
+
+/*!
+ * \brief Returns true if \a{payload} begins with either compression marker.
+ */
+bool PayloadCompressor::isCompressed(const QByteArray &payload)
+{
+    return payload.startsWith(BinaryMarker) || payload.startsWith(ArmouredMarker);
+}
+
+/*!
+ * \brief Returns the inflated contents of the compressed \a{payload}, followed by any bytes appended after the compressed data.
+ * Returns \a{payload} unchanged if it is not compressed, or if it is corrupt (which is reported).
+ */
+QByteArray PayloadCompressor::inflate(const QByteArray &payload)
+{
+    if(payload.startsWith(BinaryMarker))
+    {
+        const int headerSize = int(qstrlen(BinaryMarker)) + 4;
+
+        if(payload.size() >= headerSize)
+        {
+            int size = int(qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(payload.constData() + headerSize - 4)));
+
+            if(size >= 0 && size <= payload.size() - headerSize)
+            {
+                QByteArray inflated = uncompress(payload.mid(headerSize, size));
+
+                if(!inflated.isNull())
+                    return inflated + payload.mid(headerSize + size);
+            }
+        }
+    }
+    else if(payload.startsWith(ArmouredMarker))
+    {
+        const int start = int(qstrlen(ArmouredMarker));
+        int end = start;
+
+        // The base64 text ends at the first byte that cannot be part of it.
+        while(end < payload.size() && (isalnum(uchar(payload.at(end))) || payload.at(end) == '+' || payload.at(end) == '/' || payload.at(end) == '='))
+            ++end;
+
+        QByteArray inflated = uncompress(QByteArray::fromBase64(payload.mid(start, end - start)));
+
+        if(!inflated.isNull())
+            return inflated + payload.mid(end);
+    }
+    else
+    {
+        return payload;
+    }
+
+    std::cerr << "[PayloadCompressor] inflate(): Corrupt compressed payload of " << payload.size() << " bytes!" << std::endl;
+    return payload;
+}
+
+/*!
+ * \brief Returns \a{value} with every compressed string in it inflated, descending into lists and maps. Inflated payloads beginning
+ * with a \c{0xFF} byte (ie. binary data, see RespParser::bulkValue()) are returned as \l{QByteArray}s, and others as \l{QString}s,
+ * just as the transports would have delivered them uncompressed.
+ */
+QVariant PayloadCompressor::inflateAll(const QVariant &value)
+{
+    switch(value.userType())
+    {
+    case QMetaType::QString:
+    {
+        QString text = value.toString();
+        if(!text.startsWith(QLatin1String(ArmouredMarker)))
+            return value;
+
+        QByteArray inflated = inflate(text.toUtf8());
+        if(inflated.startsWith('\xFF'))
+            return inflated;
+
+        return QString::fromUtf8(inflated);
+    }
+
+    case QMetaType::QByteArray:
+    {
+        QByteArray bytes = value.toByteArray();
+        if(!isCompressed(bytes))
+            return value;
+
+        QByteArray inflated = inflate(bytes);
+        if(inflated.startsWith('\xFF'))
+            return inflated;
+
+        return QString::fromUtf8(inflated);
+    }
+
+    case QMetaType::QVariantList:
+    {
+        QVariantList list = value.toList();
+        for(int i = 0; i < list.size(); ++i)
+            list[i] = inflateAll(list.at(i));
+
+        return list;
+    }
+
+    case QMetaType::QVariantMap:
+    {
+        QVariantMap map = value.toMap();
+        for(QVariantMap::iterator iter = map.begin(); iter != map.end(); ++iter)
+            iter.value() = inflateAll(iter.value());
+
+        return map;
+    }
+
+    default:
+        return value;
+    }
+}
+
+/*!
+ * \brief Returns counters describing the payloads compressed by this compressor: \c{compressed} payloads, \c{incompressible} payloads
+ * (sent uncompressed, since compression did not make them smaller), the \c{bytesIn} and \c{bytesOut} of the compressed payloads, their
+ * compression \c{ratio} (bytesOut / bytesIn), and the CPU time spent compressing (\c{compressMsecs}). The number of payloads
+ * \c{inflated}, their \c{inflatedBytesIn} and \c{inflatedBytesOut}, and the time spent inflating them (\c{inflateMsecs}) are counted
+ * across the whole process, since payloads are inflated by whichever codec decodes them (see ValueCodec::decodePayload()).
+ */
+QVariantMap PayloadCompressor::statistics() const
+{
+    QVariantMap statistics;
+    statistics.insert("compressed", _compressed);
+    statistics.insert("incompressible", _incompressible);
+    statistics.insert("bytesIn", _bytesIn);
+    statistics.insert("bytesOut", _bytesOut);
+    statistics.insert("ratio", _bytesIn > 0 ? double(_bytesOut) / double(_bytesIn) : 1.0);
+    statistics.insert("compressMsecs", double(_compressNsecs) / 1000000.0);
+    statistics.insert("inflated", qint64(_inflated.load()));
+    statistics.insert("inflatedBytesIn", qint64(_inflatedBytesIn.load()));
+    statistics.insert("inflatedBytesOut", qint64(_inflatedBytesOut.load()));
+    statistics.insert("inflateMsecs", double(_inflateNsecs.load()) / 1000000.0);
+    return statistics;
+}
+
+/*!
+ * \brief Returns the inflated bytes of \a{data} (the output of \l{qCompress()}), or a null array if it is corrupt. Counts the
+ * inflation in the process-wide statistics.
+ */
+QByteArray PayloadCompressor::uncompress(const QByteArray &data)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QByteArray inflated = qUncompress(data);
+
+    if(inflated.isNull())
+        return inflated;
+
+    _inflated.fetchAndAddRelaxed(1);
+    _inflatedBytesIn.fetchAndAddRelaxed(data.size());
+    _inflatedBytesOut.fetchAndAddRelaxed(inflated.size());
+    _inflateNsecs.fetchAndAddRelaxed(timer.nsecsElapsed());
+
+    return inflated;
+}
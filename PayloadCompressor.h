@@ -0,0 +1,71 @@
+#ifndef PAYLOADCOMPRESSOR_H
+#define PAYLOADCOMPRESSOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+#include <QVariantMap>
+#include <QAtomicInteger>
+
+class PayloadCompressor
+{
+public:
+
+    /** Constructor. If the transport is not binary-safe, compressed payloads are armoured as base64 text. */
+    explicit PayloadCompressor(bool binarySafe = true);
+
+    /** Returns the given encoded payload compressed behind a marker if it is at least the given number of bytes long (0 never
+     *  compresses) and compression makes it smaller, otherwise returning it unchanged. */
+    QByteArray compress(const QByteArray& payload, int threshold);
+
+    /** Returns the contents of a compressed payload received from the transport (followed by any bytes appended after it), or the
+     *  payload unchanged if it is not compressed. Thread-safe. */
+    static QByteArray inflate(const QByteArray& payload);
+
+    /** Returns the given value received from the transport with every compressed string in it (including those nested in lists and
+     *  maps) inflated. Inflated text is returned as a QString, and inflated binary data as a QByteArray. Thread-safe. */
+    static QVariant inflateAll(const QVariant& value);
+
+    /** Returns true if the given payload begins with a compression marker. */
+    static bool isCompressed(const QByteArray& payload);
+
+    /** Returns counters describing the payloads compressed by this compressor (compressed, incompressible, bytesIn, bytesOut, ratio,
+     *  compressMsecs), and those inflated by the whole process (inflated, inflatedBytesIn, inflatedBytesOut, inflateMsecs). */
+    QVariantMap statistics() const;
+
+    /** Threshold used by bindings opting in to compression without giving their own. */
+    static const int DefaultThreshold = 1024;
+
+    /** zlib compression level (zlib's own default balance between speed and ratio). */
+    static const int CompressionLevel = 6;
+
+private:
+
+    /** Returns the inflated bytes of the given qCompress() output, or a null array if it is corrupt, counting it in the statistics. */
+    static QByteArray uncompress(const QByteArray& data);
+
+    /** Prefix of payloads compressed as raw bytes (followed by the 32-bit big-endian size of the compressed data). Its first byte never
+     *  occurs in UTF-8 text. */
+    static const char* const BinaryMarker;
+
+    /** Prefix of payloads compressed as base64 text. */
+    static const char* const ArmouredMarker;
+
+    /** Whether the transport can carry arbitrary bytes. */
+    bool _binarySafe;
+
+    /** Counters of this compressor. */
+    qint64 _compressed;
+    qint64 _incompressible;
+    qint64 _bytesIn;
+    qint64 _bytesOut;
+    qint64 _compressNsecs;
+
+    /** Process-wide inflation counters (atomic, since payloads are inflated on whichever thread decodes them). */
+    static QAtomicInteger<qint64> _inflated;
+    static QAtomicInteger<qint64> _inflatedBytesIn;
+    static QAtomicInteger<qint64> _inflatedBytesOut;
+    static QAtomicInteger<qint64> _inflateNsecs;
+};
+
+#endif // PAYLOADCOMPRESSOR_H
@@ -0,0 +1,147 @@
+#include "PublishThrottle.h"
+
+/*!
+    \class PublishThrottle
+    \inmodule RedisInterface
+    \brief Conflates and rate-limits updates to a published property.
+
+    A property bound with RedisInterface::publishProperty() is normally written to Redis on every emission of its NOTIFY signal. For
+    properties driven by animations or sensors, most of those intermediate values are of no interest to anyone. A PublishThrottle sits
+    between the NOTIFY signal and the write, and decides when the property should actually be published:
+
+    \list
+    \li \c{"rate"} publishes the latest value at most \c{rate} times per second. The first change is published immediately; changes
+        within the following period are conflated and the latest value is published at the end of the period.
+    \li \c{"idle"} publishes the latest value once the event loop has processed all pending events, so a burst of changes made within one
+        event loop turn results in a single write.
+    \li \c{"debounce"} publishes the latest value once no further change has occurred for \c{interval} milliseconds (trailing edge).
+    \endlist
+
+    Only the fact that a change is pending is recorded; the value itself is read when fire() is emitted, so whatever is published is
+    always the newest value and the final state is never lost.
+
+    \sa RedisInterface
+*/
+
+/*!
+ * \brief Constructor. Creates a throttle with the given \a{mode} and \a{interval} (in milliseconds).
+ */
+PublishThrottle::PublishThrottle(Mode mode, int interval, QObject *parent) :
+    QObject(parent),
+    _mode(mode),
+    _interval(qMax(0, interval)),
+    _timer(new QTimer(this)),
+    _index(-1)
+{
+    _timer->setSingleShot(true);
+    connect(_timer, SIGNAL(timeout()), this, SLOT(handleTimeout()));
+}
+
+/*!
+ * \brief Creates a throttle from the \a{policy} description. The \c{policy} key selects the mode (\c{"immediate"}, \c{"rate"},
+ * \c{"idle"} or \c{"debounce"}); \c{rate} gives the maximum publish rate in Hz, and \c{interval} the debounce period in milliseconds.
+ * Returns NULL if every change should be published immediately.
+ */
+PublishThrottle* PublishThrottle::fromPolicy(const QVariantMap &policy, QObject *parent)
+{
+    QString mode = policy.value("policy", "immediate").toString();
+
+    if(mode == "rate")
+    {
+        double rate = policy.value("rate").toDouble();
+
+        if(rate > 0)
+            return new PublishThrottle(RateLimit, qRound(1000.0 / rate), parent);
+
+        std::cerr << "[PublishThrottle] fromPolicy(): Rate policy requires a positive rate!" << std::endl;
+    }
+    else if(mode == "idle")
+    {
+        return new PublishThrottle(OnIdle, 0, parent);
+    }
+    else if(mode == "debounce")
+    {
+        return new PublishThrottle(Debounce, policy.value("interval").toInt(), parent);
+    }
+    else if(mode != "immediate")
+    {
+        std::cerr << "[PublishThrottle] fromPolicy(): Unknown publish policy " << mode.toStdString() << std::endl;
+    }
+
+    return NULL;
+}
+
+/*!
+ * \brief Returns the publish policy.
+ */
+PublishThrottle::Mode PublishThrottle::mode() const
+{
+    return _mode;
+}
+
+/*!
+ * \brief Returns the policy interval, in milliseconds.
+ */
+int PublishThrottle::interval() const
+{
+    return _interval;
+}
+
+/*!
+ * \brief Returns the index of the published property binding this throttle belongs to, or -1 if none has been assigned.
+ */
+int PublishThrottle::index() const
+{
+    return _index;
+}
+
+/*!
+ * \brief Sets the \a{index} of the published property binding this throttle belongs to, so that the owner can map \c{fire()} back to
+ * the binding without a lookup.
+ */
+void PublishThrottle::setIndex(int index)
+{
+    _index = index;
+}
+
+/*!
+ * \brief Records a change to the value, emitting \c{fire()} now or scheduling it for later according to the policy.
+ */
+void PublishThrottle::trigger()
+{
+    switch(_mode)
+    {
+    case Immediate:
+        handleTimeout();
+        break;
+
+    case RateLimit:
+        // A publication is already scheduled, and will pick up the latest value.
+        if(_timer->isActive())
+            break;
+
+        if(!_lastFired.isValid() || _lastFired.elapsed() >= _interval)
+            handleTimeout();
+        else
+            _timer->start(int(_interval - _lastFired.elapsed()));
+        break;
+
+    case OnIdle:
+        if(!_timer->isActive())
+            _timer->start(0);
+        break;
+
+    case Debounce:
+        _timer->start(_interval);
+        break;
+    }
+}
+
+/*!
+ * \brief Emits \c{fire()} so that the latest value is published.
+ */
+void PublishThrottle::handleTimeout()
+{
+    _lastFired.start();
+    emit fire();
+}
@@ -0,0 +1,71 @@
+#ifndef PUBLISHTHROTTLE_H
+#define PUBLISHTHROTTLE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVariantMap>
+#include <iostream>
+
+class PublishThrottle : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Publish policies for a published property. */
+    enum Mode
+    {
+        Immediate,  /**< Publish every change. */
+        RateLimit,  /**< Publish the latest value at most N times per second. */
+        OnIdle,     /**< Publish the latest value once the event loop is idle. */
+        Debounce    /**< Publish the latest value once no change has occurred for a given interval. */
+    };
+
+    /** Constructor. Interval is in milliseconds (the minimum period for RateLimit, or the quiet period for Debounce). */
+    PublishThrottle(Mode mode, int interval, QObject* parent = 0);
+
+    /** Creates a throttle from a policy description such as { policy: "rate", rate: 10 }. Returns NULL for the immediate policy. */
+    static PublishThrottle* fromPolicy(const QVariantMap& policy, QObject* parent = 0);
+
+    Mode mode() const;
+    int interval() const;
+
+    /** Index of the published property binding this throttle belongs to (assigned by its owner). */
+    int index() const;
+    void setIndex(int index);
+
+public slots:
+
+    /** Notifies the throttle that the value has changed. fire() is emitted when the policy allows the latest value to be published. */
+    void trigger();
+
+signals:
+
+    /** Emitted when the latest value should be published. */
+    void fire();
+
+private slots:
+
+    /** Publishes the pending value. */
+    void handleTimeout();
+
+private:
+
+    /** Publish policy. */
+    Mode _mode;
+
+    /** Policy interval, in milliseconds. */
+    int _interval;
+
+    /** Timer used to defer publication of a pending value. */
+    QTimer* _timer;
+
+    /** Time since the value was last published (used by RateLimit). */
+    QElapsedTimer _lastFired;
+
+    /** Index of the owning binding. */
+    int _index;
+};
+
+#endif // PUBLISHTHROTTLE_H
@@ -7,10 +7,13 @@
     \brief A simple wrapper class that enables a RedisInterface to be instantiated as a QML Item.
 
     This QQuickItem-based wrapper provides call-throughs to a RedisInterface instance, which
-    provides a common interface for QObject-based objects to communicate via Redis + HTTP.
+    provides a common interface for QObject-based objects to communicate via Redis (either through a webdis \c{http://} URL or natively
+    through a \c{redis://} URL).
 
     Subscribed/published events and properties are defined in a declarative fashion using the \c{variant} properties
-    \l{subscribedEvents}, \l{publishedEvents}, \l{subscribedProperties}, and \l{publishedProperties}.
+    \l{subscribedEvents}, \l{publishedEvents}, \l{subscribedProperties}, and \l{publishedProperties}. Groups of properties can be bound
+    to a Redis hash as a whole with \l{subscribedObjects} and \l{publishedObjects}. Large Redis lists and sorted sets are shown in views
+    through the RedisListModel and RedisSortedSetModel types instead, which only fetch the rows being shown.
 
     Example:
     \code
@@ -20,9 +23,12 @@
         { remote: "remote:published:string", local: "localSubscribedString" }
     ]
 
-    // Local properties we wish to push to Redis automatically
+    // Local properties we wish to push to Redis automatically, optionally with a publish policy:
+    //   policy: "rate", rate: <Hz>         - latest value at most <Hz> times per second
+    //   policy: "idle"                     - latest value once the event loop is idle
+    //   policy: "debounce", interval: <ms> - latest value once unchanged for <ms> milliseconds
     publishedProperties: [
-        { local: "localPublishedDouble", remote: "remote:subscribed:double" },
+        { local: "localPublishedDouble", remote: "remote:subscribed:double", policy: "rate", rate: 10 },
         { local: "localPublishedString", remote: "remote:subscribed:string" }
     ]
 
@@ -30,7 +36,7 @@
     subscribedEvents: [
         { remote: "remote:signal:trigger", local: "localSignal"   },
         { remote: "remote:method:trigger", local: "localMethod"   },
-        { remote: "remote:wildcard*",      local: "localWildcard" }
+        { remote: "remote:wildcard*",      local: "localWildcard(QVariant)" }
     ]
 
     // Local events (signals) we wish to publish to Redis when they are emitted
@@ -62,19 +68,152 @@
         console.log("(QML) localMethod() called");
     }
 
-    // Method to invoke when "remote:wildcard*" is emitted by Redis
-    function localWildcard() {
-        console.log("(QML) localWildcard() called");
+    // Method to invoke when any channel matching "remote:wildcard*" is emitted by Redis (receives the actual channel name)
+    function localWildcard(channel) {
+        console.log("(QML) localWildcard() called for channel " + channel);
     }
     \endcode
 
-    \sa RedisInterface
+    Published signals send their arguments along with the event, and subscribed functions receive them, so data can travel with an
+    event in a single message. A first parameter named \c{channel} receives the channel name instead of an argument:
+
+    \code
+    publishedEvents: [ { local: "readingTaken", remote: "sensor:kitchen:reading" } ]
+    subscribedEvents: [ { remote: "sensor:*:reading", local: "handleReading" } ]
+
+    signal readingTaken(real celsius, string unit)
+
+    function handleReading(channel, celsius, unit) {
+        console.log(channel + ": " + celsius + " " + unit);
+    }
+    \endcode
+
+    Events delivered through pub/sub are lost if this client is slow or disconnected when they are published. Events that must not be
+    lost can be appended to a Redis stream instead, and read from it in batches, resuming where reading left off after an outage (see
+    RedisInterface::subscribeToEvent() for every option):
+
+    \code
+    // Appended to the "orders" stream, trimmed to roughly the last 100000 entries
+    publishedEvents: [ { local: "orderPlaced", remote: "orders", mode: "stream", maxLength: 100000 } ]
+
+    // Read from the "orders" stream, sharing its entries with the other members of the "fulfilment" consumer group
+    subscribedEvents: [ { remote: "orders", local: "handleOrder", mode: "stream", group: "fulfilment", consumer: "packer-1" } ]
+    \endcode
+
+    Binding properties one by one costs a key, a change channel and a write per property. For objects with many properties, such as
+    device state, the properties can instead be bound to the fields of a single Redis hash. Every property changed within one event loop
+    turn is then written with a single \c{HSET} and announced with a single message carrying just the changed fields, and subscribers
+    are hydrated with a single \c{HGETALL}. Without a \c{properties} list, every property declared in the component is bound:
+
+    \code
+    // Properties pushed to the "device:42" hash (optionally with a publish policy, as for publishedProperties)
+    publishedObjects: [ { remote: "device:42", properties: ["temperature", "humidity", "status"] } ]
+
+    // Properties pulled from the "device:7" hash
+    subscribedObjects: [ { remote: "device:7" } ]
+    \endcode
+
+    Operations made of several dependent steps can run on the server in a single round trip as Lua scripts. Scripts given in
+    \l{scripts} (or registered later with registerScript()) are loaded once, and runScript() invokes them by their digest:
+
+    \code
+    scripts: ({
+        setVersioned: "redis.call('SET', KEYS[1], ARGV[1]) " +
+                      "local version = redis.call('INCR', KEYS[1] .. ':version') " +
+                      "redis.call('PUBLISH', KEYS[1] .. '_changed', ARGV[1]) " +
+                      "return version"
+    })
+
+    onSaveClicked: redis.runScript("setVersioned", ["document:title"], [title]).then(function(version) {
+        console.log("Saved version " + version);
+    })
+    \endcode
+
+    Network I/O, protocol parsing and the inflation of compressed payloads run on a dedicated worker thread by default. Routing each
+    message to its bindings, decoding values with the value codec, and the property writes and method invocations themselves still run
+    on the GUI thread, so heavy subscription traffic is relieved of its socket and parsing costs, but not of its decoding costs. Set
+    \l{threaded} to \c{false} (before the component completes) to run everything on the GUI thread instead.
+
+    Lost connections are re-established automatically, after which every subscribed property is refreshed from Redis. The
+    \l{connectionState} property (\c{"connecting"}, \c{"connected"} or \c{"reconnecting"}) can be used to indicate an outage, and
+    \l{lastResyncDuration} reports how long the last refresh took.
+
+    The \l{metrics} property holds runtime counters (see RedisInterface::metrics()): requests sent and pending, round-trip latency
+    percentiles, messages received per channel and bytes transferred. It is refreshed every \l{metricsInterval} milliseconds (1000 by
+    default; 0 stops the updates), so it can be bound directly to an overlay:
+
+    \code
+    Text {
+        text: "p99 " + redis.metrics.latency.p99 + " ms, " + redis.metrics.pendingRequests + " pending"
+    }
+    \endcode
+
+    Values are stored in Redis as text by default. Setting \l{valueCodec} to \c{"binary"} stores them in a compact binary form that
+    preserves their types (so numbers, lists and objects are read back exactly as they were written), at the cost of readability by
+    other Redis clients.
+
+    By default, every write is accompanied by a \c{PUBLISH} on \c{key_changed}, and only writes made through a RedisInterface reach
+    subscribed properties. Setting \l{changeNotifications} to \c{"keyspace"} follows the server's keyspace notifications instead, so
+    that values written by any client (eg. a backend service) reach the UI, and each write is a single command. Every client sharing the
+    keys should use the same setting (see RedisInterface::setChangeNotifications()). The server must have keyspace notifications enabled
+    (\c{notify-keyspace-events}); by default, missing classes are only reported. Setting \l{configureServer} to \c{true} lets the
+    interface enable them with \c{CONFIG SET}, which changes the setting for the whole server and every client of it.
+
+    Large payloads can be compressed on slow links. Setting \l{compressionThreshold} compresses every value of at least that many bytes,
+    while a \c{compress} entry in the element of a published property, object or event opts in that binding alone:
+
+    \code
+    publishedProperties: [
+        { local: "report", remote: "site:report", compress: 4096 }
+    ]
+    \endcode
+
+    Compressed values are detected and inflated whatever the reader's own settings; on the transport's thread, if \l{threaded}.
+
+    Requests are sent in priority lanes, so that reads made in response to user input are not held up behind the writes of bindings
+    (see RequestScheduler). \l{laneLimits} sets how many requests of each lane may be in flight at once (eg.
+    \c{{bulk: 8, background: 2}}), a \c{lane} entry in a binding's element moves it to another lane, and cancelQueued() drops the
+    requests still queued in a lane. laneStatistics() (also part of \l{metrics}) reports the queues.
+
+    One-off requests are made with getAsync(), setAsync() and execute(), which return a RedisPromise that can be chained with
+    \c{then()} like a JavaScript promise:
+
+    \code
+    redis.getAsync("remote:published:string").then(function(value) {
+        console.log("Value is " + value);
+    }, function(error) {
+        console.log("GET failed: " + error);
+    });
+    \endcode
+
+    Passing an array of keys reads them all at once, yielding a single object mapping each key to its value:
+
+    \code
+    redis.get(["user:1:name", "user:1:email", "user:1:avatar"], function(values) {
+        console.log(values["user:1:name"] + " <" + values["user:1:email"] + ">");
+    });
+    \endcode
+
+    \sa RedisInterface, RedisPromise
 */
 
 QMLRedisInterface::QMLRedisInterface(QQuickItem *parent) :
-    QQuickItem(parent)
+    QQuickItem(parent),
+    _batchWindow(0),
+    _cacheSize(0),
+    _valueCodec("text"),
+    _changeNotifications("publish"),
+    _configureServer(false),
+    _compressionThreshold(0),
+    _threaded(true),
+    _metricsInterval(1000),
+    _metricsTimer(new QTimer(this)),
+    _redisInterface(NULL)
 {
     setFlag(ItemHasContents, true);
+
+    _metricsTimer->setInterval(_metricsInterval);
+    connect(_metricsTimer, SIGNAL(timeout()), this, SIGNAL(metricsChanged()));
 }
 
 QVariant QMLRedisInterface::subscribedEvents() const
@@ -82,6 +221,7 @@ QVariant QMLRedisInterface::subscribedEvents() const
     return _subscribedEvents;
 }
 
+#ifndef REDIS_NO_SYNCHRONOUS_GET
 QVariant QMLRedisInterface::get(const QString &key) const
 {
     if(this->isComponentComplete())
@@ -89,6 +229,7 @@ QVariant QMLRedisInterface::get(const QString &key) const
 
     return QVariant();
 }
+#endif
 
 void QMLRedisInterface::get(const QString &key, QJSValue callback) const
 {
@@ -96,17 +237,135 @@ void QMLRedisInterface::get(const QString &key, QJSValue callback) const
         _redisInterface->get(key, callback);
 }
 
-bool QMLRedisInterface::subscribeToEvent(const QString& remoteEventName, const QString& localMethodName)
+void QMLRedisInterface::get(const QStringList &keys, QJSValue callback) const
+{
+    if(this->isComponentComplete())
+        _redisInterface->get(keys, callback);
+}
+
+RedisPromise* QMLRedisInterface::getAsync(const QString &key)
+{
+    return toScript(this->isComponentComplete() && _redisInterface ? _redisInterface->getAsync(key) : NULL);
+}
+
+RedisPromise* QMLRedisInterface::getAsync(const QStringList &keys)
+{
+    return toScript(this->isComponentComplete() && _redisInterface ? _redisInterface->getAsync(keys) : NULL);
+}
+
+RedisPromise* QMLRedisInterface::setAsync(const QString &key, const QVariant &value)
+{
+    return toScript(this->isComponentComplete() && _redisInterface ? _redisInterface->setAsync(key, value) : NULL);
+}
+
+RedisPromise* QMLRedisInterface::execute(const QStringList &command)
+{
+    return toScript(this->isComponentComplete() && _redisInterface ? _redisInterface->execute(command) : NULL);
+}
+
+void QMLRedisInterface::registerScript(const QString &name, const QString &source)
+{
+    if(this->isComponentComplete() && _redisInterface)
+        _redisInterface->registerScript(name, source);
+}
+
+RedisPromise* QMLRedisInterface::runScript(const QString &name, const QStringList &keys, const QVariantList &arguments)
+{
+    return toScript(this->isComponentComplete() && _redisInterface ? _redisInterface->runScript(name, keys, arguments) : NULL);
+}
+
+RedisPromise* QMLRedisInterface::toScript(RedisPromise *promise)
+{
+    if(promise == NULL)
+    {
+        promise = new RedisPromise();
+        promise->reject("RedisInterface has not been initialised!");
+    }
+
+    promise->setJavaScriptOwnership(qmlEngine(this));
+
+    return promise;
+}
+
+QVariantMap QMLRedisInterface::changeNotificationOptions() const
+{
+    QVariantMap options;
+    options.insert("configureServer", _configureServer);
+
+    return options;
+}
+
+bool QMLRedisInterface::subscribeToEvent(const QString& remoteEventName, const QString& localMethodName, const QVariantMap& options)
 {
     if(this->isComponentComplete())
-        return _redisInterface->subscribeToEvent(remoteEventName, localMethodName);
+        return _redisInterface->subscribeToEvent(remoteEventName, localMethodName, options);
 
     return false;
 }
 
+bool QMLRedisInterface::unsubscribeFromEvent(const QString& remoteEventName, const QString& localMethodName)
+{
+    if(this->isComponentComplete())
+        return _redisInterface->unsubscribeFromEvent(remoteEventName, localMethodName);
+
+    return false;
+}
+
+QVariantMap QMLRedisInterface::batchStatistics() const
+{
+    if(this->isComponentComplete() && _redisInterface)
+        return _redisInterface->batchStatistics();
+
+    return QVariantMap();
+}
+
+QVariantMap QMLRedisInterface::cacheStatistics() const
+{
+    if(this->isComponentComplete() && _redisInterface)
+        return _redisInterface->cacheStatistics();
+
+    return QVariantMap();
+}
+
+void QMLRedisInterface::clearCache()
+{
+    if(this->isComponentComplete() && _redisInterface)
+        _redisInterface->clearCache();
+}
+
+int QMLRedisInterface::cancelQueued(const QString &lane)
+{
+    if(this->isComponentComplete() && _redisInterface)
+        return _redisInterface->cancelQueued(lane);
+
+    return 0;
+}
+
+QVariantMap QMLRedisInterface::laneStatistics() const
+{
+    if(this->isComponentComplete() && _redisInterface)
+        return _redisInterface->laneStatistics();
+
+    return QVariantMap();
+}
+
 void QMLRedisInterface::init()
 {
-    _redisInterface = new RedisInterface(serverUrl(), this);
+    _redisInterface = new RedisInterface(serverUrl(), this, threaded());
+    _redisInterface->setBatchWindow(batchWindow());
+    _redisInterface->setCacheSize(cacheSize());
+    _redisInterface->setValueCodec(valueCodec());
+    _redisInterface->setChangeNotifications(changeNotifications(), changeNotificationOptions());
+    _redisInterface->setCompressionThreshold(compressionThreshold());
+
+    for(QVariantMap::const_iterator iter = _laneLimits.constBegin(); iter != _laneLimits.constEnd(); ++iter)
+        _redisInterface->setLaneLimit(iter.key(), iter.value().toInt());
+
+    connect(_redisInterface, SIGNAL(connectionStateChanged(QString)), this, SIGNAL(connectionStateChanged(QString)));
+    connect(_redisInterface, SIGNAL(resynchronised(int)), this, SIGNAL(resynchronised(int)));
+
+    if(metricsInterval() > 0)
+        _metricsTimer->start();
 
     // Subscribe to events.
     QListIterator<QVariant> subscribedEventsIter = subscribedEvents().toList();
@@ -117,7 +376,8 @@ void QMLRedisInterface::init()
         QString remoteEventName = element.value("remote").toString();
         QString localMethodName = QString(element.value("local").toString());
 
-        _redisInterface->subscribeToEvent(remoteEventName, localMethodName);
+        // Any delivery options (eg. mode: "stream", group: "workers") are given alongside the names.
+        _redisInterface->subscribeToEvent(remoteEventName, localMethodName, element);
     }
 
     // Publish events.
@@ -129,7 +389,7 @@ void QMLRedisInterface::init()
         QString localSignalName = element.value("local").toString();
         QString remoteEventName = element.value("remote").toString();
 
-        _redisInterface->publishEvent(localSignalName, remoteEventName);
+        _redisInterface->publishEvent(localSignalName, remoteEventName, element);
     }
 
     // Subscribe to properties.
@@ -153,7 +413,37 @@ void QMLRedisInterface::init()
         QString remotePropertyName = element.value("remote").toString();
         QString localPropertyName = element.value("local").toString();
 
-        _redisInterface->publishProperty(localPropertyName, remotePropertyName);
+        // Any publish policy (eg. policy: "rate", rate: 10) is given alongside the property names.
+        _redisInterface->publishProperty(localPropertyName, remotePropertyName, element);
+    }
+
+    // Subscribe to objects.
+    QListIterator<QVariant> subscribedObjectsIter = subscribedObjects().toList();
+    while(subscribedObjectsIter.hasNext())
+    {
+        QVariantMap element = subscribedObjectsIter.next().toMap();
+
+        QString remoteHashKey = element.value("remote").toString();
+        QStringList localPropertyNames = element.value("properties").toStringList();
+
+        _redisInterface->subscribeToObject(remoteHashKey, localPropertyNames);
+    }
+
+    // Register scripts.
+    QVariantMap scriptMap = scripts().toMap();
+    for(QVariantMap::const_iterator iter = scriptMap.constBegin(); iter != scriptMap.constEnd(); ++iter)
+        _redisInterface->registerScript(iter.key(), iter.value().toString());
+
+    // Publish objects.
+    QListIterator<QVariant> publishedObjectsIter = publishedObjects().toList();
+    while(publishedObjectsIter.hasNext())
+    {
+        QVariantMap element = publishedObjectsIter.next().toMap();
+
+        QString remoteHashKey = element.value("remote").toString();
+        QStringList localPropertyNames = element.value("properties").toStringList();
+
+        _redisInterface->publishObject(remoteHashKey, localPropertyNames, element);
     }
 }
 
@@ -183,6 +473,26 @@ QVariant QMLRedisInterface::publishedEvents() const
     return _publishedEvents;
 }
 
+QVariant QMLRedisInterface::subscribedObjects() const
+{
+    return _subscribedObjects;
+}
+
+QVariant QMLRedisInterface::publishedObjects() const
+{
+    return _publishedObjects;
+}
+
+QVariant QMLRedisInterface::scripts() const
+{
+    return _scripts;
+}
+
+int QMLRedisInterface::batchWindow() const
+{
+    return _batchWindow;
+}
+
 void QMLRedisInterface::setSubscribedEvents(const QVariant &value)
 {
     if(_subscribedEvents != value)
@@ -219,6 +529,33 @@ void QMLRedisInterface::setPublishedEvents(const QVariant& value)
     }
 }
 
+void QMLRedisInterface::setSubscribedObjects(const QVariant& value)
+{
+    if(_subscribedObjects != value)
+    {
+        _subscribedObjects = value;
+        emit subscribedObjectsChanged(value);
+    }
+}
+
+void QMLRedisInterface::setPublishedObjects(const QVariant& value)
+{
+    if(_publishedObjects != value)
+    {
+        _publishedObjects = value;
+        emit publishedObjectsChanged(value);
+    }
+}
+
+void QMLRedisInterface::setScripts(const QVariant& value)
+{
+    if(_scripts != value)
+    {
+        _scripts = value;
+        emit scriptsChanged(value);
+    }
+}
+
 void QMLRedisInterface::setServerUrl(const QString& value)
 {
     if(_serverUrl != value)
@@ -227,3 +564,187 @@ void QMLRedisInterface::setServerUrl(const QString& value)
         emit serverUrlChanged(value);
     }
 }
+
+void QMLRedisInterface::setBatchWindow(int value)
+{
+    if(_batchWindow != value)
+    {
+        _batchWindow = value;
+
+        if(_redisInterface)
+            _redisInterface->setBatchWindow(value);
+
+        emit batchWindowChanged(value);
+    }
+}
+
+int QMLRedisInterface::cacheSize() const
+{
+    return _cacheSize;
+}
+
+void QMLRedisInterface::setCacheSize(int value)
+{
+    if(_cacheSize != value)
+    {
+        _cacheSize = value;
+
+        if(_redisInterface)
+            _redisInterface->setCacheSize(value);
+
+        emit cacheSizeChanged(value);
+    }
+}
+
+QString QMLRedisInterface::valueCodec() const
+{
+    return _valueCodec;
+}
+
+void QMLRedisInterface::setValueCodec(const QString &value)
+{
+    if(_valueCodec != value)
+    {
+        _valueCodec = value;
+
+        if(_redisInterface)
+            _redisInterface->setValueCodec(value);
+
+        emit valueCodecChanged(value);
+    }
+}
+
+QString QMLRedisInterface::changeNotifications() const
+{
+    return _changeNotifications;
+}
+
+void QMLRedisInterface::setChangeNotifications(const QString &value)
+{
+    if(_changeNotifications != value)
+    {
+        _changeNotifications = value;
+
+        if(_redisInterface)
+            _redisInterface->setChangeNotifications(value, changeNotificationOptions());
+
+        emit changeNotificationsChanged(value);
+    }
+}
+
+bool QMLRedisInterface::configureServer() const
+{
+    return _configureServer;
+}
+
+void QMLRedisInterface::setConfigureServer(bool value)
+{
+    if(_configureServer != value)
+    {
+        _configureServer = value;
+
+        if(_redisInterface)
+            _redisInterface->setChangeNotifications(changeNotifications(), changeNotificationOptions());
+
+        emit configureServerChanged(value);
+    }
+}
+
+int QMLRedisInterface::compressionThreshold() const
+{
+    return _compressionThreshold;
+}
+
+void QMLRedisInterface::setCompressionThreshold(int value)
+{
+    if(_compressionThreshold != value)
+    {
+        _compressionThreshold = value;
+
+        if(_redisInterface)
+            _redisInterface->setCompressionThreshold(value);
+
+        emit compressionThresholdChanged(value);
+    }
+}
+
+QVariantMap QMLRedisInterface::laneLimits() const
+{
+    return _laneLimits;
+}
+
+void QMLRedisInterface::setLaneLimits(const QVariantMap &value)
+{
+    if(_laneLimits != value)
+    {
+        _laneLimits = value;
+
+        if(_redisInterface)
+            for(QVariantMap::const_iterator iter = value.constBegin(); iter != value.constEnd(); ++iter)
+                _redisInterface->setLaneLimit(iter.key(), iter.value().toInt());
+
+        emit laneLimitsChanged(value);
+    }
+}
+
+bool QMLRedisInterface::threaded() const
+{
+    return _threaded;
+}
+
+QString QMLRedisInterface::connectionState() const
+{
+    return _redisInterface ? _redisInterface->connectionState() : "disconnected";
+}
+
+int QMLRedisInterface::lastResyncDuration() const
+{
+    return _redisInterface ? _redisInterface->lastResyncDuration() : -1;
+}
+
+QVariantMap QMLRedisInterface::metrics() const
+{
+    return _redisInterface ? _redisInterface->metrics() : QVariantMap();
+}
+
+int QMLRedisInterface::metricsInterval() const
+{
+    return _metricsInterval;
+}
+
+void QMLRedisInterface::setMetricsInterval(int value)
+{
+    if(_metricsInterval != value)
+    {
+        _metricsInterval = value;
+
+        if(value > 0)
+        {
+            _metricsTimer->setInterval(value);
+
+            if(_redisInterface)
+                _metricsTimer->start();
+        }
+        else
+        {
+            _metricsTimer->stop();
+        }
+
+        emit metricsIntervalChanged(value);
+    }
+}
+
+void QMLRedisInterface::setThreaded(bool value)
+{
+    if(_redisInterface)
+    {
+        std::cerr << "[QMLRedisInterface] setThreaded(): Threading can only be chosen before the interface is initialised!" << std::endl;
+        return;
+    }
+
+    if(_threaded != value)
+    {
+        _threaded = value;
+        emit threadedChanged(value);
+    }
+}
@@ -2,6 +2,7 @@
 #define QMLREDISINTERFACE_H
 
 #include <QQuickItem>
+#include <QTimer>
 #include <QDebug>
 #include "RedisInterface.h"
 
@@ -13,6 +14,21 @@ class QMLRedisInterface : public QQuickItem
     Q_PROPERTY(QVariant publishedProperties  READ publishedProperties  WRITE setPublishedProperties  NOTIFY publishedPropertiesChanged )
     Q_PROPERTY(QVariant subscribedEvents     READ subscribedEvents     WRITE setSubscribedEvents     NOTIFY subscribedEventsChanged    )
     Q_PROPERTY(QVariant publishedEvents      READ publishedEvents      WRITE setPublishedEvents      NOTIFY publishedEventsChanged     )
+    Q_PROPERTY(QVariant subscribedObjects    READ subscribedObjects    WRITE setSubscribedObjects    NOTIFY subscribedObjectsChanged   )
+    Q_PROPERTY(QVariant publishedObjects     READ publishedObjects     WRITE setPublishedObjects     NOTIFY publishedObjectsChanged    )
+    Q_PROPERTY(QVariant scripts              READ scripts              WRITE setScripts              NOTIFY scriptsChanged             )
+    Q_PROPERTY(int      batchWindow          READ batchWindow          WRITE setBatchWindow          NOTIFY batchWindowChanged         )
+    Q_PROPERTY(int      cacheSize            READ cacheSize            WRITE setCacheSize            NOTIFY cacheSizeChanged           )
+    Q_PROPERTY(QString  valueCodec           READ valueCodec           WRITE setValueCodec           NOTIFY valueCodecChanged          )
+    Q_PROPERTY(QString  changeNotifications  READ changeNotifications  WRITE setChangeNotifications  NOTIFY changeNotificationsChanged )
+    Q_PROPERTY(bool     configureServer      READ configureServer      WRITE setConfigureServer      NOTIFY configureServerChanged     )
+    Q_PROPERTY(int      compressionThreshold READ compressionThreshold WRITE setCompressionThreshold NOTIFY compressionThresholdChanged)
+    Q_PROPERTY(QVariantMap laneLimits        READ laneLimits           WRITE setLaneLimits           NOTIFY laneLimitsChanged          )
+    Q_PROPERTY(bool     threaded             READ threaded             WRITE setThreaded             NOTIFY threadedChanged            )
+    Q_PROPERTY(QString  connectionState      READ connectionState                                    NOTIFY connectionStateChanged     )
+    Q_PROPERTY(int      lastResyncDuration   READ lastResyncDuration                                 NOTIFY resynchronised             )
+    Q_PROPERTY(QVariantMap metrics           READ metrics                                            NOTIFY metricsChanged             )
+    Q_PROPERTY(int      metricsInterval      READ metricsInterval      WRITE setMetricsInterval      NOTIFY metricsIntervalChanged     )
 
 public:
 
@@ -23,10 +39,40 @@ public:
     QVariant publishedProperties() const;
     QVariant subscribedEvents() const;
     QVariant publishedEvents() const;
-
+    QVariant subscribedObjects() const;
+    QVariant publishedObjects() const;
+    QVariant scripts() const;
+    int batchWindow() const;
+    int cacheSize() const;
+    QString valueCodec() const;
+    QString changeNotifications() const;
+    bool configureServer() const;
+    int compressionThreshold() const;
+    QVariantMap laneLimits() const;
+    bool threaded() const;
+    QString connectionState() const;
+    int lastResyncDuration() const;
+    QVariantMap metrics() const;
+    int metricsInterval() const;
+
+#ifndef REDIS_NO_SYNCHRONOUS_GET
     Q_INVOKABLE QVariant get(const QString& key) const;
+#endif
     Q_INVOKABLE void get(const QString& key, QJSValue callback) const;
-    Q_INVOKABLE bool subscribeToEvent(const QString& remoteEventName, const QString& localMethodName);
+    Q_INVOKABLE void get(const QStringList& keys, QJSValue callback) const;
+    Q_INVOKABLE RedisPromise* getAsync(const QString& key);
+    Q_INVOKABLE RedisPromise* getAsync(const QStringList& keys);
+    Q_INVOKABLE RedisPromise* setAsync(const QString& key, const QVariant& value);
+    Q_INVOKABLE RedisPromise* execute(const QStringList& command);
+    Q_INVOKABLE void registerScript(const QString& name, const QString& source);
+    Q_INVOKABLE RedisPromise* runScript(const QString& name, const QStringList& keys = QStringList(), const QVariantList& arguments = QVariantList());
+    Q_INVOKABLE bool subscribeToEvent(const QString& remoteEventName, const QString& localMethodName, const QVariantMap& options = QVariantMap());
+    Q_INVOKABLE bool unsubscribeFromEvent(const QString& remoteEventName, const QString& localMethodName);
+    Q_INVOKABLE QVariantMap batchStatistics() const;
+    Q_INVOKABLE QVariantMap cacheStatistics() const;
+    Q_INVOKABLE void clearCache();
+    Q_INVOKABLE int cancelQueued(const QString& lane);
+    Q_INVOKABLE QVariantMap laneStatistics() const;
 
     Q_INVOKABLE void init();
 
@@ -37,6 +83,21 @@ signals:
     void publishedPropertiesChanged(const QVariant& value);
     void subscribedEventsChanged(const QVariant& value);
     void publishedEventsChanged(const QVariant& value);
+    void subscribedObjectsChanged(const QVariant& value);
+    void publishedObjectsChanged(const QVariant& value);
+    void scriptsChanged(const QVariant& value);
+    void batchWindowChanged(int value);
+    void cacheSizeChanged(int value);
+    void valueCodecChanged(const QString& value);
+    void changeNotificationsChanged(const QString& value);
+    void configureServerChanged(bool value);
+    void compressionThresholdChanged(int value);
+    void laneLimitsChanged(const QVariantMap& value);
+    void threadedChanged(bool value);
+    void connectionStateChanged(const QString& value);
+    void resynchronised(int msecs);
+    void metricsChanged();
+    void metricsIntervalChanged(int value);
 
 public slots:
 
@@ -47,14 +108,47 @@ public slots:
     void setPublishedProperties(const QVariant& value);
     void setSubscribedEvents(const QVariant& value);
     void setPublishedEvents(const QVariant& value);
+    void setSubscribedObjects(const QVariant& value);
+    void setPublishedObjects(const QVariant& value);
+    void setScripts(const QVariant& value);
+    void setBatchWindow(int value);
+    void setCacheSize(int value);
+    void setValueCodec(const QString& value);
+    void setChangeNotifications(const QString& value);
+    void setConfigureServer(bool value);
+    void setCompressionThreshold(int value);
+    void setLaneLimits(const QVariantMap& value);
+    void setThreaded(bool value);
+    void setMetricsInterval(int value);
 
 private:
 
+    /** Hands a promise over to this item's QML engine, or returns a rejected promise if the interface has not been initialised. */
+    RedisPromise* toScript(RedisPromise* promise);
+
+    /** Returns the options passed to RedisInterface::setChangeNotifications() along with changeNotifications. */
+    QVariantMap changeNotificationOptions() const;
+
     QString _serverUrl;
     QVariant _subscribedProperties;
     QVariant _publishedProperties;
     QVariant _subscribedEvents;
     QVariant _publishedEvents;
+    QVariant _subscribedObjects;
+    QVariant _publishedObjects;
+    QVariant _scripts;
+    int _batchWindow;
+    int _cacheSize;
+    QString _valueCodec;
+    QString _changeNotifications;
+    bool _configureServer;
+    int _compressionThreshold;
+    QVariantMap _laneLimits;
+    bool _threaded;
+    int _metricsInterval;
+
+    /** Timer emitting metricsChanged() every metricsInterval milliseconds. */
+    QTimer* _metricsTimer;
 
     RedisInterface* _redisInterface;
 };
@@ -0,0 +1,166 @@
+#include "ReadCache.h"
+
+/*!
+    \class ReadCache
+    \inmodule RedisInterface
+    \brief A bounded, least-recently-used cache of Redis values.
+
+    ReadCache holds the results of recent \c{GET} requests so that repeated reads of the same keys can be answered without a round trip.
+    Lookups and insertions are O(1): entries are held in a hash, and a linked list of keys records the order in which they were last used.
+    When the cache is full, inserting a new entry evicts the least recently used one.
+
+    The cache knows nothing about Redis itself. Its owner is responsible for keeping it coherent by calling invalidate() (or clear())
+    whenever a cached value may have changed on the server.
+
+    \sa RedisInterface
+*/
+
+/*!
+ * \brief Constructor. Creates a cache holding at most \a{capacity} entries (0 disables the cache).
+ */
+ReadCache::ReadCache(int capacity) :
+    _capacity(qMax(0, capacity)),
+    _hits(0),
+    _misses(0),
+    _evictions(0),
+    _invalidations(0)
+{
+}
+
+/*!
+ * \brief Returns the maximum number of entries held.
+ */
+int ReadCache::capacity() const
+{
+    return _capacity;
+}
+
+/*!
+ * \brief Sets the maximum number of entries held to \a{capacity}, evicting least recently used entries as required.
+ */
+void ReadCache::setCapacity(int capacity)
+{
+    _capacity = qMax(0, capacity);
+    evictTo(_capacity);
+}
+
+/*!
+ * \brief Returns the number of entries currently held.
+ */
+int ReadCache::size() const
+{
+    return _entries.size();
+}
+
+/*!
+ * \brief Looks up \a{key}. On a hit, sets \a{value} to the cached value, marks the entry as most recently used and returns true.
+ */
+bool ReadCache::lookup(const QString &key, QVariant &value)
+{
+    if(_capacity == 0)
+        return false;
+
+    QHash<QString, Entry>::iterator entry = _entries.find(key);
+
+    if(entry == _entries.end())
+    {
+        ++_misses;
+        return false;
+    }
+
+    // Move the key to the front of the recency list.
+    if(entry->position != _recency.begin())
+    {
+        _recency.erase(entry->position);
+        entry->position = _recency.insert(_recency.begin(), key);
+    }
+
+    value = entry->value;
+    ++_hits;
+
+    return true;
+}
+
+/*!
+ * \brief Stores \a{value} for \a{key} as the most recently used entry, evicting the least recently used entry if the cache is full.
+ */
+void ReadCache::insert(const QString &key, const QVariant &value)
+{
+    if(_capacity == 0)
+        return;
+
+    QHash<QString, Entry>::iterator entry = _entries.find(key);
+
+    if(entry != _entries.end())
+    {
+        _recency.erase(entry->position);
+        entry->position = _recency.insert(_recency.begin(), key);
+        entry->value = value;
+
+        return;
+    }
+
+    evictTo(_capacity - 1);
+
+    Entry newEntry;
+    newEntry.value = value;
+    newEntry.position = _recency.insert(_recency.begin(), key);
+    _entries.insert(key, newEntry);
+}
+
+/*!
+ * \brief Removes the entry for \a{key}, if any. Returns true if an entry was removed.
+ */
+bool ReadCache::invalidate(const QString &key)
+{
+    QHash<QString, Entry>::iterator entry = _entries.find(key);
+
+    if(entry == _entries.end())
+        return false;
+
+    _recency.erase(entry->position);
+    _entries.erase(entry);
+    ++_invalidations;
+
+    return true;
+}
+
+/*!
+ * \brief Removes every entry.
+ */
+void ReadCache::clear()
+{
+    _invalidations += _entries.size();
+    _entries.clear();
+    _recency.clear();
+}
+
+/*!
+ * \brief Returns counters describing the cache: \c{hits}, \c{misses}, \c{hitRate} (hits as a fraction of lookups), \c{evictions},
+ * \c{invalidations}, \c{size} and \c{capacity}.
+ */
+QVariantMap ReadCache::statistics() const
+{
+    QVariantMap statistics;
+    statistics["hits"] = _hits;
+    statistics["misses"] = _misses;
+    statistics["hitRate"] = (_hits + _misses) > 0 ? double(_hits) / double(_hits + _misses) : 0.0;
+    statistics["evictions"] = _evictions;
+    statistics["invalidations"] = _invalidations;
+    statistics["size"] = _entries.size();
+    statistics["capacity"] = _capacity;
+
+    return statistics;
+}
+
+/*!
+ * \brief Evicts least recently used entries until at most \a{size} remain.
+ */
+void ReadCache::evictTo(int size)
+{
+    while(_entries.size() > qMax(0, size))
+    {
+        _entries.remove(_recency.takeLast());
+        ++_evictions;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef READCACHE_H
+#define READCACHE_H
+
+#include <QHash>
+#include <QLinkedList>
+#include <QString>
+#include <QVariant>
+#include <QVariantMap>
+
+class ReadCache
+{
+public:
+
+    /** Constructor. A capacity of 0 disables the cache. */
+    explicit ReadCache(int capacity = 0);
+
+    /** Maximum number of entries held before the least recently used entry is evicted. */
+    int capacity() const;
+
+    /** Sets the capacity, evicting least recently used entries as required. */
+    void setCapacity(int capacity);
+
+    /** Number of entries currently held. */
+    int size() const;
+
+    /** Looks up the given key, counting a hit or miss and marking the entry as most recently used. */
+    bool lookup(const QString& key, QVariant& value);
+
+    /** Stores a value as the most recently used entry, evicting the least recently used entry if the cache is full. */
+    void insert(const QString& key, const QVariant& value);
+
+    /** Removes the entry for the given key (eg. because the value has changed). Returns false if no entry was held. */
+    bool invalidate(const QString& key);
+
+    /** Removes every entry. */
+    void clear();
+
+    /** Returns counters describing the cache (hits, misses, hitRate, evictions, invalidations, size, capacity). */
+    QVariantMap statistics() const;
+
+private:
+
+    /** A cached value and its position in the recency list. */
+    struct Entry
+    {
+        QVariant value;
+        QLinkedList<QString>::iterator position;
+    };
+
+    /** Evicts least recently used entries until no more than the given number remain. */
+    void evictTo(int size);
+
+    /** Maximum number of entries. */
+    int _capacity;
+
+    /** Cached values by key. */
+    QHash<QString, Entry> _entries;
+
+    /** Keys in order of use, most recently used first. */
+    QLinkedList<QString> _recency;
+
+    /** Counters. */
+    qint64 _hits;
+    qint64 _misses;
+    qint64 _evictions;
+    qint64 _invalidations;
+};
+
+#endif // READCACHE_H
@@ -0,0 +1,853 @@
+#include "RedisCollectionModel.h"
+#include "RedisLogging.h"
+#include "SharedTransport.h"
+#include <QStringList>
+#include <QVector>
+#include <QPair>
+#include <algorithm>
+#include <iostream>
+
+/*!
+    \class RedisCollectionModel
+    \inmodule RedisInterface
+    \brief Base class for list models showing a Redis collection without loading all of it.
+
+    A view only ever shows a small window of a large collection, so the model only fetches what is asked of it: when data() is called for
+    a row that isn't cached, the page of pageSize() rows holding it is fetched, along with prefetchPages() pages on either side that
+    aren't cached yet, so that scrolling seldom reaches an uncached row. Until its page arrives, a row's data is undefined; dataChanged()
+    is emitted for the page once it has. Every fetch made while rendering a frame is sent in the same batch. At most cachedPages() pages
+    of rows are kept, those furthest from the latest fetch being evicted first, so both memory use and load time depend on the size of
+    the viewport rather than on the size of the collection.
+
+    Writes made through the subclasses' methods run as Lua scripts which change the collection and announce the change on
+    \c{<key>_changed} in the same atomic step, as \c{"<operation> <index> <count> <length>"} (\c{"move <from> <to> <length>"} for moves),
+    where the length is that of the collection after the change. Every model showing the key applies the announcement as fine-grained
+    row insertions, removals, moves or data changes, shifting its cached rows along rather than resetting. If an announcement doesn't fit
+    (eg. because one was missed while the connection was down), or a \c{"reset"} is announced, the model reloads the collection's length
+    and resets instead. Changes made by clients writing to the key directly are not announced; they are picked up when a fetch finds the
+    collection's length changed, or by calling refresh().
+
+    Each fetch reads the collection's length along with the page, atomically. Fetches sent before a change was applied are discarded and
+    sent again, as are fetches which find a length other than the model's (meaning a change is still on its way), so rows are never
+    cached at the wrong position.
+
+    \sa RedisListModel, RedisSortedSetModel
+*/
+
+/*!
+ * \brief Constructor.
+ */
+RedisCollectionModel::RedisCollectionModel(QObject *parent) :
+    QAbstractListModel(parent),
+    _pageSize(DefaultPageSize),
+    _prefetchPages(DefaultPrefetchPages),
+    _cachedPages(DefaultCachedPages),
+    _valueCodec("text"),
+    _threaded(false),
+    _complete(true),
+    _transport(NULL),
+    _count(0),
+    _generation(0),
+    _refreshGeneration(-1),
+    _announcedLength(-1),
+    _resyncTimer(new QTimer(this)),
+    _fetches(0),
+    _rowsFetched(0),
+    _staleFetches(0),
+    _notifications(0),
+    _resets(0)
+{
+    _resyncTimer->setSingleShot(true);
+    _resyncTimer->setInterval(ResyncDelay);
+    connect(_resyncTimer, SIGNAL(timeout()), this, SLOT(resync()));
+}
+
+/*!
+ * \brief Returns the number of elements in the collection.
+ */
+int RedisCollectionModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : _count;
+}
+
+/*!
+ * \brief Returns the data stored under \a{role} for the row of \a{index}, fetching its page (and those around it) if it isn't cached.
+ * Returns an invalid QVariant until it has been fetched.
+ */
+QVariant RedisCollectionModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() >= _count)
+        return QVariant();
+
+    QHash<int, Item>::const_iterator item = _items.constFind(index.row());
+
+    if(item == _items.constEnd())
+    {
+        requestRow(index.row());
+        return QVariant();
+    }
+
+    switch(role)
+    {
+    case Qt::DisplayRole:
+    case ValueRole:
+        return item->value;
+    case ScoreRole:
+        return item->score;
+    default:
+        return QVariant();
+    }
+}
+
+/*!
+ * \brief Returns the role names: \c{value} for every model.
+ */
+QHash<int, QByteArray> RedisCollectionModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(ValueRole, "value");
+    return roles;
+}
+
+/*!
+ * \brief Holds off attaching to the key until every property has been set from QML.
+ */
+void RedisCollectionModel::classBegin()
+{
+    _complete = false;
+}
+
+/*!
+ * \brief Attaches to the key, now that every property has been set from QML.
+ */
+void RedisCollectionModel::componentComplete()
+{
+    _complete = true;
+    open();
+}
+
+/*!
+ * \brief Returns the URL of the server holding the collection.
+ */
+QString RedisCollectionModel::serverUrl() const
+{
+    return _serverUrl;
+}
+
+/*!
+ * \brief Returns the key of the collection.
+ */
+QString RedisCollectionModel::key() const
+{
+    return _key;
+}
+
+/*!
+ * \brief Returns the number of rows fetched at a time.
+ */
+int RedisCollectionModel::pageSize() const
+{
+    return _pageSize;
+}
+
+/*!
+ * \brief Returns the number of pages fetched ahead on either side of a requested page.
+ */
+int RedisCollectionModel::prefetchPages() const
+{
+    return _prefetchPages;
+}
+
+/*!
+ * \brief Returns the number of pages of rows kept in the cache.
+ */
+int RedisCollectionModel::cachedPages() const
+{
+    return _cachedPages;
+}
+
+/*!
+ * \brief Returns the name of the codec decoding the collection's elements.
+ */
+QString RedisCollectionModel::valueCodec() const
+{
+    return _valueCodec;
+}
+
+/*!
+ * \brief Returns true if the model's connection runs on a dedicated I/O thread.
+ */
+bool RedisCollectionModel::threaded() const
+{
+    return _threaded;
+}
+
+/*!
+ * \brief Returns the number of elements in the collection.
+ */
+int RedisCollectionModel::count() const
+{
+    return _count;
+}
+
+/*!
+ * \brief Returns counters describing the model's traffic: the number of page \c{fetches} sent and \c{rowsFetched} by them, the
+ * \c{staleFetches} discarded because the collection changed meanwhile, the change \c{notifications} received, the number of
+ * \c{resets}, and the number of \c{cachedRows}.
+ */
+QVariantMap RedisCollectionModel::statistics() const
+{
+    QVariantMap statistics;
+    statistics.insert("fetches", _fetches);
+    statistics.insert("rowsFetched", _rowsFetched);
+    statistics.insert("staleFetches", _staleFetches);
+    statistics.insert("notifications", _notifications);
+    statistics.insert("resets", _resets);
+    statistics.insert("cachedRows", _items.size());
+    return statistics;
+}
+
+/*!
+ * \brief Deletes the collection, resetting every model showing it.
+ */
+void RedisCollectionModel::clear()
+{
+    if(!checkWritable("clear"))
+        return;
+
+    runScript(ClearScript, QList<QByteArray>());
+}
+
+/*!
+ * \brief Sets the URL of the server holding the collection to \a{value}, reloading the model.
+ */
+void RedisCollectionModel::setServerUrl(const QString &value)
+{
+    if(_serverUrl == value)
+        return;
+
+    close();
+
+    delete _transport;
+    _transport = NULL;
+
+    _serverUrl = value;
+    emit serverUrlChanged(_serverUrl);
+
+    open();
+}
+
+/*!
+ * \brief Sets the key of the collection to \a{value}, reloading the model.
+ */
+void RedisCollectionModel::setKey(const QString &value)
+{
+    if(_key == value)
+        return;
+
+    close();
+
+    _key = value;
+    emit keyChanged(_key);
+
+    open();
+}
+
+/*!
+ * \brief Sets the number of rows fetched at a time to \a{value}. Cached rows are kept.
+ */
+void RedisCollectionModel::setPageSize(int value)
+{
+    if(_pageSize == value || value < 1)
+        return;
+
+    // Pages in flight were numbered by the old size.
+    ++_generation;
+    _pendingPages.clear();
+    _deferredPages.clear();
+
+    _pageSize = value;
+    emit pageSizeChanged(_pageSize);
+}
+
+/*!
+ * \brief Sets the number of pages fetched ahead on either side of a requested page to \a{value}.
+ */
+void RedisCollectionModel::setPrefetchPages(int value)
+{
+    if(_prefetchPages == value || value < 0)
+        return;
+
+    _prefetchPages = value;
+    emit prefetchPagesChanged(_prefetchPages);
+}
+
+/*!
+ * \brief Sets the number of pages of rows kept in the cache to \a{value}. The cache always holds at least the pages fetched for a single
+ * row, ie. twice prefetchPages() plus one.
+ */
+void RedisCollectionModel::setCachedPages(int value)
+{
+    if(_cachedPages == value || value < 1)
+        return;
+
+    _cachedPages = value;
+    emit cachedPagesChanged(_cachedPages);
+}
+
+/*!
+ * \brief Sets the codec decoding the collection's elements to the one named \a{value} ("text" or "binary"), reloading the model.
+ */
+void RedisCollectionModel::setValueCodec(const QString &value)
+{
+    if(_valueCodec == value)
+        return;
+
+    close();
+
+    _valueCodec = value;
+    _codec.clear();
+    emit valueCodecChanged(_valueCodec);
+
+    open();
+}
+
+/*!
+ * \brief Sets whether the model's connection runs on a dedicated I/O thread to \a{value}, reloading the model.
+ */
+void RedisCollectionModel::setThreaded(bool value)
+{
+    if(_threaded == value)
+        return;
+
+    close();
+
+    delete _transport;
+    _transport = NULL;
+
+    _threaded = value;
+    emit threadedChanged(_threaded);
+
+    open();
+}
+
+/*!
+ * \brief Reloads the collection's length, then resets the model, discarding every cached row. Change notifications received meanwhile
+ * are not applied; if the last of them announces a length other than the one loaded, the model is reloaded again.
+ */
+void RedisCollectionModel::refresh()
+{
+    if(_transport == NULL || _key.isEmpty())
+        return;
+
+    ++_generation;
+    _pendingPages.clear();
+    _deferredPages.clear();
+    _resyncTimer->stop();
+
+    _refreshGeneration = _generation;
+    _announcedLength = -1;
+
+    RedisReply* reply = _transport->sendCommand(QList<QByteArray>() << lengthCommand() << _key.toUtf8());
+    reply->setProperty("generation", _generation);
+    connect(reply, SIGNAL(finished()), this, SLOT(handleLengthReply()));
+}
+
+/*!
+ * \brief Lua script deleting \c{KEYS[1]}, and announcing it on \c{ARGV[1]}.
+ */
+const char* RedisCollectionModel::ClearScript =
+        "redis.call('DEL', KEYS[1]) "
+        "redis.call('PUBLISH', ARGV[1], 'reset 0 0 0') "
+        "return 1";
+
+/*!
+ * \brief Returns the row showing the element at \a{index} of a collection of \a{length} elements. The default returns \a{index}.
+ */
+int RedisCollectionModel::toRow(int index, int length) const
+{
+    Q_UNUSED(length);
+    return index;
+}
+
+/*!
+ * \brief Runs the Lua \a{script} on the model's key (as \c{KEYS[1]}), with the change notification channel as \c{ARGV[1]} followed by
+ * \a{arguments}. The script is expected to announce its change on the channel.
+ */
+void RedisCollectionModel::runScript(const char *script, const QList<QByteArray> &arguments)
+{
+    QList<QByteArray> command;
+    command << "EVAL" << script << "1" << _key.toUtf8() << notificationChannel().toUtf8() << arguments;
+
+    RedisReply* reply = _transport->sendCommand(command);
+    connect(reply, SIGNAL(finished()), this, SLOT(handleScriptReply()));
+}
+
+/*!
+ * \brief Encodes \a{value} with the value codec.
+ */
+QByteArray RedisCollectionModel::encode(const QVariant &value) const
+{
+    return _codec->encode(value);
+}
+
+/*!
+ * \brief Decodes \a{data} received from the transport with the value codec.
+ */
+QVariant RedisCollectionModel::decode(const QVariant &data) const
+{
+    return _codec->decodePayload(data);
+}
+
+/*!
+ * \brief Returns true if the model is attached to a key, so that it can be written to. Otherwise reports that \a{method} failed.
+ */
+bool RedisCollectionModel::checkWritable(const char *method) const
+{
+    if(_transport != NULL && !_subscribedChannel.isEmpty())
+        return true;
+
+    std::cerr << "[" << metaObject()->className() << "] " << method << "(): The model is not attached to a key!" << std::endl;
+    return false;
+}
+
+/*!
+ * \brief Handles the reply to refresh(), resetting the model to the loaded length unless another refresh has been sent since. A failed
+ * refresh is retried after a delay.
+ */
+void RedisCollectionModel::handleLengthReply()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    if(reply->property("generation").toInt() != _refreshGeneration)
+        return;
+
+    _refreshGeneration = -1;
+
+    if(reply->isError())
+    {
+        std::cerr << "[" << metaObject()->className() << "] handleLengthReply(): Failed to load the length of " << _key.toStdString() << ": " << reply->errorString().toStdString() << std::endl;
+        _resyncTimer->start();
+        return;
+    }
+
+    int length = reply->value().toInt();
+    resetRows(length);
+
+    qCDebug(lcRedisInterface) << "Loaded" << _key << "with" << length << "elements";
+
+    if(_announcedLength >= 0 && _announcedLength != length)
+        refresh();
+}
+
+/*!
+ * \brief Handles the reply to a page fetch, caching its rows and emitting dataChanged() for them. A fetch sent before the rows last
+ * moved is sent again; one that found the collection's length other than the model's is sent again once the change responsible has
+ * been applied.
+ */
+void RedisCollectionModel::handleRangeReply()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    int first = reply->property("first").toInt();
+    int page = first / _pageSize;
+
+    if(reply->property("generation").toInt() != _generation)
+    {
+        ++_staleFetches;
+
+        if(_refreshGeneration < 0 && first < _count && !_pendingPages.contains(page))
+            requestPage(page);
+
+        return;
+    }
+
+    _pendingPages.remove(page);
+
+    if(reply->isError())
+    {
+        std::cerr << "[" << metaObject()->className() << "] handleRangeReply(): Failed to fetch rows of " << _key.toStdString() << " from " << first << ": " << reply->errorString().toStdString() << std::endl;
+        return;
+    }
+
+    QVariantList results = reply->value().toList();
+
+    if(results.value(0).toInt() != _count)
+    {
+        ++_staleFetches;
+
+        _deferredPages.insert(page);
+        if(!_resyncTimer->isActive())
+            _resyncTimer->start();
+
+        return;
+    }
+
+    QList<Item> rows = parseRange(results.value(1));
+    if(rows.isEmpty())
+        return;
+
+    for(int i = 0; i < rows.size(); i++)
+        _items.insert(first + i, rows.at(i));
+
+    _rowsFetched += rows.size();
+
+    emit dataChanged(index(first), index(first + rows.size() - 1));
+
+    evict(first + rows.size() / 2);
+}
+
+/*!
+ * \brief Reports a failed write.
+ */
+void RedisCollectionModel::handleScriptReply()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    if(reply->isError())
+        std::cerr << "[" << metaObject()->className() << "] handleScriptReply(): Failed to write to " << _key.toStdString() << ": " << reply->errorString().toStdString() << std::endl;
+}
+
+/*!
+ * \brief Applies the change announced by \a{payload} on \a{channel}, reloading the model if it doesn't fit.
+ */
+void RedisCollectionModel::handleNotification(QString subscription, QString channel, QVariant payload)
+{
+    Q_UNUSED(subscription);
+
+    if(channel != _subscribedChannel)
+        return;
+
+    ++_notifications;
+
+    QStringList fields = payload.toString().split(' ');
+
+    if(fields.size() != 4)
+    {
+        std::cerr << "[" << metaObject()->className() << "] handleNotification(): Malformed change notification on " << channel.toStdString() << std::endl;
+        refresh();
+        return;
+    }
+
+    int length = fields.at(3).toInt();
+
+    // The length being loaded may or may not include this change; it is checked against the last one announced.
+    if(_refreshGeneration >= 0)
+    {
+        _announcedLength = length;
+        return;
+    }
+
+    if(!applyChange(fields.at(0), fields.at(1).toInt(), fields.at(2).toInt(), length))
+    {
+        qCDebug(lcRedisInterface) << "Reloading" << _key << "after change" << payload.toString();
+        refresh();
+        return;
+    }
+
+    requestDeferredPages();
+}
+
+/*!
+ * \brief Reloads the model: a fetch found the collection changed, and no change has been announced since, so it was made by another
+ * client (or the announcement was lost).
+ */
+void RedisCollectionModel::resync()
+{
+    refresh();
+}
+
+/*!
+ * \brief Subscribes to change notifications on the model's key, and loads its length, once the model has a server and a key (and, when
+ * created from QML, once all of its properties have been set).
+ */
+void RedisCollectionModel::open()
+{
+    if(!_complete || _serverUrl.isEmpty() || _key.isEmpty())
+        return;
+
+    if(_transport == NULL)
+    {
+        _transport = new SharedTransport(_serverUrl, _threaded, this);
+        connect(_transport, SIGNAL(messageReceived(QString,QString,QVariant)), this, SLOT(handleNotification(QString,QString,QVariant)));
+
+        // Changes announced while the subscription was down have been missed.
+        connect(_transport, SIGNAL(resubscribed()), this, SLOT(refresh()));
+    }
+
+    if(_codec.isNull())
+    {
+        ValueCodec* codec = ValueCodec::create(_valueCodec, _transport->isBinarySafe());
+
+        if(codec == NULL)
+        {
+            std::cerr << "[" << metaObject()->className() << "] open(): Unknown value codec " << _valueCodec.toStdString() << "!" << std::endl;
+            codec = ValueCodec::create("text", _transport->isBinarySafe());
+        }
+
+        _codec = QSharedPointer<ValueCodec>(codec);
+    }
+
+    _subscribedChannel = notificationChannel();
+    _transport->subscribe(_subscribedChannel);
+
+    refresh();
+}
+
+/*!
+ * \brief Unsubscribes from change notifications on the model's key, and empties the model.
+ */
+void RedisCollectionModel::close()
+{
+    if(_transport != NULL && !_subscribedChannel.isEmpty())
+        _transport->unsubscribe(_subscribedChannel);
+
+    _subscribedChannel.clear();
+    _refreshGeneration = -1;
+    _resyncTimer->stop();
+
+    resetRows(0);
+}
+
+/*!
+ * \brief Returns the channel on which changes to the collection are announced: \c{<key>_changed}.
+ */
+QString RedisCollectionModel::notificationChannel() const
+{
+    return _key + "_changed";
+}
+
+/*!
+ * \brief Fetches the page holding \a{row} unless it is already being fetched, along with the pages within prefetchPages() of it whose
+ * first or last row isn't cached. Nothing is fetched while the model is being reloaded, since it is about to be reset.
+ */
+void RedisCollectionModel::requestRow(int row) const
+{
+    if(_transport == NULL || _refreshGeneration >= 0 || row < 0 || row >= _count)
+        return;
+
+    int page = row / _pageSize;
+    int lastPage = (_count - 1) / _pageSize;
+
+    for(int i = qMax(0, page - _prefetchPages); i <= qMin(lastPage, page + _prefetchPages); i++)
+    {
+        if(_pendingPages.contains(i))
+            continue;
+
+        int first = i * _pageSize;
+        int last = qMin(first + _pageSize, _count) - 1;
+
+        if(i == page || !_items.contains(first) || !_items.contains(last))
+            requestPage(i);
+    }
+}
+
+/*!
+ * \brief Fetches \a{page}, in a transaction along with the collection's length.
+ */
+void RedisCollectionModel::requestPage(int page) const
+{
+    int first = page * _pageSize;
+    int last = qMin(first + _pageSize, _count) - 1;
+
+    QByteArray key = _key.toUtf8();
+
+    QList<QList<QByteArray> > commands;
+    commands << (QList<QByteArray>() << lengthCommand() << key);
+    commands << rangeCommand(key, first, last);
+
+    RedisReply* reply = _transport->sendTransaction(commands);
+    reply->setProperty("first", first);
+    reply->setProperty("generation", _generation);
+    connect(reply, SIGNAL(finished()), this, SLOT(handleRangeReply()));
+
+    _pendingPages.insert(page);
+    ++_fetches;
+}
+
+/*!
+ * \brief Fetches the pages whose fetches found a change that has now been applied.
+ */
+void RedisCollectionModel::requestDeferredPages()
+{
+    _resyncTimer->stop();
+
+    foreach(int page, _deferredPages)
+    {
+        if(page * _pageSize < _count && !_pendingPages.contains(page))
+            requestPage(page);
+    }
+
+    _deferredPages.clear();
+}
+
+/*!
+ * \brief Evicts the cached rows furthest from \a{centre} until no more than cacheCapacity() rows are cached.
+ */
+void RedisCollectionModel::evict(int centre)
+{
+    int excess = _items.size() - cacheCapacity();
+    if(excess <= 0)
+        return;
+
+    QVector<QPair<int, int> > distances;
+    distances.reserve(_items.size());
+
+    for(QHash<int, Item>::const_iterator iter = _items.constBegin(); iter != _items.constEnd(); ++iter)
+        distances.append(qMakePair(-qAbs(iter.key() - centre), iter.key()));
+
+    std::sort(distances.begin(), distances.end());
+
+    for(int i = 0; i < excess; i++)
+        _items.remove(distances.at(i).second);
+}
+
+/*!
+ * \brief Applies the change announced as \a{operation} (\c{insert}, \c{remove}, \c{update} or \c{move}) on the collection's indexes
+ * \a{first} and \a{second} (the number of elements, or for moves the destination), after which it holds \a{length} elements. Returns
+ * false if the change doesn't fit the rows, or leaves them at a length other than \a{length}.
+ */
+bool RedisCollectionModel::applyChange(const QString &operation, int first, int second, int length)
+{
+    if(operation == "insert")
+    {
+        if(second < 1)
+            return false;
+
+        int row = qMin(toRow(first, length), toRow(first + second - 1, length));
+        if(row < 0 || row > _count)
+            return false;
+
+        beginInsertRows(QModelIndex(), row, row + second - 1);
+        shiftRows(row, _count - 1, second);
+        _count += second;
+        ++_generation;
+        _pendingPages.clear();
+        endInsertRows();
+
+        emit countChanged(_count);
+    }
+    else if(operation == "remove")
+    {
+        if(second < 1)
+            return false;
+
+        int row = qMin(toRow(first, length + second), toRow(first + second - 1, length + second));
+        if(row < 0 || row + second > _count)
+            return false;
+
+        beginRemoveRows(QModelIndex(), row, row + second - 1);
+        for(int i = row; i < row + second; i++)
+            _items.remove(i);
+        shiftRows(row + second, _count - 1, -second);
+        _count -= second;
+        ++_generation;
+        _pendingPages.clear();
+        endRemoveRows();
+
+        emit countChanged(_count);
+    }
+    else if(operation == "update")
+    {
+        if(second < 1)
+            return false;
+
+        int row = qMin(toRow(first, length), toRow(first + second - 1, length));
+        if(row < 0 || row + second > _count)
+            return false;
+
+        for(int i = row; i < row + second; i++)
+            _items.remove(i);
+
+        emit dataChanged(index(row), index(row + second - 1));
+    }
+    else if(operation == "move")
+    {
+        int from = toRow(first, length);
+        int to = toRow(second, length);
+        if(from < 0 || from >= _count || to < 0 || to >= _count)
+            return false;
+
+        _items.remove(from);
+
+        if(from != to)
+        {
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to);
+            if(to > from)
+                shiftRows(from + 1, to, -1);
+            else
+                shiftRows(to, from - 1, 1);
+            ++_generation;
+            _pendingPages.clear();
+            endMoveRows();
+        }
+
+        // The moved element has changed too.
+        emit dataChanged(index(to), index(to));
+    }
+    else
+    {
+        return false;
+    }
+
+    return _count == length;
+}
+
+/*!
+ * \brief Moves the cached rows from \a{first} to \a{last} (inclusive) by \a{offset} rows. The rows they move onto must not be cached.
+ */
+void RedisCollectionModel::shiftRows(int first, int last, int offset)
+{
+    if(first > last || _items.isEmpty())
+        return;
+
+    QHash<int, Item> shifted;
+    shifted.reserve(_items.size());
+
+    for(QHash<int, Item>::const_iterator iter = _items.constBegin(); iter != _items.constEnd(); ++iter)
+        shifted.insert(iter.key() >= first && iter.key() <= last ? iter.key() + offset : iter.key(), iter.value());
+
+    _items.swap(shifted);
+}
+
+/*!
+ * \brief Resets the model to \a{count} rows, none of them cached.
+ */
+void RedisCollectionModel::resetRows(int count)
+{
+    beginResetModel();
+
+    _items.clear();
+    _pendingPages.clear();
+    _deferredPages.clear();
+    ++_generation;
+
+    bool changed = _count != count;
+    _count = count;
+    ++_resets;
+
+    endResetModel();
+
+    if(changed)
+        emit countChanged(_count);
+}
+
+/*!
+ * \brief Returns the number of rows kept in the cache: cachedPages() pages, but no fewer than are fetched for a single row.
+ */
+int RedisCollectionModel::cacheCapacity() const
+{
+    return qMax(_cachedPages, 2 * _prefetchPages + 1) * _pageSize;
+}
@@ -0,0 +1,218 @@
+#ifndef REDISCOLLECTIONMODEL_H
+#define REDISCOLLECTIONMODEL_H
+
+#include <QAbstractListModel>
+#include <QQmlParserStatus>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVariantMap>
+#include "RedisTransport.h"
+#include "ValueCodec.h"
+
+class RedisCollectionModel : public QAbstractListModel, public QQmlParserStatus
+{
+    Q_OBJECT
+    Q_INTERFACES(QQmlParserStatus)
+    Q_PROPERTY(QString serverUrl     READ serverUrl     WRITE setServerUrl     NOTIFY serverUrlChanged    )
+    Q_PROPERTY(QString key           READ key           WRITE setKey           NOTIFY keyChanged          )
+    Q_PROPERTY(int     pageSize      READ pageSize      WRITE setPageSize      NOTIFY pageSizeChanged     )
+    Q_PROPERTY(int     prefetchPages READ prefetchPages WRITE setPrefetchPages NOTIFY prefetchPagesChanged)
+    Q_PROPERTY(int     cachedPages   READ cachedPages   WRITE setCachedPages   NOTIFY cachedPagesChanged  )
+    Q_PROPERTY(QString valueCodec    READ valueCodec    WRITE setValueCodec    NOTIFY valueCodecChanged   )
+    Q_PROPERTY(bool    threaded      READ threaded      WRITE setThreaded      NOTIFY threadedChanged     )
+    Q_PROPERTY(int     count         READ count                                NOTIFY countChanged        )
+
+public:
+
+    /** Roles under which the rows' data is exposed (as "value" and "score" in QML). */
+    enum Roles
+    {
+        ValueRole = Qt::UserRole + 1,   /**< The element (list value or set member), decoded with the value codec. */
+        ScoreRole                       /**< The member's score (sorted sets only). */
+    };
+
+    /** Constructor. */
+    explicit RedisCollectionModel(QObject* parent = 0);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+    QHash<int, QByteArray> roleNames() const;
+
+    void classBegin();
+    void componentComplete();
+
+    QString serverUrl() const;
+    QString key() const;
+    int pageSize() const;
+    int prefetchPages() const;
+    int cachedPages() const;
+    QString valueCodec() const;
+    bool threaded() const;
+    int count() const;
+
+    /** Returns counters describing the model's traffic (fetches, rowsFetched, staleFetches, notifications, resets, cachedRows). */
+    Q_INVOKABLE QVariantMap statistics() const;
+
+    /** Deletes the collection. */
+    Q_INVOKABLE void clear();
+
+    /** Default number of rows per page, pages fetched on either side of a requested page, and pages kept in the row cache. */
+    static const int DefaultPageSize = 50;
+    static const int DefaultPrefetchPages = 1;
+    static const int DefaultCachedPages = 8;
+
+signals:
+
+    void serverUrlChanged(const QString& value);
+    void keyChanged(const QString& value);
+    void pageSizeChanged(int value);
+    void prefetchPagesChanged(int value);
+    void cachedPagesChanged(int value);
+    void valueCodecChanged(const QString& value);
+    void threadedChanged(bool value);
+    void countChanged(int value);
+
+public slots:
+
+    void setServerUrl(const QString& value);
+    void setKey(const QString& value);
+    void setPageSize(int value);
+    void setPrefetchPages(int value);
+    void setCachedPages(int value);
+    void setValueCodec(const QString& value);
+    void setThreaded(bool value);
+
+    /** Reloads the collection's length from Redis and resets the model, discarding every cached row. */
+    void refresh();
+
+protected:
+
+    /** A cached row. */
+    struct Item
+    {
+        QVariant value;
+        double score;
+    };
+
+    /** Returns the command returning the number of elements in the collection stored at the given key. */
+    virtual QByteArray lengthCommand() const = 0;
+
+    /** Returns the command returning the elements from the given first to last row (inclusive) of the collection at the given key. */
+    virtual QList<QByteArray> rangeCommand(const QByteArray& key, int first, int last) const = 0;
+
+    /** Converts the reply to a rangeCommand() to rows. */
+    virtual QList<Item> parseRange(const QVariant& reply) const = 0;
+
+    /** Returns the row at which the element at the given index (in the collection's own order, counted from the start of a collection of
+     *  the given length) is shown. The default shows elements in the collection's order. */
+    virtual int toRow(int index, int length) const;
+
+    /** Runs the given Lua script against the model's key, passing the change notification channel and the given arguments as ARGV. */
+    void runScript(const char* script, const QList<QByteArray>& arguments);
+
+    /** Encodes/decodes elements with the value codec. */
+    QByteArray encode(const QVariant& value) const;
+    QVariant decode(const QVariant& data) const;
+
+    /** Returns false (and reports it) if the model is not attached to a key, so that the named write cannot be made. */
+    bool checkWritable(const char* method) const;
+
+private slots:
+
+    /** Private handler slots for replies and notifications. */
+    void handleLengthReply();
+    void handleRangeReply();
+    void handleScriptReply();
+    void handleNotification(QString subscription, QString channel, QVariant payload);
+
+    /** Reloads the model after a fetch found the collection changed, if the change has not been announced since. */
+    void resync();
+
+private:
+
+    /** Attaches the model to its server and key once both are set, and loads the collection's length. */
+    void open();
+
+    /** Detaches the model from its key, leaving it empty. */
+    void close();
+
+    /** Returns the channel on which changes to the model's key are announced. */
+    QString notificationChannel() const;
+
+    /** Fetches the page holding the given row, unless it is cached or already being fetched, and the pages around it that are not. */
+    void requestRow(int row) const;
+    void requestPage(int page) const;
+
+    /** Fetches the pages whose fetches raced with a change, now that it has been applied. */
+    void requestDeferredPages();
+
+    /** Evicts the cached rows furthest from the given row until the cache fits its capacity. */
+    void evict(int centre);
+
+    /** Applies a change notification to the rows, returning false if it does not fit the model (which must then be reloaded). */
+    bool applyChange(const QString& operation, int first, int second, int length);
+
+    /** Moves the cached rows from the given first to last row (inclusive) by the given offset. */
+    void shiftRows(int first, int last, int offset);
+
+    /** Resets the model to the given number of uncached rows. */
+    void resetRows(int count);
+
+    /** Returns the number of rows kept in the cache. */
+    int cacheCapacity() const;
+
+    /** Lua script deleting the collection, and announcing it. */
+    static const char* ClearScript;
+
+    /** Delay in milliseconds after which a change found by a fetch, but not announced, is assumed to have been made by another client. */
+    static const int ResyncDelay = 500;
+
+    QString _serverUrl;
+    QString _key;
+    int _pageSize;
+    int _prefetchPages;
+    int _cachedPages;
+    QString _valueCodec;
+    bool _threaded;
+
+    /** Whether the QML component has been completed (or the model was never created from QML). */
+    bool _complete;
+
+    /** Transport to the server, and the codec decoding the collection's elements. */
+    RedisTransport* _transport;
+    QSharedPointer<ValueCodec> _codec;
+
+    /** Channel subscribed to for change notifications. */
+    QString _subscribedChannel;
+
+    /** Number of rows. */
+    int _count;
+
+    /** Cached rows, keyed by row. */
+    QHash<int, Item> _items;
+
+    /** Pages being fetched, and pages whose fetches raced with a change and must be fetched again. */
+    mutable QSet<int> _pendingPages;
+    QSet<int> _deferredPages;
+
+    /** Incremented whenever rows move, so that fetches sent before can be recognised as stale. */
+    int _generation;
+
+    /** Generation of the refresh in flight (or -1), and the collection length last announced while it was. */
+    int _refreshGeneration;
+    int _announcedLength;
+
+    /** Timer used to delay resync(). */
+    QTimer* _resyncTimer;
+
+    /** Counters. */
+    mutable qint64 _fetches;
+    qint64 _rowsFetched;
+    qint64 _staleFetches;
+    qint64 _notifications;
+    qint64 _resets;
+};
+
+#endif // REDISCOLLECTIONMODEL_H
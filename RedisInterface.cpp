@@ -1,10 +1,23 @@
 #include "RedisInterface.h"
+#include "RedisLogging.h"
+
+/** Pattern matching the change notification published with every SET made through a RedisInterface. */
+static const char* const ChangeNotificationPattern = "*_changed";
+
+/** Keyspace notification classes needed by keyspace change notifications: keyspace events for generic, string and hash commands. */
+static const char* const KeyspaceEventClasses = "Kg$h";
+
+/** Markers introducing the origin header at the start of a change notification (before binary payloads, and before any others), and
+ *  the length of the origin ID following them. Both begin like the markers escaped by the codecs, so no value can be mistaken for one. */
+static const char* const BinaryOriginMarker = "\xFFQO:";
+static const char* const TextOriginMarker = "\x1BQO:";
+static const int OriginIdLength = 16;
 
 /*!
     \mainclass
     \class RedisInterface
     \inmodule RedisInterface
-    \brief Provides a common interface for QObject-based objects to communicate via Redis + HTTP.
+    \brief Provides a common interface for QObject-based objects to communicate via Redis.
 
     Redis is a networked, in-memory, key-value data store with an inbuilt publish/subscribe messaging system. The RedisInterface class
     enables binding of Redis values to/from Qt properties, and Redis events to/from Qt methods/signals/slots.
@@ -13,30 +26,140 @@
     to be synchronised (in either direction) with corresponding values on the Redis server. Similarly, any Qt \c{signals} can be set to automatically
     \c{PUBLISH} to Redis events, and any \c{slots}/\c{signals}/ordinary methods can be set up to receive Redis events via \c{SUBSCRIBE}/\c{PSUBSCRIBE}.
 
+    Commands are sent using the RedisTransport selected by the scheme of the server URL: \c{http://} URLs are sent as HTTP requests to a
+    webdis proxy, while \c{redis://} URLs speak the native Redis protocol directly to redis-server over persistent TCP connections. The
+    property/event binding API is identical for both.
+
+    Every RedisInterface on a thread that targets the same server shares one connection (see SharedConnection): the same command
+    connection(s) and a single subscriber connection, however many interfaces exist. Subscriptions to the same channel from different
+    interfaces are merged into one. Incoming messages are routed to their local methods and properties through an in-process dispatch
+    table, so adding or removing a binding at runtime simply subscribes or unsubscribes the channel on the shared connection.
+
+    The connection can optionally be driven from a dedicated I/O thread (see the constructor), which keeps socket reads, protocol
+    parsing and the inflation of compressed payloads off the GUI thread under heavy subscription traffic. Decoding values and
+    dispatching them to bindings still happen on the interface's own thread.
+
+    Requests are sent in priority lanes (see RequestScheduler): reads whose results are waited for are only held back by queued writes
+    to the keys they read (so that they never return the value from before such a write), while the writes made by bindings are limited
+    in number in flight, so that a burst of them cannot delay a read made in response to user input.
+    A binding can be demoted further with a \c{lane} option (eg. \c{{lane: "background"}}), lane limits are set with setLaneLimit(),
+    and queued low-priority work can be dropped with cancelQueued().
+
+    Lost connections are re-established automatically, and every subscription is restored. Since any change notifications published
+    while disconnected are lost, every subscribed property is then re-read from Redis (in one pipelined batch), so that local state
+    converges as soon as the connection is back. The connection state and the duration of the last resynchronisation are reported by
+    connectionState() and lastResyncDuration().
+
+    Whole objects can be bound to a Redis hash, one field per property (see publishObject() and subscribeToObject()). Only the fields
+    that have changed are written, with a single \c{HSET}, and a single change notification carries just those fields, so updating many
+    properties of an object costs one write and one message rather than one of each per property.
+
+    A process that both publishes and subscribes to the same property would otherwise receive its own change notifications back, and
+    write the value it has just published to the property again. Every change notification therefore begins with an origin header (a
+    marker and an ID unique to the RedisInterface), and notifications from the interface itself are dropped before they are decoded. The
+    header is \c{"\\x1BQO:"} (or \c{"\\xFFQO:"}, before a binary payload) followed by 16 hex digits (inside the compressed data, if the
+    notification is compressed); other clients reading change notifications must skip it. Values never begin with either marker, since
+    the codecs escape any value that would (see TextValueCodec). Only change notifications of subscribed properties and objects are
+    checked for a header, so event payloads and other channels are delivered untouched. Bound properties and object fields are also not
+    written at all when their value equals the last value known to be in Redis (the last value successfully written, or received in a
+    change notification), so a value received from Redis is never echoed back to it.
+
+    Events can also be delivered through Redis streams rather than pub/sub (see subscribeToEvent() and publishEvent()). Pub/sub
+    delivery is fire-and-forget, so a slow or briefly disconnected client misses events; entries appended to a stream are kept, and are
+    read in batches (see StreamConsumer), resuming from the last entry seen after an outage, optionally shared out by a consumer group.
+
+    Outgoing commands are batched: everything issued within one event loop turn (or within the window set by setBatchWindow()) is sent
+    to Redis as a single pipeline, so updating many published properties at once costs one round trip rather than one per property.
+
+    Published signals and properties are resolved once, when they are bound, into flat tables indexed by the method index of the
+    triggering signal, holding pre-encoded channel names and keys. Emitting a bound signal therefore involves no string building, map
+    lookups or name-based property access, and NOTIFY signals may be named arbitrarily.
+
+    Repeated reads can be served from an optional client-side read cache (see setCacheSize()), holding the most recently used \c{GET}
+    results. On a native connection to Redis 6 or later, the cache is kept coherent by server-assisted key tracking: the server reports
+    every change to a key the cache has read. Otherwise, the cache subscribes to the \c{key_changed} notifications published with every
+    \c{SET} made through a RedisInterface, and so only sees changes made that way (or, with keyspace change notifications, to every
+    keyspace notification of the database).
+
+    Change notifications can instead be taken from Redis itself (see setChangeNotifications()). In \c{"keyspace"} mode, a write is a
+    single \c{SET} (or \c{HSET}) with no accompanying \c{PUBLISH}, and subscribed properties and objects follow the server's keyspace
+    notifications (\c{__keyspace@N__:key}) instead of \c{key_changed}. Those carry only the name of the command, so the keys they
+    report are collected and re-read once per event loop turn, with a single multi-key read for properties (and an \c{HGETALL} per
+    object), however many times they changed in the meantime. Since the server announces every write, this follows changes made by
+    any client, not only those using a RedisInterface.
+
+    Compound operations can be moved to the server as Lua scripts (see registerScript() and runScript()), so that several dependent
+    steps take a single round trip and run atomically. Scripts are loaded once and invoked by their digest (see ScriptRegistry).
+
+    Large payloads can be compressed to save bandwidth (see setCompressionThreshold(), and the \c{compress} option of publishProperty(),
+    publishObject() and publishEvent()). Compressed payloads carry a marker, and are inflated whatever the reader's own settings and
+    transport (see PayloadCompressor), but other Redis clients will not be able to read them. With a threaded transport, replies and
+    messages are inflated on the transport's thread, before they reach the interface.
+
+    Values are converted to and from the bytes stored in Redis by a ValueCodec (see setValueCodec()). The default codec stores text that
+    other Redis clients can read; the \c{"binary"} codec stores values in \l{QDataStream} form, preserving their types exactly. Either
+    way, values received for a subscribed property are converted to the type of the property.
+
     In addition to event/property binding, the \c{RedisInterface} supports a nominal set of 'once-off' commands such as \c{GET},\c{SET}, and \c{PUBLISH}.
     This set of commands will be expanded in the future as required.
 
+    Once-off requests are best made asynchronously: getAsync(), setAsync() and execute() (which sends any command) return a RedisPromise,
+    which can be chained with continuations or converted to a \l{QFuture}. The synchronous get() blocks in a nested event loop and can be
+    compiled out by defining \c{REDIS_NO_SYNCHRONOUS_GET}.
+
     A QML wrapper is provided by the QMLRedisInterface class.
 
-    \sa QMLRedisInterface
+    \sa QMLRedisInterface, RedisTransport
 */
 
 /*!
- * \brief Constructor. Enables this object to interact with the Redis (webdis) server at \a{serverUrl}
+ * \brief Constructor. Enables this object to interact with the Redis server at \a{serverUrl} (either a webdis \c{http://} URL or a
+ * native \c{redis://} URL)
  * and map Redis events/properties to \c{signals}/\c{slots}/properties on the given \c{QObject}-based \a{parent} (and vice versa).
+ *
+ * If \a{threaded} is true, all network I/O, protocol parsing and inflation of compressed payloads is performed on a dedicated worker
+ * thread (see ThreadedTransport), and this object's thread receives parsed replies and messages in batches. Decoding them with the value
+ * codec, and dispatching them to bindings, still happens on this object's thread. Bindings behave identically either way.
  */
-RedisInterface::RedisInterface(QString serverUrl, QObject *parent) :
+RedisInterface::RedisInterface(QString serverUrl, QObject *parent, bool threaded) :
     QObject(parent),
     _serverUrl(serverUrl),
-    _networkInterface(new QNetworkAccessManager(this))
+    _threaded(threaded),
+    _transport(new SharedTransport(serverUrl, threaded, this)),
+    _codec(ValueCodec::create("text", _transport->isBinarySafe())),
+    _signalRelay(new SignalRelay(this, RedisInterface::getSlot(this, "handlePublishedEventArguments(int,QVariantList)"), this)),
+    _cacheEpoch(0),
+    _cacheSubscribed(false),
+    _lastResyncDuration(-1),
+    _originId(QUuid::createUuid().toRfc4122().toHex().left(OriginIdLength)),
+    _keyspaceNotifications(false),
+    _keyspacePrefix(keyspacePrefix(serverUrl)),
+    _configureServer(false),
+    _keyspaceTimer(new QTimer(this)),
+    _scripts(new ScriptRegistry(_transport, this)),
+    _compressor(_transport->isBinarySafe()),
+    _compressionThreshold(0),
+    _scheduler(new RequestScheduler(_transport, this))
 {
-    // Make sure Redis server URL ends with a slash.
-    if(!_serverUrl.endsWith("/"))
-        _serverUrl.append("/");
-
     // Fail hard if no parent is given.
     if(parent == NULL)
         throw std::runtime_error("RedisInterface::RedisInterface(): RedisInterface constructor must be passed a non-null QObject-based parent!");
+
+    // Route every message arriving on the subscriber connection through the dispatch table.
+    connect(_transport, SIGNAL(messageReceived(QString,QString,QVariant)), this, SLOT(handleSubscriptionMessage(QString,QString,QVariant)));
+
+    // Keep the read cache coherent with changes reported by the server.
+    connect(_transport, SIGNAL(keysInvalidated(QStringList)), this, SLOT(handleKeysInvalidated(QStringList)));
+    connect(_transport, SIGNAL(keyTrackingChanged(bool)), this, SLOT(handleKeyTrackingChanged(bool)));
+
+    // Catch up on anything missed while disconnected.
+    connect(_transport, SIGNAL(connectionStateChanged(RedisTransport::ConnectionState)), this, SLOT(handleConnectionStateChanged(RedisTransport::ConnectionState)));
+    connect(_transport, SIGNAL(resubscribed()), this, SLOT(handleResubscribed()));
+
+    // Keys reported by keyspace notifications are re-read together, once per event loop turn.
+    _keyspaceTimer->setSingleShot(true);
+    _keyspaceTimer->setInterval(0);
+    connect(_keyspaceTimer, SIGNAL(timeout()), this, SLOT(handleKeyspaceFetch()));
 }
 
 /*!
@@ -81,6 +204,41 @@ QMetaMethod RedisInterface::getSlot(QObject *object, QString signature)
     return QMetaMethod();
 }
 
+/*!
+ * \brief Inspects the meta-object of the given \a{object} and returns the method (or, if \a{signalsOnly} is true, the \c{signal}) named
+ * by \a{nameOrSignature}. A full signature (eg. \c{"valueChanged(int)"}) must match exactly. A bare name (eg. \c{"valueChanged"})
+ * matches an overload without parameters if there is one, and otherwise the most derived method of that name, so that QML functions
+ * and signals with parameters can be bound by name. Returns an invalid \l{QMetaMethod} if no method matches.
+ */
+QMetaMethod RedisInterface::resolveMethod(QObject *object, QString nameOrSignature, bool signalsOnly)
+{
+    if(object == NULL)
+    {
+        std::cerr << "RedisInterface::resolveMethod(): Can't find method on NULL!";
+        return QMetaMethod();
+    }
+
+    if(nameOrSignature.contains("("))
+        return signalsOnly ? getSignal(object, nameOrSignature) : getMethod(object, nameOrSignature);
+
+    QMetaMethod method = signalsOnly ? getSignal(object, nameOrSignature + "()") : getMethod(object, nameOrSignature + "()");
+    if(method.isValid())
+        return method;
+
+    const QMetaObject* metaObject = object->metaObject();
+    QByteArray name = nameOrSignature.toUtf8();
+
+    for(int i = metaObject->methodCount() - 1; i >= 0; --i)
+    {
+        QMetaMethod candidate = metaObject->method(i);
+
+        if(candidate.name() == name && (!signalsOnly || candidate.methodType() == QMetaMethod::Signal))
+            return candidate;
+    }
+
+    return QMetaMethod();
+}
+
 /*!
  * \brief Inspects the meta-object of the given \a{object} and returns the \c{Q_PROPERTY} with the given \a{propertyName}.
  * Returns an invalid \l{QMetaProperty} if the property could not be found.
@@ -98,21 +256,62 @@ QMetaProperty RedisInterface::getProperty(QObject *object, QString propertyName)
 /*!
  * \brief Adds a subscription to the Redis event \a{remoteEventName}, which will cause \a{localMethodName} (if valid) to be invoked
  * each time \a{remoteEventName} occurs.
+ *
+ * \a{localMethodName} may be a full signature (eg. \c{"handleReading(QString,double)"}) or a bare name. The method receives the
+ * arguments of the event (see publishEvent()), each converted to the type of its parameter; it may take fewer parameters than the event
+ * has arguments. Events published with publish() carry their value as a single argument.
+ *
+ * \a{remoteEventName} may be a glob-style pattern (eg. \c{"sensor:*:temperature"}), in which case the method is invoked for events on
+ * every matching channel. To find out which channel an event arrived on, the method's first parameter may be a \l{QString} (or, for
+ * QML functions, \l{QVariant}) named \c{channel}, eg. \c{"handleReading(QString channel, double value)"}. An unnamed sole parameter
+ * of either type also receives the channel name, eg. \c{"handleSensorEvent(QString)"}.
+ *
+ * By default, events are received through pub/sub, so events published while this client is slow to read them or disconnected are
+ * lost. Passing \c{{mode: "stream"}} as the \a{options} reads them from the Redis stream \a{remoteEventName} instead (see
+ * publishEvent()), so that none are lost: entries are read in batches by a blocking read on a connection of its own, and delivery resumes
+ * from the last entry seen after an outage. The stream's key is passed as the channel name; patterns are not supported. The options may
+ * also give:
+ *
+ * \list
+ * \li \c{group}: a consumer group to read the stream in, sharing its entries with the group's other consumers. Entries are then
+ *     acknowledged in batches once dispatched, and entries left unacknowledged are delivered again, so delivery is at-least-once.
+ * \li \c{consumer}: the name of this consumer within the group (by default, the host name and process ID). A fixed name lets a
+ *     restarted client receive the entries it had not acknowledged.
+ * \li \c{count}: the maximum number of entries read per round trip (default 100).
+ * \li \c{block}: how long, in milliseconds, each read waits for new entries (default 1000).
+ * \endlist
+ *
+ * Every stream bound with the same group (or without one) is read by the same blocking read, so its \c{consumer}, \c{count} and
+ * \c{block} apply to all of them. Entries added by other clients (without the \c{payload} field written by publishEvent()) are passed
+ * as a single argument holding a map of their fields.
  */
-bool RedisInterface::subscribeToEvent(QString remoteEventName, QString localMethodName)
+bool RedisInterface::subscribeToEvent(QString remoteEventName, QString localMethodName, QVariantMap options)
 {
-    // Append parentheses if missing.
-    if(!localMethodName.endsWith("()"))
-        localMethodName += "()";
-
     // Locate target method in parent's meta-object.
-    QMetaMethod localMethod = RedisInterface::getMethod(parent(), localMethodName);
+    QMetaMethod localMethod = RedisInterface::resolveMethod(parent(), localMethodName);
+    QString mode = options.value("mode", "pubsub").toString();
 
-    if(localMethod.isValid())
+    if(localMethod.isValid() && !RedisInterface::acceptsEventArguments(localMethod))
+    {
+        std::cerr << "RedisInterface::subscribeToEvent(): Target method " << localMethodName.toStdString() << " has parameters of unknown types, or too many of them!" << std::endl;
+        return false;
+    }
+    else if(localMethod.isValid() && mode == "stream")
+    {
+        return subscribeToStream(remoteEventName, localMethod, options);
+    }
+    else if(localMethod.isValid() && mode != "pubsub")
     {
+        std::cerr << "RedisInterface::subscribeToEvent(): Unknown delivery mode " << mode.toStdString() << "!" << std::endl;
+        return false;
+    }
+    else if(localMethod.isValid())
+    {
+        qCDebug(lcRedisInterface) << "Connecting remote event" << remoteEventName << "to local method" << localMethod.name();
+
         // Set remoteEventName to call localMethod each time it is triggered.
-        addEventSubscription(remoteEventName, parent(), localMethod);
         _subscribedEvents.insert(remoteEventName, localMethod);
+        updateSubscriptions();
 
         return true;
     }
@@ -124,27 +323,173 @@ bool RedisInterface::subscribeToEvent(QString remoteEventName, QString localMeth
 }
 
 /*!
- * \brief Adds a publication of \a{localSignalName}, which (if valid) will cause a \a{remoteEventName} event to be sent to Redis
- * each time the local signal is emitted is emitted.
+ * \brief Binds \a{method} to the entries of the stream \a{key}, read by the consumer for the consumer group given in \a{options} (which
+ * is created on first use). See subscribeToEvent().
+ */
+bool RedisInterface::subscribeToStream(const QString &key, const QMetaMethod &method, const QVariantMap &options)
+{
+    if(RedisTransport::isPattern(key))
+    {
+        std::cerr << "RedisInterface::subscribeToStream(): Streams can't be read by pattern (" << key.toStdString() << ")!" << std::endl;
+        return false;
+    }
+
+    QString group = options.value("group").toString();
+    QHash<QString, StreamSubscription>::iterator subscription = _subscribedStreams.find(key);
+
+    if(subscription != _subscribedStreams.end() && subscription->consumer->group() != group)
+    {
+        std::cerr << "RedisInterface::subscribeToStream(): Stream " << key.toStdString() << " is already read in another consumer group!" << std::endl;
+        return false;
+    }
+
+    StreamConsumer* consumer = _streamConsumers.value(group);
+
+    if(consumer == NULL)
+    {
+        consumer = new StreamConsumer(_serverUrl, _threaded, _transport, group, options.value("consumer").toString(), this);
+        connect(consumer, SIGNAL(entriesReceived(QString,QVariantList)), this, SLOT(handleStreamEntries(QString,QVariantList)));
+
+        _streamConsumers.insert(group, consumer);
+    }
+
+    if(options.contains("count"))
+        consumer->setCount(options.value("count").toInt());
+
+    if(options.contains("block"))
+        consumer->setBlockTime(options.value("block").toInt());
+
+    if(subscription == _subscribedStreams.end())
+    {
+        subscription = _subscribedStreams.insert(key, StreamSubscription());
+        subscription->consumer = consumer;
+        consumer->addStream(key);
+    }
+
+    qCDebug(lcRedisInterface) << "Connecting remote stream" << key << "to local method" << method.name();
+
+    subscription->methods.append(EventMarshaller(method));
+    return true;
+}
+
+/*!
+ * \brief Removes the binding between the Redis event \a{remoteEventName} and \a{localMethodName}. If no other bindings remain on
+ * \a{remoteEventName}, the channel is unsubscribed (or the stream is no longer read).
+ */
+bool RedisInterface::unsubscribeFromEvent(QString remoteEventName, QString localMethodName)
+{
+    QMetaMethod localMethod = RedisInterface::resolveMethod(parent(), localMethodName);
+
+    if(localMethod.isValid() && _subscribedEvents.remove(remoteEventName, localMethod) > 0)
+    {
+        updateSubscriptions();
+        return true;
+    }
+    else if(localMethod.isValid() && unsubscribeFromStream(remoteEventName, localMethod))
+    {
+        return true;
+    }
+    else
+    {
+        std::cerr << "RedisInterface::unsubscribeFromEvent(): Method " << localMethodName.toStdString() << " is not bound to " << remoteEventName.toStdString() << std::endl;
+        return false;
+    }
+}
+
+/*!
+ * \brief Removes the binding between the stream \a{key} and \a{method}. Once no bindings remain, the stream is no longer read, and a
+ * consumer left without streams is closed. Returns false if the method was not bound to the stream.
  */
-void RedisInterface::publishEvent(QString localSignalName, QString remoteEventName)
+bool RedisInterface::unsubscribeFromStream(const QString &key, const QMetaMethod &method)
 {
-    // Append parentheses if missing.
-    if(!localSignalName.endsWith("()"))
-        localSignalName.append("()");
+    QHash<QString, StreamSubscription>::iterator subscription = _subscribedStreams.find(key);
+    if(subscription == _subscribedStreams.end())
+        return false;
+
+    QList<EventMarshaller>& methods = subscription->methods;
+    int index = 0;
 
-    // Locate the source signal in parent's meta-obeject.
-    QMetaMethod localSignal = RedisInterface::getSignal(parent(), localSignalName);
+    while(index < methods.size() && methods.at(index).method() != method)
+        ++index;
+
+    if(index == methods.size())
+        return false;
+
+    methods.removeAt(index);
+
+    if(methods.isEmpty())
+    {
+        StreamConsumer* consumer = subscription->consumer;
+
+        _subscribedStreams.erase(subscription);
+        consumer->removeStream(key);
+
+        if(consumer->streams().isEmpty())
+        {
+            _streamConsumers.remove(consumer->group());
+            consumer->deleteLater();
+        }
+    }
+
+    return true;
+}
+
+/*!
+ * \brief Adds a publication of \a{localSignalName}, which (if valid) will cause a \a{remoteEventName} event to be sent to Redis
+ * each time the local signal is emitted.
+ *
+ * \a{localSignalName} may be a full signature or a bare name. The arguments of each emission are sent with the event, encoded as a list
+ * by the value codec, so subscribers receive them in the same message (see subscribeToEvent()). A signal's parameter types are resolved
+ * once, here. Signals without parameters publish their signature as the payload, as they always have.
+ *
+ * Passing \c{{mode: "stream"}} as the \a{options} appends each event to the Redis stream \a{remoteEventName} with \c{XADD} instead of
+ * publishing it, so that it can be read losslessly (see subscribeToEvent()). The payload is stored in the entry's \c{payload} field.
+ * Giving \c{maxLength} as well trims the stream to roughly that many entries as it grows (\c{MAXLEN ~}), which is much cheaper than
+ * exact trimming.
+ *
+ * Giving \c{compress} in the \a{options} compresses the payloads of at least that many bytes (or, with \c{true}, of at least
+ * PayloadCompressor::DefaultThreshold bytes), overriding setCompressionThreshold(). Events are sent in the bulk lane (see
+ * RequestScheduler), unless the \a{options} give another \c{lane}.
+ */
+void RedisInterface::publishEvent(QString localSignalName, QString remoteEventName, QVariantMap options)
+{
+    // Locate the source signal in parent's meta-object.
+    QMetaMethod localSignal = RedisInterface::resolveMethod(parent(), localSignalName, true);
+    QString mode = options.value("mode", "pubsub").toString();
 
-    if(localSignal.isValid())
+    if(localSignal.isValid() && !RedisInterface::acceptsEventArguments(localSignal))
+    {
+        std::cerr << "RedisInterface::publishEvent(): Source signal " << localSignalName.toStdString() << " has parameters of unknown types, or too many of them!" << std::endl;
+    }
+    else if(localSignal.isValid() && mode != "pubsub" && mode != "stream")
+    {
+        std::cerr << "RedisInterface::publishEvent(): Unknown delivery mode " << mode.toStdString() << "!" << std::endl;
+    }
+    else if(localSignal.isValid())
     {
-        qDebug() << "[RedisInterface] Connecting local signal" << localSignalName << "to remote event" << remoteEventName;
+        qCDebug(lcRedisInterface) << "Connecting local signal" << localSignal.methodSignature() << "to remote event" << remoteEventName;
+
+        // Set handlePublishedEvent() (or, to capture its arguments, handlePublishedEventArguments()) to be called each time the signal is emitted.
+        if(localSignal.parameterCount() == 0)
+            connect(parent(), localSignal, this, RedisInterface::getSlot(this, "handlePublishedEvent()"), Qt::UniqueConnection);
+        else
+            _signalRelay->relay(parent(), localSignal);
+
+        PublishedEvent event;
+        event.remoteEventName = remoteEventName.toUtf8();
+        event.payload = localSignal.methodSignature();
+        event.stream = (mode == "stream");
 
-        // Set handlePublishedEvent() to be called each time localSignalName is emitted..
-        QMetaMethod publishSlot = RedisInterface::getSlot(this, "handlePublishedEvent()");
-        connect(parent(), localSignal, this, publishSlot);
+        if(event.stream && options.value("maxLength").toLongLong() > 0)
+            event.maxLength = QByteArray::number(options.value("maxLength").toLongLong());
 
-        _publishedEvents.insert(localSignalName, remoteEventName);
+        event.compressionThreshold = compressionThreshold(options);
+        event.lane = bindingLane(options);
+
+        if(_publishedEvents.size() <= localSignal.methodIndex())
+            _publishedEvents.resize(localSignal.methodIndex() + 1);
+
+        _publishedEvents[localSignal.methodIndex()].append(event);
     }
     else
     {
@@ -158,21 +503,59 @@ void RedisInterface::publishEvent(QString localSignalName, QString remoteEventNa
  */
 void RedisInterface::subscribeToProperty(QString remotePropertyName, QString localPropertyName)
 {
-    qDebug() << "[RedisInterface] Mapping remote property" << remotePropertyName << "to local property" << localPropertyName;
+    QMetaProperty property = RedisInterface::getProperty(parent(), localPropertyName);
+
+    if(property.isValid())
+    {
+        qCDebug(lcRedisInterface) << "Mapping remote property" << remotePropertyName << "to local property" << localPropertyName;
+
+        // Update localPropertyName each time the change notification for remotePropertyName is received.
+        _subscribedProperties.insert(remotePropertyName, property);
+        updateSubscriptions();
+    }
+    else
+    {
+        std::cerr << "[RedisInterface] Error: Property " << localPropertyName.toStdString() << " is invalid!" << std::endl;
+    }
+}
+
+/*!
+ * \brief Removes the binding between the Redis property \a{remotePropertyName} and \a{localPropertyName}. If no other bindings remain
+ * on \a{remotePropertyName}, its change notification channel is unsubscribed.
+ */
+void RedisInterface::unsubscribeFromProperty(QString remotePropertyName, QString localPropertyName)
+{
+    QMultiMap<QString, QMetaProperty>::iterator iter = _subscribedProperties.find(remotePropertyName);
 
-    // Set handleSubscribedPropertyUpdate() to be called each time the '_changed' event for remotePropertyName is received.
-    QMetaMethod propertyUpdateSlot = RedisInterface::getSlot(this, "handleSubscribedPropertyUpdate()");
-    addEventSubscription(remotePropertyName + "_changed", this, propertyUpdateSlot);
+    while(iter != _subscribedProperties.end() && iter.key() == remotePropertyName)
+    {
+        if(localPropertyName == iter.value().name())
+            iter = _subscribedProperties.erase(iter);
+        else
+            ++iter;
+    }
 
-    _subscribedProperties.insert(remotePropertyName, RedisInterface::getProperty(parent(), localPropertyName));
+    updateSubscriptions();
 }
 
 /*!
  * \brief Adds a publication of the local property \a{localPropertyName}, which will cause the Redis property \a{remotePropertyName} to be
  * automatically updated each time the local property changes. In addition, a "remotePropertyName_changed" Redis event will be generated to notify
- * any subscribers to the updated property.
+ * any subscribers to the updated property (unless change notifications are taken from the keyspace; see setChangeNotifications()).
+ *
+ * The optional \a{policy} controls how often the property is written (see PublishThrottle): \c{{policy: "rate", rate: 10}} publishes the
+ * latest value at most 10 times per second, \c{{policy: "idle"}} publishes once the event loop is idle, and
+ * \c{{policy: "debounce", interval: 250}} publishes once the property has been stable for 250ms. Intermediate values are conflated, so
+ * only the newest value is written. By default, every change is published.
+ *
+ * A \c{compress} entry in the \a{policy} compresses the values of at least that many bytes (or, with \c{true}, of at least
+ * PayloadCompressor::DefaultThreshold bytes) before they are written and published, overriding setCompressionThreshold(). Eg.
+ * \c{{compress: 4096}} suits a property holding large JSON documents.
+ *
+ * Values are written in the bulk lane (see RequestScheduler), unless the \a{policy} gives another \c{lane}. While the lane is at its
+ * limit, a newer value of the property replaces the queued one.
  */
-void RedisInterface::publishProperty(QString localPropertyName, QString remotePropertyName)
+void RedisInterface::publishProperty(QString localPropertyName, QString remotePropertyName, QVariantMap policy)
 {
     // Locate the local property on the parent's meta-object.
     QMetaProperty property = RedisInterface::getProperty(parent(), localPropertyName);
@@ -183,9 +566,29 @@ void RedisInterface::publishProperty(QString localPropertyName, QString remotePr
         QMetaMethod notifySignal = property.notifySignal();
         QMetaMethod setSlot = RedisInterface::getSlot(this, "handlePublishedPropertyUpdate()");
 
-        qDebug() << "[RedisInterface] Mapping local property" << localPropertyName << "to remote property" << remotePropertyName << "(via notify signal" << notifySignal.name() + "())";
-        connect(parent(), notifySignal, this, setSlot);
-        _publishedProperties.insert(localPropertyName, remotePropertyName);
+        qCDebug(lcRedisInterface) << "Mapping local property" << localPropertyName << "to remote property" << remotePropertyName << "(via notify signal" << notifySignal.name() + "())";
+        connect(parent(), notifySignal, this, setSlot, Qt::UniqueConnection);
+
+        PublishedProperty binding;
+        binding.property = property;
+        binding.remoteKey = remotePropertyName.toUtf8();
+        binding.changedChannel = QString(remotePropertyName + "_changed").toUtf8();
+        binding.compressionThreshold = compressionThreshold(policy);
+        binding.lane = bindingLane(policy);
+
+        // Route changes through a throttle if the property has a publish policy.
+        binding.throttle = PublishThrottle::fromPolicy(policy, this);
+        if(binding.throttle)
+        {
+            binding.throttle->setIndex(_publishedProperties.size());
+            connect(binding.throttle, SIGNAL(fire()), this, SLOT(handleThrottledPropertyUpdate()));
+        }
+
+        if(_publishedPropertiesBySignal.size() <= notifySignal.methodIndex())
+            _publishedPropertiesBySignal.resize(notifySignal.methodIndex() + 1);
+
+        _publishedPropertiesBySignal[notifySignal.methodIndex()].append(_publishedProperties.size());
+        _publishedProperties.append(binding);
     }
     else
     {
@@ -194,276 +597,1872 @@ void RedisInterface::publishProperty(QString localPropertyName, QString remotePr
 }
 
 /*!
- * \brief Subscribes to the Redis event \a{remoteEventName}, connecting it to the \a{targetMethod} method belonging to \a{targetObject}.
+ * \brief Adds a publication of the parent's properties named \a{localPropertyNames} (by default, every property declared by the
+ * parent's own class, eg. those declared in a QML component) as the fields of the Redis hash \a{remoteHashKey}, named after the
+ * properties. Properties without a NOTIFY signal are skipped.
+ *
+ * Changes are not written as they happen. Instead, changed fields are marked dirty, and once per event loop turn every dirty field is
+ * written with a single multi-field \c{HSET}, along with a single \c{PUBLISH} on \c{"remoteHashKey_changed"} carrying a map of just the
+ * changed fields, in one atomic transaction. A \a{policy} may be given to write less often, as for publishProperty(); every change made
+ * in the meantime is still written, since it is the set of dirty fields that is conflated. As for publishProperty(), a \c{compress}
+ * entry in the \a{policy} compresses the fields (and change notifications) of at least that many bytes, and a \c{lane} entry selects
+ * the lane the writes are sent in (by default, the bulk lane).
  */
-void RedisInterface::addEventSubscription(QString remoteEventName, QObject* targetObject, QMetaMethod targetMethod)
+void RedisInterface::publishObject(QString remoteHashKey, QStringList localPropertyNames, QVariantMap policy)
 {
-    if(targetObject != NULL && targetMethod.isValid() && targetMethod.enclosingMetaObject() == targetObject->metaObject())
-    {
-        // Use pattern subscribe for remote events containing wildcards.
-        QString subscribeCommand = remoteEventName.contains("*") ? "PSUBSCRIBE" : "SUBSCRIBE";
+    PublishedObject binding;
+    binding.remoteKey = remoteHashKey.toUtf8();
+    binding.changedChannel = QString(remoteHashKey + "_changed").toUtf8();
+    binding.compressionThreshold = compressionThreshold(policy);
+    binding.lane = bindingLane(policy);
 
-        qDebug() << "[RedisInterface] Connecting remote event" << remoteEventName << "to local method" << targetMethod.name() << "using" << subscribeCommand;
+    QMetaMethod updateSlot = RedisInterface::getSlot(this, "handlePublishedObjectUpdate()");
+    int index = _publishedObjects.size();
 
-        // Make the subscription request via Redis (over HTTP via webdis).
-        QNetworkReply* reply = _networkInterface->get(QNetworkRequest(QUrl(_serverUrl + subscribeCommand + "/" + remoteEventName)));
-        QMetaMethod readyRead = RedisInterface::getSignal(reply, "readyRead()");
-        connect(reply, readyRead, targetObject, targetMethod);
-        connect(reply, SIGNAL(finished()), reply, SLOT(deleteLater()));
-    }
-    else
+    foreach(const QMetaProperty& property, objectProperties(localPropertyNames))
     {
-        if(targetObject == NULL)
+        if(!property.hasNotifySignal())
         {
-            std::cerr << "[RedisInterface] addEventSubscription(): targetObject must not be NULL!" << std::endl;
+            std::cerr << "[RedisInterface] publishObject(): Property " << property.name() << " has no NOTIFY signal, skipping." << std::endl;
+            continue;
         }
-        else
-        {
-            if(!targetMethod.isValid())
-                std::cerr << "[RedisInterface] addEventSubscription(): targetMethod is invalid!" << std::endl;
 
-            if(targetMethod.enclosingMetaObject() != targetObject->metaObject())
-                std::cerr << "[RedisInterface] addEventSubscription(): targetMethod does not belong to targetObject!" << std::endl;
-        }
+        QMetaMethod notifySignal = property.notifySignal();
+        connect(parent(), notifySignal, this, updateSlot, Qt::UniqueConnection);
+
+        if(_publishedObjectFieldsBySignal.size() <= notifySignal.methodIndex())
+            _publishedObjectFieldsBySignal.resize(notifySignal.methodIndex() + 1);
+
+        _publishedObjectFieldsBySignal[notifySignal.methodIndex()].append(qMakePair(index, binding.properties.size()));
+
+        binding.properties.append(property);
+        binding.fields.append(QByteArray(property.name()));
+    }
+
+    if(binding.properties.isEmpty())
+    {
+        std::cerr << "[RedisInterface] publishObject(): No properties to publish to " << remoteHashKey.toStdString() << "!" << std::endl;
+        return;
+    }
+
+    qCDebug(lcRedisInterface) << "Mapping" << binding.properties.size() << "local properties to remote hash" << remoteHashKey;
+
+    binding.dirty.resize(binding.properties.size());
+    binding.lastValues.resize(binding.properties.size());
+
+    // Dirty fields are written once the event loop is idle, unless a policy is given.
+    binding.throttle = policy.contains("policy") ? PublishThrottle::fromPolicy(policy, this) : new PublishThrottle(PublishThrottle::OnIdle, 0, this);
+    if(binding.throttle)
+    {
+        binding.throttle->setIndex(index);
+        connect(binding.throttle, SIGNAL(fire()), this, SLOT(handleThrottledObjectUpdate()));
     }
+
+    _publishedObjects.append(binding);
 }
 
 /*!
- * \brief Handles an incoming Redis event, invoking any corresponding methods/signals/slots that have been bound to the event.
+ * \brief Adds a subscription to the Redis hash \a{remoteHashKey}, binding each of its fields to the parent's property of the same name,
+ * for the properties named \a{localPropertyNames} (by default, every property declared by the parent's own class).
+ *
+ * The properties are hydrated straight away by reading the whole hash with a single \c{HGETALL}, and again after every reconnection.
+ * Thereafter, each change notification published by publishObject() updates just the fields it carries. Fields without a bound
+ * property are ignored.
  */
-void RedisInterface::handleSubscribedEvent()
+void RedisInterface::subscribeToObject(QString remoteHashKey, QStringList localPropertyNames)
 {
-    // Retrieve the network reply.
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
-
-    try {
-        QJsonObject doc = QJsonDocument::fromJson(reply->readAll()).object();
+    ObjectFields& fields = _subscribedObjects[remoteHashKey];
 
-        // Subscription message format is {"SUBSCRIPTION":["message/pmessage","message_name","message_value"]}.
-        QJsonArray data = doc.value(doc.keys().at(0)).toArray();
-        QString eventType = data.at(0).toString();
+    foreach(const QMetaProperty& property, objectProperties(localPropertyNames))
+        if(property.isWritable())
+            fields.insert(property.name(), property);
 
-        // Invoke the method if the event is a proper message (as opposed to the initial subscription reply).
-        if(eventType == "message" || eventType == "pmessage")
-        {
-            QString eventName = data.at(1).toString();
-            _subscribedEvents.value(eventName).invoke(parent());
-        }
-    }
-    catch(std::exception& e)
+    if(fields.isEmpty())
     {
-        if(reply)
-            std::cerr << "RedisInterface::receiveRemoteEvent(): Error: " << reply->errorString().toStdString() << std::endl;
-        else
-            std::cerr << "RedisInterface::receiveRemoteEvent(): Error: Network reply is NULL!" << std::endl;
+        std::cerr << "[RedisInterface] subscribeToObject(): No writable properties to bind to " << remoteHashKey.toStdString() << "!" << std::endl;
+        _subscribedObjects.remove(remoteHashKey);
+        return;
     }
+
+    qCDebug(lcRedisInterface) << "Mapping remote hash" << remoteHashKey << "to" << fields.size() << "local properties";
+
+    updateSubscriptions();
+    hydrateObject(remoteHashKey);
 }
 
 /*!
- * \brief Handles a published event (signal) being emitted, in turn publishing any Redis events that have been bound to the event.
+ * \brief Removes the binding to the Redis hash \a{remoteHashKey}. If nothing else is bound to its change notifications, they are
+ * unsubscribed.
  */
-void RedisInterface::handlePublishedEvent()
+void RedisInterface::unsubscribeFromObject(QString remoteHashKey)
 {
-    // Retrieve the signal sender.
-    QString senderSignal = parent()->metaObject()->method(senderSignalIndex()).methodSignature();
-
-    qDebug() << "[RedisInterface] Publishing" << senderSignal << "--->" << _publishedEvents.value(senderSignal);
-    publish(_publishedEvents.value(senderSignal), senderSignal);
+    if(_subscribedObjects.remove(remoteHashKey) > 0)
+        updateSubscriptions();
 }
 
 /*!
- * \brief Handles an incoming 'changed' event for a subscribed property. Sets the corresponding local property to the new value.
+ * \brief Returns the parent's properties named \a{names}, skipping (and reporting) any that do not exist. If no names are given, returns
+ * every property declared by the parent's own class, excluding those inherited from its base classes.
  */
-void RedisInterface::handleSubscribedPropertyUpdate()
+QList<QMetaProperty> RedisInterface::objectProperties(const QStringList &names) const
 {
-    // Retrieve the network reply.
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    const QMetaObject* metaObject = parent()->metaObject();
+    QList<QMetaProperty> properties;
 
-    try
+    if(names.isEmpty())
     {
-        // Parse the JSON response.
-        QJsonObject doc = QJsonDocument::fromJson(reply->readAll()).object();
-
-        // Subscription message format is {"SUBSCRIPTION":["message/pmessage","message_name","message_value"]}.
-        QJsonArray data = doc.value(doc.keys().at(0)).toArray();
-        QString eventType = data.at(0).toString();
+        for(int i = metaObject->propertyOffset(); i < metaObject->propertyCount(); ++i)
+            properties.append(metaObject->property(i));
 
-        // Invoke the method if the event is a proper message (as opposed to the initial subscription reply).
-        if(eventType == "message" || eventType == "pmessage")
-        {
-            QString eventName = data.at(1).toString();
-
-            if(eventName.endsWith("_changed"))
-            {
-                QString propertyName = eventName.left(eventName.length() - 8);
-                QVariant value = data.at(2).toVariant();
-                qDebug() << "[RedisInterface] Remote property" << propertyName << "changed to" << value;
-                _subscribedProperties.value(propertyName).write(parent(), value);
-            }
-            else
-            {
-                std::cerr << "[RedisInterface] Error: Unexpected property changed message format: " << eventName.toStdString() << std::endl;
-            }
-        }
+        return properties;
     }
-    catch(std::exception& e)
+
+    foreach(const QString& name, names)
     {
-        std::cerr << "[RedisInterface] handleSubscribedPropertyUpdate(): Error: " << e.what();
+        QMetaProperty property = RedisInterface::getProperty(parent(), name);
+
+        if(property.isValid())
+            properties.append(property);
+        else
+            std::cerr << "[RedisInterface] Error: Property " << name.toStdString() << " is invalid!" << std::endl;
     }
+
+    return properties;
 }
 
 /*!
- * \brief Handles a published property update, in turn updating the corresponding Redis value.
+ * \brief Rebuilds the dispatch table from \c{_subscribedEvents}, \c{_subscribedProperties} and \c{_subscribedObjects}, subscribing to any channels that have
+ * gained their first binding and unsubscribing from any that have lost their last.
  */
-void RedisInterface::handlePublishedPropertyUpdate()
+void RedisInterface::updateSubscriptions()
 {
-    // Retrieve the name of the NOTIFY signal that triggered this slot.
-    QString senderSignal = parent()->metaObject()->method(senderSignalIndex()).name();
+    QHash<QString, SubscriptionTargets> dispatchTable;
 
-    if(senderSignal.endsWith("Changed"))
-    {
-        QString localPropertyName = senderSignal.left(senderSignal.length() - QString("Changed").length());
-        QVariant newValue = parent()->property(localPropertyName.toStdString().c_str());
+    for(QMultiMap<QString, QMetaMethod>::const_iterator iter = _subscribedEvents.constBegin(); iter != _subscribedEvents.constEnd(); ++iter)
+        dispatchTable[iter.key()].methods.append(EventMarshaller(iter.value()));
 
-        // Update the Redis value.
-        set(_publishedProperties.value(localPropertyName), newValue);
-    }
-    else
-    {
-        std::cerr << "[RedisInterface] handlePublishedPropertyUpdate(): Unexpected sender signal " << senderSignal.toStdString() << std::endl;
-    }
+    for(QMultiMap<QString, QMetaProperty>::const_iterator iter = _subscribedProperties.constBegin(); iter != _subscribedProperties.constEnd(); ++iter)
+        dispatchTable[changeChannel(iter.key())].properties.append(iter.value());
+
+    for(QHash<QString, ObjectFields>::const_iterator iter = _subscribedObjects.constBegin(); iter != _subscribedObjects.constEnd(); ++iter)
+        dispatchTable[changeChannel(iter.key())].objects.append(iter.value());
+
+    foreach(const QString& channel, _dispatchTable.keys())
+        if(!dispatchTable.contains(channel) && !(_cacheSubscribed && channel == cacheNotificationPattern()))
+            _transport->unsubscribe(channel);
+
+    foreach(const QString& channel, dispatchTable.keys())
+        if(!_dispatchTable.contains(channel))
+            _transport->subscribe(channel);
+
+    _dispatchTable = dispatchTable;
 }
 
 /*!
- * \brief Handles an asynchronous GET request response, calling the appropriate JavaScript callback.
+ * \brief Returns true if \a{method} can be bound to events: every parameter must have a type known to \l{QMetaType}, and there must be
+ * no more than EventMarshaller::MaxParameters of them.
  */
-void RedisInterface::handleGetRequestResponse_JavaScript()
+bool RedisInterface::acceptsEventArguments(const QMetaMethod &method)
 {
-    // Retrieve the network reply.
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    return EventMarshaller(method).isValid();
+}
 
-    try
+/*!
+ * \brief Handles a message received on the subscriber connection, invoking any methods/signals/slots bound to the matching
+ * \a{subscription} and updating any properties bound to it with \a{payload}.
+ *
+ * The transport reports which subscription the message was delivered for, so pattern subscriptions resolve with the same single hash
+ * lookup as exact ones, however many patterns are bound. Methods are passed the event's arguments (decoded from \a{payload} once, and
+ * only if some method takes any), and \a{channel}, the channel the message was actually published on, if they take it.
+ *
+ * Change notifications of bound properties and objects published by this interface itself are recognised by their origin header and
+ * dropped before anything is decoded.
+ * Keyspace notifications carry no value, so the keys they report for bound properties and objects are queued to be re-read.
+ */
+void RedisInterface::handleSubscriptionMessage(QString subscription, QString channel, QVariant payload)
+{
+    QString changedKey = changeChannelKey(channel);
+    QHash<QString, SubscriptionTargets>::const_iterator found = _dispatchTable.constFind(subscription);
+
+    // Only the change notifications of bound properties and objects carry an origin header (see setEncoded()).
+    if(found != _dispatchTable.constEnd() && !changedKey.isNull() && (!found->properties.isEmpty() || !found->objects.isEmpty()) &&
+       stripOriginTag(payload))
+        return;
+
+    // A change notification means any cached value of the key is stale.
+    if(_cache.capacity() > 0 && !changedKey.isNull())
+        invalidateCachedKey(changedKey);
+
+    if(found == _dispatchTable.constEnd())
     {
-        // Parse the JSON response.
-        QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+        // Messages on the read cache's own subscription have no other targets.
+        if(_cacheSubscribed && subscription == cacheNotificationPattern())
+            return;
 
-        // Find the JavaScriptCallback we tacked on earlier, retrieve the callback, and call it with the value we requested.
-        QJSValue callback = dynamic_cast<JavaScriptCallback*>(reply->userData(0))->callback;
-        QJSValue value = callback.engine()->toScriptValue(doc.object().value("GET").toVariant());
-        callback.call(QJSValueList() << value);
+        std::cerr << "[RedisInterface] handleSubscriptionMessage(): No local targets bound to " << subscription.toStdString() << std::endl;
+        return;
+    }
 
-        reply->deleteLater();
+    // Copied, since the methods invoked (and the properties written) may add or remove bindings, rebuilding the dispatch table.
+    const SubscriptionTargets targets = found.value();
+
+    QVariantList arguments;
+    bool argumentsDecoded = false;
+
+    foreach(const EventMarshaller& marshaller, targets.methods)
+    {
+        if(marshaller.argumentCount() > 0 && !argumentsDecoded)
+        {
+            arguments = decodeEventArguments(payload);
+            argumentsDecoded = true;
+        }
+
+        marshaller.invoke(parent(), channel, arguments);
     }
-    catch(std::exception& e)
+
+    if(_keyspaceNotifications)
     {
-        if(reply == NULL)
-            std::cerr << "[RedisInterface] handleGetRequestResponse_JavaScript(): Network reply is NULL!" << std::endl;
-        else
-            std::cerr << "[RedisInterface] handleGetRequestResponse_JavaScript(): Error: " << e.what() << std::endl;
+        if(changedKey.isNull())
+            return;
+
+        if(!targets.properties.isEmpty())
+            _keyspaceChangedKeys.insert(changedKey);
+
+        if(!targets.objects.isEmpty())
+            _keyspaceChangedObjects.insert(changedKey);
+
+        if(!_keyspaceTimer->isActive())
+            _keyspaceTimer->start();
+
+        return;
     }
-}
 
-void RedisInterface::handleGetRequestResponse_MetaMethod()
-{
-    // Retrieve the network reply.
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    // Remember the value, so that writing it back from the property isn't sent to Redis again.
+    if(!targets.properties.isEmpty())
+        _lastRemoteValues.insert(changedKey.toUtf8(), payloadBytes(payload));
 
-    try
+    foreach(const QMetaProperty& property, targets.properties)
     {
-        // Parse the JSON response.
-        QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
+        QVariant value = _codec->decodePayload(payload, property.userType());
 
-        // Find the MetaMethodCallback we tacked on earlier and call it with the value we requested.
-        MetaMethodCallback* metaMethodCallback = dynamic_cast<MetaMethodCallback*>(reply->userData(0));
-        QVariant value = doc.object().value("GET").toVariant();
-        metaMethodCallback->callback.invoke(metaMethodCallback->requester, QGenericArgument("key", &metaMethodCallback->key), QGenericArgument("value", value.data()));
-
-        reply->deleteLater();
+        qCDebug(lcRedisInterface) << "Remote property" << channel << "changed to" << value;
+        property.write(parent(), value);
     }
-    catch(std::exception& e)
+
+    if(targets.objects.isEmpty())
+        return;
+
+    // Object notifications carry a map of just the changed fields.
+    QVariantMap changes = _codec->decodePayload(payload, QMetaType::QVariantMap).toMap();
+    noteObjectFields(changedKey.toUtf8(), changes, true);
+
+    foreach(const ObjectFields& fields, targets.objects)
     {
-        if(reply == NULL)
-            std::cerr << "[RedisInterface] handleGetRequestResponse_MetaMethod(): Network reply is NULL!" << std::endl;
-        else
-            std::cerr << "[RedisInterface] handleGetRequestResponse_MetaMethod(): Error: " << e.what() << std::endl;
+        for(QVariantMap::const_iterator iter = changes.constBegin(); iter != changes.constEnd(); ++iter)
+        {
+            ObjectFields::const_iterator field = fields.constFind(iter.key());
+
+            if(field != fields.constEnd())
+                field.value().write(parent(), iter.value());
+        }
     }
 }
 
 /*!
- * \brief SETs the Redis property with the given \a{key} to the given \a{value}.
+ * \brief Handles a published event (signal) being emitted, in turn publishing any Redis events that have been bound to the event.
  */
-void RedisInterface::set(QString key, const QVariant &value)
+void RedisInterface::handlePublishedEvent()
 {
-    QNetworkReply* setReply = _networkInterface->get(QNetworkRequest(QUrl(_serverUrl + "SET/" + key + "/" + value.toString())));
-    publish(QString(key + "_changed"), value);
+    int signalIndex = senderSignalIndex();
+    if(signalIndex < 0 || signalIndex >= _publishedEvents.size())
+        return;
 
-    connect(setReply, SIGNAL(finished()), setReply, SLOT(deleteLater()));
+    const QVector<PublishedEvent>& events = _publishedEvents.at(signalIndex);
+    for(int i = 0; i < events.size(); ++i)
+        sendEvent(events.at(i), events.at(i).payload);
 }
 
 /*!
- * \brief Performs a synchronous GET request for the Redis value with the given \a{key}. This method blocks the calling thread (which, in QML, is the main thread), therefore
- * it is highly recommended that you use one of the asynchronous overloads instead.
+ * \brief Handles a published signal with parameters being emitted (via the signal relay), in turn publishing any Redis events that have
+ * been bound to it with its \a{arguments} as the payload. The arguments are encoded once, however many events are bound.
  */
-QVariant RedisInterface::get(QString key) const
+void RedisInterface::handlePublishedEventArguments(int signalIndex, QVariantList arguments)
 {
-    // Perform the HTTP GET request for the key.
-    QNetworkReply* reply = _networkInterface->get(QNetworkRequest(QUrl(_serverUrl + "GET/" + key)));
+    if(signalIndex < 0 || signalIndex >= _publishedEvents.size())
+        return;
 
-    // Spin up an event loop and wait for the response.
-    QEventLoop waitLoop;
-    connect(reply, SIGNAL(finished()), &waitLoop, SLOT(quit()));
-    waitLoop.exec();
+    const QVector<PublishedEvent>& events = _publishedEvents.at(signalIndex);
+    if(events.isEmpty())
+        return;
 
-    // Parse the response and return the requested value to the caller.
-    QJsonDocument doc = QJsonDocument::fromJson(reply->readAll());
-    if(doc.isObject())
-        return doc.object().value("GET").toVariant();
-    else
-        std::cerr << "[RedisInterface] Synchronous get(): Bad response from server!" << std::endl;
+    QByteArray payload = _codec->encode(arguments);
 
-    return "";
+    for(int i = 0; i < events.size(); ++i)
+        sendEvent(events.at(i), payload);
 }
 
 /*!
- * \brief Performs an asynchronous GET request for the Redis value with the given \a{key}. When a response is received, the given JavaScript \a{callback}
- * will be invoked.
+ * \brief Handles a batch of entries read from a subscribed \a{stream}, invoking the methods bound to it once per entry, in order. Each
+ * entry's arguments are decoded from its payload once, and only if some method takes any; entries added by other clients (whose payload
+ * is a map of their fields) carry that map as their single argument.
  */
-void RedisInterface::get(QString key, QJSValue callback) const
+void RedisInterface::handleStreamEntries(QString stream, QVariantList payloads)
 {
-    qDebug() << "[RedisInterface] Performing asynchronus GET request for" << key << "with callback" << callback.toString();
+    QHash<QString, StreamSubscription>::const_iterator subscription = _subscribedStreams.constFind(stream);
 
-    // Perform the GET request.
-    QNetworkReply* reply = _networkInterface->get(QNetworkRequest(QUrl(_serverUrl + "GET/" + key)));
-    connect(reply, SIGNAL(readyRead()), this, SLOT(handleGetRequestResponse_JavaScript()));
-    connect(reply, SIGNAL(finished()), reply, SLOT(deleteLater()));
+    if(subscription == _subscribedStreams.constEnd() || subscription->consumer != sender())
+        return;
 
-    // Tack the callback onto the reply as a UserData object. This will be unwrapped in handleGetRequestResponse_JavaScript().
-    reply->setUserData(0, new JavaScriptCallback(callback));
-}
+    // Copied, since the methods invoked may add or remove bindings.
+    QList<EventMarshaller> methods = subscription->methods;
 
-/*!
- * \brief Performs an asynchronous GET request for the Redis value with the given \a{key}. When a response is received, the given C++ method \a{callback}
- * will be invoked.
- */
-void RedisInterface::get(QString key, QMetaMethod callback) const
-{
-    qDebug() << "[RedisInterface] Performing asynchronus GET request for " << key << "with callback" << callback.name();
+    foreach(const QVariant& payload, payloads)
+    {
+        QVariantList arguments;
+        bool argumentsDecoded = false;
 
-    // Perform the GET request.
-    QNetworkReply* reply = _networkInterface->get(QNetworkRequest(QUrl(_serverUrl + "GET/" + key)));
-    connect(reply, SIGNAL(readyRead()), this, SLOT(handleGetRequestResponse_MetaMethod()));
+        foreach(const EventMarshaller& marshaller, methods)
+        {
+            if(marshaller.argumentCount() > 0 && !argumentsDecoded)
+            {
+                arguments = (payload.userType() == QMetaType::QVariantMap) ? QVariantList() << payload : decodeEventArguments(payload);
+                argumentsDecoded = true;
+            }
+
+            marshaller.invoke(parent(), stream, arguments);
+        }
+    }
+}
+
+/*!
+ * \brief Handles a published property update, in turn updating the corresponding Redis value for every property published via the
+ * emitting NOTIFY signal (deferring to the property's throttle, if it has one).
+ */
+void RedisInterface::handlePublishedPropertyUpdate()
+{
+    int signalIndex = senderSignalIndex();
+    if(signalIndex < 0 || signalIndex >= _publishedPropertiesBySignal.size())
+        return;
+
+    const QVector<int>& bindings = _publishedPropertiesBySignal.at(signalIndex);
+    for(int i = 0; i < bindings.size(); ++i)
+    {
+        PublishThrottle* throttle = _publishedProperties.at(bindings.at(i)).throttle;
+
+        if(throttle)
+            throttle->trigger();
+        else
+            publishPropertyValue(bindings.at(i));
+    }
+}
+
+/*!
+ * \brief Handles a throttled property becoming due for publication, writing its latest value to Redis.
+ */
+void RedisInterface::handleThrottledPropertyUpdate()
+{
+    PublishThrottle* throttle = qobject_cast<PublishThrottle*>(sender());
+
+    if(throttle && throttle->index() >= 0 && throttle->index() < _publishedProperties.size())
+        publishPropertyValue(throttle->index());
+}
+
+/*!
+ * \brief Writes the current value of the published property with binding \a{index} to Redis, unless it equals the last value known to
+ * be held by Redis.
+ */
+void RedisInterface::publishPropertyValue(int index)
+{
+    const PublishedProperty& binding = _publishedProperties.at(index);
+    QByteArray encodedValue = _codec->encode(binding.property.read(parent()));
+
+    QHash<QByteArray, QByteArray>::const_iterator lastValue = _lastRemoteValues.constFind(binding.remoteKey);
+    if(lastValue != _lastRemoteValues.constEnd() && lastValue.value() == encodedValue)
+        return;
+
+    RedisReply* reply = setEncoded(binding.remoteKey, binding.changedChannel, encodedValue, binding.compressionThreshold, binding.lane);
+    reply->setProperty("publishedValue", true);
+}
+
+/*!
+ * \brief Handles a NOTIFY signal of a property published with publishObject(), marking its field dirty and triggering the object's
+ * throttle (or, without one, writing the field straight away).
+ */
+void RedisInterface::handlePublishedObjectUpdate()
+{
+    int signalIndex = senderSignalIndex();
+    if(signalIndex < 0 || signalIndex >= _publishedObjectFieldsBySignal.size())
+        return;
+
+    const QVector<QPair<int, int> >& fields = _publishedObjectFieldsBySignal.at(signalIndex);
+    for(int i = 0; i < fields.size(); ++i)
+    {
+        PublishedObject& object = _publishedObjects[fields.at(i).first];
+        object.dirty.setBit(fields.at(i).second);
+
+        if(object.throttle)
+            object.throttle->trigger();
+        else
+            publishObjectFields(fields.at(i).first);
+    }
+}
+
+/*!
+ * \brief Handles a published object becoming due for publication, writing its dirty fields to Redis.
+ */
+void RedisInterface::handleThrottledObjectUpdate()
+{
+    PublishThrottle* throttle = qobject_cast<PublishThrottle*>(sender());
+
+    if(throttle && throttle->index() >= 0 && throttle->index() < _publishedObjects.size())
+        publishObjectFields(throttle->index());
+}
+
+/*!
+ * \brief Writes the dirty fields of the published object with binding \a{index} to its Redis hash with a single multi-field \c{HSET},
+ * and PUBLISHes a map of their new values (behind this interface's origin header) on its change channel, as a single atomic
+ * transaction. With keyspace change notifications, the \c{HSET} is sent alone. Fields whose value equals the last value known to be
+ * held by Redis are left out, and nothing is sent if none remain. The write is sent for the hash's key, so that reads of the hash are
+ * held behind it, but without superseding earlier writes, since each carries different fields (see RequestScheduler).
+ */
+void RedisInterface::publishObjectFields(int index)
+{
+    PublishedObject& object = _publishedObjects[index];
+
+    if(object.dirty.count(true) == 0)
+        return;
+
+    QList<QByteArray> setCommand;
+    setCommand << "HSET" << object.remoteKey;
+
+    QVariantMap changes;
+    QVariantList fieldIndexes;
+    QVariantList encodedValues;
+
+    for(int i = 0; i < object.properties.size(); ++i)
+    {
+        if(!object.dirty.testBit(i))
+            continue;
+
+        QVariant value = object.properties.at(i).read(parent());
+        QByteArray encodedValue = _codec->encode(value);
+
+        if(object.lastValues.at(i).isValid() && object.lastValues.at(i).toByteArray() == encodedValue)
+            continue;
+
+        fieldIndexes << i;
+        encodedValues << encodedValue;
+
+        setCommand << object.fields.at(i) << compress(encodedValue, object.compressionThreshold);
+        changes.insert(QString::fromUtf8(object.fields.at(i)), value);
+    }
+
+    object.dirty.fill(false);
+
+    if(changes.isEmpty())
+        return;
+
+    RedisReply* reply;
+
+    if(_keyspaceNotifications)
+    {
+        reply = _scheduler->sendCommand(object.lane, setCommand, object.remoteKey, false);
+    }
+    else
+    {
+        QList<QList<QByteArray> > commands;
+        commands << setCommand;
+        commands << (QList<QByteArray>() << "PUBLISH" << object.changedChannel << compress(originTagged(_codec->encode(changes)), object.compressionThreshold));
+
+        reply = _scheduler->sendTransaction(object.lane, commands, object.remoteKey, false);
+    }
+
+    reply->setProperty("objectIndex", index);
+    reply->setProperty("fieldIndexes", fieldIndexes);
+    reply->setProperty("encodedValues", encodedValues);
+    connect(reply, SIGNAL(finished()), this, SLOT(handlePublishedFieldsWritten()));
+}
+
+/*!
+ * \brief Handles the reply to a write sent by publishObjectFields(). Once the write has succeeded, the written values become the last
+ * values known to be held by Redis. If it failed (or was cancelled or superseded before being sent), the fields are marked dirty again,
+ * with no last known values, so that the next change or flush of the object writes them again.
+ */
+void RedisInterface::handlePublishedFieldsWritten()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    int index = reply->property("objectIndex").toInt();
+    if(index < 0 || index >= _publishedObjects.size())
+        return;
+
+    PublishedObject& object = _publishedObjects[index];
+    QVariantList fieldIndexes = reply->property("fieldIndexes").toList();
+    QVariantList encodedValues = reply->property("encodedValues").toList();
+
+    for(int i = 0; i < fieldIndexes.size() && i < encodedValues.size(); ++i)
+    {
+        int field = fieldIndexes.at(i).toInt();
+
+        if(reply->isError())
+        {
+            object.lastValues[field] = QVariant();
+            object.dirty.setBit(field);
+        }
+        else
+        {
+            object.lastValues[field] = encodedValues.at(i);
+        }
+    }
+
+    if(reply->isError())
+        qCDebug(lcRedisInterface) << "Write of" << object.remoteKey << "failed, its fields will be written again:" << reply->errorString();
+}
+
+/*!
+ * \brief Reads every field of the subscribed Redis hash \a{key} with a single \c{HGETALL}, held behind any write of the hash still
+ * queued (see RequestScheduler::sendRead()). See handleObjectHydrated().
+ */
+void RedisInterface::hydrateObject(const QString &key)
+{
+    QByteArray remoteKey = key.toUtf8();
+    RedisReply* reply = _scheduler->sendRead(RequestScheduler::Interactive, QList<QByteArray>() << "HGETALL" << remoteKey,
+                                             QList<QByteArray>() << remoteKey);
+    reply->setProperty("objectKey", key);
+    connect(reply, SIGNAL(finished()), this, SLOT(handleObjectHydrated()));
+}
+
+/*!
+ * \brief Handles the reply to an \c{HGETALL} sent by hydrateObject(), writing each field of the hash (decoded to the type of its
+ * property) to its bound property. Fields missing from the hash leave their properties untouched.
+ */
+void RedisInterface::handleObjectHydrated()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    QString key = reply->property("objectKey").toString();
+
+    if(reply->isError())
+    {
+        std::cerr << "[RedisInterface] handleObjectHydrated(): Failed to read " << key.toStdString() << ": " << reply->errorString().toStdString() << std::endl;
+        return;
+    }
+
+    QHash<QString, ObjectFields>::const_iterator fields = _subscribedObjects.constFind(key);
+    if(fields == _subscribedObjects.constEnd())
+        return;
+
+    // Native replies list the fields and values in turn; webdis replies map the fields to their values.
+    QVariantMap values = reply->value().toMap();
+    QVariantList list = reply->value().toList();
+
+    for(int i = 0; i + 1 < list.size(); i += 2)
+        values.insert(list.at(i).toString(), list.at(i + 1));
+
+    noteObjectFields(key.toUtf8(), values, false);
+
+    for(QVariantMap::const_iterator iter = values.constBegin(); iter != values.constEnd(); ++iter)
+    {
+        ObjectFields::const_iterator field = fields->constFind(iter.key());
+
+        if(field != fields->constEnd())
+            field.value().write(parent(), _codec->decodePayload(iter.value(), field.value().userType()));
+    }
+}
+
+/*!
+ * \brief Handles an asynchronous GET request response, calling the appropriate JavaScript callback.
+ */
+void RedisInterface::handleGetRequestResponse_JavaScript()
+{
+    // Retrieve the Redis reply.
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+
+    try
+    {
+        if(reply->isError())
+            std::cerr << "[RedisInterface] handleGetRequestResponse_JavaScript(): Error: " << reply->errorString().toStdString() << std::endl;
+
+        // Find the JavaScriptCallback we tacked on earlier, retrieve the callback, and call it with the value we requested.
+        QJSValue callback = dynamic_cast<JavaScriptCallback*>(reply->userData(0))->callback;
+        QJSValue value = callback.engine()->toScriptValue(reply->value());
+        callback.call(QJSValueList() << value);
+
+        reply->deleteLater();
+    }
+    catch(std::exception& e)
+    {
+        if(reply == NULL)
+            std::cerr << "[RedisInterface] handleGetRequestResponse_JavaScript(): Redis reply is NULL!" << std::endl;
+        else
+            std::cerr << "[RedisInterface] handleGetRequestResponse_JavaScript(): Error: " << e.what() << std::endl;
+    }
+}
+
+void RedisInterface::handleGetRequestResponse_MetaMethod()
+{
+    // Retrieve the Redis reply.
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+
+    try
+    {
+        if(reply->isError())
+            std::cerr << "[RedisInterface] handleGetRequestResponse_MetaMethod(): Error: " << reply->errorString().toStdString() << std::endl;
+
+        // Find the MetaMethodCallback we tacked on earlier and call it with the value we requested.
+        MetaMethodCallback* metaMethodCallback = dynamic_cast<MetaMethodCallback*>(reply->userData(0));
+        QVariant value = reply->value();
+        metaMethodCallback->callback.invoke(metaMethodCallback->requester, QGenericArgument("key", &metaMethodCallback->key), QGenericArgument("value", value.data()));
+
+        reply->deleteLater();
+    }
+    catch(std::exception& e)
+    {
+        if(reply == NULL)
+            std::cerr << "[RedisInterface] handleGetRequestResponse_MetaMethod(): Redis reply is NULL!" << std::endl;
+        else
+            std::cerr << "[RedisInterface] handleGetRequestResponse_MetaMethod(): Error: " << e.what() << std::endl;
+    }
+}
+
+/*!
+ * \brief SETs the Redis property with the given \a{key} to the given \a{value}. The \c{SET} and the accompanying \c{key_changed}
+ * \c{PUBLISH} are sent together as a single atomic transaction, so subscribers never observe the notification without the new value.
+ * With keyspace change notifications, the \c{SET} is sent alone, and the server notifies subscribers itself.
+ */
+void RedisInterface::set(QString key, const QVariant &value)
+{
+    setEncoded(key.toUtf8(), QString(key + "_changed").toUtf8(), _codec->encode(value));
+}
+
+/*!
+ * \brief SETs the pre-encoded \a{key} to \a{encodedValue} and PUBLISHes it, behind this interface's origin header, on the
+ * pre-encoded \a{changedChannel}, as a single atomic transaction (or, with keyspace change notifications, only SETs it). The value is
+ * compressed if it reaches \a{compressionThreshold} (see compress()), and the change notification then compressed with its origin
+ * header inside, so that readers can inflate it before looking for the header. The write is sent in \a{lane}, superseding any
+ * write to \a{key} still queued in any lane (see RequestScheduler). The returned reply deletes itself once finished (see
+ * handleValueWritten()).
+ */
+RedisReply* RedisInterface::setEncoded(const QByteArray &key, const QByteArray &changedChannel, const QByteArray &encodedValue, int compressionThreshold,
+                                       RequestScheduler::Lane lane)
+{
+    // Make sure a get() issued straight after the set() doesn't return the old value from the cache. Reads of the key from the server
+    // are held back by the scheduler until the write has been sent, whatever its lane (see RequestScheduler::sendRead()).
+    if(_cache.capacity() > 0)
+        invalidateCachedKey(QString::fromUtf8(key));
+
+    QByteArray payload = compress(encodedValue, compressionThreshold);
+
+    QList<QByteArray> setCommand;
+    setCommand << "SET" << key << payload;
+
+    RedisReply* setReply;
+
+    if(_keyspaceNotifications)
+    {
+        setReply = _scheduler->sendCommand(lane, setCommand, key);
+    }
+    else
+    {
+        QList<QList<QByteArray> > commands;
+        commands << setCommand;
+        QByteArray notification = PayloadCompressor::isCompressed(payload) ? compress(originTagged(encodedValue), compressionThreshold)
+                                                                            : originTagged(payload);
+        commands << (QList<QByteArray>() << "PUBLISH" << changedChannel << notification);
+
+        setReply = _scheduler->sendTransaction(lane, commands, key);
+    }
+
+    setReply->setProperty("key", key);
+    setReply->setProperty("encodedValue", encodedValue);
+    connect(setReply, SIGNAL(finished()), this, SLOT(handleValueWritten()));
+
+    return setReply;
+}
+
+/*!
+ * \brief Handles the reply to a write sent by setEncoded(). Once the write has succeeded, the written value becomes the last value known
+ * to be held by Redis for a published property's key (including explicit writes to it, so that writing the previous value from the
+ * property isn't skipped). If it failed (or was cancelled or superseded before being sent), the key's last known value is forgotten,
+ * so that the property's next write isn't skipped.
+ */
+void RedisInterface::handleValueWritten()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    QByteArray key = reply->property("key").toByteArray();
+
+    if(reply->isError())
+        _lastRemoteValues.remove(key);
+    else if(reply->property("publishedValue").toBool() || _lastRemoteValues.contains(key))
+        _lastRemoteValues.insert(key, reply->property("encodedValue").toByteArray());
+}
+
+#ifndef REDIS_NO_SYNCHRONOUS_GET
+/*!
+ * \brief Performs a synchronous GET request for the Redis value with the given \a{key}. This method blocks the calling thread (which, in QML, is the main thread), therefore
+ * it is highly recommended that you use getAsync() instead. If the key is held in the read cache, its value is returned without
+ * blocking.
+ *
+ * While waiting, a nested event loop is run, so arbitrary slots may be re-entered before this method returns. Applications can remove
+ * this method altogether by defining \c{REDIS_NO_SYNCHRONOUS_GET}.
+ */
+QVariant RedisInterface::get(QString key) const
+{
+    QVariant cachedValue;
+    if(_cache.lookup(key, cachedValue))
+        return cachedValue;
+
+    // Perform the GET request for the key.
+    RedisReply* reply = sendGetCommand(key);
+
+    // Spin up an event loop and wait for the response.
+    QEventLoop waitLoop;
+    connect(reply, SIGNAL(finished()), &waitLoop, SLOT(quit()));
+    waitLoop.exec();
+
+    reply->deleteLater();
+
+    // Return the requested value to the caller.
+    if(!reply->isError())
+        return reply->value();
+    else
+        std::cerr << "[RedisInterface] Synchronous get(): Bad response from server: " << reply->errorString().toStdString() << std::endl;
+
+    return "";
+}
+#endif
+
+/*!
+ * \brief Performs an asynchronous GET request for the Redis value with the given \a{key}, returning a promise of the value (see
+ * RedisPromise). If the key is held in the read cache, the promise is fulfilled from the event loop without contacting the server.
+ */
+RedisPromise* RedisInterface::getAsync(QString key)
+{
+    RedisPromise* promise = new RedisPromise(this);
+
+    QVariant cachedValue;
+    if(_cache.lookup(key, cachedValue))
+    {
+        QMetaObject::invokeMethod(promise, "resolve", Qt::QueuedConnection, Q_ARG(QVariant, cachedValue));
+        return promise;
+    }
+
+    promise->follow(sendGetCommand(key));
+
+    return promise;
+}
+
+/*!
+ * \brief Reads all of the given \a{keys} at once, returning a promise of a \l{QVariantMap} from each key to its value (invalid for keys
+ * that do not exist). Keys held in the read cache are served from it; the rest are read with \c{MGET}s of at most
+ * \c{MaxKeysPerMultiGet} keys each. All of the \c{MGET}s are queued together, so they are sent in a single batch and processed by the
+ * server back-to-back rather than one round trip after another.
+ */
+RedisPromise* RedisInterface::getAsync(QStringList keys)
+{
+    RedisPromise* promise = new RedisPromise(this);
+    MultiGetRequest* request = new MultiGetRequest(_codec, promise);
+
+    QStringList missingKeys;
+    QVariant cachedValue;
+
+    keys.removeDuplicates();
+
+    foreach(const QString& key, keys)
+    {
+        if(_cache.lookup(key, cachedValue))
+            request->setValue(key, cachedValue);
+        else
+            missingKeys.append(key);
+    }
+
+    for(int first = 0; first < missingKeys.size(); first += MaxKeysPerMultiGet)
+    {
+        QStringList chunkKeys = missingKeys.mid(first, MaxKeysPerMultiGet);
+
+        QList<QByteArray> command;
+        command << "MGET";
+        foreach(const QString& key, chunkKeys)
+            command << key.toUtf8();
+
+        request->addChunk(_scheduler->sendRead(RequestScheduler::Interactive, command, command.mid(1)), chunkKeys);
+    }
+
+    // Only cache the results if the cache is coherent now, and no invalidation occurs before they arrive.
+    if(_cache.capacity() > 0 && (_transport->isKeyTrackingActive() || _cacheSubscribed))
+        request->setCacheEpoch(_cacheEpoch);
+
+    connect(request, SIGNAL(finished()), this, SLOT(handleMultiGetFinished()));
+    request->start();
+
+    return promise;
+}
+
+/*!
+ * \brief Reads all of the given \a{keys} at once, then calls the JavaScript \a{callback} once with a map (JavaScript object) from each key
+ * to its value. See getAsync() for how the keys are fetched.
+ */
+void RedisInterface::get(QStringList keys, QJSValue callback)
+{
+    getAsync(keys)->then(callback);
+}
+
+/*!
+ * \brief Reads all of the given \a{keys} at once, then invokes \a{callback} on the parent object once with a \l{QVariant} holding a
+ * \l{QVariantMap} from each key to its value. See getAsync() for how the keys are fetched.
+ */
+void RedisInterface::get(QStringList keys, QMetaMethod callback)
+{
+    getAsync(keys)->then(parent(), callback);
+}
+
+/*!
+ * \brief SETs the Redis property with the given \a{key} to \a{value}, exactly as set() does, and returns a promise that is fulfilled
+ * with the results of the \c{SET} and \c{PUBLISH} (as a list, or with keyspace change notifications, the result of the \c{SET} alone)
+ * once the server has applied them.
+ */
+RedisPromise* RedisInterface::setAsync(QString key, const QVariant &value)
+{
+    RedisPromise* promise = new RedisPromise(this);
+    promise->follow(setEncoded(key.toUtf8(), QString(key + "_changed").toUtf8(), _codec->encode(value)));
+
+    return promise;
+}
+
+/*!
+ * \brief Sends \a{command} (the command name followed by its arguments, eg. \c{["HGET", "user:1", "name"]}) to Redis, returning a
+ * promise of its decoded reply. Commands sent this way bypass the read cache.
+ */
+RedisPromise* RedisInterface::execute(QStringList command)
+{
+    QList<QByteArray> encodedCommand;
+    foreach(const QString& argument, command)
+        encodedCommand.append(argument.toUtf8());
+
+    RedisPromise* promise = new RedisPromise(this);
+
+    if(encodedCommand.isEmpty())
+        promise->reject("No command given!");
+    else
+        promise->follow(_scheduler->sendCommand(RequestScheduler::Control, encodedCommand));
+
+    return promise;
+}
+
+/*!
+ * \brief Registers the Lua \a{source} under \a{name} (replacing any script registered under it), and loads it into the server's script
+ * cache, so that runScript() only has to send its digest. Scripts are loaded again whenever the connection is re-established.
+ *
+ * Example, setting a property, bumping its version and notifying subscribers in one round trip:
+ * \code
+ * redis->registerScript("setVersioned",
+ *     "redis.call('SET', KEYS[1], ARGV[1]) "
+ *     "local version = redis.call('INCR', KEYS[1] .. ':version') "
+ *     "redis.call('PUBLISH', KEYS[1] .. '_changed', ARGV[1]) "
+ *     "return version");
+ *
+ * redis->runScript("setVersioned", QStringList() << "sensor:temperature", QVariantList() << 21.5);
+ * \endcode
+ */
+void RedisInterface::registerScript(QString name, QString source)
+{
+    _scripts->registerScript(name, source.toUtf8());
+}
+
+/*!
+ * \brief Removes the script registered under \a{name}.
+ */
+void RedisInterface::unregisterScript(QString name)
+{
+    _scripts->unregisterScript(name);
+}
+
+/*!
+ * \brief Runs the script registered under \a{name} with \c{EVALSHA}, passing \a{keys} as \c{KEYS} and \a{arguments} as \c{ARGV},
+ * and returns a promise of its result (as returned by the server, like execute()). Numbers and booleans are passed as text (booleans
+ * as \c{"1"} or \c{"0"}), so that scripts can use \c{tonumber()} on them; other arguments are encoded with the value codec, exactly as
+ * set() would store them. If the server has lost the script, it is sent again in full, transparently. The promise is rejected if no
+ * script is registered under \a{name}.
+ */
+RedisPromise* RedisInterface::runScript(QString name, QStringList keys, QVariantList arguments)
+{
+    RedisPromise* promise = new RedisPromise(this);
+
+    QList<QByteArray> encodedKeys;
+    foreach(const QString& key, keys)
+        encodedKeys.append(key.toUtf8());
+
+    QList<QByteArray> encodedArguments;
+    foreach(const QVariant& argument, arguments)
+        encodedArguments.append(encodeScriptArgument(argument));
+
+    RedisReply* reply = _scripts->invoke(name, encodedKeys, encodedArguments);
+
+    if(reply == NULL)
+        promise->reject("No script registered as " + name + "!");
+    else
+        promise->follow(reply);
+
+    return promise;
+}
+
+/*!
+ * \brief Performs an asynchronous GET request for the Redis value with the given \a{key}. When a response is received, the given JavaScript \a{callback}
+ * will be invoked.
+ */
+void RedisInterface::get(QString key, QJSValue callback) const
+{
+    qCDebug(lcRedisInterface) << "Performing asynchronus GET request for" << key << "with callback" << callback.toString();
+
+    // Perform the GET request (unless the value is cached).
+    RedisReply* reply = cachedReply(key);
+    if(reply == NULL)
+        reply = sendGetCommand(key);
+
+    connect(reply, SIGNAL(finished()), this, SLOT(handleGetRequestResponse_JavaScript()));
+
+    // Tack the callback onto the reply as a UserData object. This will be unwrapped in handleGetRequestResponse_JavaScript().
+    reply->setUserData(0, new JavaScriptCallback(callback));
+}
+
+/*!
+ * \brief Performs an asynchronous GET request for the Redis value with the given \a{key}. When a response is received, the given C++ method \a{callback}
+ * will be invoked.
+ */
+void RedisInterface::get(QString key, QMetaMethod callback) const
+{
+    qCDebug(lcRedisInterface) << "Performing asynchronus GET request for " << key << "with callback" << callback.name();
+
+    // Perform the GET request (unless the value is cached).
+    RedisReply* reply = cachedReply(key);
+    if(reply == NULL)
+        reply = sendGetCommand(key);
+
+    connect(reply, SIGNAL(finished()), this, SLOT(handleGetRequestResponse_MetaMethod()));
+
+    // Tack the callback onto the reply as a UserData object. this will be unwrapped in handleGetRequestResponse_MetaMethod().
+    reply->setUserData(0, new MetaMethodCallback(parent(), key, callback));
+}
+
+/*!
+ * \brief Performs a single-shot PUBLISH command via Redis.
+ */
+void RedisInterface::publish(QString remoteEventName, QVariant value)
+{
+    publishEncoded(remoteEventName.toUtf8(), compress(_codec->encode(value), -1));
+}
+
+/*!
+ * \brief Decodes the arguments carried by an event's \a{payload}: the elements of a list (as sent by a published signal with
+ * parameters), or otherwise the payload itself as a single argument (as sent by publish()).
+ */
+QVariantList RedisInterface::decodeEventArguments(const QVariant &payload) const
+{
+    QVariant arguments = _codec->decodePayload(payload, QMetaType::QVariantList);
+
+    if(arguments.userType() == QMetaType::QVariantList)
+        return arguments.toList();
+
+    return QVariantList() << _codec->decodePayload(payload);
+}
+
+/*!
+ * \brief Returns \a{payload} behind this interface's origin header: the binary marker if \a{payload} is binary (begins with a \c{0xFF}
+ * byte, so that transports still recognise it as binary, see RespParser::bulkValue()), otherwise the text marker, then the origin ID.
+ */
+QByteArray RedisInterface::originTagged(const QByteArray &payload) const
+{
+    return (payload.startsWith('\xFF') ? BinaryOriginMarker : TextOriginMarker) + _originId + payload;
+}
+
+/*!
+ * \brief Removes the origin header (see originTagged()) from the start of a change notification \a{payload}, if it has one. Returns true
+ * if the header carries this interface's own ID, ie. the notification is an echo of a change published by this interface. Compressed
+ * notifications hold their header inside, so \a{payload} is inflated first, unless the threaded transport already has.
+ */
+bool RedisInterface::stripOriginTag(QVariant &payload) const
+{
+    payload = PayloadCompressor::inflateAll(payload);
+
+    const int markerSize = int(qstrlen(TextOriginMarker));
+    const int headerSize = markerSize + OriginIdLength;
+
+    if(payload.userType() == QMetaType::QByteArray)
+    {
+        QByteArray bytes = payload.toByteArray();
+
+        if(bytes.size() < headerSize || !(bytes.startsWith(BinaryOriginMarker) || bytes.startsWith(TextOriginMarker)))
+            return false;
+
+        if(bytes.mid(markerSize, OriginIdLength) == _originId)
+            return true;
+
+        payload = bytes.mid(headerSize);
+        return false;
+    }
+
+    if(payload.userType() != QMetaType::QString)
+        return false;
+
+    QString text = payload.toString();
+
+    if(text.size() < headerSize || !text.startsWith(QLatin1String(TextOriginMarker)))
+        return false;
+
+    if(text.midRef(markerSize, OriginIdLength) == QLatin1String(_originId))
+        return true;
+
+    payload = text.mid(headerSize);
+    return false;
+}
+
+/*!
+ * \brief Returns the encoded bytes of a \a{payload} received from Redis: binary payloads are held as a \l{QByteArray}, and text as a
+ * \l{QString} (see RespParser::bulkValue()). Compressed payloads are inflated (see PayloadCompressor), as for decoding.
+ */
+QByteArray RedisInterface::payloadBytes(const QVariant &payload)
+{
+    if(payload.userType() == QMetaType::QByteArray)
+        return PayloadCompressor::inflate(payload.toByteArray());
+
+    return PayloadCompressor::inflate(payload.toString().toUtf8());
+}
+
+/*!
+ * \brief Records the last known remote values of the fields of the Redis hash \a{key}, for every object published to it: the encoded
+ * \a{values} of the fields, or if \a{decoded} is true, their decoded values (which are encoded for comparison with later writes).
+ */
+void RedisInterface::noteObjectFields(const QByteArray &key, const QVariantMap &values, bool decoded)
+{
+    for(int i = 0; i < _publishedObjects.size(); ++i)
+    {
+        PublishedObject& object = _publishedObjects[i];
+        if(object.remoteKey != key)
+            continue;
+
+        for(int j = 0; j < object.fields.size(); ++j)
+        {
+            QVariantMap::const_iterator value = values.constFind(QString::fromUtf8(object.fields.at(j)));
+
+            if(value != values.constEnd())
+                object.lastValues[j] = decoded ? _codec->encode(value.value()) : payloadBytes(value.value());
+        }
+    }
+}
+
+/*!
+ * \brief Performs a single-shot PUBLISH of the pre-encoded \a{payload} on the pre-encoded \a{channel}, in \a{lane}.
+ */
+void RedisInterface::publishEncoded(const QByteArray &channel, const QByteArray &payload, RequestScheduler::Lane lane)
+{
+    RedisReply* reply = _scheduler->sendCommand(lane, QList<QByteArray>() << "PUBLISH" << channel << payload);
+    connect(reply, SIGNAL(finished()), reply, SLOT(deleteLater()));
+}
+
+/*!
+ * \brief Sends the encoded \a{payload} of the published \a{event} (compressed, if the event calls for it): PUBLISHes it, or for
+ * stream events, appends it to the stream with \c{XADD} (trimming the stream, if the event has a maximum length).
+ */
+void RedisInterface::sendEvent(const PublishedEvent &event, const QByteArray &encodedPayload)
+{
+    QByteArray payload = compress(encodedPayload, event.compressionThreshold);
+
+    if(!event.stream)
+    {
+        publishEncoded(event.remoteEventName, payload, event.lane);
+        return;
+    }
+
+    QList<QByteArray> command;
+    command << "XADD" << event.remoteEventName;
+
+    if(!event.maxLength.isEmpty())
+        command << "MAXLEN" << "~" << event.maxLength;
+
+    command << "*" << StreamConsumer::PayloadField << payload;
+
+    RedisReply* reply = _scheduler->sendCommand(event.lane, command);
     connect(reply, SIGNAL(finished()), reply, SLOT(deleteLater()));
+}
+
+/*!
+ * \brief Sets the batch window to \a{msecs} milliseconds. Commands issued within the window are sent to Redis as one batch. The default
+ * of 0 sends every command issued within one event loop turn as one batch.
+ */
+void RedisInterface::setBatchWindow(int msecs)
+{
+    _transport->setBatchWindow(msecs);
+}
+
+/*!
+ * \brief Returns counters describing the batches of commands sent so far: \c{batches}, \c{commands}, \c{largestBatch} and
+ * \c{averageBatchSize}.
+ */
+QVariantMap RedisInterface::batchStatistics() const
+{
+    return _transport->batchStatistics();
+}
+
+/*!
+ * \brief Sets the capacity of the client-side read cache to \a{entries} values. When the cache is full, the least recently used value is
+ * evicted. A capacity of 0 (the default) disables the cache, so that every get() goes to the server.
+ */
+void RedisInterface::setCacheSize(int entries)
+{
+    _cache.setCapacity(entries);
+
+    if(entries > 0)
+        _transport->enableKeyTracking();
+    else
+        _cache.clear();
+
+    updateCacheSubscription();
+}
+
+/*!
+ * \brief Returns the capacity of the read cache.
+ */
+int RedisInterface::cacheSize() const
+{
+    return _cache.capacity();
+}
+
+/*!
+ * \brief Returns counters describing the read cache: \c{hits}, \c{misses}, \c{hitRate}, \c{evictions}, \c{invalidations}, \c{size} and
+ * \c{capacity}, plus \c{tracking}, which is true while the cache is kept coherent by server-assisted key tracking.
+ */
+QVariantMap RedisInterface::cacheStatistics() const
+{
+    QVariantMap statistics = _cache.statistics();
+    statistics["tracking"] = _transport->isKeyTrackingActive();
+
+    return statistics;
+}
+
+/*!
+ * \brief Returns runtime counters for this interface, suitable for an on-screen overlay or periodic logging:
+ *
+ * \list
+ * \li \c{commandsSent} and \c{commands} (by command name), and \c{pendingRequests}, the requests still awaiting replies.
+ * \li \c{latency}: round-trip times in milliseconds (\c{p50}, \c{p90}, \c{p99} and \c{max}), measured from the moment a request is
+ *     issued, so including the batch window.
+ * \li \c{messagesReceived} and \c{messages} (by channel).
+ * \li \c{bytesOut} and \c{bytesIn}: bytes transferred by the connection, which is shared by every interface to the same server.
+ * \li \c{batches}: the batchStatistics(), and \c{cache}: the cacheStatistics().
+ * \li \c{streams}: the statistics of each StreamConsumer reading subscribed streams, if there are any.
+ * \li \c{compression}: the PayloadCompressor statistics (compression ratio, and time spent compressing and inflating payloads).
+ * \li \c{lanes}: the laneStatistics().
+ * \endlist
+ *
+ * Counters are kept with a few integer operations per request or message, so they are always enabled.
+ */
+QVariantMap RedisInterface::metrics() const
+{
+    QVariantMap metrics = _transport->metrics();
+    metrics.insert("batches", batchStatistics());
+    metrics.insert("cache", cacheStatistics());
+
+    if(!_scripts->names().isEmpty())
+        metrics.insert("scripts", _scripts->statistics());
+
+    metrics.insert("compression", _compressor.statistics());
+    metrics.insert("lanes", laneStatistics());
+
+    if(!_streamConsumers.isEmpty())
+    {
+        QVariantList streams;
+        foreach(StreamConsumer* consumer, _streamConsumers)
+            streams.append(consumer->statistics());
+
+        metrics.insert("streams", streams);
+    }
+
+    return metrics;
+}
+
+/*!
+ * \brief Discards every value held in the read cache.
+ */
+void RedisInterface::clearCache()
+{
+    ++_cacheEpoch;
+    _cache.clear();
+}
+
+/*!
+ * \brief Selects the codec named \a{name} for the values written to and read from Redis: \c{"text"} (the default) or \c{"binary"} (see
+ * ValueCodec). Returns false, leaving the current codec in place, if there is no codec with the given name.
+ *
+ * Every client reading or writing the same keys must use the same codec. The binary codec can still read values written as text, but
+ * clients using the text codec (or other Redis clients) will not be able to make sense of binary values.
+ */
+bool RedisInterface::setValueCodec(QString name)
+{
+    ValueCodec* codec = ValueCodec::create(name, _transport->isBinarySafe());
+
+    if(codec == NULL)
+    {
+        std::cerr << "[RedisInterface] setValueCodec(): Unknown value codec " << name.toStdString() << "!" << std::endl;
+        return false;
+    }
+
+    setValueCodec(QSharedPointer<ValueCodec>(codec));
+    return true;
+}
+
+/*!
+ * \brief Installs \a{codec} for the values written to and read from Redis. Values already held in the read cache were decoded by the
+ * previous codec, so the cache is cleared.
+ */
+void RedisInterface::setValueCodec(QSharedPointer<ValueCodec> codec)
+{
+    if(codec.isNull())
+        return;
+
+    _codec = codec;
+    clearCache();
+}
+
+/*!
+ * \brief Returns the name of the current value codec.
+ */
+QString RedisInterface::valueCodec() const
+{
+    return _codec->name();
+}
+
+/*!
+ * \brief Returns an already-completed reply holding the cached value of \a{key}, or NULL if it is not cached. The reply is finished
+ * from the event loop, so that callbacks connected to it still run asynchronously.
+ */
+RedisReply* RedisInterface::cachedReply(const QString &key) const
+{
+    QVariant value;
+    if(!_cache.lookup(key, value))
+        return NULL;
+
+    RedisReply* reply = new RedisReply(_transport);
+    reply->setValue(value);
+    QMetaObject::invokeMethod(reply, "finish", Qt::QueuedConnection);
+
+    return reply;
+}
+
+/*!
+ * \brief Sends a \c{GET} for \a{key}. The reply's value is decoded (see handleGetResponse()) before any other receiver of its
+ * \c{finished()} signal sees it. If the read cache is enabled and coherent, the reply is also tagged with the key and the current
+ * invalidation epoch so that cacheReply() can store its result.
+ */
+RedisReply* RedisInterface::sendGetCommand(const QString &key) const
+{
+    RedisReply* reply = _scheduler->sendRead(RequestScheduler::Interactive, QList<QByteArray>() << "GET" << key.toUtf8(),
+                                             QList<QByteArray>() << key.toUtf8());
+
+    // Connected first, so that it runs before the caller's own handlers.
+    connect(reply, SIGNAL(finished()), this, SLOT(handleGetResponse()));
+
+    if(_cache.capacity() > 0 && (_transport->isKeyTrackingActive() || _cacheSubscribed))
+    {
+        reply->setProperty("cacheKey", key);
+        reply->setProperty("cacheEpoch", _cacheEpoch);
+    }
+
+    return reply;
+}
+
+/*!
+ * \brief Stores the result of the completed \c{GET} \a{reply} in the read cache. The result is discarded if the reply was not tagged by
+ * sendGetCommand(), or if any invalidation has occurred since it was sent (in which case the value may already be out of date).
+ */
+void RedisInterface::cacheReply(RedisReply *reply) const
+{
+    QVariant key = reply->property("cacheKey");
+
+    if(!key.isValid() || reply->isError() || reply->property("cacheEpoch").toULongLong() != _cacheEpoch)
+        return;
+
+    _cache.insert(key.toString(), reply->value());
+}
+
+/*!
+ * \brief Removes \a{key} from the read cache, and marks any \c{GET}s in flight as stale.
+ */
+void RedisInterface::invalidateCachedKey(const QString &key)
+{
+    ++_cacheEpoch;
+    _cache.invalidate(key);
+}
 
-    // Tack the callback onto the reply as a UserData object. this will be unwrapped in handleGetRequestResponse_MetaMethod().
-    reply->setUserData(0, new MetaMethodCallback(parent(), key, callback));
+/*!
+ * \brief Subscribes to cacheNotificationPattern() on behalf of the read cache while it is enabled without key tracking, and unsubscribes
+ * (unless something else is bound to the pattern) once it is no longer needed.
+ */
+void RedisInterface::updateCacheSubscription()
+{
+    bool subscribe = _cache.capacity() > 0 && !_transport->isKeyTrackingActive();
+
+    if(subscribe == _cacheSubscribed)
+        return;
+
+    _cacheSubscribed = subscribe;
+
+    if(subscribe)
+        _transport->subscribe(cacheNotificationPattern());
+    else if(!_dispatchTable.contains(cacheNotificationPattern()))
+        _transport->unsubscribe(cacheNotificationPattern());
 }
 
 /*!
- * \brief Performs a single-shot PUBLISH command via Redis.
+ * \brief Handles the server reporting that \a{keys} have changed, removing them from the read cache. An empty list means that every
+ * key may have changed.
  */
-void RedisInterface::publish(QString remoteEventName, QVariant value)
+void RedisInterface::handleKeysInvalidated(QStringList keys)
 {
-//    qDebug() << "[RedisInterface] Publishing event" << remoteEventName << "via Redis, with value" << value.toString();
-    QNetworkReply* reply = _networkInterface->get(QNetworkRequest(QUrl(_serverUrl + "PUBLISH/" + remoteEventName + "/" + value.toString())));
-    connect(reply, SIGNAL(finished()), reply, SLOT(deleteLater()));
+    if(keys.isEmpty())
+        clearCache();
+
+    foreach(const QString& key, keys)
+        invalidateCachedKey(key);
+}
+
+/*!
+ * \brief Handles the reply to a \c{GET} sent by sendGetCommand(), replacing its value with the value decoded by the codec and storing it
+ * in the read cache.
+ */
+void RedisInterface::handleGetResponse()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL || reply->isError())
+        return;
+
+    reply->setValue(_codec->decodePayload(reply->value()));
+    cacheReply(reply);
+}
+
+/*!
+ * \brief Handles the completion of a multi-key read, caching the values fetched (if no invalidation has occurred since they were
+ * requested) and settling the promise that owns the request.
+ */
+void RedisInterface::handleMultiGetFinished()
+{
+    MultiGetRequest* request = qobject_cast<MultiGetRequest*>(sender());
+    RedisPromise* promise = request ? qobject_cast<RedisPromise*>(request->parent()) : NULL;
+
+    if(promise == NULL)
+        return;
+
+    if(request->isError())
+    {
+        promise->reject(request->errorString());
+        return;
+    }
+
+    if(request->isCacheable() && request->cacheEpoch() == _cacheEpoch)
+    {
+        QVariantMap fetchedValues = request->fetchedValues();
+
+        for(QVariantMap::const_iterator iter = fetchedValues.constBegin(); iter != fetchedValues.constEnd(); ++iter)
+            _cache.insert(iter.key(), iter.value());
+    }
+
+    promise->resolve(request->values());
+}
+
+/*!
+ * \brief Handles key tracking starting or stopping. Values cached under the previous scheme are not covered by the new one, so the
+ * cache is cleared, and the change notification subscription is taken out or released as required.
+ */
+void RedisInterface::handleKeyTrackingChanged(bool active)
+{
+    Q_UNUSED(active);
+
+    clearCache();
+    updateCacheSubscription();
+}
+
+/*!
+ * \brief Returns the state of the connection to Redis: \c{"connecting"} until it is first established, \c{"connected"}, or
+ * \c{"reconnecting"} after it has been lost.
+ */
+QString RedisInterface::connectionState() const
+{
+    switch(_transport->connectionState())
+    {
+    case RedisTransport::Connected:
+        return "connected";
+
+    case RedisTransport::Reconnecting:
+        return "reconnecting";
+
+    default:
+        return "connecting";
+    }
+}
+
+/*!
+ * \brief Returns how long, in milliseconds, the last resynchronisation took: from the subscriptions being restored after a reconnection
+ * until every subscribed property had been refreshed. Returns -1 if no resynchronisation has completed.
+ */
+int RedisInterface::lastResyncDuration() const
+{
+    return _lastResyncDuration;
+}
+
+/*!
+ * \brief Handles a change of connection \a{state}, re-emitting it as \c{connectionStateChanged()}.
+ */
+void RedisInterface::handleConnectionStateChanged(RedisTransport::ConnectionState state)
+{
+    Q_UNUSED(state);
+
+    emit connectionStateChanged(connectionState());
+}
+
+/*!
+ * \brief Handles every subscription having been restored after the subscriber connection was lost. Change notifications (and cache
+ * invalidations) published in the meantime were missed, so the read cache is cleared and every subscribed property is re-read with a
+ * single multi-key read. Subscribed objects are hydrated again alongside it. The last known remote values of published properties are
+ * forgotten, so that their next writes are not skipped.
+ */
+void RedisInterface::handleResubscribed()
+{
+    clearCache();
+    _resyncTimer.start();
+
+    // Writes may have been lost with the connection, and other clients' changes missed, so nothing is known about the remote values.
+    _lastRemoteValues.clear();
+
+    // Everything is about to be re-read anyway.
+    _keyspaceChangedKeys.clear();
+    _keyspaceChangedObjects.clear();
+
+    for(int i = 0; i < _publishedObjects.size(); ++i)
+        _publishedObjects[i].lastValues.fill(QVariant());
+
+    foreach(const QString& key, _subscribedObjects.keys())
+        hydrateObject(key);
+
+    QStringList keys = _subscribedProperties.uniqueKeys();
+
+    if(keys.isEmpty())
+    {
+        handleResyncFinished(QVariantMap());
+        return;
+    }
+
+    qCDebug(lcRedisInterface) << "Resubscribed, resynchronising" << keys.size() << "properties";
+
+    RedisPromise* promise = getAsync(keys);
+    connect(promise, SIGNAL(fulfilled(QVariant)), this, SLOT(handleResyncFinished(QVariant)));
+    connect(promise, SIGNAL(rejected(QString)), this, SLOT(handleResyncFailed(QString)));
+}
+
+/*!
+ * \brief Writes the re-read \a{values} (a map from each subscribed property's key to its value) to the bound local properties, and
+ * records the duration of the resynchronisation. Keys that no longer exist leave their properties untouched.
+ */
+void RedisInterface::handleResyncFinished(QVariant values)
+{
+    writeSubscribedProperties(values.toMap());
+
+    _lastResyncDuration = int(_resyncTimer.elapsed());
+    emit resynchronised(_lastResyncDuration);
+}
+
+/*!
+ * \brief Reports a failed resynchronisation. Properties will catch up with their next change notification.
+ */
+void RedisInterface::handleResyncFailed(QString errorString)
+{
+    std::cerr << "[RedisInterface] handleResyncFailed(): Failed to resynchronise subscribed properties: " << errorString.toStdString() << std::endl;
+}
+
+/*!
+ * \brief Writes the given \a{values} (a map from subscribed properties' keys to their values) to the bound local properties. Keys missing
+ * from the map, or that no longer exist, leave their properties untouched.
+ */
+void RedisInterface::writeSubscribedProperties(const QVariantMap &values)
+{
+    for(QMultiMap<QString, QMetaProperty>::const_iterator iter = _subscribedProperties.constBegin(); iter != _subscribedProperties.constEnd(); ++iter)
+    {
+        QVariant value = values.value(iter.key());
+
+        if(value.isValid())
+            iter.value().write(parent(), _codec->decodePayload(value, iter.value().userType()));
+    }
+}
+
+/*!
+ * \brief Selects where change notifications come from, by \a{mode}:
+ *
+ * \list
+ * \li \c{"publish"} (the default): every write made through a RedisInterface is accompanied by a \c{PUBLISH} on \c{key_changed}
+ *     carrying the new value, which subscribers apply directly. Only writes made through a RedisInterface are seen.
+ * \li \c{"keyspace"}: writes are sent alone, and subscribed properties and objects follow the server's keyspace notifications. Each
+ *     notification only names the command, so the changed keys are re-read, coalesced once per event loop turn. Writes made by any
+ *     client are seen.
+ * \endlist
+ *
+ * Every client writing or subscribing to the same keys should use the same mode. Keyspace notifications must be enabled on the server
+ * (\c{notify-keyspace-events}): selecting \c{"keyspace"} reads the setting, and warns if a class it needs (keyspace events for generic,
+ * string and hash commands) is missing. Only if \a{options} holds a true \c{configureServer} are the missing classes enabled with
+ * \c{CONFIG SET}, keeping any already enabled. That setting is global to the server, so it applies to every client and database on it,
+ * and lasts until the server is reconfigured or restarted; the server may also refuse it. Notifications are those of the database selected
+ * by the server URL (database 0 through webdis, unless webdis is configured otherwise). A write's own notification cannot be told
+ * apart from anyone else's, so a property both published and subscribed is re-read after each of its writes (without being written
+ * back, since its value is unchanged). Returns false if the mode is unknown.
+ */
+bool RedisInterface::setChangeNotifications(QString mode, QVariantMap options)
+{
+    if(mode != "publish" && mode != "keyspace")
+    {
+        std::cerr << "[RedisInterface] setChangeNotifications(): Unknown change notification mode " << mode.toStdString() << "!" << std::endl;
+        return false;
+    }
+
+    bool keyspace = mode == "keyspace";
+    bool configureServer = options.value("configureServer", false).toBool();
+    bool allowedToConfigure = configureServer && !_configureServer;
+    _configureServer = configureServer;
+
+    if(keyspace == _keyspaceNotifications)
+    {
+        // Being allowed to configure the server is a reason to check it again.
+        if(keyspace && allowedToConfigure)
+            checkKeyspaceEvents();
+
+        return true;
+    }
+
+    // The read cache's subscription follows the mode too.
+    if(_cacheSubscribed)
+    {
+        if(!_dispatchTable.contains(cacheNotificationPattern()))
+            _transport->unsubscribe(cacheNotificationPattern());
+
+        _cacheSubscribed = false;
+    }
+
+    _keyspaceNotifications = keyspace;
+    _keyspaceChangedKeys.clear();
+    _keyspaceChangedObjects.clear();
+
+    if(keyspace)
+        checkKeyspaceEvents();
+
+    updateSubscriptions();
+    updateCacheSubscription();
+
+    return true;
+}
+
+/*!
+ * \brief Returns where change notifications come from: \c{"publish"} or \c{"keyspace"} (see setChangeNotifications()).
+ */
+QString RedisInterface::changeNotifications() const
+{
+    return _keyspaceNotifications ? "keyspace" : "publish";
+}
+
+/*!
+ * \brief Returns the channel on which changes to \a{key} are notified: \c{key_changed}, or with keyspace change notifications,
+ * \c{__keyspace@N__:key}.
+ */
+QString RedisInterface::changeChannel(const QString &key) const
+{
+    return _keyspaceNotifications ? _keyspacePrefix + key : key + "_changed";
+}
+
+/*!
+ * \brief Returns the key whose changes are notified on \a{channel}, or a null string if it is not a change notification channel.
+ */
+QString RedisInterface::changeChannelKey(const QString &channel) const
+{
+    if(_keyspaceNotifications)
+        return channel.startsWith(_keyspacePrefix) ? channel.mid(_keyspacePrefix.size()) : QString();
+
+    return channel.endsWith("_changed") ? channel.left(channel.size() - 8) : QString();
+}
+
+/*!
+ * \brief Returns the pattern subscribed to by the read cache when key tracking is unavailable: every change notification of the current
+ * mode.
+ */
+QString RedisInterface::cacheNotificationPattern() const
+{
+    return _keyspaceNotifications ? _keyspacePrefix + "*" : QString(ChangeNotificationPattern);
+}
+
+/*!
+ * \brief Returns the prefix of the keyspace notification channels of the database selected by \a{serverUrl}.
+ */
+QString RedisInterface::keyspacePrefix(const QString &serverUrl)
+{
+    QUrl url(serverUrl);
+    int database = url.scheme() == "redis" ? url.path().mid(1).toInt() : 0;
+
+    return QString("__keyspace@%1__:").arg(database);
+}
+
+/*!
+ * \brief Reads the server's \c{notify-keyspace-events} setting, so that handleKeyspaceConfig() can report (or enable) any classes still
+ * missing.
+ */
+void RedisInterface::checkKeyspaceEvents()
+{
+    RedisReply* reply = _scheduler->sendCommand(RequestScheduler::Background, QList<QByteArray>() << "CONFIG" << "GET" << "notify-keyspace-events");
+    connect(reply, SIGNAL(finished()), this, SLOT(handleKeyspaceConfig()));
+}
+
+/*!
+ * \brief Handles the reply to checkKeyspaceEvents(), warning about the keyspace event classes needed but not enabled, or if allowed to
+ * configure the server (see setChangeNotifications()), adding them to those already enabled with \c{CONFIG SET}. If the server
+ * refuses, keyspace notifications must be enabled in its configuration.
+ */
+void RedisInterface::handleKeyspaceConfig()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    if(reply->isError())
+    {
+        std::cerr << "[RedisInterface] handleKeyspaceConfig(): Failed to read notify-keyspace-events (" << reply->errorString().toStdString() << "); keyspace notifications must be enabled on the server" << std::endl;
+        return;
+    }
+
+    QString classes = reply->value().toList().value(1).toString();
+    QString missing;
+
+    // "A" stands for every class of command.
+    for(const char* eventClass = KeyspaceEventClasses; *eventClass; ++eventClass)
+        if(!classes.contains(QLatin1Char(*eventClass)) && !(*eventClass != 'K' && classes.contains(QLatin1Char('A'))))
+            missing.append(QLatin1Char(*eventClass));
+
+    if(missing.isEmpty())
+        return;
+
+    if(!_configureServer)
+    {
+        std::cerr << "[RedisInterface] handleKeyspaceConfig(): Keyspace event classes \"" << missing.toStdString() << "\" are not enabled on the server (notify-keyspace-events is \"" << classes.toStdString() << "\"); keyspace change notifications will be missed until they are" << std::endl;
+        return;
+    }
+
+    qCDebug(lcRedisInterface) << "Enabling keyspace events" << missing << "in addition to" << classes;
+
+    RedisReply* setReply = _scheduler->sendCommand(RequestScheduler::Background, QList<QByteArray>() << "CONFIG" << "SET" << "notify-keyspace-events" << (classes + missing).toUtf8());
+    connect(setReply, SIGNAL(finished()), this, SLOT(handleKeyspaceConfigured()));
+}
+
+/*!
+ * \brief Reports a failure to enable keyspace notifications.
+ */
+void RedisInterface::handleKeyspaceConfigured()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    if(reply->isError())
+        std::cerr << "[RedisInterface] handleKeyspaceConfigured(): Failed to enable keyspace notifications (" << reply->errorString().toStdString() << "); they must be enabled on the server" << std::endl;
+}
+
+/*!
+ * \brief Re-reads the keys reported by the keyspace notifications received since the last call: every changed property key with a
+ * single multi-key read, and every changed object with an \c{HGETALL}. Runs once per event loop turn, so a key changed many times in
+ * the meantime is read once.
+ */
+void RedisInterface::handleKeyspaceFetch()
+{
+    foreach(const QString& key, _keyspaceChangedObjects)
+        hydrateObject(key);
+
+    _keyspaceChangedObjects.clear();
+
+    if(_keyspaceChangedKeys.isEmpty())
+        return;
+
+    QStringList keys = _keyspaceChangedKeys.toList();
+    _keyspaceChangedKeys.clear();
+
+    RedisPromise* promise = getAsync(keys);
+    connect(promise, SIGNAL(fulfilled(QVariant)), this, SLOT(handleKeyspaceValues(QVariant)));
+    connect(promise, SIGNAL(rejected(QString)), this, SLOT(handleKeyspaceFetchFailed(QString)));
+}
+
+/*!
+ * \brief Writes the \a{values} re-read after keyspace notifications to their bound properties, remembering them as the values held by
+ * Redis so that they are not written back.
+ */
+void RedisInterface::handleKeyspaceValues(QVariant values)
+{
+    QVariantMap valueMap = values.toMap();
+
+    for(QVariantMap::const_iterator iter = valueMap.constBegin(); iter != valueMap.constEnd(); ++iter)
+        if(iter.value().isValid())
+            _lastRemoteValues.insert(iter.key().toUtf8(), _codec->encode(iter.value()));
+
+    writeSubscribedProperties(valueMap);
+}
+
+/*!
+ * \brief Reports a failed re-read of keys reported by keyspace notifications. Their properties will catch up with their next change.
+ */
+void RedisInterface::handleKeyspaceFetchFailed(QString errorString)
+{
+    std::cerr << "[RedisInterface] handleKeyspaceFetchFailed(): Failed to read changed properties: " << errorString.toStdString() << std::endl;
+}
+
+/*!
+ * \brief Encodes the script \a{argument}: numbers as text, booleans as \c{"1"} or \c{"0"}, and anything else with the value codec.
+ */
+QByteArray RedisInterface::encodeScriptArgument(const QVariant &argument) const
+{
+    switch(argument.userType())
+    {
+    case QMetaType::Bool:
+        return argument.toBool() ? "1" : "0";
+
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Double:
+    case QMetaType::Float:
+        return argument.toString().toUtf8();
+
+    default:
+        return _codec->encode(argument);
+    }
+}
+
+/*!
+ * \brief Sets the size in \a{bytes} from which payloads are compressed (see PayloadCompressor): values written by set() and setAsync(),
+ * events sent by publish(), and the payloads of bindings that don't give their own \c{compress} option. The default of 0 disables
+ * compression. Compression only pays off for large payloads on slow links, and every reader must be a RedisInterface.
+ */
+void RedisInterface::setCompressionThreshold(int bytes)
+{
+    _compressionThreshold = qMax(0, bytes);
+}
+
+/*!
+ * \brief Returns the size in bytes from which payloads are compressed, or 0 if compression is disabled.
+ */
+int RedisInterface::compressionThreshold() const
+{
+    return _compressionThreshold;
+}
+
+/*!
+ * \brief Returns the compression threshold selected by the \c{compress} entry of a binding's \a{options}: a size in bytes, \c{true}
+ * for PayloadCompressor::DefaultThreshold, or \c{false} (or 0) to disable compression. Returns -1 if there is no such entry.
+ */
+int RedisInterface::compressionThreshold(const QVariantMap &options)
+{
+    QVariantMap::const_iterator option = options.constFind("compress");
+
+    if(option == options.constEnd())
+        return -1;
+
+    if(option.value().userType() == QMetaType::Bool)
+        return option.value().toBool() ? PayloadCompressor::DefaultThreshold : 0;
+
+    return qMax(0, option.value().toInt());
+}
+
+/*!
+ * \brief Returns the encoded \a{payload} compressed if it is at least \a{threshold} bytes long (or, if \a{threshold} is -1, at
+ * least compressionThreshold() bytes), otherwise unchanged.
+ */
+QByteArray RedisInterface::compress(const QByteArray &payload, int threshold)
+{
+    return _compressor.compress(payload, threshold < 0 ? _compressionThreshold : threshold);
+}
+
+/*!
+ * \brief Sets the maximum number of requests of the named \a{lane} (\c{"interactive"}, \c{"control"}, \c{"bulk"} or
+ * \c{"background"}) in flight at once to \a{maxInFlight}, or removes the limit if it is 0 (see RequestScheduler). Returns false,
+ * changing nothing, if there is no lane with the given name.
+ */
+bool RedisInterface::setLaneLimit(QString lane, int maxInFlight)
+{
+    int index = RequestScheduler::laneFromName(lane);
+
+    if(index < 0)
+    {
+        std::cerr << "[RedisInterface] setLaneLimit(): Unknown lane " << lane.toStdString() << "!" << std::endl;
+        return false;
+    }
+
+    _scheduler->setLimit(RequestScheduler::Lane(index), maxInFlight);
+    return true;
+}
+
+/*!
+ * \brief Cancels every request queued (but not yet sent) in the named \a{lane}, eg. pending bulk writes that a view being closed no
+ * longer needs. Their promises are rejected, and cancelled binding writes are treated as failed writes (see handleValueWritten()), so
+ * writing the same values again is not skipped. Returns the number of requests cancelled.
+ */
+int RedisInterface::cancelQueued(QString lane)
+{
+    int index = RequestScheduler::laneFromName(lane);
+
+    if(index < 0)
+    {
+        std::cerr << "[RedisInterface] cancelQueued(): Unknown lane " << lane.toStdString() << "!" << std::endl;
+        return 0;
+    }
+
+    return _scheduler->cancelQueued(RequestScheduler::Lane(index));
+}
+
+/*!
+ * \brief Returns counters describing each request lane, by lane name: requests queued, held and in flight, limits, requests sent,
+ * completed, cancelled and superseded, and the time spent queued (see RequestScheduler::statistics()).
+ */
+QVariantMap RedisInterface::laneStatistics() const
+{
+    return _scheduler->statistics();
+}
+
+/*!
+ * \brief Returns the lane selected by the \c{lane} entry of a binding's \a{options} (see RequestScheduler::laneName()), or the bulk
+ * lane if there is none (or it names no lane, which is reported).
+ */
+RequestScheduler::Lane RedisInterface::bindingLane(const QVariantMap &options)
+{
+    if(!options.contains("lane"))
+        return RequestScheduler::Bulk;
+
+    int lane = RequestScheduler::laneFromName(options.value("lane").toString());
+
+    if(lane < 0)
+    {
+        std::cerr << "[RedisInterface] bindingLane(): Unknown lane " << options.value("lane").toString().toStdString() << ", using bulk" << std::endl;
+        return RequestScheduler::Bulk;
+    }
+
+    return RequestScheduler::Lane(lane);
 }
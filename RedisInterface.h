@@ -3,21 +3,36 @@
 
 #include <QObject>
 #include <QMap>
+#include <QHash>
+#include <QVector>
+#include <QSet>
+#include <QBitArray>
+#include <QPair>
 #include <QUrl>
-#include <QNetworkAccessManager>
-#include <QNetworkRequest>
-#include <QNetworkReply>
 #include <QMetaMethod>
-#include <QJsonObject>
-#include <QJsonDocument>
-#include <QJsonArray>
 #include <iostream>
 #include <QJSEngine>
 #include <QJSValue>
 #include <QObjectUserData>
 #include <QEventLoop>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QUuid>
 #include <QDebug>
 #include <stdexcept>
+#include "RedisTransport.h"
+#include "SharedTransport.h"
+#include "PublishThrottle.h"
+#include "ReadCache.h"
+#include "RedisPromise.h"
+#include "MultiGetRequest.h"
+#include "ValueCodec.h"
+#include "EventMarshaller.h"
+#include "SignalRelay.h"
+#include "StreamConsumer.h"
+#include "ScriptRegistry.h"
+#include "PayloadCompressor.h"
+#include "RequestScheduler.h"
 
 class RedisInterface : public QObject
 {
@@ -25,8 +40,8 @@ class RedisInterface : public QObject
 
 public:
 
-    /** Constructor. Requires a valid QObject-based parent to map events to/from. */
-    RedisInterface(QString serverUrl, QObject* parent);
+    /** Constructor. Requires a valid QObject-based parent to map events to/from. If threaded, network I/O runs on a worker thread. */
+    RedisInterface(QString serverUrl, QObject* parent, bool threaded = false);
 
     /** Convenience methods for retrieving methods/signals/slots/properties from a given QObject's meta-object. */
     static QMetaMethod getMethod(QObject* object, QString signature);
@@ -34,25 +49,81 @@ public:
     static QMetaMethod getSlot(QObject* object, QString signature);
     static QMetaProperty getProperty(QObject* object, QString propertyName);
 
+    /** Returns the method (or signal, if signalsOnly) with the given signature, or with the given bare name (preferring an overload without parameters). */
+    static QMetaMethod resolveMethod(QObject* object, QString nameOrSignature, bool signalsOnly = false);
+
+    /** Returns true if the given method can send or receive event arguments (see EventMarshaller). */
+    static bool acceptsEventArguments(const QMetaMethod& method);
+
+    /** Installs a custom codec for the values written to and read from Redis. */
+    void setValueCodec(QSharedPointer<ValueCodec> codec);
+
 public slots:
 
-    /** Subscribes to the given Redis event, causing localMethodName to be called automatically. */
-    bool subscribeToEvent(QString remoteEventName, QString localMethodName);
+    /** Subscribes to the given Redis event (or glob-style pattern), causing localMethodName to be called automatically. The options select
+     *  between pub/sub delivery (the default) and lossless delivery from a Redis stream (see subscribeToEvent() docs). */
+    bool subscribeToEvent(QString remoteEventName, QString localMethodName, QVariantMap options = QVariantMap());
+
+    /** Removes a binding previously added with subscribeToEvent(). */
+    bool unsubscribeFromEvent(QString remoteEventName, QString localMethodName);
 
-    /** Publishes the given local signal, generating the given Redis event automatically. */
-    void publishEvent(QString localSignalName, QString remoteEventName);
+    /** Publishes the given local signal, generating the given Redis event automatically (or, if the options say so, appending it to a stream). */
+    void publishEvent(QString localSignalName, QString remoteEventName, QVariantMap options = QVariantMap());
 
     /** Subscribes to the given Redis property, causing localPropertyName to be updated automatically. */
     void subscribeToProperty(QString remotePropertyName, QString localPropertyName);
 
-    /** Publishes the given local property, causing remotePropertyName to be updated automatically on Redis. */
-    void publishProperty(QString localPropertyName, QString remotePropertyName);
+    /** Removes a binding previously added with subscribeToProperty(). */
+    void unsubscribeFromProperty(QString remotePropertyName, QString localPropertyName);
+
+    /** Publishes the given local property, causing remotePropertyName to be updated automatically on Redis according to the given publish policy. */
+    void publishProperty(QString localPropertyName, QString remotePropertyName, QVariantMap policy = QVariantMap());
+
+    /** Publishes the given local properties (by default, those declared by the parent's own class) as the fields of the given Redis
+     *  hash, writing only the fields that have changed (once per event loop turn, unless the given publish policy says otherwise). */
+    void publishObject(QString remoteHashKey, QStringList localPropertyNames = QStringList(), QVariantMap policy = QVariantMap());
+
+    /** Subscribes to the given Redis hash, hydrating the given local properties (by default, those declared by the parent's own class)
+     *  from its fields with a single HGETALL, and updating them whenever its fields change. */
+    void subscribeToObject(QString remoteHashKey, QStringList localPropertyNames = QStringList());
+
+    /** Removes a binding previously added with subscribeToObject(). */
+    void unsubscribeFromObject(QString remoteHashKey);
 
     /** SETs the given Redis property to the given value. */
     void set(QString key, const QVariant& value);
 
-    /** Performs a synchronous (thread-blocking) GET request for the given Redis key. */
+#ifndef REDIS_NO_SYNCHRONOUS_GET
+    /** Performs a synchronous (thread-blocking) GET request for the given Redis key. Define REDIS_NO_SYNCHRONOUS_GET to remove it. */
     QVariant get(QString key) const;
+#endif
+
+    /** Performs an asynchronous GET request, returning a promise of the value. */
+    RedisPromise* getAsync(QString key);
+
+    /** Reads several keys at once (as bounded MGET chunks sent in one batch), returning a promise of a key-to-value map. */
+    RedisPromise* getAsync(QStringList keys);
+
+    /** Reads several keys at once, calling the given JavaScript callback with a single key-to-value map upon completion. */
+    void get(QStringList keys, QJSValue callback);
+
+    /** Reads several keys at once, calling the given C++ method (taking a QVariant) with a single key-to-value map upon completion. */
+    void get(QStringList keys, QMetaMethod callback);
+
+    /** SETs the given Redis property (publishing its change notification), returning a promise that settles once the server has applied it. */
+    RedisPromise* setAsync(QString key, const QVariant& value);
+
+    /** Sends an arbitrary command (command name followed by its arguments), returning a promise of its reply. */
+    RedisPromise* execute(QStringList command);
+
+    /** Registers the given Lua script under the given name, loading it into the server once so that it can be run by its digest. */
+    void registerScript(QString name, QString source);
+
+    /** Removes the script registered under the given name. */
+    void unregisterScript(QString name);
+
+    /** Runs the named script (with EVALSHA) on the given keys, passing the given arguments, returning a promise of its result. */
+    RedisPromise* runScript(QString name, QStringList keys = QStringList(), QVariantList arguments = QVariantList());
 
     /** Performs an asynchronous GET request, calling the given JavaScript callback upon completion. */
     void get(QString key, QJSValue callback) const;
@@ -63,22 +134,250 @@ public slots:
     /** Performs a single-shot PUBLISH event to Redis, with the given event name and value. */
     void publish(QString remoteEventName, QVariant value);
 
-private slots:
+    /** Sets how long (in milliseconds) outgoing commands are collected before being sent as one batch. */
+    void setBatchWindow(int msecs);
+
+    /** Returns counters describing the batches of commands sent so far. */
+    QVariantMap batchStatistics() const;
+
+    /** Sets the maximum number of GET results held in the client-side read cache (0, the default, disables the cache). */
+    void setCacheSize(int entries);
+    int cacheSize() const;
+
+    /** Returns counters describing the read cache (hits, misses, hitRate, evictions, invalidations, size, capacity, tracking). */
+    QVariantMap cacheStatistics() const;
+
+    /** Discards every value held in the read cache. */
+    void clearCache();
+
+    /** Returns runtime counters: requests sent and pending, reply latency percentiles, messages received and bytes transferred (see
+     *  RedisMetrics), along with the batch and cache statistics. */
+    QVariantMap metrics() const;
+
+    /** Selects the codec for the values written to and read from Redis by name ("text", the default, or "binary"). */
+    bool setValueCodec(QString name);
+    QString valueCodec() const;
+
+    /** Returns the state of the connection to Redis ("connecting", "connected" or "reconnecting"). */
+    QString connectionState() const;
+
+    /** Returns how long (in milliseconds) the last resynchronisation after a reconnection took, or -1 if there has been none. */
+    int lastResyncDuration() const;
 
-    /** Adds a subscription to the given remote event, hooking it up to the given method belonging to the given QObject subclass. */
-    void addEventSubscription(QString remoteEventName, QObject *targetObject, QMetaMethod targetMethod);
+    /** Selects where change notifications come from: "publish" (the default), a PUBLISH accompanying every write, or "keyspace", the
+     *  server's keyspace notifications, which report writes made by any client. The "configureServer" option allows keyspace mode to
+     *  enable missing keyspace notification classes on the server (a server-wide setting), rather than only warning about them. */
+    bool setChangeNotifications(QString mode, QVariantMap options = QVariantMap());
+    QString changeNotifications() const;
+
+    /** Sets the size (in bytes) from which payloads written by set(), setAsync() and publish(), and by bindings that don't give their
+     *  own "compress" option, are compressed (0, the default, disables compression). */
+    void setCompressionThreshold(int bytes);
+    int compressionThreshold() const;
+
+    /** Sets the maximum number of requests of the given lane ("interactive", "control", "bulk" or "background") in flight at once
+     *  (0 for no limit). Returns false if there is no such lane. */
+    bool setLaneLimit(QString lane, int maxInFlight);
+
+    /** Cancels the requests queued (but not yet sent) in the given lane, returning their number. */
+    int cancelQueued(QString lane);
+
+    /** Returns counters describing each request lane (see RequestScheduler::statistics()). */
+    QVariantMap laneStatistics() const;
+
+signals:
+
+    /** Emitted when the connection to Redis is lost or (re-)established. */
+    void connectionStateChanged(QString state);
+
+    /** Emitted once every subscribed property has been refreshed after a reconnection, with the time taken since resubscribing. */
+    void resynchronised(int msecs);
+
+private slots:
 
     /** Private handler slots to catch remote and local events. */
-    void handleSubscribedEvent();
+    void handleSubscriptionMessage(QString subscription, QString channel, QVariant payload);
     void handlePublishedEvent();
-    void handleSubscribedPropertyUpdate();
+    void handlePublishedEventArguments(int signalIndex, QVariantList arguments);
+    void handleStreamEntries(QString stream, QVariantList payloads);
     void handlePublishedPropertyUpdate();
+    void handleThrottledPropertyUpdate();
+    void handlePublishedObjectUpdate();
+    void handleThrottledObjectUpdate();
+    void handleObjectHydrated();
+    void handleValueWritten();
+    void handlePublishedFieldsWritten();
     void handleGetRequestResponse_JavaScript();
     void handleGetRequestResponse_MetaMethod();
+    void handleKeysInvalidated(QStringList keys);
+    void handleKeyTrackingChanged(bool active);
+    void handleGetResponse();
+    void handleMultiGetFinished();
+    void handleConnectionStateChanged(RedisTransport::ConnectionState state);
+    void handleResubscribed();
+    void handleResyncFinished(QVariant values);
+    void handleResyncFailed(QString errorString);
+    void handleKeyspaceConfig();
+    void handleKeyspaceConfigured();
+    void handleKeyspaceFetch();
+    void handleKeyspaceValues(QVariant values);
+    void handleKeyspaceFetchFailed(QString errorString);
 
 private:
 
-    /** Packages up a JavaScript callback such that it can be tacked onto a QNetworkReply for later invocation. */
+    /** A published local signal, with its Redis event name (or stream key) and payload encoded once at registration time. */
+    struct PublishedEvent
+    {
+        QByteArray remoteEventName;
+        QByteArray payload;
+        bool stream;
+        QByteArray maxLength;
+        int compressionThreshold;
+        RequestScheduler::Lane lane;
+    };
+
+    /** A published local property, with its Redis key and change channel encoded once at registration time. */
+    struct PublishedProperty
+    {
+        QMetaProperty property;
+        QByteArray remoteKey;
+        QByteArray changedChannel;
+        PublishThrottle* throttle;
+        int compressionThreshold;
+        RequestScheduler::Lane lane;
+    };
+
+    /** Local properties published as the fields of a Redis hash, with the key, change channel and field names encoded once at
+     *  registration time, and the fields changed since the last write. */
+    struct PublishedObject
+    {
+        QByteArray remoteKey;
+        QByteArray changedChannel;
+        QVector<QMetaProperty> properties;
+        QVector<QByteArray> fields;
+        QBitArray dirty;
+        QVector<QVariant> lastValues;
+        PublishThrottle* throttle;
+        int compressionThreshold;
+        RequestScheduler::Lane lane;
+    };
+
+    /** Local properties bound to the fields of a subscribed Redis hash, by field name. */
+    typedef QHash<QString, QMetaProperty> ObjectFields;
+
+    /** Local targets bound to a single Redis channel or pattern. */
+    struct SubscriptionTargets
+    {
+        QList<EventMarshaller> methods;
+        QList<QMetaProperty> properties;
+        QList<ObjectFields> objects;
+    };
+
+    /** Local methods bound to a single Redis stream, and the consumer reading it. */
+    struct StreamSubscription
+    {
+        StreamConsumer* consumer;
+        QList<EventMarshaller> methods;
+    };
+
+    /** Binds the given method to the entries of the given stream, read by the consumer selected by the options. */
+    bool subscribeToStream(const QString& key, const QMetaMethod& method, const QVariantMap& options);
+
+    /** Removes a binding made by subscribeToStream(). Returns false if there was none. */
+    bool unsubscribeFromStream(const QString& key, const QMetaMethod& method);
+
+    /** PUBLISHes the given encoded payload (compressed, if the event calls for it) for the given published event, or appends it to the
+     *  event's stream. */
+    void sendEvent(const PublishedEvent& event, const QByteArray& encodedPayload);
+
+    /** Writes the current value of the published property with the given binding index to Redis. */
+    void publishPropertyValue(int index);
+
+    /** Writes the changed fields of the published object with the given binding index to Redis, with a single HSET and notification. */
+    void publishObjectFields(int index);
+
+    /** Reads every field of the given subscribed hash with a single HGETALL, writing them to their local properties. */
+    void hydrateObject(const QString& key);
+
+    /** Returns the parent's properties with the given names (or, if none are given, those declared by the parent's own class). */
+    QList<QMetaProperty> objectProperties(const QStringList& names) const;
+
+    /** SETs the given pre-encoded key to the given encoded value and PUBLISHes its (origin-tagged) change notification on the given
+     *  pre-encoded channel, compressing the value if it reaches the given compression threshold (see compress()), in the given lane. */
+    RedisReply* setEncoded(const QByteArray& key, const QByteArray& changedChannel, const QByteArray& encodedValue, int compressionThreshold = -1,
+                           RequestScheduler::Lane lane = RequestScheduler::Control);
+
+    /** Returns the given change notification payload behind this interface's origin header. */
+    QByteArray originTagged(const QByteArray& payload) const;
+
+    /** Removes the origin header from a change notification payload. Returns true if the notification was published by this interface. */
+    bool stripOriginTag(QVariant& payload) const;
+
+    /** Returns the bytes of a payload received from Redis (as the transport decoded them). */
+    static QByteArray payloadBytes(const QVariant& payload);
+
+    /** Records the last known remote values of the fields of the given hash, for any objects published to it. */
+    void noteObjectFields(const QByteArray& key, const QVariantMap& values, bool decoded);
+
+    /** PUBLISHes the given pre-encoded payload on the given pre-encoded channel, in the given lane. */
+    void publishEncoded(const QByteArray& channel, const QByteArray& payload, RequestScheduler::Lane lane = RequestScheduler::Control);
+
+    /** Decodes the arguments carried by an event's payload (a list, or a single value). */
+    QVariantList decodeEventArguments(const QVariant& payload) const;
+
+    /** Returns an already-completed reply holding the cached value of the given key, or NULL if it is not cached. */
+    RedisReply* cachedReply(const QString& key) const;
+
+    /** Sends a GET for the given key, arranging for its result to be decoded and tagging the reply so that cacheReply() can store it. */
+    RedisReply* sendGetCommand(const QString& key) const;
+
+    /** Stores the result of a completed GET in the read cache, if no invalidation has occurred since it was sent. */
+    void cacheReply(RedisReply* reply) const;
+
+    /** Removes the given key from the read cache, and marks any GETs in flight as stale. */
+    void invalidateCachedKey(const QString& key);
+
+    /** Subscribes to (or unsubscribes from) the change notifications keeping the read cache coherent when key tracking is unavailable. */
+    void updateCacheSubscription();
+
+    /** Maximum number of keys read by a single MGET. Larger reads are split into several MGETs, sent in the same batch. */
+    static const int MaxKeysPerMultiGet = 100;
+
+    /** Rebuilds the dispatch table from the subscription maps, sending SUBSCRIBE/UNSUBSCRIBE for any channels gained or lost. */
+    void updateSubscriptions();
+
+    /** Writes the given values (by key) to the local properties subscribed to those keys. */
+    void writeSubscribedProperties(const QVariantMap& values);
+
+    /** Returns the channel notifying changes to the given key, and the key whose changes are notified on the given channel (or a null
+     *  string), in the current change notification mode. */
+    QString changeChannel(const QString& key) const;
+    QString changeChannelKey(const QString& channel) const;
+
+    /** Returns the pattern matching every change notification in the current mode, subscribed to by the read cache without key tracking. */
+    QString cacheNotificationPattern() const;
+
+    /** Returns the prefix of the keyspace notification channels for the database selected by the given server URL. */
+    static QString keyspacePrefix(const QString& serverUrl);
+
+    /** Checks that the server has the keyspace notification classes needed by keyspace change notifications enabled, enabling them if
+     *  allowed to configure the server. */
+    void checkKeyspaceEvents();
+
+    /** Returns the compression threshold selected by the "compress" option of a binding: a size in bytes, true for the default
+     *  threshold, false (or 0) to disable compression, or -1 if the option is missing (so that the interface's threshold applies). */
+    static int compressionThreshold(const QVariantMap& options);
+
+    /** Returns the lane selected by the "lane" option of a binding, by default the bulk lane. */
+    static RequestScheduler::Lane bindingLane(const QVariantMap& options);
+
+    /** Compresses the given encoded payload if it reaches the given threshold (or, if it is -1, the interface's threshold). */
+    QByteArray compress(const QByteArray& payload, int threshold);
+
+    /** Encodes a script argument: numbers and booleans as text, anything else with the value codec. */
+    QByteArray encodeScriptArgument(const QVariant& argument) const;
+
+    /** Packages up a JavaScript callback such that it can be tacked onto a RedisReply for later invocation. */
     class JavaScriptCallback : public QObjectUserData
     {
     public:
@@ -86,7 +385,7 @@ private:
         QJSValue callback;
     };
 
-    /** Packages up a QMetaMethod callback such that it can be tacked onto a QNetworkReply for later invocation. */
+    /** Packages up a QMetaMethod callback such that it can be tacked onto a RedisReply for later invocation. */
     class MetaMethodCallback: public QObjectUserData
     {
     public:
@@ -102,23 +401,98 @@ private:
         QMetaMethod callback;
     };
 
-    /** URL of the Redis HTTP (webdis) server (eg. "http://localhost:7379/") */
+    /** URL of the Redis server, either webdis (eg. "http://localhost:7379/") or native (eg. "redis://localhost:6379") */
     QString _serverUrl;
 
-    /** Object responsible for making network requests to Redis. */
-    QNetworkAccessManager* _networkInterface;
+    /** Whether network I/O runs on a worker thread (for the connection shared with other interfaces, and any stream consumers). */
+    bool _threaded;
+
+    /** Object responsible for sending commands to Redis over the protocol selected by _serverUrl. */
+    RedisTransport* _transport;
+
+    /** Codec used to encode the values written to Redis, and to decode the values read from it. Shared with requests in flight. */
+    QSharedPointer<ValueCodec> _codec;
 
     /** Mapping of Redis events to local methods on the parent object. */
-    QMap<QString, QMetaMethod> _subscribedEvents;
+    QMultiMap<QString, QMetaMethod> _subscribedEvents;
+
+    /** Published events, indexed by the method index of the parent signal that triggers them. */
+    QVector<QVector<PublishedEvent> > _publishedEvents;
+
+    /** Relay capturing the arguments of published signals that have any. */
+    SignalRelay* _signalRelay;
 
-    /** Mapping of parent signals to Redis event names. */
-    QMap<QString, QString> _publishedEvents;
+    /** Subscribed Redis streams, by key. */
+    QHash<QString, StreamSubscription> _subscribedStreams;
+
+    /** Consumers reading the subscribed streams, by consumer group (empty for plain reads). */
+    QHash<QString, StreamConsumer*> _streamConsumers;
 
     /** Mapping of Redis properties to local Q_PROPERTYs on the parent object. */
-    QMap<QString, QMetaProperty> _subscribedProperties;
+    QMultiMap<QString, QMetaProperty> _subscribedProperties;
+
+    /** Mapping of subscribed Redis channels/patterns to their local targets, built from _subscribedEvents and _subscribedProperties. */
+    QHash<QString, SubscriptionTargets> _dispatchTable;
+
+    /** Published properties, in order of registration. */
+    QVector<PublishedProperty> _publishedProperties;
+
+    /** Indices into _publishedProperties of the properties published by each parent NOTIFY signal, indexed by the signal's method index. */
+    QVector<QVector<int> > _publishedPropertiesBySignal;
+
+    /** Published objects, in order of registration. */
+    QVector<PublishedObject> _publishedObjects;
+
+    /** Indices into _publishedObjects (and into their properties) of the fields published by each parent NOTIFY signal, indexed by the
+     *  signal's method index. */
+    QVector<QVector<QPair<int, int> > > _publishedObjectFieldsBySignal;
+
+    /** Subscribed Redis hashes, by key. */
+    QHash<QString, ObjectFields> _subscribedObjects;
+
+    /** Client-side cache of GET results (mutable, since lookups from the const get() overloads update its recency and counters). */
+    mutable ReadCache _cache;
+
+    /** Incremented on every cache invalidation, so that GET results which may have been overtaken by a change are not cached. */
+    quint64 _cacheEpoch;
+
+    /** Whether the "*_changed" pattern is subscribed on behalf of the read cache. */
+    bool _cacheSubscribed;
+
+    /** Measures the resynchronisation in progress, and records the duration of the last one. */
+    QElapsedTimer _resyncTimer;
+    int _lastResyncDuration;
+
+    /** ID carried by the origin header of the change notifications published by this interface, identifying it as their origin. */
+    QByteArray _originId;
+
+    /** Last known remote (encoded) value of each published key that has been successfully written or received, so that unchanged
+     *  values are not written again. */
+    QHash<QByteArray, QByteArray> _lastRemoteValues;
+
+    /** Whether change notifications come from the server's keyspace notifications, and the prefix of their channels. */
+    bool _keyspaceNotifications;
+    QString _keyspacePrefix;
+
+    /** Whether keyspace change notifications may enable missing keyspace notification classes on the server with CONFIG SET. */
+    bool _configureServer;
+
+    /** Subscribed property keys and object keys reported changed by keyspace notifications, waiting to be re-read. */
+    QSet<QString> _keyspaceChangedKeys;
+    QSet<QString> _keyspaceChangedObjects;
+
+    /** Timer re-reading the changed keys once per event loop turn. */
+    QTimer* _keyspaceTimer;
+
+    /** Scripts registered with registerScript(). */
+    ScriptRegistry* _scripts;
+
+    /** Compressor for large payloads, and the size from which payloads are compressed when their binding gives no threshold. */
+    PayloadCompressor _compressor;
+    int _compressionThreshold;
 
-    /** Mapping of parent property names to Redis properties. */
-    QMap<QString, QString> _publishedProperties;
+    /** Scheduler sending this interface's requests in priority lanes. */
+    RequestScheduler* _scheduler;
 };
 
 #endif // REDISINTERFACE_H
@@ -0,0 +1,153 @@
+#include "RedisListModel.h"
+#include <QUuid>
+#include <iostream>
+
+/*!
+    \class RedisListModel
+    \inmodule RedisInterface
+    \brief A list model showing a Redis list, fetching only the rows being shown.
+
+    Rows are fetched a page at a time with \c{LRANGE}, as described for RedisCollectionModel. Each row's element is exposed as the
+    \c{value} role, decoded with the value codec. Elements written through append(), prepend(), set(), remove() and clear() appear in
+    every model showing the list, as the corresponding row changes.
+
+    Example:
+    \code
+    ListView {
+        model: RedisListModel {
+            id: messages
+            serverUrl: "redis://localhost:6379"
+            key: "chat:messages"
+        }
+        delegate: Text { text: value === undefined ? "..." : value }
+    }
+
+    Button { onClicked: messages.append(input.text) }
+    \endcode
+
+    \sa RedisSortedSetModel
+*/
+
+/*!
+ * \brief Constructor.
+ */
+RedisListModel::RedisListModel(QObject *parent) :
+    RedisCollectionModel(parent)
+{
+}
+
+/*!
+ * \brief Lua scripts changing the list \c{KEYS[1]}, and announcing the change on \c{ARGV[1]}. The remove script overwrites the element
+ * with a unique placeholder (\c{ARGV[3]}) so that \c{LREM} removes exactly that one.
+ */
+const char* RedisListModel::AppendScript =
+        "local length = redis.call('RPUSH', KEYS[1], ARGV[2]) "
+        "redis.call('PUBLISH', ARGV[1], 'insert ' .. (length - 1) .. ' 1 ' .. length) "
+        "return length";
+
+const char* RedisListModel::PrependScript =
+        "local length = redis.call('LPUSH', KEYS[1], ARGV[2]) "
+        "redis.call('PUBLISH', ARGV[1], 'insert 0 1 ' .. length) "
+        "return length";
+
+const char* RedisListModel::SetScript =
+        "redis.call('LSET', KEYS[1], ARGV[2], ARGV[3]) "
+        "redis.call('PUBLISH', ARGV[1], 'update ' .. ARGV[2] .. ' 1 ' .. redis.call('LLEN', KEYS[1])) "
+        "return 1";
+
+const char* RedisListModel::RemoveScript =
+        "if not redis.call('LINDEX', KEYS[1], ARGV[2]) then return 0 end "
+        "redis.call('LSET', KEYS[1], ARGV[2], ARGV[3]) "
+        "redis.call('LREM', KEYS[1], 1, ARGV[3]) "
+        "redis.call('PUBLISH', ARGV[1], 'remove ' .. ARGV[2] .. ' 1 ' .. redis.call('LLEN', KEYS[1])) "
+        "return 1";
+
+/*!
+ * \brief Adds \a{value} to the end of the list.
+ */
+void RedisListModel::append(const QVariant &value)
+{
+    if(!checkWritable("append"))
+        return;
+
+    runScript(AppendScript, QList<QByteArray>() << encode(value));
+}
+
+/*!
+ * \brief Adds \a{value} to the start of the list.
+ */
+void RedisListModel::prepend(const QVariant &value)
+{
+    if(!checkWritable("prepend"))
+        return;
+
+    runScript(PrependScript, QList<QByteArray>() << encode(value));
+}
+
+/*!
+ * \brief Replaces the element at \a{index} with \a{value}.
+ */
+void RedisListModel::set(int index, const QVariant &value)
+{
+    if(!checkWritable("set"))
+        return;
+
+    if(index < 0)
+    {
+        std::cerr << "[RedisListModel] set(): Invalid index " << index << std::endl;
+        return;
+    }
+
+    runScript(SetScript, QList<QByteArray>() << QByteArray::number(index) << encode(value));
+}
+
+/*!
+ * \brief Removes the element at \a{index}. Does nothing if there is none.
+ */
+void RedisListModel::remove(int index)
+{
+    if(!checkWritable("remove"))
+        return;
+
+    if(index < 0)
+    {
+        std::cerr << "[RedisListModel] remove(): Invalid index " << index << std::endl;
+        return;
+    }
+
+    runScript(RemoveScript, QList<QByteArray>() << QByteArray::number(index) << QUuid::createUuid().toRfc4122());
+}
+
+/*!
+ * \brief Returns \c{LLEN}.
+ */
+QByteArray RedisListModel::lengthCommand() const
+{
+    return "LLEN";
+}
+
+/*!
+ * \brief Returns the \c{LRANGE} of \a{key} from \a{first} to \a{last}.
+ */
+QList<QByteArray> RedisListModel::rangeCommand(const QByteArray &key, int first, int last) const
+{
+    return QList<QByteArray>() << "LRANGE" << key << QByteArray::number(first) << QByteArray::number(last);
+}
+
+/*!
+ * \brief Decodes the elements returned by \c{LRANGE}.
+ */
+QList<RedisCollectionModel::Item> RedisListModel::parseRange(const QVariant &reply) const
+{
+    QList<Item> rows;
+
+    foreach(const QVariant& element, reply.toList())
+    {
+        Item item;
+        item.value = decode(element);
+        item.score = 0.0;
+        rows.append(item);
+    }
+
+    return rows;
+}
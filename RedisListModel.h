@@ -0,0 +1,40 @@
+#ifndef REDISLISTMODEL_H
+#define REDISLISTMODEL_H
+
+#include "RedisCollectionModel.h"
+
+class RedisListModel : public RedisCollectionModel
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. */
+    explicit RedisListModel(QObject* parent = 0);
+
+    /** Adds the given value to the end/start of the list. */
+    Q_INVOKABLE void append(const QVariant& value);
+    Q_INVOKABLE void prepend(const QVariant& value);
+
+    /** Replaces the element at the given index with the given value. */
+    Q_INVOKABLE void set(int index, const QVariant& value);
+
+    /** Removes the element at the given index. */
+    Q_INVOKABLE void remove(int index);
+
+protected:
+
+    QByteArray lengthCommand() const;
+    QList<QByteArray> rangeCommand(const QByteArray& key, int first, int last) const;
+    QList<Item> parseRange(const QVariant& reply) const;
+
+private:
+
+    /** Lua scripts making (and announcing) each kind of change. */
+    static const char* AppendScript;
+    static const char* PrependScript;
+    static const char* SetScript;
+    static const char* RemoveScript;
+};
+
+#endif // REDISLISTMODEL_H
@@ -0,0 +1,10 @@
+#include "RedisLogging.h"
+
+/*
+    Debug messages are disabled by default, so that they cost no more than a flag check on the hot path (qCDebug() doesn't evaluate its
+    arguments unless the category is enabled). They can be enabled with QT_LOGGING_RULES, eg. "redis.*.debug=true", or with
+    QLoggingCategory::setFilterRules(). Warnings remain enabled.
+*/
+
+Q_LOGGING_CATEGORY(lcRedisInterface, "redis.interface", QtWarningMsg)
+Q_LOGGING_CATEGORY(lcRedisTransport, "redis.transport", QtWarningMsg)
@@ -0,0 +1,12 @@
+#ifndef REDISLOGGING_H
+#define REDISLOGGING_H
+
+#include <QLoggingCategory>
+
+/** Logging category for bindings, requests and resynchronisation in RedisInterface ("redis.interface"). */
+Q_DECLARE_LOGGING_CATEGORY(lcRedisInterface)
+
+/** Logging category for connection handling in the transports ("redis.transport"). */
+Q_DECLARE_LOGGING_CATEGORY(lcRedisTransport)
+
+#endif // REDISLOGGING_H
@@ -0,0 +1,189 @@
+#include "RedisMetrics.h"
+
+/*!
+    \class RedisMetrics
+    \inmodule RedisInterface
+    \brief Low-overhead runtime counters for a RedisTransport.
+
+    Every transport keeps a RedisMetrics instance, recording the requests it sends (and the commands they hold, by command name), the
+    round-trip time of every reply, the messages it receives (by channel) and the bytes it writes to and reads from the network.
+    Recording a sample costs a hash increment or a couple of integer operations: round-trip times are kept in a histogram of power-of-two
+    buckets rather than as individual samples, so percentiles are approximate (to within a factor of two) but memory use is constant.
+
+    The byte counters may be recorded from an I/O thread (see ThreadedTransport) and read from any thread; the other counters belong to
+    the transport's thread.
+
+    \sa RedisTransport, RedisInterface::metrics()
+*/
+
+/*!
+ * \brief Constructor.
+ */
+RedisMetrics::RedisMetrics() :
+    _requestsSent(0),
+    _commandsSent(0),
+    _repliesReceived(0),
+    _maxLatencyUsecs(0),
+    _messagesReceived(0),
+    _otherMessages(0),
+    _bytesOut(0),
+    _bytesIn(0)
+{
+    for(int i = 0; i < LatencyBuckets; ++i)
+        _latencyHistogram[i] = 0;
+}
+
+/*!
+ * \brief Records a request being sent. \a{commands} holds a single command, or every command of a transaction; each is counted under its
+ * (upper-cased) name, eg. \c{"GET"}.
+ */
+void RedisMetrics::recordRequest(const QList<QList<QByteArray> > &commands)
+{
+    foreach(const QList<QByteArray>& command, commands)
+    {
+        if(!command.isEmpty())
+            _commands[command.first().toUpper()]++;
+    }
+
+    _commandsSent += commands.size();
+    _requestsSent++;
+}
+
+/*!
+ * \brief Records a reply received \a{latencyUsecs} microseconds after its command was issued.
+ */
+void RedisMetrics::recordReply(qint64 latencyUsecs)
+{
+    int bucket = 0;
+    while(bucket < LatencyBuckets - 1 && (latencyUsecs >> (bucket + 1)) > 0)
+        bucket++;
+
+    _latencyHistogram[bucket]++;
+    _maxLatencyUsecs = qMax(_maxLatencyUsecs, latencyUsecs);
+    _repliesReceived++;
+}
+
+/*!
+ * \brief Records a message received on \a{channel}. Once \c{MaxCountedChannels} channels are being counted, messages on new channels
+ * are only counted in total, so that subscribing to a busy pattern can't grow the counters without bound.
+ */
+void RedisMetrics::recordMessage(const QString &channel)
+{
+    _messagesReceived++;
+
+    QHash<QString, qint64>::iterator count = _messages.find(channel);
+
+    if(count != _messages.end())
+        ++count.value();
+    else if(_messages.size() < MaxCountedChannels)
+        _messages.insert(channel, 1);
+    else
+        _otherMessages++;
+}
+
+/*!
+ * \brief Records \a{bytes} written to the network.
+ */
+void RedisMetrics::recordBytesOut(qint64 bytes)
+{
+    _bytesOut.fetchAndAddRelaxed(bytes);
+}
+
+/*!
+ * \brief Records \a{bytes} read from the network.
+ */
+void RedisMetrics::recordBytesIn(qint64 bytes)
+{
+    _bytesIn.fetchAndAddRelaxed(bytes);
+}
+
+/*!
+ * \brief Returns the number of bytes written to the network.
+ */
+qint64 RedisMetrics::bytesOut() const
+{
+    return _bytesOut.load();
+}
+
+/*!
+ * \brief Returns the number of bytes read from the network.
+ */
+qint64 RedisMetrics::bytesIn() const
+{
+    return _bytesIn.load();
+}
+
+/*!
+ * \brief Returns the number of requests sent whose replies have not yet been received.
+ */
+qint64 RedisMetrics::pendingRequests() const
+{
+    return _requestsSent - _repliesReceived;
+}
+
+/*!
+ * \brief Returns the round-trip time, in milliseconds, within which \a{fraction} (eg. 0.99) of all replies were received. The result is
+ * the upper bound of the histogram bucket holding that percentile, capped at the largest round trip seen.
+ */
+double RedisMetrics::latencyPercentile(double fraction) const
+{
+    if(_repliesReceived == 0)
+        return 0.0;
+
+    qint64 target = qint64(fraction * _repliesReceived + 0.5);
+    qint64 cumulative = 0;
+
+    for(int i = 0; i < LatencyBuckets; ++i)
+    {
+        cumulative += _latencyHistogram[i];
+
+        if(cumulative >= target && cumulative > 0)
+            return qMin(qint64(2) << i, _maxLatencyUsecs) / 1000.0;
+    }
+
+    return _maxLatencyUsecs / 1000.0;
+}
+
+/*!
+ * \brief Returns every counter as a map:
+ *
+ * \list
+ * \li \c{commandsSent}, and \c{commands}: a map from command name to the number sent.
+ * \li \c{messagesReceived}, and \c{messages}: a map from channel to the number of messages received on it (plus \c{"(other)"} for
+ *     channels beyond \c{MaxCountedChannels}).
+ * \li \c{pendingRequests}: requests (single commands or transactions) awaiting replies.
+ * \li \c{latency}: a map of round-trip times in milliseconds: \c{p50}, \c{p90}, \c{p99} and \c{max}.
+ * \li \c{bytesOut} and \c{bytesIn}: bytes written to and read from the network.
+ * \endlist
+ */
+QVariantMap RedisMetrics::statistics() const
+{
+    QVariantMap commands;
+    for(QHash<QByteArray, qint64>::const_iterator iter = _commands.constBegin(); iter != _commands.constEnd(); ++iter)
+        commands.insert(QString::fromUtf8(iter.key()), iter.value());
+
+    QVariantMap messages;
+    for(QHash<QString, qint64>::const_iterator iter = _messages.constBegin(); iter != _messages.constEnd(); ++iter)
+        messages.insert(iter.key(), iter.value());
+
+    if(_otherMessages > 0)
+        messages.insert("(other)", _otherMessages);
+
+    QVariantMap latency;
+    latency.insert("p50", latencyPercentile(0.5));
+    latency.insert("p90", latencyPercentile(0.9));
+    latency.insert("p99", latencyPercentile(0.99));
+    latency.insert("max", _maxLatencyUsecs / 1000.0);
+
+    QVariantMap statistics;
+    statistics.insert("commandsSent", _commandsSent);
+    statistics.insert("commands", commands);
+    statistics.insert("messagesReceived", _messagesReceived);
+    statistics.insert("messages", messages);
+    statistics.insert("pendingRequests", pendingRequests());
+    statistics.insert("latency", latency);
+    statistics.insert("bytesOut", bytesOut());
+    statistics.insert("bytesIn", bytesIn());
+
+    return statistics;
+}
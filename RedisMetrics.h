@@ -0,0 +1,72 @@
+#ifndef REDISMETRICS_H
+#define REDISMETRICS_H
+
+#include <QHash>
+#include <QList>
+#include <QByteArray>
+#include <QString>
+#include <QVariantMap>
+#include <QAtomicInteger>
+
+class RedisMetrics
+{
+public:
+
+    /** Constructor. */
+    RedisMetrics();
+
+    /** Records a request sent: a single command, or the commands of a transaction (counted by command name). */
+    void recordRequest(const QList<QList<QByteArray> >& commands);
+
+    /** Records a reply received after the given round-trip time (in microseconds). */
+    void recordReply(qint64 latencyUsecs);
+
+    /** Records a message received on the given channel. */
+    void recordMessage(const QString& channel);
+
+    /** Records bytes written to / read from the network. Thread-safe. */
+    void recordBytesOut(qint64 bytes);
+    void recordBytesIn(qint64 bytes);
+
+    /** Returns the bytes written to / read from the network so far. Thread-safe. */
+    qint64 bytesOut() const;
+    qint64 bytesIn() const;
+
+    /** Returns the number of requests sent whose replies have not yet been received. */
+    qint64 pendingRequests() const;
+
+    /** Returns the round-trip time (in milliseconds) below which the given fraction of replies were received. */
+    double latencyPercentile(double fraction) const;
+
+    /** Returns every counter as a map (see statistics() docs). */
+    QVariantMap statistics() const;
+
+private:
+
+    /** Number of latency histogram buckets. Bucket i counts round trips of less than 2^(i+1) microseconds. */
+    static const int LatencyBuckets = 32;
+
+    /** Maximum number of channels counted individually. Messages on any further channels are counted together. */
+    static const int MaxCountedChannels = 1024;
+
+    /** Requests sent, and the commands they held by name. */
+    qint64 _requestsSent;
+    QHash<QByteArray, qint64> _commands;
+    qint64 _commandsSent;
+
+    /** Replies received, and a histogram of their round-trip times. */
+    qint64 _repliesReceived;
+    qint64 _latencyHistogram[LatencyBuckets];
+    qint64 _maxLatencyUsecs;
+
+    /** Messages received, by channel. */
+    QHash<QString, qint64> _messages;
+    qint64 _messagesReceived;
+    qint64 _otherMessages;
+
+    /** Bytes written to / read from the network (atomic, since they may be recorded on an I/O thread). */
+    QAtomicInteger<qint64> _bytesOut;
+    QAtomicInteger<qint64> _bytesIn;
+};
+
+#endif // REDISMETRICS_H
@@ -0,0 +1,431 @@
+#include "RedisPromise.h"
+#include <QQmlEngine>
+
+/*!
+    \class RedisPromise
+    \inmodule RedisInterface
+    \brief The eventual result of an asynchronous Redis request.
+
+    RedisInterface returns a RedisPromise from each of its asynchronous methods (eg. \l{RedisInterface::getAsync()}). The promise is
+    pending until the server responds, and is then either fulfilled with the decoded reply value or rejected with an error string.
+
+    The outcome can be consumed in several ways:
+
+    \list
+    \li Through the \c{fulfilled()}, \c{rejected()} and \c{settled()} signals.
+    \li Through future(), a \l{QFuture} that can be watched with a \l{QFutureWatcher}; its \c{result()} throws RedisPromise::Error if the
+        promise was rejected. The future remains valid after the promise itself has been deleted.
+    \li By chaining continuations with then(). In C++, a continuation is a slot taking the value as a \l{QVariant}; in QML, it is a
+        JavaScript function, with the same semantics as JavaScript promises:
+    \endlist
+
+    \code
+    redis.getAsync("user:current").then(function(user) {
+        return redis.getAsync("user:" + user + ":name");
+    }).then(function(name) {
+        console.log("Current user is " + name);
+    }, function(error) {
+        console.log("Lookup failed: " + error);
+    });
+    \endcode
+
+    Continuations attached to a promise that has already settled are run straight away. Rejections pass down a chain until they reach a
+    continuation with a rejection handler.
+
+    By default, a promise deletes itself once it has settled and run its continuations, so C++ callers must attach their continuations (or
+    take its future()) before returning to the event loop, or call setAutoDelete(false) and delete it themselves. Promises handed to QML
+    are owned by the JavaScript engine instead (see setJavaScriptOwnership()).
+
+    \sa RedisInterface, RedisReply
+*/
+
+/*!
+ * \brief Constructor.
+ */
+RedisPromise::RedisPromise(QObject *parent) :
+    QObject(parent),
+    _state(Pending),
+    _autoDelete(true)
+{
+    _futureInterface.reportStarted();
+}
+
+/*!
+ * \brief Destructor. If the promise is still pending, its future is cancelled so that nothing waits on it forever.
+ */
+RedisPromise::~RedisPromise()
+{
+    if(_state == Pending)
+    {
+        _futureInterface.reportCanceled();
+        _futureInterface.reportFinished();
+    }
+}
+
+/*!
+ * \brief Returns true until the promise has been fulfilled or rejected.
+ */
+bool RedisPromise::isPending() const
+{
+    return _state == Pending;
+}
+
+/*!
+ * \brief Returns true if the promise was rejected.
+ */
+bool RedisPromise::isRejected() const
+{
+    return _state == Rejected;
+}
+
+/*!
+ * \brief Returns the value the promise was fulfilled with (invalid until then).
+ */
+QVariant RedisPromise::value() const
+{
+    return _value;
+}
+
+/*!
+ * \brief Returns the error the promise was rejected with (empty unless rejected).
+ */
+QString RedisPromise::errorString() const
+{
+    return _errorString;
+}
+
+/*!
+ * \brief Returns a \l{QFuture} that finishes when the promise settles. Its result is the fulfilled value; if the promise was rejected,
+ * \c{result()} throws RedisPromise::Error. Note that waiting on the future blocks, and that the reply can only arrive while the event
+ * loop of the RedisInterface's thread is running, so a QFutureWatcher should be used rather than \c{waitForFinished()}.
+ */
+QFuture<QVariant> RedisPromise::future() const
+{
+    return const_cast<QFutureInterface<QVariant>&>(_futureInterface).future();
+}
+
+/*!
+ * \brief Returns true if the promise deletes itself once it has settled.
+ */
+bool RedisPromise::autoDelete() const
+{
+    return _autoDelete;
+}
+
+/*!
+ * \brief Sets whether the promise deletes itself once it has settled and run its continuations.
+ */
+void RedisPromise::setAutoDelete(bool autoDelete)
+{
+    _autoDelete = autoDelete;
+}
+
+/*!
+ * \brief Hands ownership of the promise to the JavaScript \a{engine}. The engine holds a reference to the promise until it settles (so
+ * that a chain of continuations survives even if the script keeps no reference to it), after which it is garbage-collected like any other
+ * JavaScript object. Promises chained from it with then() are owned by the same engine.
+ */
+void RedisPromise::setJavaScriptOwnership(QJSEngine *engine)
+{
+    _autoDelete = false;
+    _engine = engine;
+
+    setParent(0);
+    QQmlEngine::setObjectOwnership(this, QQmlEngine::JavaScriptOwnership);
+
+    if(_state == Pending && engine)
+        _self = engine->newQObject(this);
+}
+
+/*!
+ * \brief Settles the promise with the outcome of \a{reply} once it finishes. The promise takes ownership of the reply. If the reply is
+ * destroyed before it finishes (eg. because the connection was torn down), the promise is rejected.
+ */
+void RedisPromise::follow(RedisReply *reply)
+{
+    connect(reply, SIGNAL(finished()), this, SLOT(handleReplyFinished()));
+    connect(reply, SIGNAL(destroyed()), this, SLOT(handleReplyDestroyed()));
+}
+
+/*!
+ * \brief Settles the promise with the outcome of \a{other} once it settles.
+ */
+void RedisPromise::adopt(RedisPromise *other)
+{
+    if(other == this)
+    {
+        reject("A promise cannot adopt itself!");
+        return;
+    }
+
+    if(other->isPending())
+        connect(other, SIGNAL(settled()), this, SLOT(handleAdoptedPromiseSettled()));
+    else if(other->isRejected())
+        reject(other->errorString());
+    else
+        resolve(other->value());
+}
+
+/*!
+ * \brief Calls the slot \a{method} (given with the \c{SLOT()} macro) on \a{receiver} with the value once the promise is fulfilled. The
+ * slot may take the value as a single \l{QVariant} argument, or no arguments. Returns a promise that settles with the slot's return value
+ * if it returns a \l{QVariant} (or adopts it, if it returns a \c{RedisPromise*}), and with the same value otherwise. If this promise is
+ * rejected, the slot is skipped and the returned promise is rejected with the same error.
+ */
+RedisPromise* RedisPromise::then(QObject *receiver, const char *method)
+{
+    QMetaMethod metaMethod;
+
+    // Skip the code character prepended by the SLOT() macro.
+    if(receiver && method && method[0] != '\0')
+    {
+        QByteArray signature = QMetaObject::normalizedSignature(method + 1);
+        metaMethod = receiver->metaObject()->method(receiver->metaObject()->indexOfMethod(signature.constData()));
+    }
+
+    return then(receiver, metaMethod);
+}
+
+/*!
+ * \overload
+ * \brief Calls \a{method} on \a{receiver} with the value once the promise is fulfilled.
+ */
+RedisPromise* RedisPromise::then(QObject *receiver, const QMetaMethod &method)
+{
+    Continuation continuation;
+    continuation.receiver = receiver;
+    continuation.method = method;
+    continuation.next = createNext();
+
+    if(!method.isValid() || method.parameterCount() > 1 || (method.parameterCount() == 1 && method.parameterType(0) != QMetaType::QVariant))
+        std::cerr << "[RedisPromise] then(): Method " << method.methodSignature().constData() << " is invalid, or does not take a single QVariant!" << std::endl;
+
+    if(_state == Pending)
+        _continuations.append(continuation);
+    else
+        runContinuation(continuation);
+
+    return continuation.next;
+}
+
+/*!
+ * \brief Calls the JavaScript function \a{onFulfilled} with the value once the promise is fulfilled, or \a{onRejected} with the error
+ * string if it is rejected. Returns a promise that settles with the callback's return value (adopting it if it is itself a promise), or is
+ * rejected if the callback throws. If no callback is given for the outcome, it is passed straight on to the returned promise.
+ */
+RedisPromise* RedisPromise::then(QJSValue onFulfilled, QJSValue onRejected)
+{
+    Continuation continuation;
+    continuation.onFulfilled = onFulfilled;
+    continuation.onRejected = onRejected;
+    continuation.next = createNext();
+
+    if(_state == Pending)
+        _continuations.append(continuation);
+    else
+        runContinuation(continuation);
+
+    return continuation.next;
+}
+
+/*!
+ * \brief Fulfils the promise with \a{value}, notifying listeners and running any continuations. Has no effect if the promise has already
+ * settled.
+ */
+void RedisPromise::resolve(const QVariant &value)
+{
+    if(_state != Pending)
+        return;
+
+    _value = value;
+    settle(Fulfilled);
+}
+
+/*!
+ * \brief Rejects the promise with \a{errorString}, notifying listeners and running any continuations. Has no effect if the promise has
+ * already settled.
+ */
+void RedisPromise::reject(const QString &errorString)
+{
+    if(_state != Pending)
+        return;
+
+    _errorString = errorString;
+    settle(Rejected);
+}
+
+/*!
+ * \brief Handles the followed reply finishing, settling the promise with its outcome and releasing the reply.
+ */
+void RedisPromise::handleReplyFinished()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    disconnect(reply, SIGNAL(destroyed()), this, SLOT(handleReplyDestroyed()));
+    reply->deleteLater();
+
+    if(reply->isError())
+        reject(reply->errorString());
+    else
+        resolve(reply->value());
+}
+
+/*!
+ * \brief Handles the followed reply being destroyed before it finished.
+ */
+void RedisPromise::handleReplyDestroyed()
+{
+    reject("Request was abandoned before a reply was received!");
+}
+
+/*!
+ * \brief Handles an adopted promise settling.
+ */
+void RedisPromise::handleAdoptedPromiseSettled()
+{
+    RedisPromise* other = qobject_cast<RedisPromise*>(sender());
+    if(other == NULL)
+        return;
+
+    if(other->isRejected())
+        reject(other->errorString());
+    else
+        resolve(other->value());
+}
+
+/*!
+ * \brief Creates the promise returned by then(). It is kept alive by the same parent (or JavaScript engine) as this promise, and
+ * deletes itself under the same conditions.
+ */
+RedisPromise* RedisPromise::createNext()
+{
+    RedisPromise* next = new RedisPromise(parent());
+    next->setAutoDelete(_autoDelete);
+
+    if(_engine)
+        next->setJavaScriptOwnership(_engine);
+
+    return next;
+}
+
+/*!
+ * \brief Records the final \a{state}, reports it to the future, emits the notification signals and runs the attached continuations.
+ * The promise is then deleted (if autoDelete() is set) or released to its JavaScript engine.
+ */
+void RedisPromise::settle(State state)
+{
+    _state = state;
+
+    if(state == Fulfilled)
+        _futureInterface.reportResult(_value);
+    else
+        _futureInterface.reportException(Error(_errorString));
+
+    _futureInterface.reportFinished();
+
+    if(state == Fulfilled)
+        emit fulfilled(_value);
+    else
+        emit rejected(_errorString);
+
+    emit settled();
+
+    QList<Continuation> continuations = _continuations;
+    _continuations.clear();
+
+    foreach(const Continuation& continuation, continuations)
+        runContinuation(continuation);
+
+    _self = QJSValue();
+
+    if(_autoDelete)
+        deleteLater();
+}
+
+/*!
+ * \brief Runs \a{continuation} against the settled outcome, settling its chained promise with the result.
+ */
+void RedisPromise::runContinuation(const Continuation &continuation)
+{
+    RedisPromise* next = continuation.next;
+
+    if(_state == Rejected)
+    {
+        if(continuation.onRejected.isCallable())
+            settleWithScriptResult(next, continuation.onRejected.call(QJSValueList() << QJSValue(_errorString)));
+        else if(next)
+            next->reject(_errorString);
+    }
+    else if(continuation.onFulfilled.isCallable())
+    {
+        QJSEngine* engine = continuation.onFulfilled.engine();
+        QJSValue value = engine ? engine->toScriptValue(_value) : QJSValue(_value.toString());
+
+        settleWithScriptResult(next, continuation.onFulfilled.call(QJSValueList() << value));
+    }
+    else if(continuation.method.isValid())
+    {
+        if(!continuation.receiver)
+        {
+            if(next)
+                next->reject("Continuation receiver was destroyed before the promise settled!");
+
+            return;
+        }
+
+        QGenericArgument argument = continuation.method.parameterCount() == 1 ? Q_ARG(QVariant, _value) : QGenericArgument();
+        int promiseType = qMetaTypeId<RedisPromise*>();
+
+        if(continuation.method.returnType() == QMetaType::QVariant)
+        {
+            QVariant result;
+            continuation.method.invoke(continuation.receiver, Qt::DirectConnection, Q_RETURN_ARG(QVariant, result), argument);
+
+            if(next)
+                next->resolve(result);
+        }
+        else if(continuation.method.returnType() == promiseType)
+        {
+            RedisPromise* result = NULL;
+            continuation.method.invoke(continuation.receiver, Qt::DirectConnection, Q_RETURN_ARG(RedisPromise*, result), argument);
+
+            if(next && result)
+                next->adopt(result);
+            else if(next)
+                next->resolve(QVariant());
+        }
+        else
+        {
+            continuation.method.invoke(continuation.receiver, Qt::DirectConnection, argument);
+
+            if(next)
+                next->resolve(_value);
+        }
+    }
+    else if(next)
+    {
+        // Nothing to call for this outcome, so pass the value straight through.
+        next->resolve(_value);
+    }
+}
+
+/*!
+ * \brief Settles \a{next} with the \a{result} of a JavaScript continuation: rejected if the callback threw, adopted if it returned a
+ * promise, and fulfilled with the returned value otherwise.
+ */
+void RedisPromise::settleWithScriptResult(RedisPromise *next, const QJSValue &result)
+{
+    if(next == NULL)
+        return;
+
+    RedisPromise* promise = qobject_cast<RedisPromise*>(result.toQObject());
+
+    if(result.isError())
+        next->reject(result.toString());
+    else if(promise)
+        next->adopt(promise);
+    else
+        next->resolve(result.toVariant());
+}
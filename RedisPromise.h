@@ -0,0 +1,155 @@
+#ifndef REDISPROMISE_H
+#define REDISPROMISE_H
+
+#include <QObject>
+#include <QVariant>
+#include <QString>
+#include <QList>
+#include <QPointer>
+#include <QMetaMethod>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QException>
+#include <QJSValue>
+#include <QJSEngine>
+#include <iostream>
+#include "RedisReply.h"
+
+class RedisPromise : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool     pending     READ isPending   NOTIFY settled)
+    Q_PROPERTY(QVariant value       READ value       NOTIFY settled)
+    Q_PROPERTY(QString  errorString READ errorString NOTIFY settled)
+
+public:
+
+    /** Exception carried by the future of a rejected promise. */
+    class Error : public QException
+    {
+    public:
+        explicit Error(const QString& errorString) : QException(), _errorString(errorString), _what(errorString.toUtf8()) {}
+
+        void raise() const { throw *this; }
+        Error* clone() const { return new Error(*this); }
+        const char* what() const throw() { return _what.constData(); }
+        QString errorString() const { return _errorString; }
+
+    private:
+        QString _errorString;
+        QByteArray _what;
+    };
+
+    /** Constructor. Promises are normally created by RedisInterface, already following a request. */
+    explicit RedisPromise(QObject* parent = 0);
+
+    /** Destructor. A promise destroyed while pending cancels its future. */
+    ~RedisPromise();
+
+    bool isPending() const;
+    bool isRejected() const;
+    QVariant value() const;
+    QString errorString() const;
+
+    /** Returns a QFuture that finishes when the promise settles (result() throws RedisPromise::Error if it was rejected). */
+    QFuture<QVariant> future() const;
+
+    /** Whether the promise deletes itself once it has settled and run its continuations (the default). */
+    bool autoDelete() const;
+    void setAutoDelete(bool autoDelete);
+
+    /** Hands the promise over to the given JavaScript engine, which keeps it alive while pending and garbage-collects it afterwards. */
+    void setJavaScriptOwnership(QJSEngine* engine);
+
+    /** Settles the promise with the outcome of the given reply (which it takes ownership of) once it finishes. */
+    void follow(RedisReply* reply);
+
+    /** Settles the promise with the outcome of another promise once it settles. */
+    void adopt(RedisPromise* other);
+
+    /** Calls the given slot (taking the value as a QVariant) once fulfilled. The returned promise settles with the slot's return value
+     *  (if it returns a QVariant or RedisPromise*), or the same value otherwise. Rejections skip the slot and pass straight through. */
+    RedisPromise* then(QObject* receiver, const char* method);
+    RedisPromise* then(QObject* receiver, const QMetaMethod& method);
+
+    /** Calls onFulfilled with the value, or onRejected with the error string, once settled. The returned promise settles with the
+     *  callback's return value (adopting it if it is itself a promise), or is rejected if the callback throws. */
+    Q_INVOKABLE RedisPromise* then(QJSValue onFulfilled, QJSValue onRejected = QJSValue());
+
+public slots:
+
+    /** Fulfils the promise with the given value. Has no effect if it has already settled. */
+    void resolve(const QVariant& value);
+
+    /** Rejects the promise with the given error. Has no effect if it has already settled. */
+    void reject(const QString& errorString);
+
+signals:
+
+    /** Emitted when the promise is fulfilled. */
+    void fulfilled(QVariant value);
+
+    /** Emitted when the promise is rejected. */
+    void rejected(QString errorString);
+
+    /** Emitted once the promise has settled either way. */
+    void settled();
+
+private slots:
+
+    /** Private handler slots for the followed reply and adopted promise. */
+    void handleReplyFinished();
+    void handleReplyDestroyed();
+    void handleAdoptedPromiseSettled();
+
+private:
+
+    /** Settlement state. */
+    enum State
+    {
+        Pending,
+        Fulfilled,
+        Rejected
+    };
+
+    /** A callback attached with then(), and the promise settled with its outcome. */
+    struct Continuation
+    {
+        QPointer<QObject> receiver;
+        QMetaMethod method;
+        QJSValue onFulfilled;
+        QJSValue onRejected;
+        QPointer<RedisPromise> next;
+    };
+
+    /** Creates the promise returned by then(), inheriting this promise's parent and ownership. */
+    RedisPromise* createNext();
+
+    /** Records the outcome, notifies listeners and runs the attached continuations. */
+    void settle(State state);
+
+    /** Runs a single continuation against the settled outcome. */
+    void runContinuation(const Continuation& continuation);
+
+    /** Settles a chained promise with the result of a JavaScript callback. */
+    static void settleWithScriptResult(RedisPromise* next, const QJSValue& result);
+
+    State _state;
+    QVariant _value;
+    QString _errorString;
+
+    /** Backing state of the QFuture returned by future(). */
+    QFutureInterface<QVariant> _futureInterface;
+
+    /** Continuations waiting for the promise to settle. */
+    QList<Continuation> _continuations;
+
+    /** Whether to delete the promise once it has settled. */
+    bool _autoDelete;
+
+    /** Engine owning the promise (if handed over to JavaScript), and the reference keeping it alive while pending. */
+    QPointer<QJSEngine> _engine;
+    QJSValue _self;
+};
+
+#endif // REDISPROMISE_H
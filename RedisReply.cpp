@@ -0,0 +1,97 @@
+#include "RedisReply.h"
+
+/*!
+    \class RedisReply
+    \inmodule RedisInterface
+    \brief Represents a pending or completed request made through a RedisTransport.
+
+    A RedisReply plays the same role for Redis commands that \l{QNetworkReply} plays for HTTP requests: it is returned immediately by
+    the transport and emits \c{finished()} once the server has responded.
+
+    The caller owns the reply and is responsible for deleting it (typically by connecting \c{finished()} to \c{deleteLater()}).
+
+    \sa RedisTransport
+*/
+
+/*!
+ * \brief Constructor.
+ */
+RedisReply::RedisReply(QObject *parent) :
+    QObject(parent),
+    _finished(false),
+    _latency(-1)
+{
+    _timer.start();
+}
+
+/*!
+ * \brief Returns the decoded value of the reply. Bulk strings are returned as \l{QString}s, integers as \c{qlonglong}s and
+ * multi-bulk replies as \l{QVariantList}s.
+ */
+QVariant RedisReply::value() const
+{
+    return _value;
+}
+
+/*!
+ * \brief Returns true if an error occurred while processing the request.
+ */
+bool RedisReply::isError() const
+{
+    return !_errorString.isEmpty();
+}
+
+/*!
+ * \brief Returns the error description, or an empty string if no error occurred.
+ */
+QString RedisReply::errorString() const
+{
+    return _errorString;
+}
+
+/*!
+ * \brief Returns true once the reply has completed.
+ */
+bool RedisReply::isFinished() const
+{
+    return _finished;
+}
+
+/*!
+ * \brief Returns the time in microseconds from the reply's creation (when its command was queued) to its completion, or -1 if it has not
+ * yet completed.
+ */
+qint64 RedisReply::latency() const
+{
+    return _latency;
+}
+
+/*!
+ * \brief Sets the decoded reply \a{value}. Called by the transport.
+ */
+void RedisReply::setValue(const QVariant &value)
+{
+    _value = value;
+}
+
+/*!
+ * \brief Marks the reply as failed with the given \a{errorString}. Called by the transport.
+ */
+void RedisReply::setError(const QString &errorString)
+{
+    _errorString = errorString;
+}
+
+/*!
+ * \brief Marks the reply as complete and emits \c{finished()}. Subsequent calls have no effect.
+ */
+void RedisReply::finish()
+{
+    if(_finished)
+        return;
+
+    _finished = true;
+    _latency = _timer.nsecsElapsed() / 1000;
+
+    emit finished();
+}
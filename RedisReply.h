@@ -0,0 +1,65 @@
+#ifndef REDISREPLY_H
+#define REDISREPLY_H
+
+#include <QObject>
+#include <QVariant>
+#include <QString>
+#include <QElapsedTimer>
+
+class RedisReply : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. Replies are created by a RedisTransport and handed back to the caller. */
+    explicit RedisReply(QObject* parent = 0);
+
+    /** Returns the decoded value of the reply (valid once finished() has been emitted). */
+    QVariant value() const;
+
+    /** Returns true if Redis (or the transport) reported an error for this request. */
+    bool isError() const;
+
+    /** Returns a human-readable description of the error, if any. */
+    QString errorString() const;
+
+    /** Returns true once the reply has completed. */
+    bool isFinished() const;
+
+    /** Returns the time in microseconds from the reply's creation to its completion, or -1 if it has not yet completed. */
+    qint64 latency() const;
+
+signals:
+
+    /** Emitted once when the reply has completed (successfully or otherwise). */
+    void finished();
+
+public:
+
+    /** Transport-facing setters. */
+    void setValue(const QVariant& value);
+    void setError(const QString& errorString);
+
+public slots:
+
+    /** Completes the reply, emitting finished() (only once). A slot so that completion can be deferred to the event loop. */
+    void finish();
+
+private:
+
+    /** Decoded reply value. */
+    QVariant _value;
+
+    /** Error description (empty if no error occurred). */
+    QString _errorString;
+
+    /** Whether finished() has already been emitted. */
+    bool _finished;
+
+    /** Timer started when the reply is created, and the time it had measured when the reply completed. */
+    QElapsedTimer _timer;
+    qint64 _latency;
+};
+
+#endif // REDISREPLY_H
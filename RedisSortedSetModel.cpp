@@ -0,0 +1,170 @@
+#include "RedisSortedSetModel.h"
+
+/*!
+    \class RedisSortedSetModel
+    \inmodule RedisInterface
+    \brief A list model showing a Redis sorted set in score order, fetching only the rows being shown.
+
+    Rows are fetched a page at a time with \c{ZRANGE} (or \c{ZREVRANGE}, when \l{descending}), as described for RedisCollectionModel.
+    Each row exposes the member as the \c{value} role, decoded with the value codec, and its score as the \c{score} role. Members written
+    through add(), incrementBy(), remove() and clear() appear in every model showing the set; a member whose rank changes is moved to its
+    new row, so views can animate it.
+
+    Example:
+    \code
+    ListView {
+        model: RedisSortedSetModel {
+            id: leaderboard
+            serverUrl: "redis://localhost:6379"
+            key: "game:scores"
+            descending: true
+        }
+        delegate: Text { text: (index + 1) + ". " + value + ": " + score }
+    }
+
+    Button { onClicked: leaderboard.incrementBy(playerName, 10) }
+    \endcode
+
+    \sa RedisListModel
+*/
+
+/*!
+ * \brief Constructor.
+ */
+RedisSortedSetModel::RedisSortedSetModel(QObject *parent) :
+    RedisCollectionModel(parent),
+    _descending(false)
+{
+}
+
+/*!
+ * \brief Lua scripts changing the sorted set \c{KEYS[1]}, and announcing the change on \c{ARGV[1]} in ascending rank order. The score
+ * script runs \c{ZADD} or \c{ZINCRBY} (\c{ARGV[2]}) with the score (\c{ARGV[3]}) and member (\c{ARGV[4]}), announcing an insertion for a
+ * new member, or a move (possibly to the same rank) for an existing one.
+ */
+const char* RedisSortedSetModel::ScoreScript =
+        "local old = redis.call('ZRANK', KEYS[1], ARGV[4]) "
+        "local result = redis.call(ARGV[2], KEYS[1], ARGV[3], ARGV[4]) "
+        "local new = redis.call('ZRANK', KEYS[1], ARGV[4]) "
+        "local length = redis.call('ZCARD', KEYS[1]) "
+        "if old then "
+        "redis.call('PUBLISH', ARGV[1], 'move ' .. old .. ' ' .. new .. ' ' .. length) "
+        "else "
+        "redis.call('PUBLISH', ARGV[1], 'insert ' .. new .. ' 1 ' .. length) "
+        "end "
+        "return result";
+
+const char* RedisSortedSetModel::RemoveScript =
+        "local old = redis.call('ZRANK', KEYS[1], ARGV[2]) "
+        "if not old then return 0 end "
+        "redis.call('ZREM', KEYS[1], ARGV[2]) "
+        "redis.call('PUBLISH', ARGV[1], 'remove ' .. old .. ' 1 ' .. redis.call('ZCARD', KEYS[1])) "
+        "return 1";
+
+/*!
+ * \brief Returns the role names: \c{value} and \c{score}.
+ */
+QHash<int, QByteArray> RedisSortedSetModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = RedisCollectionModel::roleNames();
+    roles.insert(ScoreRole, "score");
+    return roles;
+}
+
+/*!
+ * \brief Returns true if members are shown from the highest score to the lowest.
+ */
+bool RedisSortedSetModel::descending() const
+{
+    return _descending;
+}
+
+/*!
+ * \brief Sets whether members are shown from the highest score to the lowest to \a{value}, reloading the model.
+ */
+void RedisSortedSetModel::setDescending(bool value)
+{
+    if(_descending == value)
+        return;
+
+    _descending = value;
+    emit descendingChanged(_descending);
+
+    refresh();
+}
+
+/*!
+ * \brief Adds \a{member} with \a{score}, or sets the score of \a{member} if it is already in the set.
+ */
+void RedisSortedSetModel::add(const QVariant &member, double score)
+{
+    if(!checkWritable("add"))
+        return;
+
+    runScript(ScoreScript, QList<QByteArray>() << "ZADD" << QByteArray::number(score, 'g', 17) << encode(member));
+}
+
+/*!
+ * \brief Adds \a{amount} to the score of \a{member}, adding it with a score of \a{amount} if it isn't in the set.
+ */
+void RedisSortedSetModel::incrementBy(const QVariant &member, double amount)
+{
+    if(!checkWritable("incrementBy"))
+        return;
+
+    runScript(ScoreScript, QList<QByteArray>() << "ZINCRBY" << QByteArray::number(amount, 'g', 17) << encode(member));
+}
+
+/*!
+ * \brief Removes \a{member}. Does nothing if it isn't in the set.
+ */
+void RedisSortedSetModel::remove(const QVariant &member)
+{
+    if(!checkWritable("remove"))
+        return;
+
+    runScript(RemoveScript, QList<QByteArray>() << encode(member));
+}
+
+/*!
+ * \brief Returns \c{ZCARD}.
+ */
+QByteArray RedisSortedSetModel::lengthCommand() const
+{
+    return "ZCARD";
+}
+
+/*!
+ * \brief Returns the \c{ZRANGE} (or \c{ZREVRANGE}) of \a{key} from \a{first} to \a{last}, with scores.
+ */
+QList<QByteArray> RedisSortedSetModel::rangeCommand(const QByteArray &key, int first, int last) const
+{
+    return QList<QByteArray>() << QByteArray(_descending ? "ZREVRANGE" : "ZRANGE") << key << QByteArray::number(first) << QByteArray::number(last) << "WITHSCORES";
+}
+
+/*!
+ * \brief Decodes the members and scores returned by \c{ZRANGE ... WITHSCORES}, which alternate.
+ */
+QList<RedisCollectionModel::Item> RedisSortedSetModel::parseRange(const QVariant &reply) const
+{
+    QVariantList elements = reply.toList();
+    QList<Item> rows;
+
+    for(int i = 0; i + 1 < elements.size(); i += 2)
+    {
+        Item item;
+        item.value = decode(elements.at(i));
+        item.score = elements.at(i + 1).toDouble();
+        rows.append(item);
+    }
+
+    return rows;
+}
+
+/*!
+ * \brief Returns the row of the member ranked \a{index} (in ascending order) in a set of \a{length} members.
+ */
+int RedisSortedSetModel::toRow(int index, int length) const
+{
+    return _descending ? length - 1 - index : index;
+}
@@ -0,0 +1,54 @@
+#ifndef REDISSORTEDSETMODEL_H
+#define REDISSORTEDSETMODEL_H
+
+#include "RedisCollectionModel.h"
+
+class RedisSortedSetModel : public RedisCollectionModel
+{
+    Q_OBJECT
+    Q_PROPERTY(bool descending READ descending WRITE setDescending NOTIFY descendingChanged)
+
+public:
+
+    /** Constructor. */
+    explicit RedisSortedSetModel(QObject* parent = 0);
+
+    QHash<int, QByteArray> roleNames() const;
+
+    /** Returns true if members are shown from the highest score to the lowest (eg. for a leaderboard). */
+    bool descending() const;
+
+    /** Adds the given member with the given score, or sets the score of an existing member. */
+    Q_INVOKABLE void add(const QVariant& member, double score);
+
+    /** Adds the given amount to the score of the given member (adding the member, if need be). */
+    Q_INVOKABLE void incrementBy(const QVariant& member, double amount);
+
+    /** Removes the given member. */
+    Q_INVOKABLE void remove(const QVariant& member);
+
+signals:
+
+    void descendingChanged(bool value);
+
+public slots:
+
+    void setDescending(bool value);
+
+protected:
+
+    QByteArray lengthCommand() const;
+    QList<QByteArray> rangeCommand(const QByteArray& key, int first, int last) const;
+    QList<Item> parseRange(const QVariant& reply) const;
+    int toRow(int index, int length) const;
+
+private:
+
+    /** Lua scripts making (and announcing) each kind of change. */
+    static const char* ScoreScript;
+    static const char* RemoveScript;
+
+    bool _descending;
+};
+
+#endif // REDISSORTEDSETMODEL_H
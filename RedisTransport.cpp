@@ -0,0 +1,336 @@
+#include "RedisTransport.h"
+#include "WebdisTransport.h"
+#include "RespTransport.h"
+#include "ThreadedTransport.h"
+
+/*!
+    \class RedisTransport
+    \inmodule RedisInterface
+    \brief Abstract base class for the wire protocol used by RedisInterface to talk to Redis.
+
+    Two transports are provided:
+
+    \list
+    \li WebdisTransport, which sends each command as an HTTP request to a webdis proxy (\c{http://host:7379/}).
+    \li RespTransport, which speaks the native Redis protocol (RESP) to redis-server over persistent TCP connections (\c{redis://host:6379}).
+    \endlist
+
+    The transport is selected by the scheme of the server URL passed to \l{RedisTransport::create()}. Either may be run on a dedicated
+    I/O thread by wrapping it in a ThreadedTransport, so that network I/O and parsing never run on the caller's thread.
+
+    Commands are not written to the network as soon as they are issued. Instead, every command issued within one event loop turn (or
+    within a configurable batch window, see setBatchWindow()) is collected in an outgoing queue and flushed as a single batch, which each
+    transport sends in as few round trips as its protocol allows. Groups of commands may also be queued as a transaction with
+    sendTransaction(), in which case they are executed atomically. The sizes of the batches sent are reported by batchStatistics(), and
+    the requests sent, their round-trip times, the messages received and the bytes transferred by metrics().
+
+    Every transport multiplexes all of its channel and pattern subscriptions onto a single subscriber stream, and reports each incoming
+    message through the \c{messageReceived()} signal. Routing messages to their local targets is left to the RedisInterface.
+
+    Transports supervise their connections: a lost connection is re-established with jittered exponential backoff (see
+    nextReconnectDelay()), and every subscription is replayed in a single batch once it is. The \c{resubscribed()} signal then tells the
+    RedisInterface that messages may have been missed, so that it can resynchronise its state. The progress of the connection is
+    reported by connectionState().
+
+    Transports that support server-assisted client-side caching (see enableKeyTracking()) report changes to keys they have read through
+    the \c{keysInvalidated()} signal.
+
+    \sa RedisInterface, RedisReply
+*/
+
+/*!
+ * \brief Creates a transport for \a{serverUrl}, choosing the implementation based on the URL scheme. URLs beginning with \c{redis://}
+ * use the native RESP transport; all other URLs are treated as webdis HTTP endpoints. If \a{threaded} is true, the transport runs on
+ * its own I/O thread (see ThreadedTransport).
+ */
+RedisTransport* RedisTransport::create(QString serverUrl, QObject *parent, bool threaded)
+{
+    if(threaded)
+        return new ThreadedTransport(serverUrl, parent);
+
+    if(QUrl(serverUrl).scheme() == "redis")
+        return new RespTransport(QUrl(serverUrl), parent);
+
+    return new WebdisTransport(serverUrl, parent);
+}
+
+/*!
+ * \brief Constructor.
+ */
+RedisTransport::RedisTransport(QObject *parent) :
+    QObject(parent),
+    _flushTimer(new QTimer(this)),
+    _batchesSent(0),
+    _commandsSent(0),
+    _largestBatch(0),
+    _keyTrackingActive(false),
+    _connectionState(Connecting),
+    _reconnectAttempts(0)
+{
+    _flushTimer->setSingleShot(true);
+    _flushTimer->setInterval(0);
+    connect(_flushTimer, SIGNAL(timeout()), this, SLOT(flushCommands()));
+}
+
+/*!
+ * \brief Queues \a{command} to be sent with the next batch, and returns a reply that finishes when its result has been received.
+ */
+RedisReply* RedisTransport::sendCommand(const QList<QByteArray> &command)
+{
+    return enqueue(QList<QList<QByteArray> >() << command, false);
+}
+
+/*!
+ * \brief Queues \a{commands} to be executed atomically with the next batch. The returned reply's value is a \l{QVariantList} holding
+ * the result of each command.
+ */
+RedisReply* RedisTransport::sendTransaction(const QList<QList<QByteArray> > &commands)
+{
+    return enqueue(commands, true);
+}
+
+/*!
+ * \brief Sets the batch window to \a{msecs} milliseconds. Commands issued within the window are collected and sent as one batch. A
+ * window of 0 (the default) flushes at the end of the current event loop turn.
+ */
+void RedisTransport::setBatchWindow(int msecs)
+{
+    _flushTimer->setInterval(qMax(0, msecs));
+}
+
+/*!
+ * \brief Returns the batch window, in milliseconds.
+ */
+int RedisTransport::batchWindow() const
+{
+    return _flushTimer->interval();
+}
+
+/*!
+ * \brief Returns counters describing the batches flushed so far: \c{batches}, \c{commands}, \c{largestBatch} and
+ * \c{averageBatchSize}.
+ */
+QVariantMap RedisTransport::batchStatistics() const
+{
+    QVariantMap statistics;
+    statistics.insert("batches", _batchesSent);
+    statistics.insert("commands", _commandsSent);
+    statistics.insert("largestBatch", _largestBatch);
+    statistics.insert("averageBatchSize", _batchesSent > 0 ? double(_commandsSent) / _batchesSent : 0.0);
+
+    return statistics;
+}
+
+/*!
+ * \brief Returns runtime counters for this transport, as described by \l{RedisMetrics::statistics()}. Round-trip times are measured
+ * from the moment a command is queued, so they include the batch window.
+ */
+QVariantMap RedisTransport::metrics() const
+{
+    QVariantMap metrics = _metrics.statistics();
+    metrics.insert("bytesOut", bytesWritten());
+    metrics.insert("bytesIn", bytesRead());
+
+    return metrics;
+}
+
+/*!
+ * \brief Returns the number of bytes written to the network. Transports that forward to another transport return its count instead.
+ */
+qint64 RedisTransport::bytesWritten() const
+{
+    return _metrics.bytesOut();
+}
+
+/*!
+ * \brief Returns the number of bytes read from the network. Transports that forward to another transport return its count instead.
+ */
+qint64 RedisTransport::bytesRead() const
+{
+    return _metrics.bytesIn();
+}
+
+/*!
+ * \brief Flushes every queued command to the transport as a single batch.
+ */
+void RedisTransport::flushCommands()
+{
+    _flushTimer->stop();
+
+    if(_outgoingCommands.isEmpty())
+        return;
+
+    QList<QueuedCommand> batch;
+    batch.swap(_outgoingCommands);
+
+    int batchSize = 0;
+    foreach(const QueuedCommand& queuedCommand, batch)
+        batchSize += queuedCommand.commands.size();
+
+    _batchesSent++;
+    _commandsSent += batchSize;
+    _largestBatch = qMax(_largestBatch, batchSize);
+
+    writeBatch(batch);
+}
+
+/*!
+ * \brief Adds \a{commands} to the outgoing queue, scheduling a flush at the end of the batch window (or immediately, if the queue has
+ * grown too large).
+ */
+RedisReply* RedisTransport::enqueue(const QList<QList<QByteArray> > &commands, bool transaction)
+{
+    RedisReply* reply = new RedisReply(this);
+    connect(reply, SIGNAL(finished()), this, SLOT(handleReplyFinished()));
+
+    _metrics.recordRequest(commands);
+
+    QueuedCommand queuedCommand;
+    queuedCommand.commands = commands;
+    queuedCommand.transaction = transaction;
+    queuedCommand.reply = reply;
+    _outgoingCommands.append(queuedCommand);
+
+    if(_outgoingCommands.size() >= MaxBatchSize)
+        flushCommands();
+    else if(!_flushTimer->isActive())
+        _flushTimer->start();
+
+    return reply;
+}
+
+/*!
+ * \brief Records the round-trip time of the reply that has just finished.
+ */
+void RedisTransport::handleReplyFinished()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    _metrics.recordReply(reply->latency());
+}
+
+/*!
+ * \brief Returns true if \a{channel} contains glob-style wildcards (\c{*}, \c{?} or a \c{[...]} character class) and must therefore
+ * be subscribed to using \c{PSUBSCRIBE}.
+ */
+bool RedisTransport::isPattern(const QString &channel)
+{
+    for(int i = 0; i < channel.size(); ++i)
+    {
+        ushort c = channel.at(i).unicode();
+
+        if(c == '*' || c == '?' || c == '[')
+            return true;
+    }
+
+    return false;
+}
+
+/*!
+ * \brief Returns true if command arguments and replies may hold arbitrary bytes on this transport. The default implementation returns
+ * false, for transports (such as webdis) that relay values as text.
+ */
+bool RedisTransport::isBinarySafe() const
+{
+    return false;
+}
+
+/*!
+ * \brief Asks the server to track the keys read through this transport, and to report any later changes to them via
+ * \c{keysInvalidated()}. Tracking starts asynchronously; isKeyTrackingActive() reports when it is in effect. The default implementation
+ * does nothing, for transports (such as webdis) that cannot receive invalidations.
+ */
+void RedisTransport::enableKeyTracking()
+{
+}
+
+/*!
+ * \brief Returns true while the server is tracking the keys read through this transport. Any key read while this returns true will be
+ * reported by \c{keysInvalidated()} if it subsequently changes (or \c{keyTrackingChanged(false)} will be emitted first).
+ */
+bool RedisTransport::isKeyTrackingActive() const
+{
+    return _keyTrackingActive;
+}
+
+/*!
+ * \brief Records whether key tracking is \a{active}, emitting \c{keyTrackingChanged()} if the state has changed.
+ */
+void RedisTransport::setKeyTrackingActive(bool active)
+{
+    if(_keyTrackingActive != active)
+    {
+        _keyTrackingActive = active;
+        emit keyTrackingChanged(active);
+    }
+}
+
+/*!
+ * \brief Returns the state of the connection to the server.
+ */
+RedisTransport::ConnectionState RedisTransport::connectionState() const
+{
+    return _connectionState;
+}
+
+/*!
+ * \brief Records the connection \a{state}, emitting \c{connectionStateChanged()} if it has changed.
+ */
+void RedisTransport::setConnectionState(ConnectionState state)
+{
+    if(_connectionState != state)
+    {
+        _connectionState = state;
+        emit connectionStateChanged(state);
+    }
+}
+
+/*!
+ * \brief Returns the delay in milliseconds before the next reconnection attempt. The delay doubles with every attempt, from
+ * \c{MinReconnectDelay} up to \c{MaxReconnectDelay}, and is jittered randomly between half and all of that value so that many
+ * clients cut off by the same failover don't all reconnect at the same instant.
+ */
+int RedisTransport::nextReconnectDelay()
+{
+    int delay = MinReconnectDelay << qMin(_reconnectAttempts, 16);
+    delay = qMin(delay, MaxReconnectDelay);
+
+    _reconnectAttempts++;
+
+    return delay / 2 + qrand() % (delay / 2 + 1);
+}
+
+/*!
+ * \brief Resets the reconnection delay to \c{MinReconnectDelay}, once a connection has been re-established.
+ */
+void RedisTransport::resetReconnectDelay()
+{
+    _reconnectAttempts = 0;
+}
+
+/*!
+ * \brief Records \a{bytes} written to the network. May be called from any thread.
+ */
+void RedisTransport::recordBytesWritten(qint64 bytes)
+{
+    _metrics.recordBytesOut(bytes);
+}
+
+/*!
+ * \brief Records \a{bytes} read from the network. May be called from any thread.
+ */
+void RedisTransport::recordBytesRead(qint64 bytes)
+{
+    _metrics.recordBytesIn(bytes);
+}
+
+/*!
+ * \brief Counts a message received on \a{channel} (matching \a{subscription}), and emits \c{messageReceived()} for it.
+ */
+void RedisTransport::reportMessage(const QString &subscription, const QString &channel, const QVariant &payload)
+{
+    _metrics.recordMessage(channel);
+    emit messageReceived(subscription, channel, payload);
+}
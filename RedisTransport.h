@@ -0,0 +1,174 @@
+#ifndef REDISTRANSPORT_H
+#define REDISTRANSPORT_H
+
+#include <QObject>
+#include <QList>
+#include <QByteArray>
+#include <QString>
+#include <QUrl>
+#include <QPointer>
+#include <QTimer>
+#include <QVariantMap>
+#include <QStringList>
+#include "RedisReply.h"
+#include "RedisMetrics.h"
+
+class RedisTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** State of the connection to the server. */
+    enum ConnectionState
+    {
+        Connecting,     /**< Connecting for the first time. */
+        Connected,      /**< Connected. */
+        Reconnecting    /**< The connection was lost, and is being re-established. */
+    };
+    Q_ENUM(ConnectionState)
+
+    /** Creates the appropriate transport for the scheme of the given server URL ("redis://" for native RESP, "http://" for webdis),
+     *  optionally running it on a dedicated I/O thread. */
+    static RedisTransport* create(QString serverUrl, QObject* parent, bool threaded = false);
+
+    /** Constructor. */
+    explicit RedisTransport(QObject* parent = 0);
+
+    /** Queues the given command (command name followed by its arguments) for the next batch. The caller owns the returned reply. */
+    RedisReply* sendCommand(const QList<QByteArray>& command);
+
+    /** Queues the given commands to be executed atomically (MULTI/EXEC or equivalent). The reply's value is the list of their results. */
+    RedisReply* sendTransaction(const QList<QList<QByteArray> >& commands);
+
+    /** Sets how long (in milliseconds) commands are collected before being flushed as one batch. 0 flushes at the end of the current event loop turn. */
+    void setBatchWindow(int msecs);
+    int batchWindow() const;
+
+    /** Returns counters describing the batches flushed so far (batches, commands, largestBatch, averageBatchSize). */
+    QVariantMap batchStatistics() const;
+
+    /** Returns runtime counters: requests sent and pending, reply latency, messages received and bytes transferred (see RedisMetrics). */
+    QVariantMap metrics() const;
+
+    /** Returns the number of bytes written to / read from the network by this transport (or the transport it forwards to). */
+    virtual qint64 bytesWritten() const;
+    virtual qint64 bytesRead() const;
+
+    /** Subscribes to the given channel (or pattern, if it contains wildcards) on the shared subscriber connection. */
+    virtual void subscribe(const QString& channel) = 0;
+
+    /** Removes the subscription to the given channel (or pattern). */
+    virtual void unsubscribe(const QString& channel) = 0;
+
+    /** Returns true if the given channel name should be subscribed to with PSUBSCRIBE rather than SUBSCRIBE. */
+    static bool isPattern(const QString& channel);
+
+    /** Returns true if values may hold arbitrary bytes (rather than only UTF-8 text) on this transport. The default is false. */
+    virtual bool isBinarySafe() const;
+
+    /** Asks the server to report changes to keys read through this transport (via keysInvalidated()). The default does nothing. */
+    virtual void enableKeyTracking();
+
+    /** Returns true while the server is tracking keys read through this transport, ie. every later read is covered by invalidations. */
+    bool isKeyTrackingActive() const;
+
+    /** Returns the state of the connection to the server. */
+    ConnectionState connectionState() const;
+
+protected:
+
+    /** A queued command (or group of commands, for a transaction) and the reply awaiting its result. */
+    struct QueuedCommand
+    {
+        QList<QList<QByteArray> > commands;
+        bool transaction;
+        QPointer<RedisReply> reply;
+    };
+
+    /** Sends a batch of queued commands to Redis in as few round trips as the protocol allows. */
+    virtual void writeBatch(const QList<QueuedCommand>& batch) = 0;
+
+    /** Records whether key tracking is active, emitting keyTrackingChanged() if it has changed. */
+    void setKeyTrackingActive(bool active);
+
+    /** Records the connection state, emitting connectionStateChanged() if it has changed. */
+    void setConnectionState(ConnectionState state);
+
+    /** Returns the (jittered, exponentially increasing) delay in milliseconds before the next reconnection attempt. */
+    int nextReconnectDelay();
+
+    /** Resets the reconnection delay once a connection has been re-established. */
+    void resetReconnectDelay();
+
+    /** Records bytes written to / read from the network. Safe to call from any thread. */
+    void recordBytesWritten(qint64 bytes);
+    void recordBytesRead(qint64 bytes);
+
+    /** Counts a message received on the subscriber connection, and emits messageReceived(). */
+    void reportMessage(const QString& subscription, const QString& channel, const QVariant& payload);
+
+private slots:
+
+    /** Flushes all queued commands as a single batch. */
+    void flushCommands();
+
+    /** Records the round-trip time of a finished reply. */
+    void handleReplyFinished();
+
+private:
+
+    /** Adds a command to the outgoing queue and schedules a flush. */
+    RedisReply* enqueue(const QList<QList<QByteArray> >& commands, bool transaction);
+
+    /** Number of queued commands at which the queue is flushed without waiting for the batch window to expire. */
+    static const int MaxBatchSize = 1024;
+
+    /** Bounds, in milliseconds, of the delay between reconnection attempts (before jitter). */
+    static const int MinReconnectDelay = 100;
+    static const int MaxReconnectDelay = 10000;
+
+    /** Commands collected since the last flush. */
+    QList<QueuedCommand> _outgoingCommands;
+
+    /** Timer used to flush the outgoing queue at the end of the batch window. */
+    QTimer* _flushTimer;
+
+    /** Batch counters. */
+    qint64 _batchesSent;
+    qint64 _commandsSent;
+    int _largestBatch;
+
+    /** Whether the server is currently tracking keys read through this transport. */
+    bool _keyTrackingActive;
+
+    /** State of the connection to the server. */
+    ConnectionState _connectionState;
+
+    /** Number of reconnection attempts since the connection was last established. */
+    int _reconnectAttempts;
+
+    /** Runtime counters. */
+    RedisMetrics _metrics;
+
+signals:
+
+    /** Emitted for every message received on the subscriber connection. The subscription is the channel or pattern that matched, and the
+     *  channel is the one the message was actually published on. */
+    void messageReceived(QString subscription, QString channel, QVariant payload);
+
+    /** Emitted when the server reports that tracked keys have changed. An empty list means that every tracked key may have changed. */
+    void keysInvalidated(QStringList keys);
+
+    /** Emitted when key tracking starts or stops. Values read while tracking was inactive are not covered by invalidations. */
+    void keyTrackingChanged(bool active);
+
+    /** Emitted when the connection to the server is lost, or (re-)established. */
+    void connectionStateChanged(RedisTransport::ConnectionState state);
+
+    /** Emitted once every subscription has been re-established after the subscriber connection was lost. Messages published while it
+     *  was down have been missed. */
+    void resubscribed();
+};
+
+#endif // REDISTRANSPORT_H
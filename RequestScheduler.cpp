@@ -0,0 +1,505 @@
+#include "RequestScheduler.h"
+#include "RedisLogging.h"
+
+/*!
+    \class RequestScheduler
+    \inmodule RedisInterface
+    \brief Schedules the requests of a RedisInterface in priority lanes, so that bulk traffic cannot hold up interactive requests.
+
+    Every request sent through a transport joins the same pipeline (or, on webdis, the same queue of HTTP requests, which are sent one
+    at a time, see WebdisTransport), where a reply is only received once the replies to everything sent before it have been. A burst of background writes can therefore add a long delay to
+    a read made in response to user input. The scheduler sorts requests into four lanes (see Lane), each with a limit on the number of
+    its requests in flight at once. A request whose lane is at its limit is queued instead of sent, and sent as soon as one of the
+    lane's replies comes back, so that no more than the limit of that lane's requests can ever be ahead of a more urgent one.
+
+    By default, interactive reads and control writes are never held back, while bulk and background requests are limited (see
+    setLimit()). When requests from several lanes are queued, each lane sends up to its weight in requests per round (see setWeight()),
+    so the queues are served in proportion to their weights and background work is never starved.
+
+    Requests may carry a key. A request queued for a key is superseded by any later request for the same key: in the same lane, the new
+    request takes its place in the queue, and in another lane, the old request is dropped. Either way, writes to a key are never
+    reordered, and a burst of writes to a key costs a single request. Superseded requests, and requests removed with cancelQueued(),
+    finish with an error. Requests without a key are sent in order within their lane. Requests that are sent without superseding (such
+    as partial writes of a hash, which don't replace each other) queue behind the requests for their key instead, and are never
+    superseded themselves.
+
+    Reads may name the keys they read (see sendRead()). A read is held back while a request for any of its keys is queued, and joins the
+    queue of its own lane once every such request has been sent, so that a read in an urgent lane never overtakes a queued write to the
+    same key and returns the value from before it. This relies on the transport running requests in the order they were sent: the
+    native protocol pipelines them on one connection, and WebdisTransport waits for each HTTP request to finish before sending the next,
+    since webdis requests in flight together may run in any order.
+
+    \sa RedisInterface, RedisTransport
+*/
+
+const char* const RequestScheduler::CancelledError = "Request cancelled";
+const char* const RequestScheduler::SupersededError = "Request superseded by a later request for the same key";
+
+const int RequestScheduler::DefaultLimits[RequestScheduler::LaneCount] = { 0, 0, 32, 8 };
+const int RequestScheduler::DefaultWeights[RequestScheduler::LaneCount] = { 8, 4, 2, 1 };
+
+/*!
+ * \brief Constructor. Requests are sent through \a{transport}.
+ */
+RequestScheduler::RequestScheduler(RedisTransport *transport, QObject *parent) :
+    QObject(parent),
+    _transport(transport)
+{
+    for(int lane = 0; lane < LaneCount; ++lane)
+    {
+        LaneState& state = _lanes[lane];
+        state.limit = DefaultLimits[lane];
+        state.weight = DefaultWeights[lane];
+        state.inFlight = 0;
+        state.sent = 0;
+        state.completed = 0;
+        state.cancelled = 0;
+        state.superseded = 0;
+        state.maxQueued = 0;
+        state.totalWaitUsecs = 0;
+        state.maxWaitUsecs = 0;
+    }
+}
+
+/*!
+ * \brief Sends \a{command} in \a{lane}, or queues it if the lane is at its limit. If \a{key} is given, any request queued for the same
+ * key is superseded, or (if \a{supersede} is false) waited for. Returns a reply that the caller owns.
+ */
+RedisReply* RequestScheduler::sendCommand(Lane lane, const QList<QByteArray> &command, const QByteArray &key, bool supersede)
+{
+    Request request;
+    request.commands << command;
+    request.transaction = false;
+    request.key = key;
+    request.supersedable = supersede;
+
+    return schedule(lane, request);
+}
+
+/*!
+ * \brief Sends \a{commands} as a transaction in \a{lane}, as sendCommand() does.
+ */
+RedisReply* RequestScheduler::sendTransaction(Lane lane, const QList<QList<QByteArray> > &commands, const QByteArray &key, bool supersede)
+{
+    Request request;
+    request.commands = commands;
+    request.transaction = true;
+    request.key = key;
+    request.supersedable = supersede;
+
+    return schedule(lane, request);
+}
+
+/*!
+ * \brief Sends \a{command}, which reads \a{keys}, in \a{lane}, as sendCommand() does. While a request for any of \a{keys} is queued
+ * (in any lane), the read is held back, and it is only queued in \a{lane} once all of them have been sent. Returns a reply that the
+ * caller owns.
+ */
+RedisReply* RequestScheduler::sendRead(Lane lane, const QList<QByteArray> &command, const QList<QByteArray> &keys)
+{
+    Request request;
+    request.commands << command;
+    request.transaction = false;
+    request.supersedable = false;
+    request.readKeys = keys;
+
+    return schedule(lane, request);
+}
+
+/*!
+ * \brief Sets the maximum number of requests of \a{lane} in flight at once to \a{maxInFlight} (0 for no limit). Raising the limit
+ * sends any queued requests that now fit.
+ */
+void RequestScheduler::setLimit(Lane lane, int maxInFlight)
+{
+    _lanes[lane].limit = qMax(0, maxInFlight);
+    dispatch();
+}
+
+/*!
+ * \brief Returns the maximum number of requests of \a{lane} in flight at once, or 0 if there is no limit.
+ */
+int RequestScheduler::limit(Lane lane) const
+{
+    return _lanes[lane].limit;
+}
+
+/*!
+ * \brief Sets the number of queued requests \a{lane} sends per round, when several lanes have requests queued, to \a{weight} (at
+ * least 1).
+ */
+void RequestScheduler::setWeight(Lane lane, int weight)
+{
+    _lanes[lane].weight = qMax(1, weight);
+}
+
+/*!
+ * \brief Returns the number of queued requests \a{lane} sends per round.
+ */
+int RequestScheduler::weight(Lane lane) const
+{
+    return _lanes[lane].weight;
+}
+
+/*!
+ * \brief Cancels every request queued or held in \a{lane}, finishing their replies with CancelledError. Requests already sent are not
+ * affected, and reads held behind the cancelled requests are released. Returns the number of requests cancelled.
+ */
+int RequestScheduler::cancelQueued(Lane lane)
+{
+    LaneState& state = _lanes[lane];
+
+    QList<Request> cancelled;
+    cancelled.swap(state.queue);
+    cancelled.append(state.held);
+    state.held.clear();
+    state.cancelled += cancelled.size();
+
+    foreach(const Request& request, cancelled)
+        if(!request.key.isEmpty())
+            unqueueKey(request.key);
+
+    if(!cancelled.isEmpty())
+        qCDebug(lcRedisInterface) << "Cancelled" << cancelled.size() << "queued" << laneName(lane) << "requests";
+
+    releaseHeldReads();
+    dispatch();
+
+    // Replies are finished last, since their handlers may send further requests.
+    foreach(const Request& request, cancelled)
+    {
+        if(request.reply)
+        {
+            request.reply->setError(CancelledError);
+            request.reply->finish();
+        }
+    }
+
+    return cancelled.size();
+}
+
+/*!
+ * \brief Returns counters describing each lane, keyed by lane name: the number of requests \c{queued}, reads \c{held} behind queued
+ * requests for their keys (see sendRead()) and requests \c{inFlight} now, the lane's \c{limit} and \c{weight}, the requests \c{sent},
+ * \c{completed}, \c{cancelled} and \c{superseded} so far, the longest queue (\c{maxQueued}), and the average and longest time
+ * requests spent queued before being sent (\c{averageWaitMsecs} and \c{maxWaitMsecs}).
+ */
+QVariantMap RequestScheduler::statistics() const
+{
+    QVariantMap statistics;
+
+    for(int lane = 0; lane < LaneCount; ++lane)
+    {
+        const LaneState& state = _lanes[lane];
+
+        QVariantMap laneStatistics;
+        laneStatistics.insert("queued", state.queue.size());
+        laneStatistics.insert("held", state.held.size());
+        laneStatistics.insert("inFlight", state.inFlight);
+        laneStatistics.insert("limit", state.limit);
+        laneStatistics.insert("weight", state.weight);
+        laneStatistics.insert("sent", state.sent);
+        laneStatistics.insert("completed", state.completed);
+        laneStatistics.insert("cancelled", state.cancelled);
+        laneStatistics.insert("superseded", state.superseded);
+        laneStatistics.insert("maxQueued", state.maxQueued);
+        laneStatistics.insert("averageWaitMsecs", state.sent > 0 ? double(state.totalWaitUsecs) / state.sent / 1000.0 : 0.0);
+        laneStatistics.insert("maxWaitMsecs", double(state.maxWaitUsecs) / 1000.0);
+
+        statistics.insert(laneName(Lane(lane)), laneStatistics);
+    }
+
+    return statistics;
+}
+
+/*!
+ * \brief Returns the name of \a{lane}: \c{"interactive"}, \c{"control"}, \c{"bulk"} or \c{"background"}.
+ */
+QString RequestScheduler::laneName(Lane lane)
+{
+    switch(lane)
+    {
+    case Interactive:
+        return "interactive";
+    case Control:
+        return "control";
+    case Bulk:
+        return "bulk";
+    case Background:
+        return "background";
+    default:
+        return QString();
+    }
+}
+
+/*!
+ * \brief Returns the lane named \a{name} (see laneName()), or -1 if there is none.
+ */
+int RequestScheduler::laneFromName(const QString &name)
+{
+    for(int lane = 0; lane < LaneCount; ++lane)
+        if(laneName(Lane(lane)) == name)
+            return lane;
+
+    return -1;
+}
+
+/*!
+ * \brief Handles a reply from the transport, freeing its lane's slot, passing its result on to the caller's reply if the request was
+ * queued, and sending any queued requests that now fit.
+ */
+void RequestScheduler::handleReplyFinished()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    QHash<RedisReply*, int>::iterator lane = _inFlight.find(reply);
+    if(lane != _inFlight.end())
+    {
+        LaneState& state = _lanes[lane.value()];
+        --state.inFlight;
+        ++state.completed;
+
+        _inFlight.erase(lane);
+    }
+
+    QHash<RedisReply*, QPointer<RedisReply> >::iterator forwarded = _forwarded.find(reply);
+    if(forwarded != _forwarded.end())
+    {
+        QPointer<RedisReply> callerReply = forwarded.value();
+        _forwarded.erase(forwarded);
+        reply->deleteLater();
+
+        if(callerReply)
+        {
+            if(reply->isError())
+                callerReply->setError(reply->errorString());
+            else
+                callerReply->setValue(reply->value());
+
+            callerReply->finish();
+        }
+    }
+
+    dispatch();
+}
+
+/*!
+ * \brief Frees the lane slot of a transport \a{reply} destroyed by its owner before it finished.
+ */
+void RequestScheduler::handleReplyDestroyed(QObject *reply)
+{
+    RedisReply* key = static_cast<RedisReply*>(reply);
+    _forwarded.remove(key);
+
+    QHash<RedisReply*, int>::iterator lane = _inFlight.find(key);
+    if(lane == _inFlight.end())
+        return;
+
+    --_lanes[lane.value()].inFlight;
+    _inFlight.erase(lane);
+
+    dispatch();
+}
+
+/*!
+ * \brief Sends \a{request} in \a{lane} straight away, returning the transport's reply, if the lane has room and nothing queued (for the
+ * request's key, or ahead of it in the lane). Otherwise queues it, superseding any request queued for its key, and returns a reply
+ * (parented to the scheduler until the caller takes it) that finishes once the request has been sent and answered. A read of a key
+ * with a request queued is held instead (see releaseHeldReads()).
+ */
+RedisReply* RequestScheduler::schedule(Lane lane, Request &request)
+{
+    LaneState& state = _lanes[lane];
+
+    if(isHeld(request))
+    {
+        request.reply = new RedisReply(this);
+        request.queued.start();
+        state.held.append(request);
+
+        return request.reply;
+    }
+
+    bool keyQueued = !request.key.isEmpty() && _queuedKeys.contains(request.key);
+
+    if(!keyQueued && state.queue.isEmpty() && hasCapacity(state))
+        return send(lane, request);
+
+    request.reply = new RedisReply(this);
+    request.queued.start();
+
+    if(keyQueued && request.supersedable && supersede(lane, request))
+        return request.reply;
+
+    state.queue.append(request);
+    state.maxQueued = qMax(state.maxQueued, state.queue.size());
+
+    if(!request.key.isEmpty())
+        ++_queuedKeys[request.key];
+
+    // The request may only have been queued to supersede another, in which case its lane may have room for it.
+    if(keyQueued)
+        dispatch();
+
+    return request.reply;
+}
+
+/*!
+ * \brief Finds the supersedable request queued for the key of \a{request}, and supersedes it: in \a{lane}, \a{request} takes its place
+ * in the queue, and in any other lane, it is dropped. Its reply finishes with SupersededError. Returns true if \a{request} took its
+ * place.
+ */
+bool RequestScheduler::supersede(Lane lane, Request &request)
+{
+    for(int other = 0; other < LaneCount; ++other)
+    {
+        QList<Request>& queue = _lanes[other].queue;
+
+        for(int i = 0; i < queue.size(); ++i)
+        {
+            if(queue.at(i).key != request.key || !queue.at(i).supersedable)
+                continue;
+
+            QPointer<RedisReply> previousReply = queue.at(i).reply;
+            ++_lanes[other].superseded;
+
+            if(other == lane)
+            {
+                queue[i] = request;
+            }
+            else
+            {
+                queue.removeAt(i);
+                unqueueKey(request.key);
+            }
+
+            // Finished from the event loop, since its handlers may send further requests for the key.
+            if(previousReply)
+            {
+                previousReply->setError(SupersededError);
+                QMetaObject::invokeMethod(previousReply, "finish", Qt::QueuedConnection);
+            }
+
+            return other == lane;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ * \brief Sends \a{request} through the transport, counting it against the limit of \a{lane} until its reply comes back. Returns the
+ * transport's reply.
+ */
+RedisReply* RequestScheduler::send(Lane lane, const Request &request)
+{
+    LaneState& state = _lanes[lane];
+
+    RedisReply* reply = request.transaction ? _transport->sendTransaction(request.commands) : _transport->sendCommand(request.commands.first());
+
+    ++state.inFlight;
+    ++state.sent;
+
+    if(request.queued.isValid())
+    {
+        qint64 waitUsecs = request.queued.nsecsElapsed() / 1000;
+        state.totalWaitUsecs += waitUsecs;
+        state.maxWaitUsecs = qMax(state.maxWaitUsecs, waitUsecs);
+    }
+
+    _inFlight.insert(reply, lane);
+    connect(reply, SIGNAL(finished()), this, SLOT(handleReplyFinished()));
+    connect(reply, SIGNAL(destroyed(QObject*)), this, SLOT(handleReplyDestroyed(QObject*)));
+
+    return reply;
+}
+
+/*!
+ * \brief Sends queued requests in rounds, in which each lane (most urgent first) sends up to its weight in requests while it has room,
+ * until no lane with requests queued has room left. Reads released by the requests sent are sent in the same way.
+ */
+void RequestScheduler::dispatch()
+{
+    bool dispatched = true;
+
+    while(dispatched)
+    {
+        dispatched = false;
+
+        for(int lane = 0; lane < LaneCount; ++lane)
+        {
+            LaneState& state = _lanes[lane];
+
+            for(int sent = 0; sent < state.weight && !state.queue.isEmpty() && hasCapacity(state); ++sent)
+            {
+                Request request = state.queue.takeFirst();
+                _forwarded.insert(send(Lane(lane), request), request.reply);
+                dispatched = true;
+
+                // Reads held behind the request are only released once it has been sent, so that they follow it down the pipeline
+                // (or, on webdis, the queue of requests, which also runs in order).
+                if(!request.key.isEmpty())
+                {
+                    unqueueKey(request.key);
+                    releaseHeldReads();
+                }
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Counts a request for \a{key} out of the queue, forgetting the key once none is left.
+ */
+void RequestScheduler::unqueueKey(const QByteArray &key)
+{
+    QHash<QByteArray, int>::iterator count = _queuedKeys.find(key);
+
+    if(count != _queuedKeys.end() && --count.value() <= 0)
+        _queuedKeys.erase(count);
+}
+
+/*!
+ * \brief Returns true if the lane described by \a{state} may send another request.
+ */
+bool RequestScheduler::hasCapacity(const LaneState &state) const
+{
+    return state.limit <= 0 || state.inFlight < state.limit;
+}
+
+/*!
+ * \brief Returns true if \a{request} reads a key for which a request is queued, and must therefore be held back.
+ */
+bool RequestScheduler::isHeld(const Request &request) const
+{
+    foreach(const QByteArray& key, request.readKeys)
+        if(_queuedKeys.contains(key))
+            return true;
+
+    return false;
+}
+
+/*!
+ * \brief Moves every held read whose keys no longer have requests queued to the back of its lane's queue, to be sent by dispatch().
+ */
+void RequestScheduler::releaseHeldReads()
+{
+    for(int lane = 0; lane < LaneCount; ++lane)
+    {
+        LaneState& state = _lanes[lane];
+
+        for(int i = 0; i < state.held.size();)
+        {
+            if(isHeld(state.held.at(i)))
+            {
+                ++i;
+                continue;
+            }
+
+            state.queue.append(state.held.takeAt(i));
+            state.maxQueued = qMax(state.maxQueued, state.queue.size());
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef REQUESTSCHEDULER_H
+#define REQUESTSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QVariantMap>
+#include "RedisTransport.h"
+
+class RequestScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Priority classes of outgoing requests, from most to least urgent. */
+    enum Lane
+    {
+        Interactive,    /**< Reads whose results are waited for (get(), getAsync(), hydration). */
+        Control,        /**< Explicit writes and commands (set(), setAsync(), publish(), execute()). */
+        Bulk,           /**< Writes made by bindings (published properties, objects and events). */
+        Background,     /**< Housekeeping, and bindings demoted to it. */
+        LaneCount
+    };
+
+    /** Constructor. Requests are sent through the given transport. */
+    explicit RequestScheduler(RedisTransport* transport, QObject* parent = 0);
+
+    /** Sends the given command (or queues it, if its lane is at its limit). If a key is given, any request queued for the same key is
+     *  superseded: replaced in place if it is in the same lane, otherwise dropped. If supersede is false, the request instead queues
+     *  behind those for its key, and is never superseded itself (eg. for partial writes, which don't replace each other). Either way,
+     *  reads of the key are held behind it. The caller owns the returned reply. */
+    RedisReply* sendCommand(Lane lane, const QList<QByteArray>& command, const QByteArray& key = QByteArray(), bool supersede = true);
+
+    /** Sends the given commands as a transaction, as sendCommand() does. */
+    RedisReply* sendTransaction(Lane lane, const QList<QList<QByteArray> >& commands, const QByteArray& key = QByteArray(),
+                                bool supersede = true);
+
+    /** Sends the given command reading the given keys, as sendCommand() does, but holds it back while a request for any of the keys is
+     *  queued, so that the read is sent after (and sees) every write to them made before it. The caller owns the returned reply. */
+    RedisReply* sendRead(Lane lane, const QList<QByteArray>& command, const QList<QByteArray>& keys);
+
+    /** Sets the maximum number of requests of the given lane in flight at once (0 for no limit). */
+    void setLimit(Lane lane, int maxInFlight);
+    int limit(Lane lane) const;
+
+    /** Sets the number of requests the given lane sends per round when several lanes have requests queued. */
+    void setWeight(Lane lane, int weight);
+    int weight(Lane lane) const;
+
+    /** Cancels every request queued or held (but not yet sent) in the given lane, finishing their replies with an error. Returns their
+     *  number. */
+    int cancelQueued(Lane lane);
+
+    /** Returns counters describing each lane (queued, held, inFlight, limit, weight, sent, completed, cancelled, superseded, maxQueued,
+     *  averageWaitMsecs, maxWaitMsecs), by lane name. */
+    QVariantMap statistics() const;
+
+    /** Returns the name of the given lane, or the lane with the given name (or -1 if there is none). */
+    static QString laneName(Lane lane);
+    static int laneFromName(const QString& name);
+
+    /** Error reported by the replies of cancelled and superseded requests. */
+    static const char* const CancelledError;
+    static const char* const SupersededError;
+
+private slots:
+
+    /** Private handler slots for the transport's replies. */
+    void handleReplyFinished();
+    void handleReplyDestroyed(QObject* reply);
+
+private:
+
+    /** A queued request, with the reply handed to the caller. */
+    struct Request
+    {
+        QList<QList<QByteArray> > commands;
+        bool transaction;
+        QByteArray key;
+        bool supersedable;
+        QList<QByteArray> readKeys;
+        QPointer<RedisReply> reply;
+        QElapsedTimer queued;
+    };
+
+    /** A lane's queue, settings and counters. */
+    struct LaneState
+    {
+        QList<Request> queue;
+        QList<Request> held;
+        int limit;
+        int weight;
+        int inFlight;
+        qint64 sent;
+        qint64 completed;
+        qint64 cancelled;
+        qint64 superseded;
+        int maxQueued;
+        qint64 totalWaitUsecs;
+        qint64 maxWaitUsecs;
+    };
+
+    /** Sends the request straight away if its lane has room and nothing queued ahead of it, otherwise queues it. */
+    RedisReply* schedule(Lane lane, Request& request);
+
+    /** Drops the queued supersedable request for the given key from every lane other than the given one, and replaces it in the given
+     *  lane with the given request. Returns true if the request took the place of one queued in its lane. */
+    bool supersede(Lane lane, Request& request);
+
+    /** Counts a request for the given key out of the queue. */
+    void unqueueKey(const QByteArray& key);
+
+    /** Sends the given request through the transport, returning the transport's reply. */
+    RedisReply* send(Lane lane, const Request& request);
+
+    /** Sends queued requests while their lanes have room, taking up to each lane's weight in requests per round. */
+    void dispatch();
+
+    /** Returns true if the given lane may send another request. */
+    bool hasCapacity(const LaneState& state) const;
+
+    /** Returns true if the given read must be held back, since a request for one of its keys is queued. */
+    bool isHeld(const Request& request) const;
+
+    /** Moves the held reads whose keys no longer have requests queued to the back of their lanes' queues. */
+    void releaseHeldReads();
+
+    /** Default limits and weights of each lane. */
+    static const int DefaultLimits[LaneCount];
+    static const int DefaultWeights[LaneCount];
+
+    /** Transport carrying the requests. */
+    RedisTransport* _transport;
+
+    /** Lanes, indexed by Lane. */
+    LaneState _lanes[LaneCount];
+
+    /** Number of queued requests for each key that has any (at most one supersedable request is queued per key, across all lanes). */
+    QHash<QByteArray, int> _queuedKeys;
+
+    /** Lane of each transport reply in flight. */
+    QHash<RedisReply*, int> _inFlight;
+
+    /** Caller's replies of the requests that were queued before being sent, keyed by the transport's reply. */
+    QHash<RedisReply*, QPointer<RedisReply> > _forwarded;
+};
+
+#endif // REQUESTSCHEDULER_H
@@ -0,0 +1,370 @@
+#include "RespParser.h"
+#include <cstring>
+
+/*!
+    \class RespParser
+    \inmodule RedisInterface
+    \brief An incremental parser for the Redis protocol (RESP).
+
+    Bytes are fed in as they arrive from the socket (see StreamParser), and every complete reply in the buffer can then be extracted in
+    turn. A reply split across several reads is simply reported as \c{Incomplete} until the rest arrives; several replies delivered in one
+    read are all extracted before the buffer is touched again.
+
+    Two extraction methods are provided. parseReply() decodes a reply of any shape into a QVariant and is used for ordinary command
+    replies. parseFlatReply() is the fast path for pub/sub traffic: it returns the elements of a flat array reply (eg.
+    \c{["message", channel, payload]}) as views into the buffer, so no bytes are copied until the caller converts the channel and payload.
+
+    When a reply is incomplete, the parser remembers how many bytes it needs (exactly, for a partially received bulk string) so that a large
+    payload arriving in many small reads is not re-parsed from the start on every read.
+
+    \sa RespTransport, StreamParser
+*/
+
+/*!
+ * \brief Constructor.
+ */
+RespParser::RespParser() :
+    StreamParser(),
+    _requiredBytes(0)
+{
+}
+
+/*!
+ * \brief Parses the next complete reply in the buffer into \a{value}, setting \a{isError} for error replies. Bulk and simple strings are
+ * decoded as \l{QString}s (except for binary bulk strings, see bulkValue()), integers as \c{qlonglong}s, arrays as \l{QVariantList}s and null replies as invalid \l{QVariant}s.
+ */
+RespParser::Status RespParser::parseReply(QVariant &value, bool &isError)
+{
+    if(bufferedBytes() == 0 || bufferedBytes() < _requiredBytes)
+        return Incomplete;
+
+    int position = _position;
+    Status status = parseValue(position, value, isError);
+
+    if(status == Complete)
+    {
+        _position = position;
+        _requiredBytes = 0;
+    }
+
+    return status;
+}
+
+/*!
+ * \brief Parses the next complete reply in the buffer into \a{elements}, without copying any data. Array replies yield one element per
+ * entry, with the entries of any nested arrays flattened in place (so a client tracking invalidation message,
+ * \c{["message", "__redis__:invalidate", [key1, key2]]}, yields four elements); other replies yield a single element. Each element is
+ * a view into the buffer (null for null bulk strings), valid until more data is read into the parser. \a{isError} is set for error
+ * replies.
+ */
+RespParser::Status RespParser::parseFlatReply(Elements &elements, bool &isError)
+{
+    if(bufferedBytes() == 0 || bufferedBytes() < _requiredBytes)
+        return Incomplete;
+
+    elements.clear();
+    isError = false;
+
+    int position = _position;
+
+    if(_buffer.at(position) == '*')
+    {
+        Status status = parseFlatArray(position, elements);
+        if(status != Complete)
+            return status;
+    }
+    else
+    {
+        QByteArray element;
+
+        Status status = parseElement(position, element, isError);
+        if(status != Complete)
+            return status;
+
+        elements.append(element);
+    }
+
+    _position = position;
+    _requiredBytes = 0;
+
+    return Complete;
+}
+
+/*!
+ * \brief Converts the \a{length} bytes of bulk string contents at \a{data} to a \l{QVariant}. Text is decoded as a \l{QString}. Contents
+ * beginning with a \c{0xFF} byte, which never begins UTF-8 text and marks values encoded by DataStreamValueCodec, are returned as a
+ * \l{QByteArray} so that they survive intact.
+ */
+QVariant RespParser::bulkValue(const char *data, int length)
+{
+    if(length > 0 && data[0] == '\xFF')
+        return QByteArray(data, length);
+
+    return QString::fromUtf8(data, length);
+}
+
+/*!
+ * \brief Resets the incomplete-reply bookkeeping when the buffer is cleared.
+ */
+void RespParser::resetState()
+{
+    _requiredBytes = 0;
+}
+
+/*!
+ * \brief Parses the value starting at \a{position} into \a{value}, advancing \a{position} past it if it is complete.
+ */
+RespParser::Status RespParser::parseValue(int &position, QVariant &value, bool &isError)
+{
+    const char* line;
+    int length, next;
+
+    Status status = readLine(position, line, length, next);
+    if(status != Complete)
+        return status;
+
+    char type = _buffer.at(position);
+    qlonglong integer;
+
+    isError = false;
+
+    switch(type)
+    {
+    case '+':
+        value = QString::fromUtf8(line, length);
+        break;
+
+    case '-':
+        value = QString::fromUtf8(line, length);
+        isError = true;
+        break;
+
+    case ':':
+        if(!parseInteger(line, length, integer))
+            return ProtocolError;
+
+        value = integer;
+        break;
+
+    case '$':
+        if(!parseInteger(line, length, integer))
+            return ProtocolError;
+
+        // Null bulk string.
+        if(integer < 0)
+        {
+            value = QVariant();
+            break;
+        }
+
+        if(_buffer.size() < next + integer + 2)
+        {
+            _requiredBytes = int(next + integer + 2 - _position);
+            return Incomplete;
+        }
+
+        value = bulkValue(_buffer.constData() + next, int(integer));
+        next += int(integer) + 2;
+        break;
+
+    case '*':
+    {
+        if(!parseInteger(line, length, integer))
+            return ProtocolError;
+
+        // Null array.
+        if(integer < 0)
+        {
+            value = QVariant();
+            break;
+        }
+
+        QVariantList elements;
+        elements.reserve(int(integer));
+
+        for(qlonglong i = 0; i < integer; ++i)
+        {
+            QVariant element;
+            bool elementIsError;
+
+            status = parseValue(next, element, elementIsError);
+            if(status != Complete)
+                return status;
+
+            elements.append(element);
+        }
+
+        value = elements;
+        break;
+    }
+
+    default:
+        return ProtocolError;
+    }
+
+    position = next;
+    return Complete;
+}
+
+/*!
+ * \brief Parses the array starting at \a{position}, appending its elements (and those of any nested arrays) to \a{elements} and
+ * advancing \a{position} past it if it is complete.
+ */
+RespParser::Status RespParser::parseFlatArray(int &position, Elements &elements)
+{
+    const char* line;
+    int length, next;
+    qlonglong count;
+
+    Status status = readLine(position, line, length, next);
+    if(status != Complete)
+        return status;
+
+    if(!parseInteger(line, length, count))
+        return ProtocolError;
+
+    for(qlonglong i = 0; i < count; ++i)
+    {
+        if(next < _buffer.size() && _buffer.at(next) == '*')
+        {
+            status = parseFlatArray(next, elements);
+        }
+        else
+        {
+            QByteArray element;
+            bool elementIsError;
+
+            status = parseElement(next, element, elementIsError);
+            elements.append(element);
+        }
+
+        if(status != Complete)
+            return status;
+    }
+
+    position = next;
+    return Complete;
+}
+
+/*!
+ * \brief Parses the non-array element starting at \a{position} as a view into the buffer, advancing \a{position} past it if it is
+ * complete. Integers and simple strings are returned as their textual representation.
+ */
+RespParser::Status RespParser::parseElement(int &position, QByteArray &element, bool &isError)
+{
+    const char* line;
+    int length, next;
+
+    Status status = readLine(position, line, length, next);
+    if(status != Complete)
+        return status;
+
+    char type = _buffer.at(position);
+    qlonglong bulkLength;
+
+    isError = false;
+
+    switch(type)
+    {
+    case '-':
+        isError = true;
+        // Fall through.
+    case '+':
+    case ':':
+        element = QByteArray::fromRawData(line, length);
+        break;
+
+    case '$':
+        if(!parseInteger(line, length, bulkLength))
+            return ProtocolError;
+
+        // Null bulk string.
+        if(bulkLength < 0)
+        {
+            element = QByteArray();
+            break;
+        }
+
+        if(_buffer.size() < next + bulkLength + 2)
+        {
+            _requiredBytes = int(next + bulkLength + 2 - _position);
+            return Incomplete;
+        }
+
+        element = QByteArray::fromRawData(_buffer.constData() + next, int(bulkLength));
+        next += int(bulkLength) + 2;
+        break;
+
+    default:
+        return ProtocolError;
+    }
+
+    position = next;
+    return Complete;
+}
+
+/*!
+ * \brief Locates the header line of the element at \a{position}. On success, \a{line} and \a{length} describe the text following the
+ * type byte, and \a{next} is the offset just past the terminating CRLF.
+ */
+RespParser::Status RespParser::readLine(int position, const char *&line, int &length, int &next)
+{
+    const char* data = _buffer.constData();
+    int size = _buffer.size();
+
+    if(position >= size)
+    {
+        _requiredBytes = size - _position + 1;
+        return Incomplete;
+    }
+
+    const char* lineFeed = static_cast<const char*>(memchr(data + position, '\n', size - position));
+
+    if(lineFeed == NULL)
+    {
+        _requiredBytes = size - _position + 1;
+        return Incomplete;
+    }
+
+    int lineFeedPosition = lineFeed - data;
+
+    if(lineFeedPosition == position || data[lineFeedPosition - 1] != '\r')
+        return ProtocolError;
+
+    line = data + position + 1;
+    length = lineFeedPosition - 1 - (position + 1);
+    next = lineFeedPosition + 1;
+
+    return length >= 0 ? Complete : ProtocolError;
+}
+
+/*!
+ * \brief Parses the decimal integer in the \a{length} characters at \a{data} into \a{result}. Returns false if the text is not a valid
+ * integer.
+ */
+bool RespParser::parseInteger(const char *data, int length, qlonglong &result)
+{
+    if(length <= 0)
+        return false;
+
+    bool negative = (data[0] == '-');
+    int i = negative ? 1 : 0;
+
+    if(i == length)
+        return false;
+
+    result = 0;
+
+    for(; i < length; ++i)
+    {
+        if(data[i] < '0' || data[i] > '9')
+            return false;
+
+        result = result * 10 + (data[i] - '0');
+    }
+
+    if(negative)
+        result = -result;
+
+    return true;
+}
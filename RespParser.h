@@ -0,0 +1,60 @@
+#ifndef RESPPARSER_H
+#define RESPPARSER_H
+
+#include <QVariant>
+#include <QVarLengthArray>
+#include "StreamParser.h"
+
+class RespParser : public StreamParser
+{
+public:
+
+    /** Result of an attempt to parse the next reply from the buffer. */
+    enum Status
+    {
+        Complete,
+        Incomplete,
+        ProtocolError
+    };
+
+    /** Flat reply elements, as views into the parser's buffer. Pub/sub messages have at most four elements. */
+    typedef QVarLengthArray<QByteArray, 4> Elements;
+
+    /** Constructor. */
+    RespParser();
+
+    /** Parses the next complete reply into a QVariant (strings, integers, nested lists). */
+    Status parseReply(QVariant& value, bool& isError);
+
+    /** Parses the next complete reply as a flat list of views into the buffer, without copying. Nested arrays are flattened in place. */
+    Status parseFlatReply(Elements& elements, bool& isError);
+
+    /** Converts the contents of a bulk string to a QString, or to a QByteArray if it holds binary data (see bulkValue() docs). */
+    static QVariant bulkValue(const char* data, int length);
+
+protected:
+
+    void resetState();
+
+private:
+
+    /** Parses a single value at position, advancing position past it on success. */
+    Status parseValue(int& position, QVariant& value, bool& isError);
+
+    /** Parses an array at position, appending its (flattened) elements, advancing position past it on success. */
+    Status parseFlatArray(int& position, Elements& elements);
+
+    /** Parses a single non-array element at position as a view into the buffer, advancing position past it on success. */
+    Status parseElement(int& position, QByteArray& element, bool& isError);
+
+    /** Locates the CRLF-terminated header line of the element at position. */
+    Status readLine(int position, const char*& line, int& length, int& next);
+
+    /** Parses a decimal integer from the given characters. */
+    static bool parseInteger(const char* data, int length, qlonglong& result);
+
+    /** Number of unconsumed bytes required before another parse attempt can succeed. */
+    int _requiredBytes;
+};
+
+#endif // RESPPARSER_H
@@ -0,0 +1,558 @@
+#include "RespTransport.h"
+#include "RedisLogging.h"
+
+/*!
+    \class RespTransport
+    \inmodule RedisInterface
+    \brief A RedisTransport that speaks the native Redis protocol (RESP) directly to redis-server.
+
+    Two persistent TCP connections are opened to the server: one for ordinary request/response commands, and one dedicated to
+    \c{SUBSCRIBE}/\c{PSUBSCRIBE} (since a Redis connection in pub/sub mode can no longer issue ordinary commands). Replies on the command
+    connection are matched to their requests in the order in which the commands were sent.
+
+    Each batch of queued commands is pipelined: it is encoded into a single buffer and written to the command connection at once, so a
+    batch costs one round trip regardless of its size. Transactions are wrapped in \c{MULTI}/\c{EXEC} within the pipeline.
+
+    Each connection has its own incremental RespParser, so any number of replies (or a partial reply) delivered in a single read are
+    handled correctly. Pub/sub messages are framed as views into the parser's buffer. Channel and pattern names are interned: each
+    distinct name is decoded once and the same shared QString is handed out for every later message, so the only per-message copy is of
+    the payload.
+
+    Client-side caching is supported through Redis 6 key tracking (see enableKeyTracking()). The subscriber connection learns its
+    client ID as part of its handshake; tracking is then enabled on the command connection with invalidations redirected to the subscriber
+    connection's \c{__redis__:invalidate} channel, from which they are reported by \c{keysInvalidated()}.
+
+    A lost connection is re-established automatically, with jittered exponential backoff between attempts. A new subscriber connection
+    replays every subscription as a single \c{SUBSCRIBE} and a single \c{PSUBSCRIBE}, in the same write as its handshake, and
+    \c{resubscribed()} is emitted once the server has confirmed them all. Commands issued while the command connection is down are held
+    back and sent once it is re-established; commands in flight when it was lost fail.
+
+    The server URL has the form \c{redis://[:password@]host[:port][/database]}. If a password is given, \c{AUTH} is sent on connection;
+    if a database number is given, \c{SELECT} is sent on connection.
+
+    \sa RedisTransport, WebdisTransport
+*/
+
+/*!
+ * \brief Constructor. Connects to the Redis server described by \a{serverUrl}.
+ */
+RespTransport::RespTransport(QUrl serverUrl, QObject *parent) :
+    RedisTransport(parent),
+    _host(serverUrl.host()),
+    _port(serverUrl.port(6379)),
+    _password(serverUrl.password().toUtf8()),
+    _database(serverUrl.path().mid(1).toInt()),
+    _commandSocket(new QTcpSocket(this)),
+    _subscriberSocket(new QTcpSocket(this)),
+    _subscriberConnectedBefore(false),
+    _pendingResubscriptions(0),
+    _reconnectTimer(new QTimer(this)),
+    _keyTrackingRequested(false),
+    _subscriberClientId(-1)
+{
+    _reconnectTimer->setSingleShot(true);
+    connect(_reconnectTimer, SIGNAL(timeout()), this, SLOT(reconnect()));
+
+    connect(_commandSocket, SIGNAL(connected()), this, SLOT(handleCommandSocketConnected()));
+    connect(_commandSocket, SIGNAL(readyRead()), this, SLOT(handleCommandSocketData()));
+    connect(_commandSocket, SIGNAL(disconnected()), this, SLOT(handleCommandSocketDisconnected()));
+    connect(_commandSocket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(handleSocketError(QAbstractSocket::SocketError)));
+
+    connect(_subscriberSocket, SIGNAL(connected()), this, SLOT(handleSubscriberSocketConnected()));
+    connect(_subscriberSocket, SIGNAL(readyRead()), this, SLOT(handleSubscriberSocketData()));
+    connect(_subscriberSocket, SIGNAL(disconnected()), this, SLOT(handleSubscriberSocketDisconnected()));
+    connect(_subscriberSocket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(handleSocketError(QAbstractSocket::SocketError)));
+    connect(_commandSocket, SIGNAL(bytesWritten(qint64)), this, SLOT(handleSocketBytesWritten(qint64)));
+    connect(_subscriberSocket, SIGNAL(bytesWritten(qint64)), this, SLOT(handleSocketBytesWritten(qint64)));
+
+    // Disable Nagle's algorithm, since commands are small and latency-sensitive.
+    _commandSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    _subscriberSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    _commandSocket->connectToHost(_host, _port);
+    _subscriberSocket->connectToHost(_host, _port);
+}
+
+/*!
+ * \brief Pipelines \a{batch} on the command connection as a single write. Transactions are wrapped in \c{MULTI}/\c{EXEC}; the
+ * intermediate \c{OK}/\c{QUEUED} replies are discarded and the transaction's reply receives the result of \c{EXEC}.
+ */
+void RespTransport::writeBatch(const QList<QueuedCommand> &batch)
+{
+    QByteArray data;
+
+    foreach(const QueuedCommand& queuedCommand, batch)
+    {
+        if(queuedCommand.transaction)
+        {
+            data.append(encodeCommand(QList<QByteArray>() << "MULTI"));
+            _pendingReplies.enqueue(QPointer<RedisReply>());
+
+            foreach(const QList<QByteArray>& command, queuedCommand.commands)
+            {
+                data.append(encodeCommand(command));
+                _pendingReplies.enqueue(QPointer<RedisReply>());
+            }
+
+            data.append(encodeCommand(QList<QByteArray>() << "EXEC"));
+            _pendingReplies.enqueue(queuedCommand.reply);
+        }
+        else
+        {
+            data.append(encodeCommand(queuedCommand.commands.first()));
+            _pendingReplies.enqueue(queuedCommand.reply);
+        }
+    }
+
+    write(_commandSocket, _pendingCommandData, data);
+}
+
+/*!
+ * \brief Subscribes to \a{channel} on the subscriber connection, using \c{PSUBSCRIBE} if it contains wildcards.
+ */
+void RespTransport::subscribe(const QString &channel)
+{
+    if(_subscriptions.contains(channel))
+        return;
+
+    QList<QByteArray> command;
+    command << (isPattern(channel) ? "PSUBSCRIBE" : "SUBSCRIBE") << channel.toUtf8();
+    write(_subscriberSocket, _pendingSubscriberData, encodeCommand(command));
+
+    _subscriptions.insert(channel);
+}
+
+/*!
+ * \brief Unsubscribes from \a{channel} on the subscriber connection, using \c{PUNSUBSCRIBE} if it contains wildcards.
+ */
+void RespTransport::unsubscribe(const QString &channel)
+{
+    if(!_subscriptions.remove(channel))
+        return;
+
+    QList<QByteArray> command;
+    command << (isPattern(channel) ? "PUNSUBSCRIBE" : "UNSUBSCRIBE") << channel.toUtf8();
+    write(_subscriberSocket, _pendingSubscriberData, encodeCommand(command));
+}
+
+/*!
+ * \brief Returns true, since RESP bulk strings may hold arbitrary bytes.
+ */
+bool RespTransport::isBinarySafe() const
+{
+    return true;
+}
+
+/*!
+ * \brief Asks the server to track the keys read on the command connection. Tracking starts once the subscriber connection's client ID
+ * is known, and is restarted automatically whenever the subscriber connection is re-established.
+ */
+void RespTransport::enableKeyTracking()
+{
+    if(_keyTrackingRequested)
+        return;
+
+    _keyTrackingRequested = true;
+
+    if(_subscriberClientId >= 0)
+        startKeyTracking();
+}
+
+/*!
+ * \brief Subscribes the subscriber connection to the invalidation channel and enables \c{CLIENT TRACKING} on the command connection,
+ * redirected to it. Since commands on the command connection are executed in order, every \c{GET} queued after this point is tracked,
+ * so tracking is reported as active immediately.
+ */
+void RespTransport::startKeyTracking()
+{
+    if(isKeyTrackingActive())
+        return;
+
+    write(_subscriberSocket, _pendingSubscriberData, encodeCommand(QList<QByteArray>() << "SUBSCRIBE" << "__redis__:invalidate"));
+
+    RedisReply* reply = sendCommand(QList<QByteArray>() << "CLIENT" << "TRACKING" << "on" << "REDIRECT" << QByteArray::number(_subscriberClientId));
+    connect(reply, SIGNAL(finished()), this, SLOT(handleKeyTrackingReply()));
+
+    setKeyTrackingActive(true);
+}
+
+/*!
+ * \brief Handles the reply to \c{CLIENT TRACKING}. If the server refused (eg. it predates Redis 6), tracking is abandoned.
+ */
+void RespTransport::handleKeyTrackingReply()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    if(reply->isError())
+    {
+        std::cerr << "[RespTransport] Key tracking unavailable: " << reply->errorString().toStdString() << std::endl;
+
+        _keyTrackingRequested = false;
+        setKeyTrackingActive(false);
+    }
+
+    reply->deleteLater();
+}
+
+/*!
+ * \brief Encodes \a{command} as a RESP array of bulk strings, eg. \c{*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n}.
+ */
+QByteArray RespTransport::encodeCommand(const QList<QByteArray> &command)
+{
+    QByteArray data;
+    data.reserve(16 + command.size() * 16);
+
+    data.append('*').append(QByteArray::number(command.size())).append("\r\n");
+
+    foreach(const QByteArray& argument, command)
+        data.append('$').append(QByteArray::number(argument.size())).append("\r\n").append(argument).append("\r\n");
+
+    return data;
+}
+
+/*!
+ * \brief Sends the connection handshake followed by any commands issued while connecting.
+ */
+void RespTransport::handleCommandSocketConnected()
+{
+    QByteArray handshakeData = handshake();
+
+    // Handshake replies are discarded, and precede the replies to any commands already queued.
+    int handshakeCommands = (_password.isEmpty() ? 0 : 1) + (_database != 0 ? 1 : 0);
+    for(int i = 0; i < handshakeCommands; ++i)
+        _pendingReplies.prepend(QPointer<RedisReply>());
+
+    _commandSocket->write(handshakeData + _pendingCommandData);
+    _pendingCommandData.clear();
+
+    updateConnectionState();
+}
+
+/*!
+ * \brief Parses all complete replies received on the command connection, finishing the corresponding RedisReply objects in order.
+ */
+void RespTransport::handleCommandSocketData()
+{
+    recordBytesRead(_commandParser.readFrom(_commandSocket));
+
+    QVariant value;
+    bool isError;
+    RespParser::Status status;
+
+    while((status = _commandParser.parseReply(value, isError)) == RespParser::Complete)
+    {
+        if(_pendingReplies.isEmpty())
+        {
+            std::cerr << "[RespTransport] handleCommandSocketData(): Received a reply with no pending request!" << std::endl;
+            continue;
+        }
+
+        QPointer<RedisReply> reply = _pendingReplies.dequeue();
+
+        if(reply)
+        {
+            if(isError)
+                reply->setError(value.toString());
+            else
+                reply->setValue(value);
+
+            reply->finish();
+        }
+    }
+
+    if(status == RespParser::ProtocolError)
+    {
+        std::cerr << "[RespTransport] handleCommandSocketData(): Protocol error, dropping connection!" << std::endl;
+        _commandParser.clear();
+        _commandSocket->abort();
+    }
+}
+
+/*!
+ * \brief Fails all replies still waiting on the command connection.
+ */
+void RespTransport::handleCommandSocketDisconnected()
+{
+    // Tracking is a property of the connection, so it is lost with it.
+    setKeyTrackingActive(false);
+
+    while(!_pendingReplies.isEmpty())
+    {
+        QPointer<RedisReply> reply = _pendingReplies.dequeue();
+
+        if(reply)
+        {
+            reply->setError("Connection to Redis server lost!");
+            reply->finish();
+        }
+    }
+
+    _commandParser.clear();
+
+    updateConnectionState();
+    scheduleReconnect();
+}
+
+/*!
+ * \brief Sends the connection handshake and a request for the connection's client ID (needed to redirect key tracking
+ * invalidations to it), followed by every current subscription. Subscription changes made while connecting are already reflected in
+ * the subscription set, so the buffered commands are superseded.
+ */
+void RespTransport::handleSubscriberSocketConnected()
+{
+    _subscriberSocket->write(handshake() + encodeCommand(QList<QByteArray>() << "CLIENT" << "ID") + resubscription());
+    _pendingSubscriberData.clear();
+
+    if(_subscriberConnectedBefore)
+    {
+        _pendingResubscriptions = _subscriptions.size();
+
+        if(_pendingResubscriptions == 0)
+            emit resubscribed();
+    }
+
+    _subscriberConnectedBefore = true;
+    updateConnectionState();
+}
+
+/*!
+ * \brief Parses all complete messages received on the subscriber connection and dispatches them.
+ */
+void RespTransport::handleSubscriberSocketData()
+{
+    recordBytesRead(_subscriberParser.readFrom(_subscriberSocket));
+
+    RespParser::Elements message;
+    bool isError;
+    RespParser::Status status;
+
+    while((status = _subscriberParser.parseFlatReply(message, isError)) == RespParser::Complete)
+    {
+        if(isError)
+        {
+            std::cerr << "[RespTransport] handleSubscriberSocketData(): Error: " << QString::fromUtf8(message.at(0)).toStdString() << std::endl;
+        }
+        else if(message.size() == 1)
+        {
+            // The only integer reply on this connection is to CLIENT ID (the handshake replies are all "OK").
+            bool isClientId;
+            qlonglong clientId = message.at(0).toLongLong(&isClientId);
+
+            if(isClientId)
+            {
+                _subscriberClientId = clientId;
+
+                if(_keyTrackingRequested)
+                    startKeyTracking();
+            }
+        }
+        else if(_pendingResubscriptions > 0 && (message.at(0) == "subscribe" || message.at(0) == "psubscribe"))
+        {
+            if(--_pendingResubscriptions == 0)
+                emit resubscribed();
+        }
+        else
+        {
+            dispatchMessage(message);
+        }
+    }
+
+    if(status == RespParser::ProtocolError)
+    {
+        std::cerr << "[RespTransport] handleSubscriberSocketData(): Protocol error, dropping connection!" << std::endl;
+        _subscriberParser.clear();
+        _subscriberSocket->abort();
+    }
+}
+
+/*!
+ * \brief Reports the loss of the subscriber connection.
+ */
+void RespTransport::handleSubscriberSocketDisconnected()
+{
+    _subscriberParser.clear();
+
+    // Invalidations can no longer be received, so any tracked values may go stale.
+    _subscriberClientId = -1;
+    setKeyTrackingActive(false);
+
+    _pendingResubscriptions = 0;
+
+    if(!_subscriptions.isEmpty())
+        std::cerr << "[RespTransport] Subscriber connection lost, resubscribing to " << _subscriptions.size() << " channels once reconnected." << std::endl;
+
+    updateConnectionState();
+    scheduleReconnect();
+}
+
+/*!
+ * \brief Reports socket errors. A failed connection attempt (which, unlike the loss of an established connection, is not followed by
+ * \c{disconnected()}) schedules another attempt.
+ */
+void RespTransport::handleSocketError(QAbstractSocket::SocketError error)
+{
+    Q_UNUSED(error);
+
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if(socket == NULL)
+        return;
+
+    std::cerr << "[RespTransport] Socket error: " << socket->errorString().toStdString() << std::endl;
+
+    if(socket->state() == QAbstractSocket::UnconnectedState)
+        scheduleReconnect();
+}
+
+/*!
+ * \brief Records \a{bytes} written to either connection.
+ */
+void RespTransport::handleSocketBytesWritten(qint64 bytes)
+{
+    recordBytesWritten(bytes);
+}
+
+/*!
+ * \brief Starts connecting whichever connections are down.
+ */
+void RespTransport::reconnect()
+{
+    qCDebug(lcRedisTransport) << "Reconnecting to" << _host << "port" << _port;
+
+    if(_commandSocket->state() == QAbstractSocket::UnconnectedState)
+        _commandSocket->connectToHost(_host, _port);
+
+    if(_subscriberSocket->state() == QAbstractSocket::UnconnectedState)
+        _subscriberSocket->connectToHost(_host, _port);
+}
+
+/*!
+ * \brief Schedules reconnect() after the backoff delay (see nextReconnectDelay()), unless an attempt is already scheduled.
+ */
+void RespTransport::scheduleReconnect()
+{
+    if(_reconnectTimer->isActive())
+        return;
+
+    _reconnectTimer->start(nextReconnectDelay());
+}
+
+/*!
+ * \brief Reports the connection as \c{Connected} once both connections are established (resetting the backoff delay), or as
+ * \c{Reconnecting} if either is lost after that.
+ */
+void RespTransport::updateConnectionState()
+{
+    if(_commandSocket->state() == QAbstractSocket::ConnectedState && _subscriberSocket->state() == QAbstractSocket::ConnectedState)
+    {
+        resetReconnectDelay();
+        setConnectionState(Connected);
+    }
+    else if(connectionState() == Connected)
+    {
+        setConnectionState(Reconnecting);
+    }
+}
+
+/*!
+ * \brief Returns the commands re-establishing every subscription: one \c{SUBSCRIBE} carrying every channel, and one \c{PSUBSCRIBE}
+ * carrying every pattern.
+ */
+QByteArray RespTransport::resubscription() const
+{
+    QList<QByteArray> subscribeCommand, psubscribeCommand;
+    subscribeCommand << "SUBSCRIBE";
+    psubscribeCommand << "PSUBSCRIBE";
+
+    foreach(const QString& channel, _subscriptions)
+    {
+        if(isPattern(channel))
+            psubscribeCommand << channel.toUtf8();
+        else
+            subscribeCommand << channel.toUtf8();
+    }
+
+    QByteArray data;
+
+    if(subscribeCommand.size() > 1)
+        data.append(encodeCommand(subscribeCommand));
+
+    if(psubscribeCommand.size() > 1)
+        data.append(encodeCommand(psubscribeCommand));
+
+    return data;
+}
+
+/*!
+ * \brief Returns the \c{AUTH}/\c{SELECT} commands required at the start of every connection (if any).
+ */
+QByteArray RespTransport::handshake() const
+{
+    QByteArray data;
+
+    if(!_password.isEmpty())
+        data.append(encodeCommand(QList<QByteArray>() << "AUTH" << _password));
+
+    if(_database != 0)
+        data.append(encodeCommand(QList<QByteArray>() << "SELECT" << QByteArray::number(_database)));
+
+    return data;
+}
+
+/*!
+ * \brief Writes \a{data} to \a{socket} if it is connected, otherwise appends it to \a{pendingData} to be written once it connects.
+ */
+void RespTransport::write(QTcpSocket *socket, QByteArray &pendingData, const QByteArray &data)
+{
+    if(socket->state() == QAbstractSocket::ConnectedState)
+        socket->write(data);
+    else
+        pendingData.append(data);
+}
+
+/*!
+ * \brief Reports a pub/sub \a{message} received on the subscriber connection. Subscription confirmations
+ * are ignored.
+ */
+void RespTransport::dispatchMessage(const RespParser::Elements &message)
+{
+    // Message format is ["message", channel, payload] or ["pmessage", pattern, channel, payload]. Tracking invalidations are
+    // ["message", "__redis__:invalidate", key...] once flattened, with no keys if every key was invalidated (eg. by FLUSHALL).
+    if(message.size() >= 2 && message.at(1) == "__redis__:invalidate" && message.at(0) == "message")
+    {
+        QStringList keys;
+        for(int i = 2; i < message.size(); ++i)
+            if(!message.at(i).isEmpty())
+                keys.append(QString::fromUtf8(message.at(i)));
+
+        emit keysInvalidated(keys);
+    }
+    else if(message.size() == 3 && message.at(0) == "message")
+    {
+        QString channel = internName(message.at(1));
+        reportMessage(channel, channel, RespParser::bulkValue(message.at(2).constData(), message.at(2).size()));
+    }
+    else if(message.size() == 4 && message.at(0) == "pmessage")
+    {
+        reportMessage(internName(message.at(1)), internName(message.at(2)), RespParser::bulkValue(message.at(3).constData(), message.at(3).size()));
+    }
+}
+
+/*!
+ * \brief Returns the decoded form of the channel or pattern \a{name} (a view into the parser's buffer), shared with every previous
+ * message on the same channel. The cache is simply dropped if it grows beyond \c{MaxInternedNames} distinct names, which only happens
+ * when pattern subscriptions match an unbounded set of channels.
+ */
+QString RespTransport::internName(const QByteArray &name)
+{
+    QHash<QByteArray, QString>::const_iterator interned = _internedNames.constFind(name);
+    if(interned != _internedNames.constEnd())
+        return interned.value();
+
+    if(_internedNames.size() >= MaxInternedNames)
+        _internedNames.clear();
+
+    // Deep-copy the key, since name is only a view into the parser's buffer.
+    return _internedNames.insert(QByteArray(name.constData(), name.size()), QString::fromUtf8(name)).value();
+}
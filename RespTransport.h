@@ -0,0 +1,129 @@
+#ifndef RESPTRANSPORT_H
+#define RESPTRANSPORT_H
+
+#include <QTcpSocket>
+#include <QQueue>
+#include <QSet>
+#include <QHash>
+#include <QPointer>
+#include <QVariant>
+#include <iostream>
+#include "RedisTransport.h"
+#include "RespParser.h"
+
+class RespTransport : public RedisTransport
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. Takes a URL of the form "redis://[:password@]host[:port][/database]". */
+    RespTransport(QUrl serverUrl, QObject* parent = 0);
+
+    void subscribe(const QString& channel);
+    void unsubscribe(const QString& channel);
+    void enableKeyTracking();
+    bool isBinarySafe() const;
+
+    /** Encodes the given command as a RESP multi-bulk request. */
+    static QByteArray encodeCommand(const QList<QByteArray>& command);
+
+protected:
+
+    void writeBatch(const QList<QueuedCommand>& batch);
+
+private slots:
+
+    /** Private handler slots for socket events. */
+    void handleCommandSocketConnected();
+    void handleCommandSocketData();
+    void handleCommandSocketDisconnected();
+    void handleSubscriberSocketConnected();
+    void handleSubscriberSocketData();
+    void handleSubscriberSocketDisconnected();
+    void handleSocketError(QAbstractSocket::SocketError error);
+    void handleSocketBytesWritten(qint64 bytes);
+    void handleKeyTrackingReply();
+
+    /** Reconnects whichever connections have been lost. */
+    void reconnect();
+
+private:
+
+    /** Returns the AUTH/SELECT commands to be sent first on every new connection. */
+    QByteArray handshake() const;
+
+    /** Returns the SUBSCRIBE/PSUBSCRIBE commands re-establishing every subscription on a new subscriber connection. */
+    QByteArray resubscription() const;
+
+    /** Schedules a reconnection attempt after the backoff delay, unless one is already scheduled. */
+    void scheduleReconnect();
+
+    /** Updates the connection state from the states of both connections. */
+    void updateConnectionState();
+
+    /** Writes data to the given socket, or buffers it until the socket has connected. */
+    void write(QTcpSocket* socket, QByteArray& pendingData, const QByteArray& data);
+
+    /** Enables CLIENT TRACKING on the command connection, redirecting invalidations to the subscriber connection. */
+    void startKeyTracking();
+
+    /** Reports a pub/sub message received on the subscriber connection. */
+    void dispatchMessage(const RespParser::Elements& message);
+
+    /** Returns the shared QString for the given channel/pattern name, decoding and caching it on first use. */
+    QString internName(const QByteArray& name);
+
+    /** Maximum number of distinct channel/pattern names cached by internName(). */
+    static const int MaxInternedNames = 4096;
+
+    /** Connection parameters parsed from the server URL. */
+    QString _host;
+    quint16 _port;
+    QByteArray _password;
+    int _database;
+
+    /** Connection used for ordinary request/response commands. */
+    QTcpSocket* _commandSocket;
+
+    /** Incremental parser for replies received on the command connection. */
+    RespParser _commandParser;
+
+    /** Commands written before the command connection was established. */
+    QByteArray _pendingCommandData;
+
+    /** Replies awaiting a response, in the order their commands were sent. */
+    QQueue<QPointer<RedisReply> > _pendingReplies;
+
+    /** Connection dedicated to SUBSCRIBE/PSUBSCRIBE (which puts a connection into pub/sub mode). */
+    QTcpSocket* _subscriberSocket;
+
+    /** Incremental parser for messages received on the subscriber connection. */
+    RespParser _subscriberParser;
+
+    /** Subscription commands written before the subscriber connection was established. */
+    QByteArray _pendingSubscriberData;
+
+    /** Channels/patterns currently subscribed to on the subscriber connection. */
+    QSet<QString> _subscriptions;
+
+    /** Whether the subscriber connection has been established before (so that establishing it again is a reconnection). */
+    bool _subscriberConnectedBefore;
+
+    /** Number of subscription confirmations still expected after resubscribing on a new subscriber connection. */
+    int _pendingResubscriptions;
+
+    /** Timer used to delay reconnection attempts. */
+    QTimer* _reconnectTimer;
+
+    /** Whether key tracking has been requested with enableKeyTracking(). */
+    bool _keyTrackingRequested;
+
+    /** Server-assigned ID of the subscriber connection (the target of tracking invalidations), or -1 if not yet known. */
+    qlonglong _subscriberClientId;
+
+    /** Decoded channel/pattern names seen on the subscriber connection, keyed by their raw bytes. */
+    QHash<QByteArray, QString> _internedNames;
+};
+
+#endif // RESPTRANSPORT_H
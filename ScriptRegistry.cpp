@@ -0,0 +1,231 @@
+#include "ScriptRegistry.h"
+#include "RedisLogging.h"
+#include <QCryptographicHash>
+#include <iostream>
+
+/*!
+    \class ScriptRegistry
+    \inmodule RedisInterface
+    \brief Holds named Lua scripts, loaded into Redis once and invoked by their SHA1 digest.
+
+    A compound operation (eg. setting a value, bumping a version counter and publishing a notification) made of separate commands costs
+    a round trip per step that depends on the last, and is not atomic. Run as a Lua script, it takes a single round trip, and nothing
+    else runs on the server in the middle of it. Sending the script's source with every \c{EVAL} would cost its full size on the wire
+    every time, so registered scripts are loaded into the server's script cache (with \c{SCRIPT LOAD}) when they are registered, and
+    invoked with \c{EVALSHA}, which only carries their 40-byte digest. The digest is computed locally, so scripts can be invoked straight
+    away, without waiting for the load to complete.
+
+    The server's script cache is emptied when it restarts (or by \c{SCRIPT FLUSH}), so every script is loaded again whenever the
+    connection is re-established. An invocation that still finds its script missing (\c{NOSCRIPT}) is sent once more with \c{EVAL},
+    which also puts the script back into the cache; the caller only sees the result of the second attempt.
+
+    \sa RedisInterface::registerScript(), RedisInterface::runScript()
+*/
+
+/*!
+ * \brief Constructor. Scripts are loaded and invoked through \a{transport}, and loaded again whenever its connection is re-established.
+ */
+ScriptRegistry::ScriptRegistry(RedisTransport *transport, QObject *parent) :
+    QObject(parent),
+    _transport(transport),
+    _connectionState(transport->connectionState()),
+    _invocationCount(0),
+    _fallbacks(0),
+    _loads(0)
+{
+    connect(_transport, SIGNAL(connectionStateChanged(RedisTransport::ConnectionState)), this, SLOT(handleConnectionStateChanged(RedisTransport::ConnectionState)));
+}
+
+/*!
+ * \brief Registers the Lua \a{source} under \a{name}, replacing any script already registered under it, and loads it into the server.
+ */
+void ScriptRegistry::registerScript(const QString &name, const QByteArray &source)
+{
+    Script script;
+    script.source = source;
+    script.sha = QCryptographicHash::hash(source, QCryptographicHash::Sha1).toHex();
+
+    _scripts.insert(name, script);
+    load(name, script);
+
+    qCDebug(lcRedisInterface) << "Registered script" << name << "as" << script.sha;
+}
+
+/*!
+ * \brief Removes the script registered under \a{name}. It is left in the server's script cache.
+ */
+void ScriptRegistry::unregisterScript(const QString &name)
+{
+    _scripts.remove(name);
+}
+
+/*!
+ * \brief Returns true if a script is registered under \a{name}.
+ */
+bool ScriptRegistry::contains(const QString &name) const
+{
+    return _scripts.contains(name);
+}
+
+/*!
+ * \brief Returns the names of the registered scripts.
+ */
+QStringList ScriptRegistry::names() const
+{
+    return _scripts.keys();
+}
+
+/*!
+ * \brief Returns the SHA1 digest (in hex) of the script registered under \a{name}, or an empty array if there is none.
+ */
+QByteArray ScriptRegistry::sha(const QString &name) const
+{
+    return _scripts.value(name).sha;
+}
+
+/*!
+ * \brief Invokes the script registered under \a{name} with \c{EVALSHA}, passing \a{keys} as \c{KEYS} and \a{arguments} as \c{ARGV}.
+ * Returns a reply holding the script's result, which the caller owns, or NULL if no script is registered under \a{name}. If the server
+ * doesn't hold the script, it is sent again with \c{EVAL} before the reply completes.
+ */
+RedisReply* ScriptRegistry::invoke(const QString &name, const QList<QByteArray> &keys, const QList<QByteArray> &arguments)
+{
+    if(!_scripts.contains(name))
+        return NULL;
+
+    Invocation invocation;
+    invocation.reply = new RedisReply();
+    invocation.name = name;
+    invocation.parameters << QByteArray::number(keys.size()) << keys << arguments;
+    invocation.fallback = false;
+
+    send(invocation);
+    ++_invocationCount;
+
+    return invocation.reply;
+}
+
+/*!
+ * \brief Loads every registered script into the server again. The loads are queued together, so they are sent in a single batch.
+ */
+void ScriptRegistry::reload()
+{
+    for(QHash<QString, Script>::const_iterator iter = _scripts.constBegin(); iter != _scripts.constEnd(); ++iter)
+        load(iter.key(), iter.value());
+}
+
+/*!
+ * \brief Returns counters describing the scripts' use: the number of registered \c{scripts}, \c{invocations} made, \c{fallbacks} to
+ * \c{EVAL} after \c{NOSCRIPT}, and \c{loads} sent.
+ */
+QVariantMap ScriptRegistry::statistics() const
+{
+    QVariantMap statistics;
+    statistics.insert("scripts", _scripts.size());
+    statistics.insert("invocations", _invocationCount);
+    statistics.insert("fallbacks", _fallbacks);
+    statistics.insert("loads", _loads);
+    return statistics;
+}
+
+/*!
+ * \brief Handles the reply to an invocation, copying its result into the caller's reply. A \c{NOSCRIPT} error is not reported to the
+ * caller; the invocation is sent again with \c{EVAL} instead.
+ */
+void ScriptRegistry::handleInvocationFinished()
+{
+    RedisReply* transportReply = qobject_cast<RedisReply*>(sender());
+    if(transportReply == NULL)
+        return;
+
+    transportReply->deleteLater();
+
+    Invocation invocation = _invocations.take(transportReply);
+    if(!invocation.reply)
+        return;
+
+    if(transportReply->isError() && transportReply->errorString().contains("NOSCRIPT") && !invocation.fallback)
+    {
+        if(_scripts.contains(invocation.name))
+        {
+            qCDebug(lcRedisInterface) << "Script" << invocation.name << "missing from the server, falling back to EVAL";
+
+            invocation.fallback = true;
+            send(invocation);
+            ++_fallbacks;
+            return;
+        }
+    }
+
+    if(transportReply->isError())
+        invocation.reply->setError(transportReply->errorString());
+    else
+        invocation.reply->setValue(transportReply->value());
+
+    invocation.reply->finish();
+}
+
+/*!
+ * \brief Handles the reply to a \c{SCRIPT LOAD}, reporting any error (such as a script that doesn't compile).
+ */
+void ScriptRegistry::handleLoadFinished()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    if(reply->isError())
+        std::cerr << "[ScriptRegistry] handleLoadFinished(): Failed to load script " << reply->property("scriptName").toString().toStdString() << ": " << reply->errorString().toStdString() << std::endl;
+}
+
+/*!
+ * \brief Loads every script again once the connection has been re-established, since the server may have restarted (emptying its
+ * script cache) in the meantime.
+ */
+void ScriptRegistry::handleConnectionStateChanged(RedisTransport::ConnectionState state)
+{
+    bool reconnected = state == RedisTransport::Connected && _connectionState == RedisTransport::Reconnecting;
+    _connectionState = state;
+
+    if(reconnected && !_scripts.isEmpty())
+    {
+        qCDebug(lcRedisInterface) << "Reconnected, reloading" << _scripts.size() << "scripts";
+        reload();
+    }
+}
+
+/*!
+ * \brief Sends \a{invocation} with \c{EVALSHA}, or if it is a fallback, with \c{EVAL} and the script's source.
+ */
+void ScriptRegistry::send(const Invocation &invocation)
+{
+    Script script = _scripts.value(invocation.name);
+
+    QList<QByteArray> command;
+
+    if(invocation.fallback)
+        command << "EVAL" << script.source;
+    else
+        command << "EVALSHA" << script.sha;
+
+    command << invocation.parameters;
+
+    RedisReply* transportReply = _transport->sendCommand(command);
+    connect(transportReply, SIGNAL(finished()), this, SLOT(handleInvocationFinished()));
+
+    _invocations.insert(transportReply, invocation);
+}
+
+/*!
+ * \brief Sends \c{SCRIPT LOAD} for \a{script}, registered under \a{name}.
+ */
+void ScriptRegistry::load(const QString &name, const Script &script)
+{
+    RedisReply* reply = _transport->sendCommand(QList<QByteArray>() << "SCRIPT" << "LOAD" << script.source);
+    reply->setProperty("scriptName", name);
+    connect(reply, SIGNAL(finished()), this, SLOT(handleLoadFinished()));
+
+    ++_loads;
+}
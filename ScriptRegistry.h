@@ -0,0 +1,94 @@
+#ifndef SCRIPTREGISTRY_H
+#define SCRIPTREGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QStringList>
+#include <QVariantMap>
+#include "RedisTransport.h"
+
+class ScriptRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. Scripts are loaded and invoked through the given transport. */
+    explicit ScriptRegistry(RedisTransport* transport, QObject* parent = 0);
+
+    /** Registers the given Lua source under the given name (replacing any script registered under it), and loads it into the server. */
+    void registerScript(const QString& name, const QByteArray& source);
+
+    /** Removes the script registered under the given name. */
+    void unregisterScript(const QString& name);
+
+    /** Returns true if a script is registered under the given name. */
+    bool contains(const QString& name) const;
+
+    /** Returns the names of the registered scripts. */
+    QStringList names() const;
+
+    /** Returns the SHA1 digest (in hex) by which the given script is invoked, or an empty array if there is none. */
+    QByteArray sha(const QString& name) const;
+
+    /** Invokes the named script with EVALSHA, passing the given keys (KEYS) and arguments (ARGV). Falls back to EVAL (reloading the
+     *  script) if the server doesn't hold it. Returns NULL if no script is registered under the name; otherwise, the caller owns the reply. */
+    RedisReply* invoke(const QString& name, const QList<QByteArray>& keys, const QList<QByteArray>& arguments);
+
+    /** Loads every registered script into the server again (eg. after it has restarted). */
+    void reload();
+
+    /** Returns counters describing the scripts' use (scripts, invocations, fallbacks, loads). */
+    QVariantMap statistics() const;
+
+private slots:
+
+    /** Private handler slots for replies and connection events. */
+    void handleInvocationFinished();
+    void handleLoadFinished();
+    void handleConnectionStateChanged(RedisTransport::ConnectionState state);
+
+private:
+
+    /** A registered script. */
+    struct Script
+    {
+        QByteArray source;
+        QByteArray sha;
+    };
+
+    /** A script invocation in flight, with the reply handed to the caller and what is needed to send it again with EVAL. */
+    struct Invocation
+    {
+        QPointer<RedisReply> reply;
+        QString name;
+        QList<QByteArray> parameters;
+        bool fallback;
+    };
+
+    /** Sends the given invocation, with EVALSHA (or, for a fallback, EVAL). */
+    void send(const Invocation& invocation);
+
+    /** Sends SCRIPT LOAD for the given script, registered under the given name. */
+    void load(const QString& name, const Script& script);
+
+    /** Transport carrying the scripts. */
+    RedisTransport* _transport;
+
+    /** Registered scripts, by name. */
+    QHash<QString, Script> _scripts;
+
+    /** Invocations in flight, keyed by the transport's reply. */
+    QHash<RedisReply*, Invocation> _invocations;
+
+    /** Connection state last reported by the transport. */
+    RedisTransport::ConnectionState _connectionState;
+
+    /** Counters. */
+    qint64 _invocationCount;
+    qint64 _fallbacks;
+    qint64 _loads;
+};
+
+#endif // SCRIPTREGISTRY_H
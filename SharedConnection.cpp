@@ -0,0 +1,138 @@
+#include "SharedConnection.h"
+#include "SharedTransport.h"
+
+/*!
+    \class SharedConnection
+    \inmodule RedisInterface
+    \brief A reference-counted connection to a Redis server, shared by every RedisInterface on a thread that targets the same server.
+
+    Each RedisInterface talks to Redis through its own SharedTransport, but every SharedTransport created on the same thread for the same
+    server URL (and threading mode) sends its commands through one shared SharedConnection, and hence one RedisTransport: one pair of
+    native connections, or one webdis \l{QNetworkAccessManager} and subscription stream pair, however many interfaces exist. The connection
+    is created by the first acquire() and closed by the last release().
+
+    Subscriptions are merged: the transport subscribes to a channel or pattern when the first client subscribes to it, and unsubscribes
+    when the last client unsubscribes. Incoming messages are routed only to the clients subscribed to the matching channel or pattern,
+    with a single hash lookup.
+
+    Connections are never shared across threads, since a transport may only be used from the thread it belongs to.
+
+    \sa SharedTransport, RedisTransport
+*/
+
+QHash<QString, SharedConnection*> SharedConnection::_connections;
+QMutex SharedConnection::_connectionsMutex;
+
+/*!
+ * \brief Constructor. Creates the transport for \a{serverUrl} (on its own I/O thread, if \a{threaded}), registered under \a{key}.
+ */
+SharedConnection::SharedConnection(const QString &key, const QString &serverUrl, bool threaded) :
+    QObject(),
+    _key(key),
+    _transport(RedisTransport::create(serverUrl, this, threaded)),
+    _references(0)
+{
+    connect(_transport, SIGNAL(messageReceived(QString,QString,QVariant)), this, SLOT(handleMessageReceived(QString,QString,QVariant)));
+}
+
+/*!
+ * \brief Returns the connection to \a{serverUrl} (run on its own I/O thread, if \a{threaded}) shared by every caller on the current
+ * thread, creating it if no such connection is open. Every call must be balanced by a call to release().
+ */
+SharedConnection* SharedConnection::acquire(const QString &serverUrl, bool threaded)
+{
+    QString key = QString("%1|%2|%3").arg(serverUrl).arg(threaded ? 1 : 0).arg(quintptr(QThread::currentThread()));
+
+    QMutexLocker locker(&_connectionsMutex);
+
+    SharedConnection* connection = _connections.value(key);
+
+    if(connection == NULL)
+    {
+        connection = new SharedConnection(key, serverUrl, threaded);
+        _connections.insert(key, connection);
+    }
+
+    connection->_references++;
+    return connection;
+}
+
+/*!
+ * \brief Drops a reference taken by acquire(). Once no references remain, the connection is unregistered and deleted from the event
+ * loop (so that it may safely be released from within one of its own signals).
+ */
+void SharedConnection::release()
+{
+    QMutexLocker locker(&_connectionsMutex);
+
+    if(--_references > 0)
+        return;
+
+    _connections.remove(_key);
+    deleteLater();
+}
+
+/*!
+ * \brief Returns the transport carrying every command sent over this connection.
+ */
+RedisTransport* SharedConnection::transport() const
+{
+    return _transport;
+}
+
+/*!
+ * \brief Adds \a{client} to the subscribers of \a{channel}. The transport only subscribes to the channel when its first subscriber is
+ * added.
+ */
+void SharedConnection::subscribe(SharedTransport *client, const QString &channel)
+{
+    QList<SharedTransport*>& clients = _subscribers[channel];
+
+    if(clients.contains(client))
+        return;
+
+    if(clients.isEmpty())
+        _transport->subscribe(channel);
+
+    clients.append(client);
+}
+
+/*!
+ * \brief Removes \a{client} from the subscribers of \a{channel}. The transport unsubscribes from the channel when its last subscriber
+ * is removed.
+ */
+void SharedConnection::unsubscribe(SharedTransport *client, const QString &channel)
+{
+    QHash<QString, QList<SharedTransport*> >::iterator clients = _subscribers.find(channel);
+
+    if(clients == _subscribers.end() || !clients->removeOne(client))
+        return;
+
+    if(clients->isEmpty())
+    {
+        _subscribers.erase(clients);
+        _transport->unsubscribe(channel);
+    }
+}
+
+/*!
+ * \brief Returns the number of shared connections currently open, across all threads.
+ */
+int SharedConnection::connectionCount()
+{
+    QMutexLocker locker(&_connectionsMutex);
+    return _connections.size();
+}
+
+/*!
+ * \brief Routes a message received by the transport to every client subscribed to \a{subscription}.
+ */
+void SharedConnection::handleMessageReceived(QString subscription, QString channel, QVariant payload)
+{
+    // Copied, since a client may unsubscribe (or be destroyed) while the message is being delivered.
+    QList<SharedTransport*> clients = _subscribers.value(subscription);
+
+    foreach(SharedTransport* client, clients)
+        if(_subscribers.value(subscription).contains(client))
+            client->deliverMessage(subscription, channel, payload);
+}
@@ -0,0 +1,67 @@
+#ifndef SHAREDCONNECTION_H
+#define SHAREDCONNECTION_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include "RedisTransport.h"
+
+class SharedTransport;
+
+class SharedConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Returns the connection to the given server shared by every caller on the current thread, creating it if necessary. Must be
+     *  balanced by a call to release(). */
+    static SharedConnection* acquire(const QString& serverUrl, bool threaded);
+
+    /** Drops a reference taken by acquire(), closing the connection once no references remain. */
+    void release();
+
+    /** Returns the transport carrying every command sent over this connection. */
+    RedisTransport* transport() const;
+
+    /** Adds the given client to the subscribers of a channel/pattern, subscribing the transport if it is the first. */
+    void subscribe(SharedTransport* client, const QString& channel);
+
+    /** Removes the given client from the subscribers of a channel/pattern, unsubscribing the transport if it was the last. */
+    void unsubscribe(SharedTransport* client, const QString& channel);
+
+    /** Returns the number of open shared connections, across all threads. */
+    static int connectionCount();
+
+private slots:
+
+    /** Routes a message received by the transport to the clients subscribed to its subscription. */
+    void handleMessageReceived(QString subscription, QString channel, QVariant payload);
+
+private:
+
+    /** Constructor. Use acquire() instead. */
+    SharedConnection(const QString& key, const QString& serverUrl, bool threaded);
+
+    /** Key under which this connection is registered. */
+    QString _key;
+
+    /** Transport carrying every command sent over this connection. */
+    RedisTransport* _transport;
+
+    /** Number of outstanding acquire() calls. */
+    int _references;
+
+    /** Clients subscribed to each channel/pattern. */
+    QHash<QString, QList<SharedTransport*> > _subscribers;
+
+    /** Registry of open connections (keyed by server URL, threading mode and owning thread), and the mutex guarding it. */
+    static QHash<QString, SharedConnection*> _connections;
+    static QMutex _connectionsMutex;
+};
+
+#endif // SHAREDCONNECTION_H
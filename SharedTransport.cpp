@@ -0,0 +1,159 @@
+#include "SharedTransport.h"
+
+/*!
+    \class SharedTransport
+    \inmodule RedisInterface
+    \brief A RedisTransport through which one RedisInterface uses a SharedConnection.
+
+    Every RedisInterface has its own SharedTransport, so batching (and its batch window) and batch statistics remain per interface.
+    Each batch is forwarded to the shared connection's transport, where it is merged with the batches of every other interface sharing
+    the connection before being sent. Subscriptions are registered with the shared connection, which only delivers this client the
+    messages for channels and patterns it has subscribed to.
+
+    \sa SharedConnection, RedisInterface
+*/
+
+/*!
+ * \brief Constructor. Attaches to the shared connection to \a{serverUrl} (see SharedConnection::acquire()).
+ */
+SharedTransport::SharedTransport(QString serverUrl, bool threaded, QObject *parent) :
+    RedisTransport(parent),
+    _connection(SharedConnection::acquire(serverUrl, threaded))
+{
+    connect(_connection->transport(), SIGNAL(keysInvalidated(QStringList)), this, SIGNAL(keysInvalidated(QStringList)));
+    connect(_connection->transport(), SIGNAL(keyTrackingChanged(bool)), this, SLOT(handleKeyTrackingChanged(bool)));
+    connect(_connection->transport(), SIGNAL(connectionStateChanged(RedisTransport::ConnectionState)), this, SLOT(handleConnectionStateChanged(RedisTransport::ConnectionState)));
+    connect(_connection->transport(), SIGNAL(resubscribed()), this, SIGNAL(resubscribed()));
+
+    setKeyTrackingActive(_connection->transport()->isKeyTrackingActive());
+    setConnectionState(_connection->transport()->connectionState());
+}
+
+/*!
+ * \brief Destructor. Unsubscribes from every channel this client subscribed to, and releases the shared connection.
+ */
+SharedTransport::~SharedTransport()
+{
+    foreach(const QString& channel, _subscriptions)
+        _connection->unsubscribe(this, channel);
+
+    _connection->release();
+}
+
+/*!
+ * \brief Subscribes this client to \a{channel} on the shared connection.
+ */
+void SharedTransport::subscribe(const QString &channel)
+{
+    _subscriptions.insert(channel);
+    _connection->subscribe(this, channel);
+}
+
+/*!
+ * \brief Unsubscribes this client from \a{channel} on the shared connection.
+ */
+void SharedTransport::unsubscribe(const QString &channel)
+{
+    _subscriptions.remove(channel);
+    _connection->unsubscribe(this, channel);
+}
+
+/*!
+ * \brief Enables key tracking on the shared connection (and therefore for every client sharing it).
+ */
+void SharedTransport::enableKeyTracking()
+{
+    _connection->transport()->enableKeyTracking();
+}
+
+/*!
+ * \brief Returns true if the shared connection's transport is binary-safe.
+ */
+bool SharedTransport::isBinarySafe() const
+{
+    return _connection->transport()->isBinarySafe();
+}
+
+/*!
+ * \brief Returns the number of bytes written by the shared connection, on behalf of every client sharing it.
+ */
+qint64 SharedTransport::bytesWritten() const
+{
+    return _connection->transport()->bytesWritten();
+}
+
+/*!
+ * \brief Returns the number of bytes read by the shared connection, on behalf of every client sharing it.
+ */
+qint64 SharedTransport::bytesRead() const
+{
+    return _connection->transport()->bytesRead();
+}
+
+/*!
+ * \brief Reports a message on \a{channel} (matching \a{subscription}) routed to this client.
+ */
+void SharedTransport::deliverMessage(const QString &subscription, const QString &channel, const QVariant &payload)
+{
+    reportMessage(subscription, channel, payload);
+}
+
+/*!
+ * \brief Forwards \a{batch} to the shared connection's transport, where it joins the next shared batch.
+ */
+void SharedTransport::writeBatch(const QList<QueuedCommand> &batch)
+{
+    RedisTransport* transport = _connection->transport();
+
+    foreach(const QueuedCommand& queuedCommand, batch)
+    {
+        RedisReply* sharedReply = queuedCommand.transaction ? transport->sendTransaction(queuedCommand.commands) :
+                                                              transport->sendCommand(queuedCommand.commands.first());
+
+        // The shared reply cleans up after itself, even if this client is destroyed first.
+        connect(sharedReply, SIGNAL(finished()), sharedReply, SLOT(deleteLater()));
+
+        if(queuedCommand.reply)
+        {
+            _pendingReplies.insert(sharedReply, queuedCommand.reply);
+            connect(sharedReply, SIGNAL(finished()), this, SLOT(handleSharedReplyFinished()));
+        }
+    }
+}
+
+/*!
+ * \brief Copies the result of a finished shared reply into this client's corresponding reply.
+ */
+void SharedTransport::handleSharedReplyFinished()
+{
+    RedisReply* sharedReply = qobject_cast<RedisReply*>(sender());
+    if(sharedReply == NULL)
+        return;
+
+    QPointer<RedisReply> reply = _pendingReplies.take(sharedReply);
+    if(!reply)
+        return;
+
+    if(sharedReply->isError())
+        reply->setError(sharedReply->errorString());
+    else
+        reply->setValue(sharedReply->value());
+
+    reply->finish();
+}
+
+/*!
+ * \brief Follows key tracking starting or stopping on the shared connection.
+ */
+void SharedTransport::handleKeyTrackingChanged(bool active)
+{
+    setKeyTrackingActive(active);
+}
+
+/*!
+ * \brief Follows the connection \a{state} of the shared connection.
+ */
+void SharedTransport::handleConnectionStateChanged(RedisTransport::ConnectionState state)
+{
+    setConnectionState(state);
+}
@@ -0,0 +1,55 @@
+#ifndef SHAREDTRANSPORT_H
+#define SHAREDTRANSPORT_H
+
+#include <QHash>
+#include <QSet>
+#include <QPointer>
+#include "RedisTransport.h"
+#include "SharedConnection.h"
+
+class SharedTransport : public RedisTransport
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. Attaches to the shared connection to the given server, opening it if this is its first client. */
+    SharedTransport(QString serverUrl, bool threaded, QObject* parent = 0);
+
+    /** Destructor. Releases this client's subscriptions and its reference to the shared connection. */
+    ~SharedTransport();
+
+    void subscribe(const QString& channel);
+    void unsubscribe(const QString& channel);
+    void enableKeyTracking();
+    bool isBinarySafe() const;
+    qint64 bytesWritten() const;
+    qint64 bytesRead() const;
+
+    /** Reports a message routed to this client by the shared connection. */
+    void deliverMessage(const QString& subscription, const QString& channel, const QVariant& payload);
+
+protected:
+
+    void writeBatch(const QList<QueuedCommand>& batch);
+
+private slots:
+
+    /** Private handler slots for events on the shared connection. */
+    void handleSharedReplyFinished();
+    void handleKeyTrackingChanged(bool active);
+    void handleConnectionStateChanged(RedisTransport::ConnectionState state);
+
+private:
+
+    /** Shared connection carrying this client's commands and subscriptions. */
+    SharedConnection* _connection;
+
+    /** This client's replies, keyed by the corresponding reply on the shared transport. */
+    QHash<RedisReply*, QPointer<RedisReply> > _pendingReplies;
+
+    /** Channels/patterns this client is subscribed to. */
+    QSet<QString> _subscriptions;
+};
+
+#endif // SHAREDTRANSPORT_H
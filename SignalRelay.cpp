@@ -0,0 +1,69 @@
+#include "SignalRelay.h"
+
+/*!
+    \class SignalRelay
+    \inmodule RedisInterface
+    \brief Captures the arguments of arbitrary signals.
+
+    An ordinary slot cannot receive the arguments of a signal whose signature is only known at runtime. A SignalRelay instead
+    implements \c{qt_metacall()} by hand (as \l{QSignalSpy} does), and connects each relayed signal to a method ID beyond those of
+    \l{QObject}, so that every emission arrives there with its raw argument array. The arguments are copied into a \l{QVariantList} by
+    the signal's EventMarshaller, created when the signal is relayed, and passed on to the receiver's slot along with the signal's
+    method index.
+
+    \sa EventMarshaller, RedisInterface::publishEvent()
+*/
+
+/*!
+ * \brief Constructor. Relayed emissions will be passed to \a{slot} of \a{receiver}, which must take the method index of the signal (an
+ * \c{int}) and its arguments (a \l{QVariantList}).
+ */
+SignalRelay::SignalRelay(QObject *receiver, const QMetaMethod &slot, QObject *parent) :
+    QObject(parent),
+    _receiver(receiver),
+    _slot(slot)
+{
+}
+
+/*!
+ * \brief Relays every emission of \a{signal} of \a{sender}. Relaying the same signal more than once has no further effect. Returns
+ * false if the signal's arguments cannot be marshalled (see EventMarshaller::isValid()).
+ */
+bool SignalRelay::relay(QObject *sender, const QMetaMethod &signal)
+{
+    if(_relayIds.contains(signal.methodIndex()))
+        return true;
+
+    EventMarshaller marshaller(signal);
+    if(!marshaller.isValid())
+        return false;
+
+    int relayId = _marshallers.size();
+
+    if(!QMetaObject::connect(sender, signal.methodIndex(), this, QObject::staticMetaObject.methodCount() + relayId, Qt::DirectConnection, 0))
+        return false;
+
+    _marshallers.append(marshaller);
+    _relayIds.insert(signal.methodIndex(), relayId);
+
+    return true;
+}
+
+/*!
+ * \brief Receives the emissions of relayed signals (as method IDs beyond those of \l{QObject}), passing their arguments on to the
+ * receiver.
+ */
+int SignalRelay::qt_metacall(QMetaObject::Call call, int id, void **arguments)
+{
+    id = QObject::qt_metacall(call, id, arguments);
+    if(id < 0 || call != QMetaObject::InvokeMetaMethod)
+        return id;
+
+    if(id < _marshallers.size())
+    {
+        const EventMarshaller& marshaller = _marshallers.at(id);
+        _slot.invoke(_receiver, Qt::DirectConnection, Q_ARG(int, marshaller.method().methodIndex()), Q_ARG(QVariantList, marshaller.pack(arguments)));
+    }
+
+    return -1;
+}
@@ -0,0 +1,37 @@
+#ifndef SIGNALRELAY_H
+#define SIGNALRELAY_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QMetaMethod>
+#include "EventMarshaller.h"
+
+class SignalRelay : public QObject
+{
+    // No Q_OBJECT: qt_metacall() is implemented by hand, to receive the arguments of any signal.
+
+public:
+
+    /** Constructor. Relayed emissions are passed to the given slot of the receiver, which must take (int signalIndex, QVariantList arguments). */
+    SignalRelay(QObject* receiver, const QMetaMethod& slot, QObject* parent = 0);
+
+    /** Relays emissions of the given signal of the given object. Returns false if its arguments cannot be marshalled. */
+    bool relay(QObject* sender, const QMetaMethod& signal);
+
+    int qt_metacall(QMetaObject::Call call, int id, void** arguments);
+
+private:
+
+    /** Object and slot that relayed emissions are passed to. */
+    QObject* _receiver;
+    QMetaMethod _slot;
+
+    /** Marshallers of the relayed signals, by relay method ID. */
+    QVector<EventMarshaller> _marshallers;
+
+    /** Relay method IDs, by method index of the relayed signal. */
+    QHash<int, int> _relayIds;
+};
+
+#endif // SIGNALRELAY_H
@@ -0,0 +1,390 @@
+#include "StreamConsumer.h"
+#include "RedisLogging.h"
+#include <QCoreApplication>
+#include <QSysInfo>
+#include <iostream>
+
+const char* const StreamConsumer::PayloadField = "payload";
+
+/*!
+    \class StreamConsumer
+    \inmodule RedisInterface
+    \brief Reads entries from a set of Redis streams, in batches, without losing any.
+
+    Pub/sub messages are delivered only to the clients subscribed at the moment they are published, so a slow or briefly disconnected
+    client misses them. Entries appended to a stream (with \c{XADD}) remain there, so a StreamConsumer can read every one of them: it
+    remembers the ID of the last entry it has seen on each stream (starting with the stream's last entry when it is added), and its next
+    read resumes from there, even after the connection has been lost.
+
+    All of the consumer's streams are read by a single blocking \c{XREAD} (or \c{XREADGROUP}), returning up to count() entries per
+    stream, so entries arriving at a high rate cost one round trip per batch rather than one per entry. As soon as a read returns (with
+    entries, or once blockTime() has passed without any), the next one is sent. Blocking reads would hold up every command pipelined
+    behind them, so they are sent on a connection of the consumer's own.
+
+    With a consumer group, the streams are read with \c{XREADGROUP}, sharing their entries between every consumer in the group. The group
+    is created on each stream (along with the stream itself) if it does not exist yet, starting with the entries added from then on.
+    Delivered entries are acknowledged once they have been dispatched, with a single \c{XACK} per stream per batch. Entries delivered but
+    not acknowledged (eg. because the connection was lost) remain pending for the consumer, and are read again before any new entries
+    when it starts and after every failed read, so delivery is at-least-once. Since pending entries belong to a named consumer, a
+    consumer that should pick up where it left off across restarts needs a fixed name; the default name is unique to the process.
+
+    \sa RedisInterface::subscribeToEvent()
+*/
+
+/*!
+ * \brief Constructor. Entries are read on a dedicated connection to \a{serverUrl} (on an I/O thread of its own, if \a{threaded} is
+ * true), while streams are prepared and entries acknowledged through \a{commandTransport}. If \a{group} is given, entries are read as
+ * \a{consumer} (by default, the host name and process ID) in that consumer group.
+ */
+StreamConsumer::StreamConsumer(QString serverUrl, bool threaded, RedisTransport *commandTransport, QString group, QString consumer, QObject *parent) :
+    QObject(parent),
+    _readTransport(RedisTransport::create(serverUrl, this, threaded)),
+    _commandTransport(commandTransport),
+    _group(group.toUtf8()),
+    _consumer(consumer.toUtf8()),
+    _count(DefaultCount),
+    _blockTime(DefaultBlockTime),
+    _retryTimer(new QTimer(this)),
+    _reads(0),
+    _entries(0),
+    _acknowledged(0)
+{
+    if(!_group.isEmpty() && _consumer.isEmpty())
+        _consumer = QString("%1:%2").arg(QSysInfo::machineHostName()).arg(QCoreApplication::applicationPid()).toUtf8();
+
+    _retryTimer->setSingleShot(true);
+    _retryTimer->setInterval(RetryDelay);
+    connect(_retryTimer, SIGNAL(timeout()), this, SLOT(retry()));
+}
+
+/*!
+ * \brief Returns the consumer group, or an empty string if streams are read with plain \c{XREAD}.
+ */
+QString StreamConsumer::group() const
+{
+    return QString::fromUtf8(_group);
+}
+
+/*!
+ * \brief Returns the name of this consumer within its group.
+ */
+QString StreamConsumer::consumer() const
+{
+    return QString::fromUtf8(_consumer);
+}
+
+/*!
+ * \brief Sets the maximum number of entries read from each stream per round trip to \a{count}.
+ */
+void StreamConsumer::setCount(int count)
+{
+    _count = qMax(count, 1);
+}
+
+/*!
+ * \brief Returns the maximum number of entries read from each stream per round trip.
+ */
+int StreamConsumer::count() const
+{
+    return _count;
+}
+
+/*!
+ * \brief Sets how long, in milliseconds, each read waits for new entries before returning empty. A stream added while a read is in
+ * flight is only read once it returns, so this bounds the delay before a new stream is read. 0 waits indefinitely.
+ */
+void StreamConsumer::setBlockTime(int msecs)
+{
+    _blockTime = qMax(msecs, 0);
+}
+
+/*!
+ * \brief Returns how long each read waits for new entries.
+ */
+int StreamConsumer::blockTime() const
+{
+    return _blockTime;
+}
+
+/*!
+ * \brief Starts reading the stream \a{key}. Without a consumer group, every entry added after the stream's current last entry is read;
+ * with one, the group is created on the stream if need be, and reading starts with any entries still pending for this consumer. Once
+ * prepared, streams are read from the event loop, so that every stream added at once is read together.
+ */
+void StreamConsumer::addStream(const QString &key)
+{
+    if(_nextIds.contains(key))
+        return;
+
+    _nextIds.insert(key, "0");
+    prepareStream(key);
+}
+
+/*!
+ * \brief Stops reading the stream \a{key}. Entries of the stream returned by a read already in flight are discarded (and, in a consumer
+ * group, left pending).
+ */
+void StreamConsumer::removeStream(const QString &key)
+{
+    _nextIds.remove(key);
+    _preparingStreams.remove(key);
+    _unpreparedStreams.remove(key);
+}
+
+/*!
+ * \brief Returns the keys of the streams being read.
+ */
+QStringList StreamConsumer::streams() const
+{
+    return _nextIds.keys();
+}
+
+/*!
+ * \brief Returns counters describing the reads made so far: \c{reads}, \c{entries} (received), \c{acknowledged} and \c{streams} (being
+ * read), along with the \c{group} and \c{consumer} names.
+ */
+QVariantMap StreamConsumer::statistics() const
+{
+    QVariantMap statistics;
+    statistics["reads"] = _reads;
+    statistics["entries"] = _entries;
+    statistics["acknowledged"] = _acknowledged;
+    statistics["streams"] = _nextIds.size();
+    statistics["group"] = group();
+    statistics["consumer"] = consumer();
+
+    return statistics;
+}
+
+/*!
+ * \brief Sends a single blocking read covering every stream that is ready to be read, unless a read is already in flight (in which case
+ * the next read is sent when it returns).
+ */
+void StreamConsumer::read()
+{
+    if(_readReply)
+        return;
+
+    QList<QByteArray> keys;
+    QList<QByteArray> ids;
+
+    for(QMap<QString, QByteArray>::const_iterator iter = _nextIds.constBegin(); iter != _nextIds.constEnd(); ++iter)
+    {
+        if(_preparingStreams.contains(iter.key()) || _unpreparedStreams.contains(iter.key()))
+            continue;
+
+        keys.append(iter.key().toUtf8());
+        ids.append(iter.value());
+    }
+
+    if(keys.isEmpty())
+        return;
+
+    QList<QByteArray> command;
+
+    if(_group.isEmpty())
+        command << "XREAD";
+    else
+        command << "XREADGROUP" << "GROUP" << _group << _consumer;
+
+    command << "COUNT" << QByteArray::number(_count) << "BLOCK" << QByteArray::number(_blockTime) << "STREAMS" << keys << ids;
+
+    _readReply = _readTransport->sendCommand(command);
+    connect(_readReply, SIGNAL(finished()), this, SLOT(handleReadFinished()));
+
+    ++_reads;
+}
+
+/*!
+ * \brief Handles a read returning. The entries of each stream are passed on in one \c{entriesReceived()} and, in a consumer group,
+ * acknowledged with one \c{XACK}; the next read, resuming after the last entry seen, is then sent straight away.
+ *
+ * In a consumer group, each stream is first read from ID \c{0}, which returns the entries pending for this consumer; once none remain,
+ * it is read from \c{>} (new entries). After a failed read, pending entries are read again, since the lost reply may have delivered some.
+ */
+void StreamConsumer::handleReadFinished()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    if(reply != _readReply)
+        return;
+
+    _readReply = NULL;
+
+    if(reply->isError())
+    {
+        std::cerr << "[StreamConsumer] handleReadFinished(): Read failed, retrying: " << reply->errorString().toStdString() << std::endl;
+
+        if(!_group.isEmpty())
+        {
+            // A missing group (eg. because the stream was deleted) is created again.
+            bool missingGroup = reply->errorString().startsWith("NOGROUP");
+
+            for(QMap<QString, QByteArray>::iterator iter = _nextIds.begin(); iter != _nextIds.end(); ++iter)
+            {
+                iter.value() = "0";
+
+                if(missingGroup && !_preparingStreams.contains(iter.key()))
+                    _unpreparedStreams.insert(iter.key());
+            }
+        }
+
+        _retryTimer->start();
+        return;
+    }
+
+    // A read that times out without any entries returns null.
+    QVariantList streams = reply->value().toList();
+
+    foreach(const QVariant& streamValue, streams)
+    {
+        QVariantList stream = streamValue.toList();
+        if(stream.size() < 2)
+            continue;
+
+        QString key = stream.at(0).toString();
+
+        // Skip streams removed while the read was in flight.
+        QMap<QString, QByteArray>::iterator nextId = _nextIds.find(key);
+        if(nextId == _nextIds.end())
+            continue;
+
+        QVariantList entries = stream.at(1).toList();
+        QList<QByteArray> ids;
+        QVariantList payloads;
+        payloads.reserve(entries.size());
+
+        foreach(const QVariant& entryValue, entries)
+        {
+            QVariantList entry = entryValue.toList();
+            if(entry.isEmpty())
+                continue;
+
+            ids.append(entry.at(0).toString().toUtf8());
+
+            // Pending entries that have since been deleted from the stream have no fields; they are only acknowledged.
+            QVariantList fields = entry.value(1).toList();
+            if(fields.isEmpty())
+                continue;
+
+            QVariantMap fieldMap;
+
+            for(int i = 0; i + 1 < fields.size(); i += 2)
+            {
+                if(fields.at(i).toString() == PayloadField)
+                {
+                    fieldMap.clear();
+                    payloads.append(fields.at(i + 1));
+                    break;
+                }
+
+                fieldMap.insert(fields.at(i).toString(), fields.at(i + 1));
+            }
+
+            if(!fieldMap.isEmpty())
+                payloads.append(fieldMap);
+        }
+
+        if(!ids.isEmpty() && *nextId != ">")
+            *nextId = ids.last();
+        else if(ids.isEmpty() && !_group.isEmpty())
+            *nextId = ">";
+
+        _entries += payloads.size();
+
+        if(!payloads.isEmpty())
+            emit entriesReceived(key, payloads);
+
+        if(!_group.isEmpty() && !ids.isEmpty())
+            acknowledge(key, ids);
+    }
+
+    read();
+}
+
+/*!
+ * \brief Handles the reply to a stream preparation, starting to read the stream: from after its last entry (or from the start, if it is
+ * empty) without a consumer group. A group that already exists is not an error; any other error is retried after a delay.
+ */
+void StreamConsumer::handleStreamPrepared()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL)
+        return;
+
+    reply->deleteLater();
+
+    QString key = reply->property("stream").toString();
+
+    if(!_preparingStreams.remove(key))
+        return;
+
+    if(reply->isError() && !reply->errorString().startsWith("BUSYGROUP"))
+    {
+        std::cerr << "[StreamConsumer] handleStreamPrepared(): Failed to prepare stream " << key.toStdString() << ": " << reply->errorString().toStdString() << std::endl;
+
+        _unpreparedStreams.insert(key);
+        _retryTimer->start();
+        return;
+    }
+
+    if(_group.isEmpty())
+    {
+        QVariantList lastEntry = reply->value().toList().value(0).toList();
+        _nextIds[key] = lastEntry.isEmpty() ? QByteArray("0-0") : lastEntry.first().toString().toUtf8();
+    }
+
+    qCDebug(lcRedisInterface) << "Reading stream" << key << "from" << _nextIds.value(key) << (_group.isEmpty() ? QString() : "as " + consumer() + " in group " + group());
+
+    QMetaObject::invokeMethod(this, "read", Qt::QueuedConnection);
+}
+
+/*!
+ * \brief Prepares the streams whose preparation failed again, and resumes reading.
+ */
+void StreamConsumer::retry()
+{
+    foreach(const QString& key, _unpreparedStreams.values())
+        prepareStream(key);
+
+    _unpreparedStreams.clear();
+
+    read();
+}
+
+/*!
+ * \brief Finds where to start reading stream \a{key}. With a consumer group, sends \c{XGROUP CREATE} for the group, creating the stream
+ * if it does not exist (a new group starts with the entries added from then on). Otherwise, looks up the ID of the stream's last entry
+ * with \c{XREVRANGE}.
+ */
+void StreamConsumer::prepareStream(const QString &key)
+{
+    _preparingStreams.insert(key);
+
+    QList<QByteArray> command;
+
+    if(_group.isEmpty())
+        command << "XREVRANGE" << key.toUtf8() << "+" << "-" << "COUNT" << "1";
+    else
+        command << "XGROUP" << "CREATE" << key.toUtf8() << _group << "$" << "MKSTREAM";
+
+    RedisReply* reply = _commandTransport->sendCommand(command);
+    reply->setProperty("stream", key);
+    connect(reply, SIGNAL(finished()), this, SLOT(handleStreamPrepared()));
+}
+
+/*!
+ * \brief Acknowledges the entries of stream \a{key} with the given \a{ids}, with a single \c{XACK}. It is queued on the command
+ * transport, so it is sent along with whatever else is issued in the same batch.
+ */
+void StreamConsumer::acknowledge(const QString &key, const QList<QByteArray> &ids)
+{
+    RedisReply* reply = _commandTransport->sendCommand(QList<QByteArray>() << "XACK" << key.toUtf8() << _group << ids);
+    connect(reply, SIGNAL(finished()), reply, SLOT(deleteLater()));
+
+    _acknowledged += ids.size();
+}
@@ -0,0 +1,117 @@
+#ifndef STREAMCONSUMER_H
+#define STREAMCONSUMER_H
+
+#include <QObject>
+#include <QMap>
+#include <QSet>
+#include <QPointer>
+#include <QTimer>
+#include <QStringList>
+#include <QVariantMap>
+#include "RedisTransport.h"
+
+class StreamConsumer : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. Reads on a dedicated connection to the given server, and sends group commands and acknowledgements through the
+     *  given command transport. If a consumer group is given, entries are read with XREADGROUP as the given consumer. */
+    StreamConsumer(QString serverUrl, bool threaded, RedisTransport* commandTransport, QString group = QString(), QString consumer = QString(), QObject* parent = 0);
+
+    /** Returns the consumer group (empty for plain XREAD), and the name of this consumer within it. */
+    QString group() const;
+    QString consumer() const;
+
+    /** Sets the maximum number of entries read from each stream per round trip. */
+    void setCount(int count);
+    int count() const;
+
+    /** Sets how long (in milliseconds) each read blocks waiting for new entries. Streams added meanwhile are read after at most this long. */
+    void setBlockTime(int msecs);
+    int blockTime() const;
+
+    /** Starts reading the given stream from its current end (creating the consumer group on it first, if there is one). */
+    void addStream(const QString& key);
+
+    /** Stops reading the given stream. */
+    void removeStream(const QString& key);
+
+    /** Returns the keys of the streams being read. */
+    QStringList streams() const;
+
+    /** Returns counters describing the reads made so far (reads, entries, acknowledged, streams). */
+    QVariantMap statistics() const;
+
+    /** Default number of entries read per stream per round trip, and default block time in milliseconds. */
+    static const int DefaultCount = 100;
+    static const int DefaultBlockTime = 1000;
+
+    /** Name of the field holding the payload of the entries added by a RedisInterface. */
+    static const char* const PayloadField;
+
+signals:
+
+    /** Emitted with the payloads of a batch of entries read from the given stream, in order. Each payload is the entry's "payload" field
+     *  or, for entries added by other clients, a map of all of its fields. */
+    void entriesReceived(QString stream, QVariantList payloads);
+
+private slots:
+
+    /** Sends the next blocking read, unless one is already in flight. */
+    void read();
+
+    /** Private handler slots for replies. */
+    void handleReadFinished();
+    void handleStreamPrepared();
+
+    /** Retries the stream preparations and read that failed. */
+    void retry();
+
+private:
+
+    /** Finds where to start reading the given stream: sends XGROUP CREATE (creating the stream, if need be), or without a group,
+     *  looks up the ID of its last entry. */
+    void prepareStream(const QString& key);
+
+    /** Acknowledges the given entries of the given stream with a single XACK. */
+    void acknowledge(const QString& key, const QList<QByteArray>& ids);
+
+    /** Delay in milliseconds before a failed read or stream preparation is retried. */
+    static const int RetryDelay = 1000;
+
+    /** Transport for the blocking reads, on a connection of its own (so that it never holds up other commands). */
+    RedisTransport* _readTransport;
+
+    /** Transport for stream preparation and acknowledgements. */
+    RedisTransport* _commandTransport;
+
+    /** Consumer group and consumer name, encoded once. */
+    QByteArray _group;
+    QByteArray _consumer;
+
+    /** Entries read per stream per round trip, and block time. */
+    int _count;
+    int _blockTime;
+
+    /** ID to read each stream from next: the last entry seen, or for groups, ">" once pending entries have been re-read. */
+    QMap<QString, QByteArray> _nextIds;
+
+    /** Streams being prepared for reading, or whose preparation has failed. */
+    QSet<QString> _preparingStreams;
+    QSet<QString> _unpreparedStreams;
+
+    /** Read in flight, if any. */
+    QPointer<RedisReply> _readReply;
+
+    /** Timer used to delay retries. */
+    QTimer* _retryTimer;
+
+    /** Counters. */
+    qint64 _reads;
+    qint64 _entries;
+    qint64 _acknowledged;
+};
+
+#endif // STREAMCONSUMER_H
@@ -0,0 +1,109 @@
+#include "StreamParser.h"
+
+/*!
+    \class StreamParser
+    \inmodule RedisInterface
+    \brief Base class for the incremental parsers used to frame messages on a stream connection.
+
+    A StreamParser owns a single per-connection buffer. Incoming bytes are read straight into the end of the buffer, and subclasses
+    consume complete messages from the front by advancing a read offset rather than removing them. Consumed bytes are only released when
+    the buffer has been fully drained, or when they outweigh the unconsumed remainder, so a burst of messages costs a single small move at
+    most rather than one full copy of the buffer per message.
+
+    Subclasses may hand out views into the buffer (via \l{QByteArray::fromRawData()}). Such views are only valid until the next call to
+    readFrom(), append() or clear().
+
+    \sa RespParser, JsonStreamParser
+*/
+
+/*!
+ * \brief Constructor.
+ */
+StreamParser::StreamParser() :
+    _position(0)
+{
+    // Reserving marks the capacity as sticky, so draining the buffer doesn't free it.
+    _buffer.reserve(16 * 1024);
+}
+
+/*!
+ * \brief Destructor.
+ */
+StreamParser::~StreamParser()
+{
+}
+
+/*!
+ * \brief Reads every byte currently available on \a{device} directly into the end of the buffer, and returns the number of bytes read.
+ */
+qint64 StreamParser::readFrom(QIODevice *device)
+{
+    compact();
+
+    qint64 available = device->bytesAvailable();
+    if(available <= 0)
+        return 0;
+
+    int oldSize = _buffer.size();
+    _buffer.resize(oldSize + available);
+
+    qint64 bytesRead = qMax(device->read(_buffer.data() + oldSize, available), qint64(0));
+    _buffer.resize(oldSize + bytesRead);
+
+    return bytesRead;
+}
+
+/*!
+ * \brief Appends \a{data} to the end of the buffer.
+ */
+void StreamParser::append(const QByteArray &data)
+{
+    compact();
+    _buffer.append(data);
+}
+
+/*!
+ * \brief Discards all buffered data and resets the parse state.
+ */
+void StreamParser::clear()
+{
+    _buffer.resize(0);
+    _position = 0;
+    resetState();
+}
+
+/*!
+ * \brief Returns the number of bytes received but not yet consumed.
+ */
+int StreamParser::bufferedBytes() const
+{
+    return _buffer.size() - _position;
+}
+
+/*!
+ * \brief Releases consumed bytes from the front of the buffer if it has been fully drained, or if the consumed prefix is larger than
+ * the unconsumed remainder (so that the cost of moving the remainder is amortised over the messages consumed).
+ */
+void StreamParser::compact()
+{
+    if(_position == 0)
+        return;
+
+    if(_position == _buffer.size())
+    {
+        _buffer.resize(0);
+        _position = 0;
+    }
+    else if(_position > _buffer.size() - _position)
+    {
+        _buffer.remove(0, _position);
+        _position = 0;
+    }
+}
+
+/*!
+ * \brief Resets subclass parse state. The default implementation does nothing.
+ */
+void StreamParser::resetState()
+{
+}
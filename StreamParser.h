@@ -0,0 +1,44 @@
+#ifndef STREAMPARSER_H
+#define STREAMPARSER_H
+
+#include <QByteArray>
+#include <QIODevice>
+
+class StreamParser
+{
+public:
+
+    /** Constructor. */
+    StreamParser();
+
+    /** Destructor. */
+    virtual ~StreamParser();
+
+    /** Reads all bytes currently available on the given device directly into the buffer. Returns the number of bytes read. */
+    qint64 readFrom(QIODevice* device);
+
+    /** Appends the given bytes to the buffer. */
+    void append(const QByteArray& data);
+
+    /** Discards all buffered data and resets the parse state. */
+    void clear();
+
+    /** Returns the number of bytes received but not yet consumed as complete messages. */
+    int bufferedBytes() const;
+
+protected:
+
+    /** Releases consumed bytes from the front of the buffer when doing so is cheap. Invalidates any views previously handed out. */
+    void compact();
+
+    /** Called by clear() so that subclasses can reset their own parse state. */
+    virtual void resetState();
+
+    /** Bytes received from the connection. */
+    QByteArray _buffer;
+
+    /** Offset of the first byte in _buffer that has not yet been consumed. */
+    int _position;
+};
+
+#endif // STREAMPARSER_H
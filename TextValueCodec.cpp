@@ -0,0 +1,125 @@
+#include "TextValueCodec.h"
+
+/*!
+    \class TextValueCodec
+    \inmodule RedisInterface
+    \brief A ValueCodec storing values as human-readable UTF-8 text.
+
+    Scalars are stored as their textual form (eg. \c{"3.5"}, \c{"true"}), which is what other Redis clients expect, and are converted
+    back to the type of the destination property when read. Lists and maps, which have no useful plain text form, are stored as compact
+    JSON. Byte arrays holding UTF-8 text are stored as-is. Other byte arrays, which would not survive being read back as text, are
+    armoured as base64 behind the marker \c{"\\x1BQB:"}, and read back as byte arrays on either transport. So are strings and byte arrays
+    beginning with \c{"\\x1BQ"}, the prefix reserved for markers (of compressed payloads and origin headers, for instance), so that no
+    stored value can be mistaken for one.
+
+    This is the default codec.
+
+    \sa ValueCodec, DataStreamValueCodec
+*/
+
+const char* const TextValueCodec::BytesMarker = "\x1BQB:";
+const char* const TextValueCodec::ReservedPrefix = "\x1BQ";
+
+/*!
+ * \brief Constructor.
+ */
+TextValueCodec::TextValueCodec() :
+    ValueCodec()
+{
+}
+
+/*!
+ * \brief Returns \c{"text"}.
+ */
+QString TextValueCodec::name() const
+{
+    return "text";
+}
+
+/*!
+ * \brief Encodes \a{value} as UTF-8 text, or as compact JSON for lists and maps. Byte arrays that aren't UTF-8 text, and text beginning
+ * with the reserved marker prefix, are armoured.
+ */
+QByteArray TextValueCodec::encode(const QVariant &value) const
+{
+    switch(value.userType())
+    {
+    case QMetaType::QByteArray:
+    {
+        QByteArray bytes = value.toByteArray();
+        if(isPlainText(bytes))
+            return bytes;
+
+        return BytesMarker + bytes.toBase64();
+    }
+
+    case QMetaType::QVariantMap:
+        return QJsonDocument(QJsonObject::fromVariantMap(value.toMap())).toJson(QJsonDocument::Compact);
+
+    case QMetaType::QVariantHash:
+        return QJsonDocument(QJsonObject::fromVariantHash(value.toHash())).toJson(QJsonDocument::Compact);
+
+    case QMetaType::QVariantList:
+    case QMetaType::QStringList:
+        return QJsonDocument(QJsonArray::fromVariantList(value.toList())).toJson(QJsonDocument::Compact);
+
+    default:
+    {
+        QByteArray text = value.toString().toUtf8();
+        if(text.startsWith(ReservedPrefix))
+            return BytesMarker + text.toBase64();
+
+        return text;
+    }
+    }
+}
+
+/*!
+ * \brief Decodes the text in \a{data}, converting it to \a{type} if known. Lists and maps are parsed from JSON; when the type is unknown,
+ * the text is returned as a \l{QString}. Armoured byte arrays are returned as \l{QByteArray}s. Data that has already been decoded (ie.
+ * is not text) is simply converted.
+ */
+QVariant TextValueCodec::decode(const QVariant &data, int type) const
+{
+    if(!data.isValid())
+        return data;
+
+    if(data.userType() == QMetaType::QByteArray && data.toByteArray().startsWith(BytesMarker))
+        return convert(QByteArray::fromBase64(data.toByteArray().mid(int(qstrlen(BytesMarker)))), type);
+    else if(data.userType() == QMetaType::QString && data.toString().startsWith(QLatin1String(BytesMarker)))
+        return convert(QByteArray::fromBase64(data.toString().mid(int(qstrlen(BytesMarker))).toLatin1()), type);
+
+    bool isText = data.userType() == QMetaType::QString || data.userType() == QMetaType::QByteArray;
+
+    if(isStructuredType(type) && isText)
+    {
+        QByteArray text = (data.userType() == QMetaType::QByteArray) ? data.toByteArray() : data.toString().toUtf8();
+        return convert(QJsonDocument::fromJson(text).toVariant(), type);
+    }
+
+    return convert(data, type);
+}
+
+/*!
+ * \brief Returns true if values of \a{type} are stored as JSON.
+ */
+bool TextValueCodec::isStructuredType(int type)
+{
+    return type == QMetaType::QVariantMap || type == QMetaType::QVariantHash || type == QMetaType::QVariantList ||
+           type == QMetaType::QStringList;
+}
+
+/*!
+ * \brief Returns true if \a{bytes} can be stored as-is: they are valid UTF-8 (so they survive being read back as text), and don't begin
+ * with the prefix reserved for markers.
+ */
+bool TextValueCodec::isPlainText(const QByteArray &bytes)
+{
+    if(bytes.startsWith(ReservedPrefix))
+        return false;
+
+    QTextCodec::ConverterState state(QTextCodec::IgnoreHeader);
+    QTextCodec::codecForMib(Utf8Mib)->toUnicode(bytes.constData(), bytes.size(), &state);
+
+    return state.invalidChars == 0 && state.remainingChars == 0;
+}
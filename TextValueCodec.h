@@ -0,0 +1,41 @@
+#ifndef TEXTVALUECODEC_H
+#define TEXTVALUECODEC_H
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QTextCodec>
+#include "ValueCodec.h"
+
+class TextValueCodec : public ValueCodec
+{
+public:
+
+    /** Constructor. */
+    TextValueCodec();
+
+    QString name() const;
+    QByteArray encode(const QVariant& value) const;
+    QVariant decode(const QVariant& data, int type = QMetaType::UnknownType) const;
+
+protected:
+
+    /** Returns true if values of the given type are stored as JSON rather than plain text. */
+    static bool isStructuredType(int type);
+
+private:
+
+    /** Returns true if the given bytes are stored as they are (valid UTF-8 text, not mistakable for a marker). */
+    static bool isPlainText(const QByteArray& bytes);
+
+    /** Prefix of byte arrays that aren't UTF-8 text, stored as base64. */
+    static const char* const BytesMarker;
+
+    /** Prefix of the markers of armoured and compressed values and of origin headers, which stored text never begins with. */
+    static const char* const ReservedPrefix;
+
+    /** MIB enum of the UTF-8 text codec. */
+    static const int Utf8Mib = 106;
+};
+
+#endif // TEXTVALUECODEC_H
@@ -0,0 +1,176 @@
+#include "ThreadedTransport.h"
+
+/*!
+    \class ThreadedTransport
+    \inmodule RedisInterface
+    \brief A RedisTransport that performs all network I/O and protocol parsing on a dedicated worker thread.
+
+    The underlying RespTransport or WebdisTransport (chosen by the scheme of the server URL, as by \l{RedisTransport::create()}) is
+    created on an I/O thread owned by the ThreadedTransport, and driven by a TransportWorker. Socket reads, RESP and JSON parsing, reply
+    matching and the interning of channel names therefore never run on the thread that owns the ThreadedTransport (typically the GUI
+    thread).
+
+    Commands are batched on the owning thread exactly as by any other transport; each batch is then handed to the worker in a single
+    queued call, and sent as a single batch from there. In the other direction, the worker collects everything the transport reports
+    during one iteration of the I/O thread's event loop and delivers it in a single queued call, so that the owning thread receives one
+    event per burst of traffic, holding replies and messages that are already parsed (and inflated, see PayloadCompressor). Decoding them
+    with the value codec and dispatching them to bindings is left to the owning thread. Events are replayed in the order in which
+    they occurred, so reply/invalidation ordering is preserved.
+
+    Apart from the thread they run on, and compressed payloads arriving already inflated, a ThreadedTransport behaves exactly like the
+    transport it wraps.
+
+    \sa RedisTransport, TransportWorker
+*/
+
+/*!
+ * \brief Constructor. Starts the I/O thread and creates the transport for \a{serverUrl} on it. The constructor waits until the
+ * transport has been created (but not for it to connect).
+ */
+ThreadedTransport::ThreadedTransport(QString serverUrl, QObject *parent) :
+    RedisTransport(parent),
+    _thread(new QThread(this)),
+    _worker(new TransportWorker(serverUrl)),
+    _binarySafe(false),
+    _nextRequestId(0)
+{
+    qRegisterMetaType<TransportWorker::Requests>("TransportWorker::Requests");
+    qRegisterMetaType<TransportWorker::Events>("TransportWorker::Events");
+
+    _worker->moveToThread(_thread);
+    connect(_thread, SIGNAL(finished()), _worker, SLOT(deleteLater()));
+    connect(_worker, SIGNAL(eventsReady(TransportWorker::Events)), this, SLOT(handleWorkerEvents(TransportWorker::Events)));
+
+    _thread->setObjectName("RedisTransport I/O");
+    _thread->start();
+
+    QMetaObject::invokeMethod(_worker, "start", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, _binarySafe));
+}
+
+/*!
+ * \brief Destructor. Stops the I/O thread, which deletes the worker and its transport. Replies still pending never finish.
+ */
+ThreadedTransport::~ThreadedTransport()
+{
+    _thread->quit();
+    _thread->wait();
+}
+
+/*!
+ * \brief Subscribes to \a{channel} on the I/O thread.
+ */
+void ThreadedTransport::subscribe(const QString &channel)
+{
+    QMetaObject::invokeMethod(_worker, "subscribe", Qt::QueuedConnection, Q_ARG(QString, channel));
+}
+
+/*!
+ * \brief Unsubscribes from \a{channel} on the I/O thread.
+ */
+void ThreadedTransport::unsubscribe(const QString &channel)
+{
+    QMetaObject::invokeMethod(_worker, "unsubscribe", Qt::QueuedConnection, Q_ARG(QString, channel));
+}
+
+/*!
+ * \brief Enables key tracking on the I/O thread. isKeyTrackingActive() follows the underlying transport once it reports the change.
+ */
+void ThreadedTransport::enableKeyTracking()
+{
+    QMetaObject::invokeMethod(_worker, "enableKeyTracking", Qt::QueuedConnection);
+}
+
+/*!
+ * \brief Returns true if the underlying transport is binary-safe.
+ */
+bool ThreadedTransport::isBinarySafe() const
+{
+    return _binarySafe;
+}
+
+/*!
+ * \brief Returns the number of bytes written to the network by the underlying transport.
+ */
+qint64 ThreadedTransport::bytesWritten() const
+{
+    return _worker->bytesWritten();
+}
+
+/*!
+ * \brief Returns the number of bytes read from the network by the underlying transport.
+ */
+qint64 ThreadedTransport::bytesRead() const
+{
+    return _worker->bytesRead();
+}
+
+/*!
+ * \brief Hands \a{batch} to the worker in a single queued call, remembering each reply under the ID of its request.
+ */
+void ThreadedTransport::writeBatch(const QList<QueuedCommand> &batch)
+{
+    TransportWorker::Requests requests;
+    requests.reserve(batch.size());
+
+    foreach(const QueuedCommand& queuedCommand, batch)
+    {
+        TransportWorker::Request request;
+        request.id = _nextRequestId++;
+        request.commands = queuedCommand.commands;
+        request.transaction = queuedCommand.transaction;
+        requests.append(request);
+
+        if(queuedCommand.reply)
+            _pendingReplies.insert(request.id, queuedCommand.reply);
+    }
+
+    QMetaObject::invokeMethod(_worker, "writeRequests", Qt::QueuedConnection, Q_ARG(TransportWorker::Requests, requests));
+}
+
+/*!
+ * \brief Replays \a{events} reported by the worker, in order: finishing replies, and re-emitting messages, invalidations, key
+ * tracking and connection state changes, and resubscriptions.
+ */
+void ThreadedTransport::handleWorkerEvents(TransportWorker::Events events)
+{
+    foreach(const TransportWorker::Event& event, events)
+    {
+        switch(event.type)
+        {
+        case TransportWorker::Event::ReplyFinished:
+        {
+            QPointer<RedisReply> reply = _pendingReplies.take(event.id);
+            if(!reply)
+                break;
+
+            if(event.isError)
+                reply->setError(event.value.toString());
+            else
+                reply->setValue(event.value);
+
+            reply->finish();
+            break;
+        }
+
+        case TransportWorker::Event::MessageReceived:
+            reportMessage(event.subscription, event.channel, event.value);
+            break;
+
+        case TransportWorker::Event::KeysInvalidated:
+            emit keysInvalidated(event.value.toStringList());
+            break;
+
+        case TransportWorker::Event::KeyTrackingChanged:
+            setKeyTrackingActive(event.value.toBool());
+            break;
+
+        case TransportWorker::Event::ConnectionStateChanged:
+            setConnectionState(ConnectionState(event.value.toInt()));
+            break;
+
+        case TransportWorker::Event::Resubscribed:
+            emit resubscribed();
+            break;
+        }
+    }
+}
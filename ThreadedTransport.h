@@ -0,0 +1,56 @@
+#ifndef THREADEDTRANSPORT_H
+#define THREADEDTRANSPORT_H
+
+#include <QThread>
+#include <QHash>
+#include <QPointer>
+#include "RedisTransport.h"
+#include "TransportWorker.h"
+
+class ThreadedTransport : public RedisTransport
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. Starts an I/O thread running the transport selected by the scheme of the given server URL. */
+    ThreadedTransport(QString serverUrl, QObject* parent = 0);
+
+    /** Destructor. Stops the I/O thread, closing its connections. */
+    ~ThreadedTransport();
+
+    void subscribe(const QString& channel);
+    void unsubscribe(const QString& channel);
+    void enableKeyTracking();
+    bool isBinarySafe() const;
+    qint64 bytesWritten() const;
+    qint64 bytesRead() const;
+
+protected:
+
+    void writeBatch(const QList<QueuedCommand>& batch);
+
+private slots:
+
+    /** Replays a batch of events reported by the worker thread. */
+    void handleWorkerEvents(TransportWorker::Events events);
+
+private:
+
+    /** Thread on which the worker (and its transport) runs. */
+    QThread* _thread;
+
+    /** Worker owning the underlying transport. */
+    TransportWorker* _worker;
+
+    /** Whether the underlying transport is binary-safe. */
+    bool _binarySafe;
+
+    /** ID assigned to the next request sent to the worker. */
+    quint64 _nextRequestId;
+
+    /** Replies awaiting results from the worker, by request ID. */
+    QHash<quint64, QPointer<RedisReply> > _pendingReplies;
+};
+
+#endif // THREADEDTRANSPORT_H
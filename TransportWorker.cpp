@@ -0,0 +1,216 @@
+#include "TransportWorker.h"
+#include "PayloadCompressor.h"
+
+/*!
+    \class TransportWorker
+    \inmodule RedisInterface
+    \brief Runs a RedisTransport on a worker thread on behalf of a ThreadedTransport.
+
+    The worker lives on the ThreadedTransport's I/O thread, and creates its transport there (see start()), so the transport's sockets,
+    timers and parsers all belong to that thread. Requests are handed to it as queued calls to writeRequests(); everything the transport
+    reports in return (reply results, subscription messages, invalidations) is collected and emitted as a single \c{eventsReady()} batch
+    at the end of each event loop iteration, so that a burst of traffic costs the receiving thread one queued event rather than one per
+    message. Compressed reply values and message payloads are inflated here too (see PayloadCompressor), so that the receiving thread
+    only decodes them.
+
+    \sa ThreadedTransport
+*/
+
+/*!
+ * \brief Constructor. The transport for \a{serverUrl} is created by start().
+ */
+TransportWorker::TransportWorker(QString serverUrl) :
+    QObject(),
+    _serverUrl(serverUrl),
+    _transport(NULL),
+    _deliveryTimer(NULL)
+{
+}
+
+/*!
+ * \brief Creates the transport on the current (worker) thread, returning true if it is binary-safe. Must be called on the worker's
+ * thread, before any other method.
+ */
+bool TransportWorker::start()
+{
+    _transport = RedisTransport::create(_serverUrl, this);
+
+    connect(_transport, SIGNAL(messageReceived(QString,QString,QVariant)), this, SLOT(handleMessageReceived(QString,QString,QVariant)));
+    connect(_transport, SIGNAL(keysInvalidated(QStringList)), this, SLOT(handleKeysInvalidated(QStringList)));
+    connect(_transport, SIGNAL(keyTrackingChanged(bool)), this, SLOT(handleKeyTrackingChanged(bool)));
+    connect(_transport, SIGNAL(connectionStateChanged(RedisTransport::ConnectionState)), this, SLOT(handleConnectionStateChanged(RedisTransport::ConnectionState)));
+    connect(_transport, SIGNAL(resubscribed()), this, SLOT(handleResubscribed()));
+
+    _deliveryTimer = new QTimer(this);
+    _deliveryTimer->setSingleShot(true);
+    _deliveryTimer->setInterval(0);
+    connect(_deliveryTimer, SIGNAL(timeout()), this, SLOT(deliverEvents()));
+
+    return _transport->isBinarySafe();
+}
+
+/*!
+ * \brief Returns the number of bytes written to the network by the transport. The transport's byte counters are atomic, so this may be
+ * called from any thread once start() has returned.
+ */
+qint64 TransportWorker::bytesWritten() const
+{
+    return _transport ? _transport->bytesWritten() : 0;
+}
+
+/*!
+ * \brief Returns the number of bytes read from the network by the transport. May be called from any thread once start() has returned.
+ */
+qint64 TransportWorker::bytesRead() const
+{
+    return _transport ? _transport->bytesRead() : 0;
+}
+
+/*!
+ * \brief Queues \a{requests} on the transport. Since they are all queued within one event loop iteration, the transport sends them as
+ * a single batch.
+ */
+void TransportWorker::writeRequests(TransportWorker::Requests requests)
+{
+    foreach(const Request& request, requests)
+    {
+        RedisReply* reply = request.transaction ? _transport->sendTransaction(request.commands) : _transport->sendCommand(request.commands.first());
+
+        _requestIds.insert(reply, request.id);
+        connect(reply, SIGNAL(finished()), this, SLOT(handleReplyFinished()));
+    }
+}
+
+/*!
+ * \brief Subscribes the transport to \a{channel}.
+ */
+void TransportWorker::subscribe(QString channel)
+{
+    _transport->subscribe(channel);
+}
+
+/*!
+ * \brief Unsubscribes the transport from \a{channel}.
+ */
+void TransportWorker::unsubscribe(QString channel)
+{
+    _transport->unsubscribe(channel);
+}
+
+/*!
+ * \brief Enables key tracking on the transport.
+ */
+void TransportWorker::enableKeyTracking()
+{
+    _transport->enableKeyTracking();
+}
+
+/*!
+ * \brief Records the result of a finished reply, with any compressed payloads in it inflated.
+ */
+void TransportWorker::handleReplyFinished()
+{
+    RedisReply* reply = qobject_cast<RedisReply*>(sender());
+    if(reply == NULL || !_requestIds.contains(reply))
+        return;
+
+    Event event;
+    event.type = Event::ReplyFinished;
+    event.id = _requestIds.take(reply);
+    event.isError = reply->isError();
+    event.value = reply->isError() ? QVariant(reply->errorString()) : PayloadCompressor::inflateAll(reply->value());
+    postEvent(event);
+
+    reply->deleteLater();
+}
+
+/*!
+ * \brief Records a message received on the subscriber connection, inflating its payload if it is compressed.
+ */
+void TransportWorker::handleMessageReceived(QString subscription, QString channel, QVariant payload)
+{
+    Event event;
+    event.type = Event::MessageReceived;
+    event.id = 0;
+    event.isError = false;
+    event.subscription = subscription;
+    event.channel = channel;
+    event.value = PayloadCompressor::inflateAll(payload);
+    postEvent(event);
+}
+
+/*!
+ * \brief Records the invalidation of \a{keys}.
+ */
+void TransportWorker::handleKeysInvalidated(QStringList keys)
+{
+    Event event;
+    event.type = Event::KeysInvalidated;
+    event.id = 0;
+    event.isError = false;
+    event.value = keys;
+    postEvent(event);
+}
+
+/*!
+ * \brief Records key tracking starting or stopping.
+ */
+void TransportWorker::handleKeyTrackingChanged(bool active)
+{
+    Event event;
+    event.type = Event::KeyTrackingChanged;
+    event.id = 0;
+    event.isError = false;
+    event.value = active;
+    postEvent(event);
+}
+
+/*!
+ * \brief Records a change of connection \a{state}.
+ */
+void TransportWorker::handleConnectionStateChanged(RedisTransport::ConnectionState state)
+{
+    Event event;
+    event.type = Event::ConnectionStateChanged;
+    event.id = 0;
+    event.isError = false;
+    event.value = int(state);
+    postEvent(event);
+}
+
+/*!
+ * \brief Records the re-establishment of every subscription.
+ */
+void TransportWorker::handleResubscribed()
+{
+    Event event;
+    event.type = Event::Resubscribed;
+    event.id = 0;
+    event.isError = false;
+    postEvent(event);
+}
+
+/*!
+ * \brief Appends \a{event} to the pending events, in the order reported, and schedules their delivery.
+ */
+void TransportWorker::postEvent(const Event &event)
+{
+    _events.append(event);
+
+    if(!_deliveryTimer->isActive())
+        _deliveryTimer->start();
+}
+
+/*!
+ * \brief Emits every pending event as one batch.
+ */
+void TransportWorker::deliverEvents()
+{
+    if(_events.isEmpty())
+        return;
+
+    Events events;
+    events.swap(_events);
+
+    emit eventsReady(events);
+}
@@ -0,0 +1,116 @@
+#ifndef TRANSPORTWORKER_H
+#define TRANSPORTWORKER_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QTimer>
+#include <QMetaType>
+#include "RedisTransport.h"
+
+class TransportWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** A batch entry sent to the worker: a command (or transaction), tagged with the ID under which its result is reported. */
+    struct Request
+    {
+        quint64 id;
+        QList<QList<QByteArray> > commands;
+        bool transaction;
+    };
+
+    typedef QList<Request> Requests;
+
+    /** Something the transport reported on the worker thread, to be replayed on the thread that owns the ThreadedTransport. */
+    struct Event
+    {
+        enum Type
+        {
+            ReplyFinished,          /**< Reply \c{id} finished with \c{value} (or the error string, if \c{isError}). */
+            MessageReceived,        /**< A message with \c{value} as payload arrived on \c{channel}, matching \c{subscription}. */
+            KeysInvalidated,        /**< The keys in \c{value} (a QStringList) were invalidated. */
+            KeyTrackingChanged,     /**< Key tracking started or stopped (\c{value} is a bool). */
+            ConnectionStateChanged, /**< The connection state changed (\c{value} is a RedisTransport::ConnectionState). */
+            Resubscribed            /**< Every subscription was re-established after the subscriber connection was lost. */
+        };
+
+        Type type;
+        quint64 id;
+        bool isError;
+        QString subscription;
+        QString channel;
+        QVariant value;
+    };
+
+    typedef QList<Event> Events;
+
+    /** Constructor. The transport itself is only created by start(), once the worker has been moved to its thread. */
+    explicit TransportWorker(QString serverUrl);
+
+    /** Creates the transport on the worker's thread. Returns whether it is binary-safe. */
+    Q_INVOKABLE bool start();
+
+    /** Returns the number of bytes written to / read from the network by the transport. Safe to call from any thread. */
+    qint64 bytesWritten() const;
+    qint64 bytesRead() const;
+
+public slots:
+
+    /** Queues the given requests on the transport, to be sent as a single batch. */
+    void writeRequests(TransportWorker::Requests requests);
+
+    /** Call-throughs to the transport. */
+    void subscribe(QString channel);
+    void unsubscribe(QString channel);
+    void enableKeyTracking();
+
+signals:
+
+    /** Emitted at most once per event loop iteration of the worker thread, with everything reported by the transport since the last. */
+    void eventsReady(TransportWorker::Events events);
+
+private slots:
+
+    /** Private handler slots for transport events. */
+    void handleReplyFinished();
+    void handleMessageReceived(QString subscription, QString channel, QVariant payload);
+    void handleKeysInvalidated(QStringList keys);
+    void handleKeyTrackingChanged(bool active);
+    void handleConnectionStateChanged(RedisTransport::ConnectionState state);
+    void handleResubscribed();
+
+    /** Emits eventsReady() with the events collected so far. */
+    void deliverEvents();
+
+private:
+
+    /** Records an event, scheduling delivery at the end of the current event loop iteration. */
+    void postEvent(const Event& event);
+
+    /** Server URL, as given to RedisTransport::create(). */
+    QString _serverUrl;
+
+    /** Transport owned by (and running on the thread of) this worker. */
+    RedisTransport* _transport;
+
+    /** Request IDs of the replies awaiting results. */
+    QHash<RedisReply*, quint64> _requestIds;
+
+    /** Events awaiting delivery. */
+    Events _events;
+
+    /** Timer used to deliver collected events at the end of the current event loop iteration. */
+    QTimer* _deliveryTimer;
+};
+
+Q_DECLARE_METATYPE(TransportWorker::Requests)
+Q_DECLARE_METATYPE(TransportWorker::Events)
+
+#endif // TRANSPORTWORKER_H
@@ -0,0 +1,78 @@
+#include "ValueCodec.h"
+#include "TextValueCodec.h"
+#include "DataStreamValueCodec.h"
+#include "PayloadCompressor.h"
+
+/*!
+    \class ValueCodec
+    \inmodule RedisInterface
+    \brief Abstract base class for the encoding of property values and event payloads stored in Redis.
+
+    RedisInterface passes every value it writes (with set() or a published property) through its codec, and every value it reads (with
+    get() or a subscribed property) back through the same codec. When the destination is a \c{Q_PROPERTY}, the type of the property is
+    passed to decode(), so values arrive already converted to the type the property expects.
+
+    Two codecs are provided:
+
+    \list
+    \li TextValueCodec (\c{"text"}, the default), which stores values as human-readable text that any other Redis client can read and write.
+    \li DataStreamValueCodec (\c{"binary"}), which stores values in \l{QDataStream}'s compact binary form, preserving their exact types.
+    \endlist
+
+    Custom codecs may be installed with RedisInterface::setValueCodec(). A codec used with webdis must produce valid UTF-8 text, since
+    webdis relays values as JSON strings.
+
+    Values are read through decodePayload(), which inflates compressed payloads (see PayloadCompressor) before handing them to decode(),
+    so compression works with every codec and on every transport. Payloads delivered by a ThreadedTransport have already been inflated
+    on the transport's thread.
+
+    \sa RedisInterface
+*/
+
+/*!
+ * \brief Destructor.
+ */
+ValueCodec::~ValueCodec()
+{
+}
+
+/*!
+ * \brief Decodes \a{data} received from Redis with decode(), converting it to \a{type} if known. Compressed payloads (including those
+ * nested in lists and maps) are inflated first, so that decode() only ever sees encoded values.
+ */
+QVariant ValueCodec::decodePayload(const QVariant &data, int type) const
+{
+    return decode(PayloadCompressor::inflateAll(data), type);
+}
+
+/*!
+ * \brief Creates the codec named \a{name}: \c{"text"} for a TextValueCodec, or \c{"binary"} for a DataStreamValueCodec. \a{binarySafe}
+ * tells the codec whether the transport can carry arbitrary bytes (see RedisTransport::isBinarySafe()). Returns NULL if there is no codec
+ * with the given name.
+ */
+ValueCodec* ValueCodec::create(const QString &name, bool binarySafe)
+{
+    if(name == "text")
+        return new TextValueCodec();
+
+    if(name == "binary")
+        return new DataStreamValueCodec(binarySafe);
+
+    return NULL;
+}
+
+/*!
+ * \brief Returns \a{value} converted to \a{type}, or \a{value} unchanged if \a{type} is unknown, is \l{QVariant} itself, or the conversion
+ * is not possible.
+ */
+QVariant ValueCodec::convert(const QVariant &value, int type)
+{
+    if(!value.isValid() || type == QMetaType::UnknownType || type == QMetaType::QVariant || value.userType() == type)
+        return value;
+
+    QVariant converted = value;
+    if(converted.convert(type))
+        return converted;
+
+    return value;
+}
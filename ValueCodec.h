@@ -0,0 +1,37 @@
+#ifndef VALUECODEC_H
+#define VALUECODEC_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+#include <QMetaType>
+
+class ValueCodec
+{
+public:
+
+    /** Destructor. */
+    virtual ~ValueCodec();
+
+    /** Returns the name under which the codec is created by create(). */
+    virtual QString name() const = 0;
+
+    /** Encodes the given value as the bytes stored in (or published to) Redis. */
+    virtual QByteArray encode(const QVariant& value) const = 0;
+
+    /** Decodes a value received from the transport (a QString, or a QByteArray for binary data), converting it to the given type if known. */
+    virtual QVariant decode(const QVariant& data, int type = QMetaType::UnknownType) const = 0;
+
+    /** Decodes a value received from Redis as decode() does, after inflating it if it was compressed (see PayloadCompressor). */
+    QVariant decodePayload(const QVariant& data, int type = QMetaType::UnknownType) const;
+
+    /** Creates the codec with the given name ("text" or "binary"), or returns NULL if there is none. The caller owns the codec. */
+    static ValueCodec* create(const QString& name, bool binarySafe);
+
+protected:
+
+    /** Converts the given value to the given type where possible, otherwise returning it unchanged. */
+    static QVariant convert(const QVariant& value, int type);
+};
+
+#endif // VALUECODEC_H
@@ -0,0 +1,549 @@
+#include "WebdisTransport.h"
+#include "RedisLogging.h"
+
+/*!
+    \class WebdisTransport
+    \inmodule RedisInterface
+    \brief A RedisTransport that sends commands to Redis via a webdis HTTP proxy.
+
+    Each command is sent as an HTTP \c{POST} request whose body is the webdis path \c{COMMAND/arg1/arg2} (with every argument
+    percent-encoded), and the JSON response is decoded into a RedisReply. Sending commands as request bodies rather than URLs means large
+    values aren't subject to URL length limits.
+
+    Webdis offers no way to pipeline several commands in one HTTP request, so a batch holding more than one command is sent as a single
+    \c{EVAL} of a small Lua script that executes each command in turn and returns all of their results. Since Lua scripts run atomically
+    in Redis, transactions need no further treatment. Commands that Redis refuses to run from a script (such as \c{EVAL} itself,
+    \c{SCRIPT}, \c{CONFIG} and \c{CLIENT}) are always sent on their own, splitting their batch into segments around them.
+
+    \l{QNetworkAccessManager} spreads concurrent requests over several connections, so requests in flight together may run in any
+    order. Segments are therefore queued and sent one at a time, each once the previous one has finished, so that commands run in the
+    order in which they were issued. Commands issued while a segment is in flight join the last queued segment where they can, so a
+    burst still costs few requests.
+
+    Webdis cannot add channels to an open subscription, so all subscriptions are multiplexed onto (at most) two long-lived HTTP requests:
+    one \c{SUBSCRIBE} carrying every channel, and one \c{PSUBSCRIBE} carrying every pattern. When bindings are added or removed, the
+    affected stream is reopened with the new channel set, with all changes made in the same event loop iteration coalesced into one
+    restart. This keeps the number of connections constant regardless of how many bindings exist, leaving the remaining
+    \l{QNetworkAccessManager} connections free for ordinary commands.
+
+    Each stream is framed by a JsonStreamParser, since a single read may hold several messages (or only part of one) under load.
+
+    A stream that ends unexpectedly (eg. because webdis or Redis restarted) is reopened with jittered exponential backoff, carrying its
+    full channel set. Once every lost stream is delivering data again, \c{resubscribed()} is emitted.
+
+    The byte counters reported by metrics() cover request bodies, stream URLs and response bodies; HTTP headers are not counted.
+
+    \sa RedisTransport, RespTransport
+*/
+
+/*!
+ * \brief Constructor. Sends commands to the webdis server at \a{serverUrl}.
+ */
+WebdisTransport::WebdisTransport(QString serverUrl, QObject *parent) :
+    RedisTransport(parent),
+    _serverUrl(serverUrl),
+    _networkInterface(new QNetworkAccessManager(this)),
+    _segmentInFlight(false),
+    _channelsChanged(false),
+    _patternsChanged(false),
+    _restartTimer(new QTimer(this)),
+    _channelStreamLost(false),
+    _patternStreamLost(false),
+    _reconnectTimer(new QTimer(this))
+{
+    // Make sure webdis server URL ends with a slash.
+    if(!_serverUrl.endsWith("/"))
+        _serverUrl.append("/");
+
+    _restartTimer->setSingleShot(true);
+    _restartTimer->setInterval(0);
+    connect(_restartTimer, SIGNAL(timeout()), this, SLOT(restartSubscriptionStreams()));
+
+    _reconnectTimer->setSingleShot(true);
+    connect(_reconnectTimer, SIGNAL(timeout()), this, SLOT(restartSubscriptionStreams()));
+}
+
+/*!
+ * \brief Lua script executing a batch of commands. \c{ARGV} holds each command as its argument count followed by its arguments.
+ */
+const char* WebdisTransport::BatchScript =
+        "local results = {} "
+        "local i = 1 "
+        "while i <= #ARGV do "
+        "local n = tonumber(ARGV[i]) "
+        "results[#results + 1] = redis.pcall(unpack(ARGV, i + 1, i + n)) "
+        "i = i + n + 1 "
+        "end "
+        "return results";
+
+/*!
+ * \brief Commands that Redis refuses to run from within a script (flagged \c{noscript}), and which therefore can't be batched.
+ */
+const char* const WebdisTransport::StandaloneCommands[] = {
+    "AUTH", "CLIENT", "CONFIG", "EVAL", "EVALSHA", "EXEC", "MULTI", "PSUBSCRIBE", "PUNSUBSCRIBE", "SCRIPT", "SUBSCRIBE", "UNSUBSCRIBE",
+    "WATCH", 0
+};
+
+/*!
+ * \brief Queues \a{batch} to be sent to webdis in issue order, split into segments at every command that can't be run from within a
+ * script (see isStandalone()), which makes a segment of its own. The other commands join the last queued segment unless it is such a
+ * command. Segments are sent one at a time (see sendNextSegment()).
+ */
+void WebdisTransport::writeBatch(const QList<QueuedCommand> &batch)
+{
+    foreach(const QueuedCommand& queuedCommand, batch)
+    {
+        if(!isStandalone(queuedCommand) && !_queuedSegments.isEmpty() && !isStandalone(_queuedSegments.last().first()))
+            _queuedSegments.last().append(queuedCommand);
+        else
+            _queuedSegments.append(QList<QueuedCommand>() << queuedCommand);
+    }
+
+    sendNextSegment();
+}
+
+/*!
+ * \brief Sends the first queued segment, unless another is still in flight. A lone command is sent as it is; anything more is sent as
+ * one \c{EVAL} of the batch script, whose results are distributed back to the individual replies in handleBatchFinished().
+ */
+void WebdisTransport::sendNextSegment()
+{
+    if(_segmentInFlight || _queuedSegments.isEmpty())
+        return;
+
+    QList<QueuedCommand> segment = _queuedSegments.takeFirst();
+    _segmentInFlight = true;
+
+    if(segment.size() == 1 && !segment.first().transaction)
+    {
+        writeCommand(segment.first());
+        return;
+    }
+
+    QList<QByteArray> evalCommand;
+    evalCommand << "EVAL" << BatchScript << "0";
+
+    foreach(const QueuedCommand& queuedCommand, segment)
+        foreach(const QList<QByteArray>& command, queuedCommand.commands)
+            evalCommand << QByteArray::number(command.size()) << command;
+
+    QNetworkReply* networkReply = postCommand(evalCommand);
+    connect(networkReply, SIGNAL(finished()), this, SLOT(handleBatchFinished()));
+    _pendingBatches.insert(networkReply, segment);
+}
+
+/*!
+ * \brief Returns true if \a{queuedCommand} is a single command that can't be run from within a Lua script, and must therefore be sent
+ * on its own.
+ */
+bool WebdisTransport::isStandalone(const QueuedCommand &queuedCommand)
+{
+    if(queuedCommand.transaction)
+        return false;
+
+    QByteArray name = queuedCommand.commands.first().value(0).toUpper();
+
+    for(int i = 0; StandaloneCommands[i]; ++i)
+        if(name == StandaloneCommands[i])
+            return true;
+
+    return false;
+}
+
+/*!
+ * \brief Sends the single command of \a{queuedCommand} to webdis as it is.
+ */
+void WebdisTransport::writeCommand(const QueuedCommand &queuedCommand)
+{
+    QNetworkReply* networkReply = postCommand(queuedCommand.commands.first());
+    connect(networkReply, SIGNAL(finished()), this, SLOT(handleCommandFinished()));
+    _pendingReplies.insert(networkReply, queuedCommand.reply);
+}
+
+/*!
+ * \brief Adds \a{channel} to the \c{SUBSCRIBE} stream (or to the \c{PSUBSCRIBE} stream, if it contains wildcards).
+ */
+void WebdisTransport::subscribe(const QString &channel)
+{
+    if(isPattern(channel))
+    {
+        if(_patterns.contains(channel))
+            return;
+
+        _patterns.insert(channel);
+        _patternsChanged = true;
+    }
+    else
+    {
+        if(_channels.contains(channel))
+            return;
+
+        _channels.insert(channel);
+        _channelsChanged = true;
+    }
+
+    scheduleRestart();
+}
+
+/*!
+ * \brief Removes \a{channel} from the \c{SUBSCRIBE} (or \c{PSUBSCRIBE}) stream.
+ */
+void WebdisTransport::unsubscribe(const QString &channel)
+{
+    if(isPattern(channel))
+    {
+        if(!_patterns.remove(channel))
+            return;
+
+        _patternsChanged = true;
+    }
+    else
+    {
+        if(!_channels.remove(channel))
+            return;
+
+        _channelsChanged = true;
+    }
+
+    scheduleRestart();
+}
+
+/*!
+ * \brief Reopens the subscription streams whose channel sets have changed since they were last opened.
+ */
+void WebdisTransport::restartSubscriptionStreams()
+{
+    if(_channelsChanged)
+        restartSubscriptionStream(_channelStream, _channelStreamParser, "SUBSCRIBE", _channels);
+
+    if(_patternsChanged)
+        restartSubscriptionStream(_patternStream, _patternStreamParser, "PSUBSCRIBE", _patterns);
+
+    _channelsChanged = false;
+    _patternsChanged = false;
+}
+
+/*!
+ * \brief Handles completion of a command request, decoding the JSON response into the corresponding RedisReply, then sends the next
+ * queued segment.
+ */
+void WebdisTransport::handleCommandFinished()
+{
+    QNetworkReply* networkReply = qobject_cast<QNetworkReply*>(sender());
+    if(networkReply == NULL)
+        return;
+
+    QPointer<RedisReply> reply = _pendingReplies.take(networkReply);
+
+    if(reply)
+    {
+        QString errorString = networkReply->errorString();
+        QJsonValue value;
+
+        if(networkReply->error() == QNetworkReply::NoError)
+        {
+            QByteArray response = networkReply->readAll();
+            recordBytesRead(response.size());
+
+            value = decodeResponse(response, errorString);
+        }
+
+        if(networkReply->error() != QNetworkReply::NoError || value.isUndefined())
+            reply->setError(errorString);
+        else
+            setReplyValue(reply, value);
+
+        reply->finish();
+    }
+
+    handleServerResponded(networkReply);
+    networkReply->deleteLater();
+
+    _segmentInFlight = false;
+    sendNextSegment();
+}
+
+/*!
+ * \brief Handles completion of a batch request, distributing each command's result to its reply, then sends the next queued segment.
+ * Transactions receive the list of their commands' results.
+ */
+void WebdisTransport::handleBatchFinished()
+{
+    QNetworkReply* networkReply = qobject_cast<QNetworkReply*>(sender());
+    if(networkReply == NULL)
+        return;
+
+    QList<QueuedCommand> batch = _pendingBatches.take(networkReply);
+
+    QString errorString = networkReply->errorString();
+    QJsonValue value;
+
+    if(networkReply->error() == QNetworkReply::NoError)
+    {
+        QByteArray response = networkReply->readAll();
+        recordBytesRead(response.size());
+
+        value = decodeResponse(response, errorString);
+    }
+
+    QJsonArray results = value.toArray();
+    int resultIndex = 0;
+
+    foreach(const QueuedCommand& queuedCommand, batch)
+    {
+        int resultCount = queuedCommand.commands.size();
+
+        if(queuedCommand.reply)
+        {
+            if(!value.isArray())
+            {
+                queuedCommand.reply->setError(errorString);
+            }
+            else if(queuedCommand.transaction)
+            {
+                QJsonArray transactionResults;
+                for(int i = resultIndex; i < resultIndex + resultCount; ++i)
+                    transactionResults.append(results.at(i));
+
+                setReplyValue(queuedCommand.reply, transactionResults);
+            }
+            else
+            {
+                setReplyValue(queuedCommand.reply, results.at(resultIndex));
+            }
+
+            queuedCommand.reply->finish();
+        }
+
+        resultIndex += resultCount;
+    }
+
+    handleServerResponded(networkReply);
+    networkReply->deleteLater();
+
+    _segmentInFlight = false;
+    sendNextSegment();
+}
+
+/*!
+ * \brief Handles data arriving on a subscription stream, dispatching every complete message it contains.
+ */
+void WebdisTransport::handleSubscriptionData()
+{
+    QNetworkReply* networkReply = qobject_cast<QNetworkReply*>(sender());
+    if(networkReply == NULL)
+        return;
+
+    JsonStreamParser& parser = (networkReply == _channelStream) ? _channelStreamParser : _patternStreamParser;
+    recordBytesRead(parser.readFrom(networkReply));
+
+    handleServerResponded(networkReply);
+
+    QByteArray document;
+    while(parser.nextDocument(document))
+        dispatchMessage(document);
+}
+
+/*!
+ * \brief Reports the subscription message in \a{document} if it is a \c{message}/\c{pmessage} (subscription
+ * confirmations are ignored).
+ */
+void WebdisTransport::dispatchMessage(const QByteArray &document)
+{
+    QJsonObject doc = QJsonDocument::fromJson(document).object();
+    if(doc.isEmpty())
+        return;
+
+    // Subscription message format is {"SUBSCRIBE":["message","channel","payload"]} or {"PSUBSCRIBE":["pmessage","pattern","channel","payload"]}.
+    QJsonArray data = doc.value(doc.keys().at(0)).toArray();
+    QString eventType = data.at(0).toString();
+
+    if(eventType == "message")
+        reportMessage(data.at(1).toString(), data.at(1).toString(), data.at(2).toVariant());
+    else if(eventType == "pmessage")
+        reportMessage(data.at(1).toString(), data.at(2).toString(), data.at(3).toVariant());
+}
+
+/*!
+ * \brief Handles the unexpected end of a subscription stream, scheduling it to be reopened after the backoff delay (see
+ * nextReconnectDelay()).
+ */
+void WebdisTransport::handleSubscriptionFinished()
+{
+    QNetworkReply* networkReply = qobject_cast<QNetworkReply*>(sender());
+    if(networkReply == NULL)
+        return;
+
+    std::cerr << "[WebdisTransport] Subscription stream ended: " << networkReply->errorString().toStdString() << std::endl;
+
+    if(networkReply == _channelStream)
+    {
+        _channelStreamLost = true;
+        _channelsChanged = true;
+    }
+    else if(networkReply == _patternStream)
+    {
+        _patternStreamLost = true;
+        _patternsChanged = true;
+    }
+
+    if(connectionState() == Connected)
+        setConnectionState(Reconnecting);
+
+    if(!_reconnectTimer->isActive())
+    {
+        _reconnectTimer->start(nextReconnectDelay());
+        qCDebug(lcRedisTransport) << "Reopening subscription streams in" << _reconnectTimer->interval() << "ms";
+    }
+
+    networkReply->deleteLater();
+}
+
+/*!
+ * \brief Records a response from the server on \a{networkReply}. Data on a reopened stream marks it as recovered. Once no lost streams
+ * remain, a successful response marks the connection as established and resets the backoff delay (emitting \c{resubscribed()} if a
+ * stream has just recovered). A network error reports the connection as lost.
+ */
+void WebdisTransport::handleServerResponded(QNetworkReply *networkReply)
+{
+    if(networkReply->error() != QNetworkReply::NoError)
+    {
+        if(connectionState() == Connected && networkReply->error() < QNetworkReply::ContentAccessDenied)
+            setConnectionState(Reconnecting);
+
+        return;
+    }
+
+    bool wasResubscribing = _channelStreamLost || _patternStreamLost;
+
+    if(networkReply == _channelStream)
+        _channelStreamLost = false;
+    else if(networkReply == _patternStream)
+        _patternStreamLost = false;
+
+    // Subscriptions are only back to normal once every lost stream has recovered.
+    if(_channelStreamLost || _patternStreamLost)
+        return;
+
+    resetReconnectDelay();
+    setConnectionState(Connected);
+
+    if(wasResubscribing)
+        emit resubscribed();
+}
+
+/*!
+ * \brief Aborts \a{stream} (if open) and replaces it with a single \a{command} request carrying every channel in \a{channels}.
+ */
+void WebdisTransport::restartSubscriptionStream(QPointer<QNetworkReply> &stream, JsonStreamParser &parser, const char *command, const QSet<QString> &channels)
+{
+    if(stream)
+    {
+        QNetworkReply* oldStream = stream.data();
+
+        // Disconnect first so that aborting the old stream isn't reported as an unexpected end.
+        disconnect(oldStream, 0, this, 0);
+        oldStream->abort();
+        oldStream->deleteLater();
+    }
+
+    parser.clear();
+
+    if(channels.isEmpty())
+        return;
+
+    QList<QByteArray> subscribeCommand;
+    subscribeCommand << command;
+
+    foreach(const QString& channel, channels)
+        subscribeCommand << channel.toUtf8();
+
+    QUrl streamUrl = commandUrl(subscribeCommand);
+    recordBytesWritten(streamUrl.toEncoded().size());
+
+    QNetworkReply* newStream = _networkInterface->get(QNetworkRequest(streamUrl));
+    connect(newStream, SIGNAL(readyRead()), this, SLOT(handleSubscriptionData()));
+    connect(newStream, SIGNAL(finished()), this, SLOT(handleSubscriptionFinished()));
+    stream = newStream;
+}
+
+/*!
+ * \brief Schedules a restart of the changed subscription streams once control returns to the event loop, so that several bindings
+ * added in a row result in a single new request.
+ */
+void WebdisTransport::scheduleRestart()
+{
+    if(!_restartTimer->isActive())
+        _restartTimer->start();
+}
+
+/*!
+ * \brief Builds the webdis URL for \a{command}, eg. \c{http://localhost:7379/SET/key/value}.
+ */
+QUrl WebdisTransport::commandUrl(const QList<QByteArray> &command) const
+{
+    return QUrl::fromEncoded(_serverUrl.toUtf8() + commandPath(command));
+}
+
+/*!
+ * \brief POSTs \a{command} to webdis, with its path (see commandPath()) as the request body.
+ */
+QNetworkReply* WebdisTransport::postCommand(const QList<QByteArray> &command)
+{
+    QNetworkRequest request(QUrl(_serverUrl));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+
+    QByteArray body = commandPath(command);
+    recordBytesWritten(body.size());
+
+    return _networkInterface->post(request, body);
+}
+
+/*!
+ * \brief Builds the webdis path for \a{command}, percent-encoding each part so that arguments containing \c{/}, \c{?} or spaces (such
+ * as the batch script) survive intact.
+ */
+QByteArray WebdisTransport::commandPath(const QList<QByteArray> &command)
+{
+    QByteArray path;
+
+    foreach(const QByteArray& part, command)
+    {
+        if(!path.isEmpty())
+            path.append('/');
+
+        path.append(part.toPercentEncoding());
+    }
+
+    return path;
+}
+
+/*!
+ * \brief Decodes the webdis JSON response \a{data}. Webdis wraps each result in an object keyed by the command name. Returns an undefined
+ * value (with \a{errorString} set) if the response is malformed.
+ */
+QJsonValue WebdisTransport::decodeResponse(const QByteArray &data, QString &errorString)
+{
+    QJsonDocument doc = QJsonDocument::fromJson(data);
+
+    if(!doc.isObject() || doc.object().isEmpty())
+    {
+        errorString = "Bad response from server!";
+        return QJsonValue(QJsonValue::Undefined);
+    }
+
+    QJsonObject object = doc.object();
+    return object.value(object.keys().at(0));
+}
+
+/*!
+ * \brief Stores \a{value} in \a{reply}. Webdis reports Redis errors as \c{[false, "error message"]}, which are translated into reply
+ * errors.
+ */
+void WebdisTransport::setReplyValue(RedisReply *reply, const QJsonValue &value)
+{
+    if(value.isArray() && value.toArray().size() == 2 && value.toArray().at(0).isBool() && !value.toArray().at(0).toBool())
+        reply->setError(value.toArray().at(1).toString());
+    else
+        reply->setValue(value.toVariant());
+}
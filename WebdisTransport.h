@@ -0,0 +1,135 @@
+#ifndef WEBDISTRANSPORT_H
+#define WEBDISTRANSPORT_H
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QPointer>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <iostream>
+#include "RedisTransport.h"
+#include "JsonStreamParser.h"
+
+class WebdisTransport : public RedisTransport
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. Takes the URL of the webdis server (eg. "http://localhost:7379/"). */
+    WebdisTransport(QString serverUrl, QObject* parent = 0);
+
+    void subscribe(const QString& channel);
+    void unsubscribe(const QString& channel);
+
+protected:
+
+    void writeBatch(const QList<QueuedCommand>& batch);
+
+private slots:
+
+    /** Reopens the subscription streams whose channel sets have changed. */
+    void restartSubscriptionStreams();
+
+    /** Private handler slots for HTTP replies. */
+    void handleCommandFinished();
+    void handleBatchFinished();
+    void handleSubscriptionData();
+    void handleSubscriptionFinished();
+
+private:
+
+    /** Builds the webdis URL for the given command. */
+    QUrl commandUrl(const QList<QByteArray>& command) const;
+
+    /** POSTs the given command to webdis as the request body. */
+    QNetworkReply* postCommand(const QList<QByteArray>& command);
+
+    /** Sends the next queued segment, unless one is already in flight. */
+    void sendNextSegment();
+
+    /** Sends a single queued (non-transaction) command on its own. */
+    void writeCommand(const QueuedCommand& queuedCommand);
+
+    /** Returns true if the given queued command can't be run from within a script (and so can't be batched). */
+    static bool isStandalone(const QueuedCommand& queuedCommand);
+
+    /** Builds the percent-encoded, slash-separated webdis path for the given command. */
+    static QByteArray commandPath(const QList<QByteArray>& command);
+
+    /** Replaces the given subscription stream with one carrying every channel in the given set. */
+    void restartSubscriptionStream(QPointer<QNetworkReply>& stream, JsonStreamParser& parser, const char* command, const QSet<QString>& channels);
+
+    /** Reports the message in a single JSON document received on a subscription stream. */
+    void dispatchMessage(const QByteArray& document);
+
+    /** Schedules restartSubscriptionStreams() for the next event loop iteration. */
+    void scheduleRestart();
+
+    /** Records that the server responded, marking the connection as established (and resubscribed, if a lost stream has recovered). */
+    void handleServerResponded(QNetworkReply* networkReply);
+
+    /** Decodes a webdis JSON response of the form {"COMMAND": value}, returning the value (or an error). */
+    static QJsonValue decodeResponse(const QByteArray& data, QString& errorString);
+
+    /** Stores a single decoded result in the given reply, translating webdis' [false, "error"] convention into an error. */
+    static void setReplyValue(RedisReply* reply, const QJsonValue& value);
+
+    /** Lua script that executes a batch of commands atomically and returns their results as an array. */
+    static const char* BatchScript;
+
+    /** Names of the commands that can't be run from within a script, terminated by a null pointer. */
+    static const char* const StandaloneCommands[];
+
+    /** URL of the webdis server, always ending with a slash. */
+    QString _serverUrl;
+
+    /** Object responsible for making HTTP requests to webdis. */
+    QNetworkAccessManager* _networkInterface;
+
+    /** Mapping of in-flight HTTP replies to the RedisReply objects handed out to callers. */
+    QHash<QNetworkReply*, QPointer<RedisReply> > _pendingReplies;
+
+    /** Mapping of in-flight batch requests to the queued commands they carry. */
+    QHash<QNetworkReply*, QList<QueuedCommand> > _pendingBatches;
+
+    /** Segments of commands awaiting their turn, in issue order, each sent as one request (see writeBatch()). */
+    QList<QList<QueuedCommand> > _queuedSegments;
+
+    /** Whether a segment's request is in flight, holding back the rest. */
+    bool _segmentInFlight;
+
+    /** Channels carried by the SUBSCRIBE stream, and patterns carried by the PSUBSCRIBE stream. */
+    QSet<QString> _channels;
+    QSet<QString> _patterns;
+
+    /** Long-lived HTTP requests carrying all channel and pattern subscriptions respectively. */
+    QPointer<QNetworkReply> _channelStream;
+    QPointer<QNetworkReply> _patternStream;
+
+    /** Incremental framers for the documents arriving on each subscription stream. */
+    JsonStreamParser _channelStreamParser;
+    JsonStreamParser _patternStreamParser;
+
+    /** Whether the channel/pattern sets have changed since their streams were last opened. */
+    bool _channelsChanged;
+    bool _patternsChanged;
+
+    /** Coalesces subscription changes made within one event loop iteration into a single stream restart. */
+    QTimer* _restartTimer;
+
+    /** Whether each stream ended unexpectedly and has not yet delivered data since being reopened. */
+    bool _channelStreamLost;
+    bool _patternStreamLost;
+
+    /** Delays the reopening of lost streams. */
+    QTimer* _reconnectTimer;
+};
+
+#endif // WEBDISTRANSPORT_H
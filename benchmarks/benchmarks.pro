@@ -0,0 +1,18 @@
+TEMPLATE = subdirs
+
+# Benchmarks for the RedisInterface library, run against a stand-in Redis server started inside each benchmark process (no Redis or
+# webdis installation is needed):
+#
+#   interface   End-to-end RedisInterface benchmarks: publish throughput, subscribe fan-in, property round trips, GET latency under
+#               concurrency and allocations per received message.
+#   parser      RESP parsing throughput and allocations per message, in isolation.
+#
+# "make benchmark" runs them all, writing QtTest XML results (<target>.xml) next to each executable for comparison between builds.
+# Each executable also accepts the usual QtTest options, eg. "-o results.csv,csv" or "-iterations 100".
+
+SUBDIRS += \
+    interface \
+    parser
+
+benchmark.CONFIG = recursive
+QMAKE_EXTRA_TARGETS += benchmark
@@ -0,0 +1,87 @@
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+/*!
+    \class AllocationCounter
+    \brief Counts the heap allocations made by each thread of a benchmark process.
+
+    On glibc, malloc(), calloc() and realloc() are interposed by this executable and forwarded to the C library's own implementations,
+    so every allocation is counted, including those made by Qt's containers and by operator new. Elsewhere, only operator new is
+    replaced, so the counts are lower bounds.
+
+    Counts are kept per thread, so that the stand-in server (which runs on its own thread) doesn't contribute to the client's count.
+*/
+
+namespace
+{
+    // Trivially constructed, so it lives in static TLS and reading it never allocates.
+    thread_local quint64 threadAllocations = 0;
+}
+
+#if defined(__GLIBC__)
+
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+
+    void* malloc(size_t size)
+    {
+        threadAllocations++;
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        threadAllocations++;
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size)
+    {
+        threadAllocations++;
+        return __libc_realloc(pointer, size);
+    }
+}
+
+#else
+
+void* operator new(std::size_t size)
+{
+    threadAllocations++;
+
+    void* pointer = std::malloc(size > 0 ? size : 1);
+    if(pointer == NULL)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+#endif
+
+/*!
+ * \brief Returns the number of heap allocations made so far by the calling thread.
+ */
+quint64 AllocationCounter::threadCount()
+{
+    return threadAllocations;
+}
+
+/*!
+ * \brief Returns true if allocations made with malloc() are counted as well as those made with operator new.
+ */
+bool AllocationCounter::countsMalloc()
+{
+#if defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
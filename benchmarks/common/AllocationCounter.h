@@ -0,0 +1,18 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+class AllocationCounter
+{
+public:
+
+    /** Returns the number of heap allocations made so far by the calling thread. */
+    static quint64 threadCount();
+
+    /** Returns true if every allocation is counted (including Qt's containers, which use malloc() directly), or false if only
+     *  operator new is (on platforms where malloc() cannot be interposed). */
+    static bool countsMalloc();
+};
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,345 @@
+#include "RespServer.h"
+#include "RespTransport.h"
+
+/*!
+    \class RespServer
+    \brief A minimal in-process Redis server, for benchmarking without a Redis installation.
+
+    RespServer speaks enough of the Redis protocol for RespTransport: \c{GET}, \c{SET}, \c{MGET}, \c{PUBLISH},
+    \c{SUBSCRIBE}/\c{PSUBSCRIBE} and their inverses, \c{MULTI}/\c{EXEC}, \c{PING}, and (as no-ops) \c{AUTH}, \c{SELECT} and
+    \c{CLIENT TRACKING}. Values are held in a hash in memory, and there is no persistence or expiry.
+
+    Requests are parsed with the library's own RespParser, so the server's parsing cost matches the client's. Replies to every command
+    in one read are written back in a single write, as redis-server does for pipelined commands.
+
+    The server is normally run on its own thread by a StandInServer, so that it doesn't compete with the client under test for its
+    event loop.
+
+    \sa StandInServer
+*/
+
+/*!
+ * \brief Constructor.
+ */
+RespServer::RespServer(QObject *parent) :
+    QTcpServer(parent),
+    _nextClientId(1),
+    _subscriptionCount(0)
+{
+}
+
+/*!
+ * \brief Destructor. Closes every client connection.
+ */
+RespServer::~RespServer()
+{
+    qDeleteAll(_clients);
+}
+
+/*!
+ * \brief Starts listening on an ephemeral port on the loopback interface, returning the port (or 0 if listening failed).
+ */
+int RespServer::start()
+{
+    if(!listen(QHostAddress::LocalHost, 0))
+        return 0;
+
+    return serverPort();
+}
+
+/*!
+ * \brief Returns the number of channel and pattern subscriptions held by all clients.
+ */
+int RespServer::subscriptionCount() const
+{
+    return _subscriptionCount.load();
+}
+
+/*!
+ * \brief Publishes \a{payload} on \a{channel} \a{count} times, as if \c{PUBLISH} had been called that many times in a row. Each
+ * subscriber receives all of its copies in a single write, so the client under test sees them arrive as one burst.
+ */
+void RespServer::publish(QByteArray channel, QByteArray payload, int count)
+{
+    deliver(channel, payload, count);
+}
+
+/*!
+ * \brief Accepts a new client connection.
+ */
+void RespServer::incomingConnection(qintptr socketDescriptor)
+{
+    QTcpSocket* socket = new QTcpSocket(this);
+    socket->setSocketDescriptor(socketDescriptor);
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    Client* client = new Client();
+    client->id = _nextClientId++;
+    client->inTransaction = false;
+    _clients.insert(socket, client);
+
+    connect(socket, SIGNAL(readyRead()), this, SLOT(handleClientData()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(handleClientDisconnected()));
+}
+
+/*!
+ * \brief Executes every complete command received from a client, writing all of their replies at once.
+ */
+void RespServer::handleClientData()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    Client* client = _clients.value(socket);
+    if(client == NULL)
+        return;
+
+    client->parser.readFrom(socket);
+
+    QByteArray replies;
+    RespParser::Elements elements;
+    bool isError;
+    RespParser::Status status;
+
+    while((status = client->parser.parseFlatReply(elements, isError)) == RespParser::Complete)
+    {
+        // Copied, since the elements are views into the parser's buffer.
+        QList<QByteArray> command;
+        for(int i = 0; i < elements.size(); ++i)
+            command.append(QByteArray(elements.at(i).constData(), elements.at(i).size()));
+
+        if(!command.isEmpty())
+            replies.append(execute(client, command));
+    }
+
+    if(status == RespParser::ProtocolError)
+    {
+        socket->abort();
+        return;
+    }
+
+    if(!replies.isEmpty())
+        socket->write(replies);
+}
+
+/*!
+ * \brief Drops a client's subscriptions once it disconnects.
+ */
+void RespServer::handleClientDisconnected()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    Client* client = _clients.take(socket);
+    if(client == NULL)
+        return;
+
+    _subscriptionCount.fetchAndAddRelaxed(-(client->channels.size() + client->patterns.size()));
+
+    delete client;
+    socket->deleteLater();
+}
+
+/*!
+ * \brief Executes \a{command} received from \a{client}, returning its encoded reply. Within a transaction, commands are queued until
+ * \c{EXEC}.
+ */
+QByteArray RespServer::execute(Client *client, const QList<QByteArray> &command)
+{
+    QByteArray name = command.first().toUpper();
+
+    if(client->inTransaction && name != "EXEC")
+    {
+        client->queuedCommands.append(command);
+        return "+QUEUED\r\n";
+    }
+
+    if(name == "MULTI")
+    {
+        client->inTransaction = true;
+        return "+OK\r\n";
+    }
+
+    if(name == "EXEC")
+    {
+        QByteArray replies = "*" + QByteArray::number(client->queuedCommands.size()) + "\r\n";
+        foreach(const QList<QByteArray>& queuedCommand, client->queuedCommands)
+            replies.append(executeData(queuedCommand));
+
+        client->queuedCommands.clear();
+        client->inTransaction = false;
+        return replies;
+    }
+
+    if(name == "SUBSCRIBE" || name == "PSUBSCRIBE")
+        return subscribe(client, command);
+
+    if(name == "UNSUBSCRIBE" || name == "PUNSUBSCRIBE")
+        return unsubscribe(client, command);
+
+    if(name == "CLIENT" && command.size() >= 2 && command.at(1).toUpper() == "ID")
+        return integer(client->id);
+
+    return executeData(command);
+}
+
+/*!
+ * \brief Executes a \a{command} that doesn't depend on the connection it was received on, returning its encoded reply.
+ */
+QByteArray RespServer::executeData(const QList<QByteArray> &command)
+{
+    QByteArray name = command.first().toUpper();
+
+    if(name == "GET" && command.size() == 2)
+    {
+        QHash<QByteArray, QByteArray>::const_iterator value = _store.constFind(command.at(1));
+        return value != _store.constEnd() ? bulk(value.value()) : QByteArray("$-1\r\n");
+    }
+
+    if(name == "SET" && command.size() >= 3)
+    {
+        _store.insert(command.at(1), command.at(2));
+        return "+OK\r\n";
+    }
+
+    if(name == "MGET" && command.size() >= 2)
+    {
+        QByteArray reply = "*" + QByteArray::number(command.size() - 1) + "\r\n";
+
+        for(int i = 1; i < command.size(); ++i)
+        {
+            QHash<QByteArray, QByteArray>::const_iterator value = _store.constFind(command.at(i));
+            reply.append(value != _store.constEnd() ? bulk(value.value()) : QByteArray("$-1\r\n"));
+        }
+
+        return reply;
+    }
+
+    if(name == "PUBLISH" && command.size() == 3)
+        return integer(deliver(command.at(1), command.at(2), 1));
+
+    if(name == "PING")
+        return "+PONG\r\n";
+
+    if(name == "AUTH" || name == "SELECT" || name == "CLIENT")
+        return "+OK\r\n";
+
+    return "-ERR unknown command '" + command.first() + "'\r\n";
+}
+
+/*!
+ * \brief Adds the channels (or patterns, for \c{PSUBSCRIBE}) named in \a{command} to \a{client}'s subscriptions, returning one
+ * confirmation per channel.
+ */
+QByteArray RespServer::subscribe(Client *client, const QList<QByteArray> &command)
+{
+    bool pattern = (command.first().toUpper() == "PSUBSCRIBE");
+    QSet<QByteArray>& subscriptions = pattern ? client->patterns : client->channels;
+
+    QByteArray replies;
+
+    for(int i = 1; i < command.size(); ++i)
+    {
+        if(!subscriptions.contains(command.at(i)))
+        {
+            subscriptions.insert(command.at(i));
+            _subscriptionCount.fetchAndAddRelaxed(1);
+        }
+
+        replies.append("*3\r\n");
+        replies.append(bulk(pattern ? "psubscribe" : "subscribe"));
+        replies.append(bulk(command.at(i)));
+        replies.append(integer(client->channels.size() + client->patterns.size()));
+    }
+
+    return replies;
+}
+
+/*!
+ * \brief Removes the channels (or patterns, for \c{PUNSUBSCRIBE}) named in \a{command} from \a{client}'s subscriptions (or all of them,
+ * if none are named), returning one confirmation per channel.
+ */
+QByteArray RespServer::unsubscribe(Client *client, const QList<QByteArray> &command)
+{
+    bool pattern = (command.first().toUpper() == "PUNSUBSCRIBE");
+    QSet<QByteArray>& subscriptions = pattern ? client->patterns : client->channels;
+
+    QList<QByteArray> channels = command.mid(1);
+    if(channels.isEmpty())
+        channels = subscriptions.toList();
+
+    QByteArray replies;
+
+    foreach(const QByteArray& channel, channels)
+    {
+        if(subscriptions.remove(channel))
+            _subscriptionCount.fetchAndAddRelaxed(-1);
+
+        replies.append("*3\r\n");
+        replies.append(bulk(pattern ? "punsubscribe" : "unsubscribe"));
+        replies.append(bulk(channel));
+        replies.append(integer(client->channels.size() + client->patterns.size()));
+    }
+
+    return replies;
+}
+
+/*!
+ * \brief Writes \a{count} copies of the message to every client subscribed to \a{channel} (directly, or through a matching pattern),
+ * returning the number of subscriptions that matched.
+ */
+int RespServer::deliver(const QByteArray &channel, const QByteArray &payload, int count)
+{
+    QByteArray message = RespTransport::encodeCommand(QList<QByteArray>() << "message" << channel << payload);
+    int receivers = 0;
+
+    for(QHash<QTcpSocket*, Client*>::const_iterator iter = _clients.constBegin(); iter != _clients.constEnd(); ++iter)
+    {
+        QByteArray data;
+
+        if(iter.value()->channels.contains(channel))
+        {
+            data.append(message.repeated(count));
+            receivers++;
+        }
+
+        foreach(const QByteArray& pattern, iter.value()->patterns)
+        {
+            if(matches(pattern, channel))
+            {
+                data.append(RespTransport::encodeCommand(QList<QByteArray>() << "pmessage" << pattern << channel << payload).repeated(count));
+                receivers++;
+            }
+        }
+
+        if(!data.isEmpty())
+            iter.key()->write(data);
+    }
+
+    return receivers;
+}
+
+/*!
+ * \brief Returns true if \a{channel} matches the glob-style \a{pattern}.
+ */
+bool RespServer::matches(const QByteArray &pattern, const QByteArray &channel)
+{
+    QHash<QByteArray, QRegExp>::iterator regExp = _patterns.find(pattern);
+
+    if(regExp == _patterns.end())
+        regExp = _patterns.insert(pattern, QRegExp(QString::fromUtf8(pattern), Qt::CaseSensitive, QRegExp::WildcardUnix));
+
+    return regExp.value().exactMatch(QString::fromUtf8(channel));
+}
+
+/*!
+ * \brief Encodes \a{data} as a RESP bulk string.
+ */
+QByteArray RespServer::bulk(const QByteArray &data)
+{
+    return "$" + QByteArray::number(data.size()) + "\r\n" + data + "\r\n";
+}
+
+/*!
+ * \brief Encodes \a{value} as a RESP integer.
+ */
+QByteArray RespServer::integer(qlonglong value)
+{
+    return ":" + QByteArray::number(value) + "\r\n";
+}
@@ -0,0 +1,96 @@
+#ifndef RESPSERVER_H
+#define RESPSERVER_H
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QByteArray>
+#include <QRegExp>
+#include <QAtomicInt>
+#include "RespParser.h"
+
+class RespServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. The server only starts listening once start() is called (on the thread it has been moved to). */
+    explicit RespServer(QObject* parent = 0);
+
+    /** Destructor. */
+    ~RespServer();
+
+    /** Starts listening on an ephemeral port on the loopback interface. Returns the port, or 0 on failure. */
+    Q_INVOKABLE int start();
+
+    /** Returns the number of channel and pattern subscriptions held by all clients. Safe to call from any thread. */
+    int subscriptionCount() const;
+
+public slots:
+
+    /** Publishes the given payload on the given channel count times, delivering each subscriber's copies in a single write. */
+    void publish(QByteArray channel, QByteArray payload, int count);
+
+protected:
+
+    void incomingConnection(qintptr socketDescriptor);
+
+private slots:
+
+    /** Private handler slots for client socket events. */
+    void handleClientData();
+    void handleClientDisconnected();
+
+private:
+
+    /** Per-connection state. */
+    struct Client
+    {
+        RespParser parser;
+        qlonglong id;
+        QSet<QByteArray> channels;
+        QSet<QByteArray> patterns;
+        bool inTransaction;
+        QList<QList<QByteArray> > queuedCommands;
+    };
+
+    /** Executes a command from the given client, returning the encoded reply. */
+    QByteArray execute(Client* client, const QList<QByteArray>& command);
+
+    /** Executes a command that doesn't depend on the connection it was received on (including commands queued in a transaction). */
+    QByteArray executeData(const QList<QByteArray>& command);
+
+    /** Adds or removes the given client's subscriptions, returning the confirmations. */
+    QByteArray subscribe(Client* client, const QList<QByteArray>& command);
+    QByteArray unsubscribe(Client* client, const QList<QByteArray>& command);
+
+    /** Delivers a message to every matching subscriber, returning the number of subscribers that received it. */
+    int deliver(const QByteArray& channel, const QByteArray& payload, int count);
+
+    /** Returns true if the given channel matches the given glob-style pattern. */
+    bool matches(const QByteArray& pattern, const QByteArray& channel);
+
+    /** RESP encoding helpers. */
+    static QByteArray bulk(const QByteArray& data);
+    static QByteArray integer(qlonglong value);
+
+    /** Connected clients. */
+    QHash<QTcpSocket*, Client*> _clients;
+
+    /** Keys and values. */
+    QHash<QByteArray, QByteArray> _store;
+
+    /** Compiled patterns, by pattern. */
+    QHash<QByteArray, QRegExp> _patterns;
+
+    /** ID assigned to the next client. */
+    qlonglong _nextClientId;
+
+    /** Number of subscriptions held by all clients. */
+    QAtomicInt _subscriptionCount;
+};
+
+#endif // RESPSERVER_H
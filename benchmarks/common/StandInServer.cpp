@@ -0,0 +1,89 @@
+#include "StandInServer.h"
+#include <QTest>
+#include <QElapsedTimer>
+
+/*!
+    \class StandInServer
+    \brief Runs a RespServer on its own thread within the benchmark process.
+
+    The benchmarks talk to a real TCP server, so that socket I/O, parsing and event delivery are all measured, but the server runs in the
+    same process so that no Redis installation is needed and results don't depend on one. Running it on its own thread keeps its work
+    off the event loop of the client under test.
+
+    \sa RespServer
+*/
+
+/*!
+ * \brief Constructor. Starts the server thread, and waits until the server is listening.
+ */
+StandInServer::StandInServer(QObject *parent) :
+    QObject(parent),
+    _thread(new QThread(this)),
+    _server(new RespServer()),
+    _port(0)
+{
+    _server->moveToThread(_thread);
+    connect(_thread, SIGNAL(finished()), _server, SLOT(deleteLater()));
+
+    _thread->setObjectName("Stand-in Redis server");
+    _thread->start();
+
+    QMetaObject::invokeMethod(_server, "start", Qt::BlockingQueuedConnection, Q_RETURN_ARG(int, _port));
+}
+
+/*!
+ * \brief Destructor. Stops the server thread, which deletes the server and closes every connection.
+ */
+StandInServer::~StandInServer()
+{
+    _thread->quit();
+    _thread->wait();
+}
+
+/*!
+ * \brief Returns true if the server is listening.
+ */
+bool StandInServer::isListening() const
+{
+    return _port != 0;
+}
+
+/*!
+ * \brief Returns the URL to connect to the server with.
+ */
+QString StandInServer::url() const
+{
+    return QString("redis://127.0.0.1:%1").arg(_port);
+}
+
+/*!
+ * \brief Returns the number of channel and pattern subscriptions held by all clients.
+ */
+int StandInServer::subscriptionCount() const
+{
+    return _server->subscriptionCount();
+}
+
+/*!
+ * \brief Processes events until the server holds exactly \a{count} subscriptions, or \a{timeout} milliseconds have passed. Returns
+ * true if the count was reached in time. Since clients disconnect asynchronously, waiting for a count of 0 ensures that no
+ * subscriptions remain from earlier clients.
+ */
+bool StandInServer::waitForSubscriptionCount(int count, int timeout) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while(subscriptionCount() != count && timer.elapsed() < timeout)
+        QTest::qWait(1);
+
+    return subscriptionCount() == count;
+}
+
+/*!
+ * \brief Publishes \a{payload} on \a{channel} \a{count} times. Each subscriber receives all of its copies in a single write.
+ */
+void StandInServer::publish(const QByteArray &channel, const QByteArray &payload, int count)
+{
+    QMetaObject::invokeMethod(_server, "publish", Qt::QueuedConnection, Q_ARG(QByteArray, channel), Q_ARG(QByteArray, payload), Q_ARG(int, count));
+}
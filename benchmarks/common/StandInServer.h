@@ -0,0 +1,49 @@
+#ifndef STANDINSERVER_H
+#define STANDINSERVER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include "RespServer.h"
+
+class StandInServer : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor. Starts a RespServer on its own thread, listening on an ephemeral loopback port. */
+    explicit StandInServer(QObject* parent = 0);
+
+    /** Destructor. Stops the server thread, closing every connection. */
+    ~StandInServer();
+
+    /** Returns true if the server is listening. */
+    bool isListening() const;
+
+    /** Returns the URL to connect to the server with ("redis://127.0.0.1:port"). */
+    QString url() const;
+
+    /** Returns the number of channel and pattern subscriptions held by all clients. */
+    int subscriptionCount() const;
+
+    /** Waits (processing events) until the server holds exactly the given number of subscriptions. Returns false on timeout. */
+    bool waitForSubscriptionCount(int count, int timeout = 5000) const;
+
+    /** Publishes the given payload on the given channel count times, in one burst per subscriber. */
+    void publish(const QByteArray& channel, const QByteArray& payload, int count = 1);
+
+private:
+
+    /** Thread on which the server runs. */
+    QThread* _thread;
+
+    /** Server, owned by (and running on) the server thread. */
+    RespServer* _server;
+
+    /** Port the server is listening on, or 0 if it failed to listen. */
+    int _port;
+};
+
+#endif // STANDINSERVER_H
@@ -0,0 +1,80 @@
+QT += qml network testlib
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+INCLUDEPATH += $$PWD $$ROOT
+
+SOURCES += \
+    $$PWD/AllocationCounter.cpp \
+    $$PWD/RespServer.cpp \
+    $$PWD/StandInServer.cpp \
+    $$ROOT/DataStreamValueCodec.cpp \
+    $$ROOT/EventMarshaller.cpp \
+    $$ROOT/JsonStreamParser.cpp \
+    $$ROOT/MultiGetRequest.cpp \
+    $$ROOT/PayloadCompressor.cpp \
+    $$ROOT/PublishThrottle.cpp \
+    $$ROOT/ReadCache.cpp \
+    $$ROOT/RedisCollectionModel.cpp \
+    $$ROOT/RedisInterface.cpp \
+    $$ROOT/RedisListModel.cpp \
+    $$ROOT/RedisLogging.cpp \
+    $$ROOT/RedisMetrics.cpp \
+    $$ROOT/RedisPromise.cpp \
+    $$ROOT/RedisReply.cpp \
+    $$ROOT/RedisSortedSetModel.cpp \
+    $$ROOT/RedisTransport.cpp \
+    $$ROOT/RequestScheduler.cpp \
+    $$ROOT/RespParser.cpp \
+    $$ROOT/RespTransport.cpp \
+    $$ROOT/ScriptRegistry.cpp \
+    $$ROOT/SharedConnection.cpp \
+    $$ROOT/SharedTransport.cpp \
+    $$ROOT/SignalRelay.cpp \
+    $$ROOT/StreamConsumer.cpp \
+    $$ROOT/StreamParser.cpp \
+    $$ROOT/TextValueCodec.cpp \
+    $$ROOT/ThreadedTransport.cpp \
+    $$ROOT/TransportWorker.cpp \
+    $$ROOT/ValueCodec.cpp \
+    $$ROOT/WebdisTransport.cpp
+
+HEADERS += \
+    $$PWD/AllocationCounter.h \
+    $$PWD/RespServer.h \
+    $$PWD/StandInServer.h \
+    $$ROOT/DataStreamValueCodec.h \
+    $$ROOT/EventMarshaller.h \
+    $$ROOT/JsonStreamParser.h \
+    $$ROOT/MultiGetRequest.h \
+    $$ROOT/PayloadCompressor.h \
+    $$ROOT/PublishThrottle.h \
+    $$ROOT/ReadCache.h \
+    $$ROOT/RedisCollectionModel.h \
+    $$ROOT/RedisInterface.h \
+    $$ROOT/RedisListModel.h \
+    $$ROOT/RedisLogging.h \
+    $$ROOT/RedisMetrics.h \
+    $$ROOT/RedisPromise.h \
+    $$ROOT/RedisReply.h \
+    $$ROOT/RedisSortedSetModel.h \
+    $$ROOT/RedisTransport.h \
+    $$ROOT/RequestScheduler.h \
+    $$ROOT/RespParser.h \
+    $$ROOT/RespTransport.h \
+    $$ROOT/ScriptRegistry.h \
+    $$ROOT/SharedConnection.h \
+    $$ROOT/SharedTransport.h \
+    $$ROOT/SignalRelay.h \
+    $$ROOT/StreamConsumer.h \
+    $$ROOT/StreamParser.h \
+    $$ROOT/TextValueCodec.h \
+    $$ROOT/ThreadedTransport.h \
+    $$ROOT/TransportWorker.h \
+    $$ROOT/ValueCodec.h \
+    $$ROOT/WebdisTransport.h
+
+# Runs the benchmark, printing the results and writing them as QtTest XML for comparison between builds.
+benchmark.commands = ./$$TARGET -o -,txt -o $${TARGET}.xml,xml
+QMAKE_EXTRA_TARGETS += benchmark
@@ -0,0 +1,5 @@
+TARGET = tst_interfacebenchmark
+
+include(../common/common.pri)
+
+SOURCES += tst_interfacebenchmark.cpp
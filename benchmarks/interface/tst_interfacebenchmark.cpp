@@ -0,0 +1,326 @@
+#include <QtTest>
+#include <QEventLoop>
+#include <QTimer>
+#include "RedisInterface.h"
+#include "StandInServer.h"
+#include "AllocationCounter.h"
+
+/*
+    End-to-end benchmarks for RedisInterface, run against a StandInServer. Each benchmark is run with the transport on the calling
+    thread and on a worker thread (the "threaded" column).
+*/
+
+/** Object bound to a RedisInterface, counting the events, property writes and replies it receives. */
+class BenchmarkTarget : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariant value READ value WRITE setValue NOTIFY valueChanged)
+
+public:
+
+    BenchmarkTarget() : QObject(), _count(0), _target(0) {}
+
+    QVariant value() const { return _value; }
+    int count() const { return _count; }
+    void reset() { _count = 0; }
+
+    /** Processes events until at least the given number of events/writes/replies has been counted. Returns false on timeout. */
+    bool waitFor(int target)
+    {
+        if(_count >= target)
+            return true;
+
+        _target = target;
+
+        QEventLoop loop;
+        connect(this, SIGNAL(targetReached()), &loop, SLOT(quit()));
+        QTimer::singleShot(Timeout, &loop, SLOT(quit()));
+        loop.exec();
+
+        return _count >= target;
+    }
+
+public slots:
+
+    void setValue(const QVariant& value)
+    {
+        _value = value;
+        emit valueChanged(value);
+        increment();
+    }
+
+    void handleEvent() { increment(); }
+    void handleReply(QVariant value) { Q_UNUSED(value); increment(); }
+
+signals:
+
+    void valueChanged(QVariant value);
+    void targetReached();
+
+private:
+
+    void increment()
+    {
+        if(++_count == _target)
+            emit targetReached();
+    }
+
+    /** How long waitFor() waits, in milliseconds. */
+    static const int Timeout = 10000;
+
+    QVariant _value;
+    int _count;
+    int _target;
+};
+
+class InterfaceBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+
+    void publishThroughput_data();
+    void publishThroughput();
+    void subscribeFanIn_data();
+    void subscribeFanIn();
+    void propertyRoundTrip_data();
+    void propertyRoundTrip();
+    void getLatency_data();
+    void getLatency();
+    void messageAllocations_data();
+    void messageAllocations();
+
+private:
+
+    /** Adds the "threaded" column, with a row for each setting. */
+    void addThreadedRows();
+
+    /** Sends a PING and waits for its reply, so that every command issued before it has been executed. */
+    bool roundTrip(RedisInterface& redis, BenchmarkTarget& target);
+
+    /** Number of messages sent or received per benchmark iteration. */
+    static const int MessagesPerIteration = 1000;
+
+    StandInServer* _server;
+};
+
+void InterfaceBenchmark::initTestCase()
+{
+    _server = new StandInServer(this);
+    QVERIFY(_server->isListening());
+
+    if(!AllocationCounter::countsMalloc())
+        qWarning("Only operator new is counted on this platform, so allocation counts are lower bounds.");
+}
+
+void InterfaceBenchmark::cleanupTestCase()
+{
+    delete _server;
+}
+
+void InterfaceBenchmark::cleanup()
+{
+    // Wait for the last benchmark's connections to close, so that its subscriptions aren't mistaken for the next one's.
+    QVERIFY(_server->waitForSubscriptionCount(0));
+}
+
+void InterfaceBenchmark::addThreadedRows()
+{
+    QTest::addColumn<bool>("threaded");
+
+    QTest::newRow("calling thread") << false;
+    QTest::newRow("worker thread") << true;
+}
+
+bool InterfaceBenchmark::roundTrip(RedisInterface &redis, BenchmarkTarget &target)
+{
+    int expected = target.count() + 1;
+
+    RedisPromise* promise = redis.execute(QStringList() << "PING");
+    connect(promise, SIGNAL(fulfilled(QVariant)), &target, SLOT(handleReply(QVariant)));
+
+    return target.waitFor(expected);
+}
+
+/*
+    Time to publish MessagesPerIteration events (until the server has executed them all).
+*/
+void InterfaceBenchmark::publishThroughput_data()
+{
+    addThreadedRows();
+}
+
+void InterfaceBenchmark::publishThroughput()
+{
+    QFETCH(bool, threaded);
+
+    BenchmarkTarget target;
+    RedisInterface redis(_server->url(), &target, threaded);
+    QVERIFY(roundTrip(redis, target));
+
+    QBENCHMARK
+    {
+        for(int i = 0; i < MessagesPerIteration; ++i)
+            redis.publish("bench:publish", i);
+
+        QVERIFY(roundTrip(redis, target));
+    }
+}
+
+/*
+    Time to receive and dispatch MessagesPerIteration events arriving in one burst.
+*/
+void InterfaceBenchmark::subscribeFanIn_data()
+{
+    addThreadedRows();
+}
+
+void InterfaceBenchmark::subscribeFanIn()
+{
+    QFETCH(bool, threaded);
+
+    BenchmarkTarget target;
+    RedisInterface redis(_server->url(), &target, threaded);
+    QVERIFY(redis.subscribeToEvent("bench:fanin", "handleEvent"));
+    QVERIFY(_server->waitForSubscriptionCount(1));
+
+    QBENCHMARK
+    {
+        target.reset();
+        _server->publish("bench:fanin", "1", MessagesPerIteration);
+        QVERIFY(target.waitFor(MessagesPerIteration));
+    }
+}
+
+/*
+    Time from writing a published property to the change reaching a subscribed property through the server.
+*/
+void InterfaceBenchmark::propertyRoundTrip_data()
+{
+    addThreadedRows();
+}
+
+void InterfaceBenchmark::propertyRoundTrip()
+{
+    QFETCH(bool, threaded);
+
+    BenchmarkTarget publisher;
+    BenchmarkTarget subscriber;
+    RedisInterface publishing(_server->url(), &publisher, threaded);
+    RedisInterface subscribing(_server->url(), &subscriber, threaded);
+
+    publishing.publishProperty("value", "bench:property");
+    subscribing.subscribeToProperty("bench:property", "value");
+    QVERIFY(_server->waitForSubscriptionCount(1));
+    QVERIFY(roundTrip(publishing, publisher));
+    QVERIFY(roundTrip(subscribing, subscriber));
+
+    int value = 0;
+
+    QBENCHMARK
+    {
+        subscriber.reset();
+        publisher.setValue(++value);
+        QVERIFY(subscriber.waitFor(1));
+    }
+
+    QCOMPARE(subscriber.value().toInt(), value);
+}
+
+/*
+    Time to complete a number of concurrent GETs (of distinct keys, so that none are coalesced).
+*/
+void InterfaceBenchmark::getLatency_data()
+{
+    QTest::addColumn<bool>("threaded");
+    QTest::addColumn<int>("concurrency");
+
+    QTest::newRow("calling thread, 1 request") << false << 1;
+    QTest::newRow("calling thread, 16 requests") << false << 16;
+    QTest::newRow("calling thread, 256 requests") << false << 256;
+    QTest::newRow("worker thread, 1 request") << true << 1;
+    QTest::newRow("worker thread, 16 requests") << true << 16;
+    QTest::newRow("worker thread, 256 requests") << true << 256;
+}
+
+void InterfaceBenchmark::getLatency()
+{
+    QFETCH(bool, threaded);
+    QFETCH(int, concurrency);
+
+    BenchmarkTarget target;
+    RedisInterface redis(_server->url(), &target, threaded);
+
+    QStringList keys;
+    for(int i = 0; i < concurrency; ++i)
+    {
+        keys << QString("bench:get:%1").arg(i);
+        redis.set(keys.last(), i);
+    }
+
+    QVERIFY(roundTrip(redis, target));
+
+    QBENCHMARK
+    {
+        target.reset();
+
+        foreach(const QString& key, keys)
+        {
+            RedisPromise* promise = redis.getAsync(key);
+            connect(promise, SIGNAL(fulfilled(QVariant)), &target, SLOT(handleReply(QVariant)));
+        }
+
+        QVERIFY(target.waitFor(concurrency));
+    }
+}
+
+/*
+    Heap allocations made on the calling thread per message received, from the socket read to the bound slot or property write. Reported
+    as "events" per iteration, where an iteration is one message. Measured with the transport on the calling thread, so that the whole
+    receive path is counted.
+*/
+void InterfaceBenchmark::messageAllocations_data()
+{
+    QTest::addColumn<bool>("property");
+
+    QTest::newRow("event") << false;
+    QTest::newRow("property") << true;
+}
+
+void InterfaceBenchmark::messageAllocations()
+{
+    QFETCH(bool, property);
+
+    BenchmarkTarget target;
+    RedisInterface redis(_server->url(), &target, false);
+
+    if(property)
+        redis.subscribeToProperty("bench:allocations", "value");
+    else
+        QVERIFY(redis.subscribeToEvent("bench:allocations_changed", "handleEvent"));
+
+    QVERIFY(_server->waitForSubscriptionCount(1));
+    QVERIFY(roundTrip(redis, target));
+
+    // Warm up, so that buffers, interned channel names and the like are already allocated.
+    target.reset();
+    _server->publish("bench:allocations_changed", "1", MessagesPerIteration);
+    QVERIFY(target.waitFor(MessagesPerIteration));
+
+    target.reset();
+    quint64 allocationsBefore = AllocationCounter::threadCount();
+
+    _server->publish("bench:allocations_changed", "1", MessagesPerIteration);
+    QVERIFY(target.waitFor(MessagesPerIteration));
+
+    quint64 allocations = AllocationCounter::threadCount() - allocationsBefore;
+    QTest::setBenchmarkResult(qreal(allocations) / MessagesPerIteration, QTest::Events);
+}
+
+QTEST_GUILESS_MAIN(InterfaceBenchmark)
+
+#include "tst_interfacebenchmark.moc"
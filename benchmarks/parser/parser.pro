@@ -0,0 +1,5 @@
+TARGET = tst_parserbenchmark
+
+include(../common/common.pri)
+
+SOURCES += tst_parserbenchmark.cpp
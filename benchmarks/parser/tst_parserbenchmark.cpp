@@ -0,0 +1,153 @@
+#include <QtTest>
+#include "RespParser.h"
+#include "RespTransport.h"
+#include "AllocationCounter.h"
+
+/*
+    Benchmarks for RespParser in isolation: the cost of framing and decoding the pub/sub messages and command replies that arrive on a
+    RespTransport's connections, without any socket I/O.
+*/
+
+class ParserBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void parseMessages_data();
+    void parseMessages();
+    void parseReplies_data();
+    void parseReplies();
+    void messageAllocations_data();
+    void messageAllocations();
+
+private:
+
+    /** Adds the "data" and "messages" columns, with a row for each message shape and payload size. */
+    void addMessageRows();
+
+    /** Number of messages or replies parsed per benchmark iteration. */
+    static const int MessagesPerIteration = 10000;
+};
+
+void ParserBenchmark::addMessageRows()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("messages");
+
+    QByteArray smallPayload(16, 'x');
+    QByteArray largePayload(4096, 'x');
+
+    QTest::newRow("message, 16 bytes") << RespTransport::encodeCommand(QList<QByteArray>() << "message" << "bench:channel" << smallPayload).repeated(MessagesPerIteration) << MessagesPerIteration;
+    QTest::newRow("message, 4 KiB") << RespTransport::encodeCommand(QList<QByteArray>() << "message" << "bench:channel" << largePayload).repeated(MessagesPerIteration) << MessagesPerIteration;
+    QTest::newRow("pmessage, 16 bytes") << RespTransport::encodeCommand(QList<QByteArray>() << "pmessage" << "bench:*" << "bench:channel" << smallPayload).repeated(MessagesPerIteration) << MessagesPerIteration;
+}
+
+/*
+    Time to frame MessagesPerIteration pub/sub messages and decode their payloads, as on the subscriber connection.
+*/
+void ParserBenchmark::parseMessages_data()
+{
+    addMessageRows();
+}
+
+void ParserBenchmark::parseMessages()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, messages);
+
+    RespParser parser;
+    RespParser::Elements elements;
+    bool isError;
+
+    QBENCHMARK
+    {
+        parser.append(data);
+
+        int parsed = 0;
+        while(parser.parseFlatReply(elements, isError) == RespParser::Complete)
+        {
+            const QByteArray& payload = elements.last();
+            RespParser::bulkValue(payload.constData(), payload.size());
+            parsed++;
+        }
+
+        QCOMPARE(parsed, messages);
+    }
+}
+
+/*
+    Time to parse MessagesPerIteration command replies into QVariants, as on the command connection.
+*/
+void ParserBenchmark::parseReplies_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("replies");
+
+    QByteArray bulkReply = "$16\r\n" + QByteArray(16, 'x') + "\r\n";
+    QByteArray arrayReply = "*4\r\n" + bulkReply.repeated(3) + "$-1\r\n";
+
+    QTest::newRow("bulk string") << bulkReply.repeated(MessagesPerIteration) << MessagesPerIteration;
+    QTest::newRow("integer") << QByteArray(":12345\r\n").repeated(MessagesPerIteration) << MessagesPerIteration;
+    QTest::newRow("array of 4") << arrayReply.repeated(MessagesPerIteration) << MessagesPerIteration;
+}
+
+void ParserBenchmark::parseReplies()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, replies);
+
+    RespParser parser;
+    QVariant value;
+    bool isError;
+
+    QBENCHMARK
+    {
+        parser.append(data);
+
+        int parsed = 0;
+        while(parser.parseReply(value, isError) == RespParser::Complete)
+            parsed++;
+
+        QCOMPARE(parsed, replies);
+    }
+}
+
+/*
+    Heap allocations per pub/sub message framed and decoded, reported as "events" per iteration, where an iteration is one message.
+*/
+void ParserBenchmark::messageAllocations_data()
+{
+    addMessageRows();
+}
+
+void ParserBenchmark::messageAllocations()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, messages);
+
+    RespParser parser;
+    RespParser::Elements elements;
+    bool isError;
+
+    // Warm up, so that the parser's buffer has already grown to size.
+    parser.append(data);
+    while(parser.parseFlatReply(elements, isError) == RespParser::Complete)
+        ;
+
+    quint64 allocationsBefore = AllocationCounter::threadCount();
+
+    parser.append(data);
+    while(parser.parseFlatReply(elements, isError) == RespParser::Complete)
+    {
+        const QByteArray& payload = elements.last();
+        RespParser::bulkValue(payload.constData(), payload.size());
+    }
+
+    quint64 allocations = AllocationCounter::threadCount() - allocationsBefore;
+    QTest::setBenchmarkResult(qreal(allocations) / messages, QTest::Events);
+}
+
+QTEST_GUILESS_MAIN(ParserBenchmark)
+
+#include "tst_parserbenchmark.moc"
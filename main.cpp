@@ -1,6 +1,8 @@
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include "QMLRedisInterface.h"
+#include "RedisListModel.h"
+#include "RedisSortedSetModel.h"
 #include "CppRedisTest.h"
 
 int main(int argc, char *argv[])
@@ -8,6 +10,9 @@ int main(int argc, char *argv[])
     QGuiApplication app(argc, argv);
 
     qmlRegisterType<QMLRedisInterface>("Redis", 1, 0, "RedisInterface");
+    qmlRegisterType<RedisListModel>("Redis", 1, 0, "RedisListModel");
+    qmlRegisterType<RedisSortedSetModel>("Redis", 1, 0, "RedisSortedSetModel");
+    qmlRegisterUncreatableType<RedisPromise>("Redis", 1, 0, "RedisPromise", "RedisPromises are returned by RedisInterface requests");
 
     CppRedisTest test;
 
@@ -15,8 +15,10 @@ Window {
         btnPublishEvent1.onClicked: redis.publishedSignal1()
         btnPublishEvent2.onClicked: redis.publishedSignal2()
         btnGetAsync.onClicked: {
-            redis.get("get:async", function(value){
+            redis.getAsync("get:async").then(function(value){
                 redis.asynchronousGetVariable = value;
+            }, function(error){
+                console.log("(QML) getAsync() failed: " + error);
             })
         }
         btnGetSync.onClicked: {
@@ -61,8 +63,8 @@ Window {
             console.log("(QML) localMethod() called");
         }
 
-        function localWildcard() {
-            console.log("(QML) localWildcard() called");
+        function localWildcard(channel) {
+            console.log("(QML) localWildcard() called for channel " + channel);
         }
 
         function handleLocalSignal() {
@@ -77,14 +79,14 @@ Window {
         ]
 
         publishedProperties: [
-            { local: "localPublishedDouble", remote: "remote:subscribed:double" },
+            { local: "localPublishedDouble", remote: "remote:subscribed:double", policy: "rate", rate: 10 },
             { local: "localPublishedString", remote: "remote:subscribed:string" }
         ]
 
         subscribedEvents: [
             { remote: "remote:signal:trigger", local: "localSignal"   },
             { remote: "remote:method:trigger", local: "localMethod"   },
-            { remote: "remote:wildcard*",      local: "localWildcard" }
+            { remote: "remote:wildcard*",      local: "localWildcard(QVariant)" }
         ]
 
         publishedEvents: [
@@ -1,12 +1,41 @@
 TEMPLATE = app
 
-QT += qml quick
+QT += qml quick network
 CONFIG += c++11
 
 SOURCES += main.cpp \
     CppRedisTest.cpp \
+    DataStreamValueCodec.cpp \
+    EventMarshaller.cpp \
+    JsonStreamParser.cpp \
+    MultiGetRequest.cpp \
+    PayloadCompressor.cpp \
+    PublishThrottle.cpp \
     QMLRedisInterface.cpp \
-    RedisInterface.cpp
+    ReadCache.cpp \
+    RedisCollectionModel.cpp \
+    RedisInterface.cpp \
+    RedisListModel.cpp \
+    RedisLogging.cpp \
+    RedisMetrics.cpp \
+    RedisPromise.cpp \
+    RedisReply.cpp \
+    RedisSortedSetModel.cpp \
+    RedisTransport.cpp \
+    RequestScheduler.cpp \
+    RespParser.cpp \
+    RespTransport.cpp \
+    ScriptRegistry.cpp \
+    SharedConnection.cpp \
+    SharedTransport.cpp \
+    SignalRelay.cpp \
+    StreamConsumer.cpp \
+    StreamParser.cpp \
+    TextValueCodec.cpp \
+    ThreadedTransport.cpp \
+    TransportWorker.cpp \
+    ValueCodec.cpp \
+    WebdisTransport.cpp
 
 RESOURCES += qml.qrc
 
@@ -27,6 +56,9 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Uncomment to remove the synchronous (nested event loop) RedisInterface::get(), leaving only the asynchronous API.
+#DEFINES += REDIS_NO_SYNCHRONOUS_GET
+
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
@@ -34,6 +66,35 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 
 HEADERS += \
     CppRedisTest.h \
+    DataStreamValueCodec.h \
+    EventMarshaller.h \
+    JsonStreamParser.h \
+    MultiGetRequest.h \
+    PayloadCompressor.h \
+    PublishThrottle.h \
     QMLRedisInterface.h \
-    RedisInterface.h
+    ReadCache.h \
+    RedisCollectionModel.h \
+    RedisInterface.h \
+    RedisListModel.h \
+    RedisLogging.h \
+    RedisMetrics.h \
+    RedisPromise.h \
+    RedisReply.h \
+    RedisSortedSetModel.h \
+    RedisTransport.h \
+    RequestScheduler.h \
+    RespParser.h \
+    RespTransport.h \
+    ScriptRegistry.h \
+    SharedConnection.h \
+    SharedTransport.h \
+    SignalRelay.h \
+    StreamConsumer.h \
+    StreamParser.h \
+    TextValueCodec.h \
+    ThreadedTransport.h \
+    TransportWorker.h \
+    ValueCodec.h \
+    WebdisTransport.h
 
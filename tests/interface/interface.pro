@@ -0,0 +1,7 @@
+TARGET = tst_redisinterface
+
+include(../../benchmarks/common/common.pri)
+
+CONFIG += testcase
+
+SOURCES += tst_redisinterface.cpp
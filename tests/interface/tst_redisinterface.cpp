@@ -0,0 +1,230 @@
+#include <QtTest>
+#include <QEventLoop>
+#include <QTimer>
+#include "RedisInterface.h"
+#include "StandInServer.h"
+
+/*
+    End-to-end tests for RedisInterface, run against a StandInServer with the transport on the calling thread (unless a test says otherwise).
+*/
+
+/** Object bound to a RedisInterface. Its property notifies every write, even of an unchanged value. */
+class TestTarget : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariant value READ value WRITE setValue NOTIFY valueChanged)
+
+public:
+
+    QVariant value() const { return _value; }
+
+public slots:
+
+    void setValue(const QVariant& value)
+    {
+        _value = value;
+        emit valueChanged(value);
+    }
+
+signals:
+
+    void valueChanged(QVariant value);
+
+private:
+
+    QVariant _value;
+};
+
+class RedisInterfaceTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void initTestCase();
+    void cleanupTestCase();
+
+    void cancelledWriteIsRetried();
+    void readFollowsQueuedWrite();
+    void byteArrayRoundTrip_data();
+    void byteArrayRoundTrip();
+    void compressedRoundTrip_data();
+    void compressedRoundTrip();
+    void eventPayloadIsUntouched();
+
+private:
+
+    /** Waits for the given promise to settle, returning false on timeout. */
+    bool waitFor(RedisPromise* promise);
+
+    /** Reads the given key until it holds the given value, returning false on timeout. */
+    bool waitForValue(RedisInterface& redis, const QString& key, const QVariant& expected);
+
+    /** How long waits last, in milliseconds. */
+    static const int Timeout = 5000;
+
+    StandInServer* _server;
+};
+
+void RedisInterfaceTest::initTestCase()
+{
+    _server = new StandInServer(this);
+    QVERIFY(_server->isListening());
+}
+
+void RedisInterfaceTest::cleanupTestCase()
+{
+    delete _server;
+}
+
+bool RedisInterfaceTest::waitFor(RedisPromise *promise)
+{
+    if(promise->isPending())
+    {
+        QEventLoop loop;
+        connect(promise, SIGNAL(settled()), &loop, SLOT(quit()));
+        QTimer::singleShot(Timeout, &loop, SLOT(quit()));
+        loop.exec();
+    }
+
+    return !promise->isPending();
+}
+
+bool RedisInterfaceTest::waitForValue(RedisInterface &redis, const QString &key, const QVariant &expected)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while(timer.elapsed() < Timeout)
+    {
+        RedisPromise* promise = redis.getAsync(key);
+
+        if(waitFor(promise) && !promise->isRejected() && promise->value() == expected)
+            return true;
+
+        QTest::qWait(10);
+    }
+
+    return false;
+}
+
+/*
+    A queued binding write that is cancelled must not be taken for the value held by Redis: writing the same value again is sent.
+*/
+void RedisInterfaceTest::cancelledWriteIsRetried()
+{
+    TestTarget target;
+    RedisInterface redis(_server->url(), &target, false);
+    QVERIFY(redis.setLaneLimit("bulk", 1));
+    redis.publishProperty("value", "test:cancelled");
+
+    target.setValue("first");
+    target.setValue("second");
+    QCOMPARE(redis.cancelQueued("bulk"), 1);
+
+    target.setValue("second");
+    QVERIFY(waitForValue(redis, "test:cancelled", "second"));
+}
+
+/*
+    A read in the interactive lane does not overtake a binding write to the same key still queued in the bulk lane.
+*/
+void RedisInterfaceTest::readFollowsQueuedWrite()
+{
+    TestTarget target;
+    RedisInterface redis(_server->url(), &target, false);
+    QVERIFY(redis.setLaneLimit("bulk", 1));
+    redis.publishProperty("value", "test:ordered");
+
+    target.setValue("first");
+    target.setValue("second");
+
+    RedisPromise* read = redis.getAsync("test:ordered");
+    QVERIFY(waitFor(read));
+    QVERIFY(!read->isRejected());
+    QCOMPARE(read->value(), QVariant("second"));
+}
+
+/*
+    Byte arrays written with the default codec are read back intact, whether or not they hold UTF-8 text.
+*/
+void RedisInterfaceTest::byteArrayRoundTrip_data()
+{
+    QTest::addColumn<QByteArray>("bytes");
+
+    QTest::newRow("UTF-8 text") << QByteArray("caf\xC3\xA9");
+    QTest::newRow("invalid UTF-8") << QByteArray("\x80\x81 abc \xC3(");
+    QTest::newRow("leading 0xFF") << QByteArray("\xFF\x00\x01\x02", 4);
+    QTest::newRow("truncated sequence") << QByteArray("abc\xE2\x82");
+}
+
+void RedisInterfaceTest::byteArrayRoundTrip()
+{
+    QFETCH(QByteArray, bytes);
+
+    TestTarget target;
+    RedisInterface redis(_server->url(), &target, false);
+
+    RedisPromise* written = redis.setAsync("test:bytes", bytes);
+    QVERIFY(waitFor(written));
+    QVERIFY(!written->isRejected());
+
+    RedisPromise* read = redis.getAsync("test:bytes");
+    QVERIFY(waitFor(read));
+    QVERIFY(!read->isRejected());
+    QCOMPARE(read->value().toByteArray(), bytes);
+}
+
+void RedisInterfaceTest::compressedRoundTrip_data()
+{
+    QTest::addColumn<bool>("threaded");
+
+    QTest::newRow("same thread") << false;
+    QTest::newRow("threaded") << true;
+}
+
+/*
+    Compressed values are inflated before they are decoded (by the transport's worker thread, if threaded), so that readers see the
+    original value.
+*/
+void RedisInterfaceTest::compressedRoundTrip()
+{
+    QFETCH(bool, threaded);
+
+    TestTarget target;
+    RedisInterface redis(_server->url(), &target, threaded);
+    redis.setCompressionThreshold(64);
+
+    QString text = QString("compressible ").repeated(100);
+
+    RedisPromise* written = redis.setAsync("test:compressed", text);
+    QVERIFY(waitFor(written));
+    QVERIFY(!written->isRejected());
+
+    RedisPromise* read = redis.getAsync("test:compressed");
+    QVERIFY(waitFor(read));
+    QVERIFY(!read->isRejected());
+    QCOMPARE(read->value(), QVariant(text));
+    QCOMPARE(redis.metrics().value("compression").toMap().value("compressed").toInt(), 1);
+}
+
+/*
+    Only change notifications carry an origin header, so an event payload is delivered whole, whatever it ends with.
+*/
+void RedisInterfaceTest::eventPayloadIsUntouched()
+{
+    TestTarget target;
+    RedisInterface redis(_server->url(), &target, false);
+
+    QVERIFY(redis.subscribeToEvent("test:event", "setValue"));
+    QVERIFY(_server->waitForSubscriptionCount(1));
+
+    QByteArray payload = "payload\x1E" "0123456789abcdef";
+    _server->publish("test:event", payload);
+
+    QTRY_COMPARE_WITH_TIMEOUT(target.value().toString(), QString::fromUtf8(payload), Timeout);
+}
+
+QTEST_GUILESS_MAIN(RedisInterfaceTest)
+
+#include "tst_redisinterface.moc"
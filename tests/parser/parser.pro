@@ -0,0 +1,7 @@
+TARGET = tst_parser
+
+include(../../benchmarks/common/common.pri)
+
+CONFIG += testcase
+
+SOURCES += tst_parser.cpp
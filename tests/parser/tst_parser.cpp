@@ -0,0 +1,292 @@
+#include <QtTest>
+#include <QJsonDocument>
+#include "RespParser.h"
+#include "RespTransport.h"
+#include "JsonStreamParser.h"
+
+/*
+    Tests for the stream parsers: the same RESP and webdis streams, split into chunks in every way a connection may deliver them, must
+    yield the same sequence of messages as when they arrive whole.
+*/
+
+class ParserTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void respReplies_data();
+    void respReplies();
+    void respFlatReplies_data();
+    void respFlatReplies();
+    void webdisDocuments_data();
+    void webdisDocuments();
+
+private:
+
+    /** Adds the "split" column, with a row for each way of splitting a stream. */
+    void addSplitRows();
+
+    /** Returns the given messages concatenated into one stream, then split into chunks as named by the given split. */
+    static QList<QByteArray> splitStream(const QList<QByteArray>& messages, const QString& split);
+
+    /** Returns the messages of a RESP stream: replies of every type, pub/sub messages, and a bulk string longer than a chunk. */
+    static QList<QByteArray> respMessages();
+
+    /** Returns the documents of a webdis subscription stream, including brackets and escapes inside strings and a long payload. */
+    static QList<QByteArray> webdisMessages();
+
+    /** Size of the large payloads, several times the parsers' initial buffer, so that they cross many chunks. */
+    static const int LargePayloadSize = 40000;
+};
+
+void ParserTest::addSplitRows()
+{
+    QTest::addColumn<QString>("split");
+
+    QTest::newRow("whole") << "whole";
+    QTest::newRow("byte by byte") << "bytes";
+    QTest::newRow("at message boundaries") << "messages";
+    QTest::newRow("three messages per chunk") << "three messages";
+    QTest::newRow("7-byte chunks") << "7";
+    QTest::newRow("4 KiB chunks") << "4096";
+}
+
+QList<QByteArray> ParserTest::splitStream(const QList<QByteArray> &messages, const QString &split)
+{
+    QList<QByteArray> chunks;
+
+    if(split == "messages" || split == "three messages")
+    {
+        int perChunk = (split == "messages") ? 1 : 3;
+
+        for(int i = 0; i < messages.size(); i += perChunk)
+        {
+            QByteArray chunk;
+            for(int j = i; j < qMin(i + perChunk, messages.size()); ++j)
+                chunk += messages.at(j);
+
+            chunks << chunk;
+        }
+
+        return chunks;
+    }
+
+    QByteArray stream;
+    foreach(const QByteArray& message, messages)
+        stream += message;
+
+    int chunkSize = (split == "whole") ? stream.size() : (split == "bytes") ? 1 : split.toInt();
+
+    for(int i = 0; i < stream.size(); i += chunkSize)
+        chunks << stream.mid(i, chunkSize);
+
+    return chunks;
+}
+
+QList<QByteArray> ParserTest::respMessages()
+{
+    QByteArray largePayload;
+    for(int i = 0; largePayload.size() < LargePayloadSize; ++i)
+        largePayload += QByteArray::number(i) + ' ';
+
+    QList<QByteArray> messages;
+    messages << "+OK\r\n";
+    messages << "-ERR unknown command\r\n";
+    messages << ":42\r\n";
+    messages << "$5\r\nhello\r\n";
+    messages << "$-1\r\n";
+    messages << "$0\r\n\r\n";
+    messages << RespTransport::encodeCommand(QList<QByteArray>() << "message" << "test:channel" << "payload\r\nwith CRLF");
+    messages << RespTransport::encodeCommand(QList<QByteArray>() << "pmessage" << "test:*" << "test:channel"
+                                                                 << QByteArray("\xFF\x00\x01 binary", 10));
+    messages << "*3\r\n$7\r\nmessage\r\n$20\r\n__redis__:invalidate\r\n*2\r\n$4\r\nkey1\r\n$4\r\nkey2\r\n";
+    messages << "+queued after nested\r\n";
+
+    // The large bulk string follows small messages, so the buffer is compacted while it is still incomplete.
+    messages << RespTransport::encodeCommand(QList<QByteArray>() << "message" << "test:large" << largePayload);
+    messages << ":-7\r\n";
+    messages << RespTransport::encodeCommand(QList<QByteArray>() << "message" << "test:channel" << "last");
+
+    return messages;
+}
+
+QList<QByteArray> ParserTest::webdisMessages()
+{
+    QByteArray largePayload(LargePayloadSize, 'x');
+
+    QList<QByteArray> messages;
+    messages << "{\"SUBSCRIBE\":[\"subscribe\",\"test:channel\",1]}";
+    messages << "{\"SUBSCRIBE\":[\"message\",\"test:channel\",\"plain\"]}";
+    messages << "\r\n{\"SUBSCRIBE\":[\"message\",\"test:channel\",\"brackets } ] { [ inside\"]}";
+    messages << "{\"SUBSCRIBE\":[\"message\",\"test:channel\",\"escaped \\\" quote } and \\\\\"]}\n";
+    messages << "{\"PSUBSCRIBE\":[\"pmessage\",\"test:*\",\"test:channel\",\"{\\\"nested\\\":[1,2]}\"]}";
+    messages << "{\"SUBSCRIBE\":[\"message\",\"test:large\",\"" + largePayload + "\"]}";
+    messages << "{\"SUBSCRIBE\":[\"message\",\"test:channel\",\"last\"]}";
+
+    return messages;
+}
+
+/*
+    Replies parsed into QVariants are the same however the stream is split, with every reply consumed as soon as it is complete.
+*/
+void ParserTest::respReplies_data()
+{
+    addSplitRows();
+}
+
+void ParserTest::respReplies()
+{
+    QFETCH(QString, split);
+
+    QList<QByteArray> messages = respMessages();
+
+    // The stream parsed whole gives the expected sequence.
+    QVariantList expected;
+    QList<bool> expectedErrors;
+
+    RespParser wholeParser;
+    foreach(const QByteArray& message, messages)
+        wholeParser.append(message);
+
+    QVariant value;
+    bool isError = false;
+
+    while(wholeParser.parseReply(value, isError) == RespParser::Complete)
+    {
+        expected << value;
+        expectedErrors << isError;
+        isError = false;
+    }
+
+    QCOMPARE(expected.size(), messages.size());
+    QCOMPARE(wholeParser.bufferedBytes(), 0);
+    QCOMPARE(expectedErrors.at(1), true);
+    QCOMPARE(expected.at(2), QVariant(qlonglong(42)));
+    QVERIFY(expected.at(7).toList().value(3).userType() == QMetaType::QByteArray);
+    QVERIFY(expected.at(10).toList().value(2).toString().size() >= LargePayloadSize);
+
+    RespParser parser;
+    QVariantList parsed;
+    QList<bool> errors;
+    RespParser::Status status = RespParser::Incomplete;
+
+    foreach(const QByteArray& chunk, splitStream(messages, split))
+    {
+        parser.append(chunk);
+
+        isError = false;
+        while((status = parser.parseReply(value, isError)) == RespParser::Complete)
+        {
+            parsed << value;
+            errors << isError;
+            isError = false;
+        }
+
+        QVERIFY(status != RespParser::ProtocolError);
+    }
+
+    QCOMPARE(parsed, expected);
+    QCOMPARE(errors, expectedErrors);
+    QCOMPARE(parser.bufferedBytes(), 0);
+}
+
+/*
+    Replies parsed as flat views into the buffer are the same however the stream is split. Views are copied before more data is
+    appended, since appending may compact the buffer.
+*/
+void ParserTest::respFlatReplies_data()
+{
+    addSplitRows();
+}
+
+void ParserTest::respFlatReplies()
+{
+    QFETCH(QString, split);
+
+    QList<QByteArray> messages = respMessages();
+    RespParser::Elements elements;
+    bool isError = false;
+
+    QList<QList<QByteArray> > expected;
+    RespParser wholeParser;
+    foreach(const QByteArray& message, messages)
+        wholeParser.append(message);
+
+    while(wholeParser.parseFlatReply(elements, isError) == RespParser::Complete)
+    {
+        QList<QByteArray> copies;
+        foreach(const QByteArray& element, elements)
+            copies << QByteArray(element.constData(), element.size());
+
+        expected << copies;
+    }
+
+    QCOMPARE(expected.size(), messages.size());
+    QCOMPARE(expected.at(8).size(), 4);
+
+    RespParser parser;
+    QList<QList<QByteArray> > parsed;
+    RespParser::Status status = RespParser::Incomplete;
+
+    foreach(const QByteArray& chunk, splitStream(messages, split))
+    {
+        parser.append(chunk);
+
+        while((status = parser.parseFlatReply(elements, isError)) == RespParser::Complete)
+        {
+            QList<QByteArray> copies;
+            foreach(const QByteArray& element, elements)
+                copies << QByteArray(element.constData(), element.size());
+
+            parsed << copies;
+        }
+
+        QVERIFY(status != RespParser::ProtocolError);
+    }
+
+    QCOMPARE(parsed, expected);
+    QCOMPARE(parser.bufferedBytes(), 0);
+}
+
+/*
+    Webdis documents are framed the same however the stream is split, ignoring brackets and escaped quotes inside strings and any
+    separators between documents.
+*/
+void ParserTest::webdisDocuments_data()
+{
+    addSplitRows();
+}
+
+void ParserTest::webdisDocuments()
+{
+    QFETCH(QString, split);
+
+    QList<QByteArray> messages = webdisMessages();
+
+    QList<QByteArray> expected;
+    foreach(const QByteArray& message, messages)
+        expected << message.trimmed();
+
+    JsonStreamParser parser;
+    QList<QByteArray> parsed;
+    QByteArray document;
+
+    foreach(const QByteArray& chunk, splitStream(messages, split))
+    {
+        parser.append(chunk);
+
+        while(parser.nextDocument(document))
+        {
+            QVERIFY(!QJsonDocument::fromJson(document).isNull());
+            parsed << QByteArray(document.constData(), document.size());
+        }
+    }
+
+    QCOMPARE(parsed, expected);
+    QCOMPARE(parser.bufferedBytes(), 0);
+}
+
+QTEST_GUILESS_MAIN(ParserTest)
+
+#include "tst_parser.moc"
@@ -0,0 +1,15 @@
+TEMPLATE = subdirs
+
+# Tests for the RedisInterface library, run against stand-in servers started inside each test process (the benchmarks' stand-in Redis
+# server, see benchmarks/common), so no Redis or webdis installation is needed:
+#
+#   interface   End-to-end RedisInterface behaviour: write bookkeeping, lanes and value round trips.
+#   parser      RespParser and JsonStreamParser framing, with their streams split in every way a connection may deliver them.
+#   webdis      WebdisTransport's batching, against a stand-in webdis server.
+#
+# "make check" runs them all.
+
+SUBDIRS += \
+    interface \
+    parser \
+    webdis
@@ -0,0 +1,190 @@
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QEventLoop>
+#include <QTimer>
+#include "WebdisTransport.h"
+#include "RedisReply.h"
+
+/*
+    Tests for WebdisTransport, run against a stand-in webdis server that records the command of every request.
+*/
+
+/** A minimal webdis server, answering every command with "OK" (or, for a batch script, one "OK" per command it carries). */
+class WebdisServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+
+    WebdisServer() : QTcpServer() { listen(QHostAddress::LocalHost, 0); }
+
+    QString url() const { return QString("http://127.0.0.1:%1/").arg(serverPort()); }
+
+    /** Commands received so far, as their decoded webdis paths (eg. "GET/key"). */
+    QStringList commands;
+
+protected:
+
+    void incomingConnection(qintptr socketDescriptor)
+    {
+        QTcpSocket* socket = new QTcpSocket(this);
+        socket->setSocketDescriptor(socketDescriptor);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(handleData()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+
+private slots:
+
+    void handleData()
+    {
+        QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+        QByteArray& buffer = _buffers[socket];
+        buffer.append(socket->readAll());
+
+        int headerEnd;
+        while((headerEnd = buffer.indexOf("\r\n\r\n")) >= 0)
+        {
+            QRegExp contentLength("Content-Length: *(\\d+)", Qt::CaseInsensitive);
+            int bodySize = contentLength.indexIn(QString::fromLatin1(buffer.left(headerEnd))) >= 0 ? contentLength.cap(1).toInt() : 0;
+
+            if(buffer.size() < headerEnd + 4 + bodySize)
+                return;
+
+            QList<QByteArray> parts = buffer.mid(headerEnd + 4, bodySize).split('/');
+            buffer.remove(0, headerEnd + 4 + bodySize);
+
+            QStringList command;
+            foreach(const QByteArray& part, parts)
+                command << QString::fromUtf8(QByteArray::fromPercentEncoding(part));
+
+            commands << command.join('/');
+
+            QByteArray result = "\"OK\"";
+            if(command.first() == "EVAL")
+            {
+                QStringList results;
+                for(int i = 3; i < command.size(); i += command.at(i).toInt() + 1)
+                    results << "\"OK\"";
+
+                result = "[" + results.join(',').toUtf8() + "]";
+            }
+
+            QByteArray body = "{\"" + command.first().toUtf8() + "\":" + result + "}";
+            socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n\r\n");
+            socket->write(body);
+        }
+    }
+
+private:
+
+    QHash<QTcpSocket*, QByteArray> _buffers;
+};
+
+class WebdisTransportTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void mixedBatch();
+    void issueOrder();
+
+private:
+
+    /** Waits for the given reply to finish, returning false on timeout. */
+    bool waitFor(RedisReply* reply);
+};
+
+bool WebdisTransportTest::waitFor(RedisReply *reply)
+{
+    if(!reply->isFinished())
+    {
+        QEventLoop loop;
+        connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+        QTimer::singleShot(5000, &loop, SLOT(quit()));
+        loop.exec();
+    }
+
+    return reply->isFinished();
+}
+
+/*
+    Commands that Redis refuses to run from a script are sent on their own, splitting their batch into segments that are each sent as
+    one script, in issue order.
+*/
+void WebdisTransportTest::mixedBatch()
+{
+    WebdisServer server;
+    QVERIFY(server.isListening());
+
+    WebdisTransport transport(server.url());
+
+    QList<RedisReply*> replies;
+    replies << transport.sendCommand(QList<QByteArray>() << "SET" << "test:key" << "1");
+    replies << transport.sendCommand(QList<QByteArray>() << "GET" << "test:key");
+    replies << transport.sendCommand(QList<QByteArray>() << "CONFIG" << "GET" << "notify-keyspace-events");
+    replies << transport.sendCommand(QList<QByteArray>() << "SET" << "test:key" << "2");
+    replies << transport.sendCommand(QList<QByteArray>() << "GET" << "test:key");
+    replies << transport.sendCommand(QList<QByteArray>() << "SCRIPT" << "LOAD" << "return 1");
+    replies << transport.sendCommand(QList<QByteArray>() << "client" << "id");
+
+    foreach(RedisReply* reply, replies)
+    {
+        QVERIFY(waitFor(reply));
+        QVERIFY2(!reply->isError(), qPrintable(reply->errorString()));
+    }
+
+    QCOMPARE(server.commands.size(), 5);
+    QVERIFY(server.commands.at(0).startsWith("EVAL/"));
+    QVERIFY(server.commands.at(0).endsWith("/0/3/SET/test:key/1/2/GET/test:key"));
+    QCOMPARE(server.commands.at(1), QString("CONFIG/GET/notify-keyspace-events"));
+    QVERIFY(server.commands.at(2).startsWith("EVAL/"));
+    QVERIFY(server.commands.at(2).endsWith("/0/3/SET/test:key/2/2/GET/test:key"));
+    QCOMPARE(server.commands.at(3), QString("SCRIPT/LOAD/return 1"));
+    QCOMPARE(server.commands.at(4), QString("client/id"));
+
+    qDeleteAll(replies);
+}
+
+/*
+    Commands reach the server in the order they were issued, even when later batches are flushed while earlier requests are still in
+    flight.
+*/
+void WebdisTransportTest::issueOrder()
+{
+    WebdisServer server;
+    QVERIFY(server.isListening());
+
+    WebdisTransport transport(server.url());
+
+    QList<RedisReply*> replies;
+    QStringList expected;
+
+    for(int i = 0; i < 10; ++i)
+    {
+        QByteArray key = "test:" + QByteArray::number(i);
+        QByteArray name = "client" + QByteArray::number(i);
+
+        replies << transport.sendCommand(QList<QByteArray>() << "SET" << key << "1");
+        replies << transport.sendCommand(QList<QByteArray>() << "CLIENT" << "SETNAME" << name);
+        expected << QString::fromUtf8("SET/" + key + "/1") << QString::fromUtf8("CLIENT/SETNAME/" + name);
+
+        // Flush this pair as its own batch.
+        QTest::qWait(1);
+    }
+
+    foreach(RedisReply* reply, replies)
+    {
+        QVERIFY(waitFor(reply));
+        QVERIFY2(!reply->isError(), qPrintable(reply->errorString()));
+    }
+
+    QCOMPARE(server.commands, expected);
+
+    qDeleteAll(replies);
+}
+
+QTEST_GUILESS_MAIN(WebdisTransportTest)
+
+#include "tst_webdistransport.moc"
@@ -0,0 +1,7 @@
+TARGET = tst_webdistransport
+
+include(../../benchmarks/common/common.pri)
+
+CONFIG += testcase
+
+SOURCES += tst_webdistransport.cpp